@@ -0,0 +1,115 @@
+#!/usr/bin/env python2
+# Copyright (c) 2014 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Benchmark the rollback of the Omni Core databases after a reorganization
+#
+# Fills blocks with Omni transactions, then invalidates the chain at several
+# depths. The databases are rolled back, when the replacement block is
+# connected, and the time spent on the rollback is read from the line
+# "Rolled back the databases to block ... in ... ms" of omnicore.log, so the
+# mining of the replacement block is not measured.
+#
+# Requires a build with wallet support, and isn't part of the default RPC tests,
+# because it runs for a few minutes. To run it:
+#
+#   ./configure --enable-wallet && make
+#   qa/rpc-tests/omni_reorgrollback.py --srcdir=src
+#
+# The rollback is also measured by the benchmarks RollbackDepth* of
+# bench_omnicore, which don't need a wallet or a running node.
+#
+
+from test_framework import BitcoinTestFramework
+from bitcoinrpc.authproxy import AuthServiceProxy, JSONRPCException
+from util import *
+import os
+import re
+
+BLOCKS = 50
+SENDS_PER_BLOCK = 20
+DEPTHS = [1, 2, 5, 10, 20, 40]
+
+class OmniReorgRollbackTest(BitcoinTestFramework):
+
+    def rollbacks(self):
+        logfile = os.path.join(self.options.tmpdir, "node0", "regtest", "omnicore.log")
+        entries = []
+        with open(logfile, 'r') as f:
+            for line in f:
+                match = re.search(r"Rolled back the databases to block (\d+) in ([0-9.]+) ms", line)
+                if match:
+                    entries.append((int(match.group(1)), float(match.group(2))))
+        return entries
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self):
+        self.nodes = []
+        self.is_network_split = False
+        self.nodes.append(start_node(0, self.options.tmpdir, ["-debug", "-omnidebug=none"]))
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        print "Mine 101 blocks and fund the issuer"
+        node.setgenerate(True, 101)
+        issuer = node.getnewaddress()
+        for i in xrange(SENDS_PER_BLOCK + 1):
+            node.sendtoaddress(issuer, 1.0)
+        node.setgenerate(True, 1)
+
+        print "Create tokens in the test ecosystem"
+        node.omni_sendissuancefixed(issuer, 2, 1, 0, "", "", "Bench", "", "", "1000000000")
+        node.setgenerate(True, 1)
+        propertyId = 2147483651
+        assert(node.omni_getbalance(issuer, propertyId)["balance"] == "1000000000")
+
+        print "Mine %d blocks with %d sends each" % (BLOCKS, SENDS_PER_BLOCK)
+        receivers = [node.getnewaddress() for i in xrange(SENDS_PER_BLOCK)]
+        for block in xrange(BLOCKS):
+            for receiver in receivers:
+                node.omni_send(issuer, receiver, propertyId, "1")
+            node.setgenerate(True, 1)
+            # keep enough confirmed outputs for the sends of the next block
+            node.sendtoaddress(issuer, 1.0)
+
+        tip = node.getblockcount()
+        tiphash = node.getbestblockhash()
+        print "Chain height: %d, Omni transactions: %d" % (tip, BLOCKS * SENDS_PER_BLOCK + 1)
+
+        print "%8s %16s" % ("depth", "rollback (ms)")
+        for depth in DEPTHS:
+            if depth >= BLOCKS:
+                break
+            height = tip - depth + 1
+            oldhash = node.getblockhash(height)
+
+            before = len(self.rollbacks())
+            node.invalidateblock(oldhash)
+            node.setgenerate(True, 1)
+            entries = self.rollbacks()
+            assert(len(entries) == before + 1)
+            # the rollback runs, when the replacement block at the height of the
+            # invalidated block is connected, and keeps the records up to its parent
+            block, elapsed = entries[-1]
+            assert(block == height - 1)
+            print "%8d %16.3f" % (depth, elapsed)
+
+            # restore the original chain for the next run
+            node.invalidateblock(node.getbestblockhash())
+            node.reconsiderblock(oldhash)
+            assert(node.getblockcount() == tip)
+            assert(node.getbestblockhash() == tiphash)
+
+        print "Verify the state after the reorganizations"
+        assert(node.omni_getbalance(issuer, propertyId)["balance"] == str(1000000000 - BLOCKS * SENDS_PER_BLOCK))
+        for receiver in receivers:
+            assert(node.omni_getbalance(receiver, propertyId)["balance"] == str(BLOCKS))
+
+if __name__ == '__main__':
+    OmniReorgRollbackTest().main()
@@ -223,6 +223,7 @@ void SyncWithWallets(const CTransaction &tx, const CBlock *pblock) {
 int mastercore_handler_disc_begin(int nBlockNow, CBlockIndex const * pBlockIndex);
 int mastercore_handler_disc_end(int nBlockNow, CBlockIndex const * pBlockIndex);
 int mastercore_handler_block_begin(int nBlockNow, CBlockIndex const * pBlockIndex);
+int mastercore_handler_block_prepare(int nBlockPrev, CBlockIndex const * pBlockIndex, const CBlock& block);
 int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex, unsigned int);
 int mastercore_handler_tx(const CTransaction &tx, int nBlock, unsigned int idx, CBlockIndex const * pBlockIndex);
 
@@ -2048,6 +2049,10 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     LogPrint("handler", "Omni Core handler: block connect begin [height: %d]\n", GetHeight());
     mastercore_handler_block_begin(GetHeight(), pindexNew);
 
+    //! Omni Core: resolve transaction inputs and parse transactions ahead of their execution
+    LogPrint("handler", "Omni Core handler: block connect prepare [height: %d]\n", GetHeight());
+    mastercore_handler_block_prepare(GetHeight(), pindexNew, *pblock);
+
     // Remove conflicting transactions from the mempool.
     list<CTransaction> txConflicted;
     mempool.removeForBlock(pblock->vtx, pindexNew->nHeight, txConflicted);
@@ -0,0 +1,88 @@
+#include "omnicore/bench/bench.h"
+
+#include "omnicore/log.h"
+
+#include "utiltime.h"
+
+#include <stdint.h>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+
+using namespace benchmark;
+
+/** Returns the registered benchmarks, sorted by name. */
+static std::map<std::string, BenchFunction>& GetBenchmarks()
+{
+    static std::map<std::string, BenchFunction> benchmarks;
+    return benchmarks;
+}
+
+State::State(const std::string& nameIn, int64_t nMaxElapsedIn)
+  : name(nameIn), nMaxElapsed(nMaxElapsedIn), fStarted(false), nTimeBegin(0), nTimeLast(0),
+    nCount(0), nBatchSize(1), nBatchCount(0), dMinTime(std::numeric_limits<double>::max()), dMaxTime(0.0)
+{
+}
+
+/**
+ * The clock is read once per batch of iterations, so short iterations can be measured
+ * with a clock of microsecond resolution. The batch size doubles, until a batch takes at
+ * least a sixteenth of the time of the benchmark. Only batches of that length count for
+ * the reported minimum and maximum, which are the averages of the fastest and the
+ * slowest batch.
+ */
+bool State::KeepRunning()
+{
+    if (!fStarted) {
+        fStarted = true;
+        nTimeBegin = nTimeLast = GetTimeMicros();
+        return true;
+    }
+
+    ++nCount;
+    if (++nBatchCount < nBatchSize) {
+        return true;
+    }
+
+    int64_t nTimeNow = GetTimeMicros();
+    int64_t nBatchElapsed = nTimeNow - nTimeLast;
+    if (nBatchElapsed * 16 < nMaxElapsed) {
+        nBatchSize *= 2;
+    } else {
+        double dElapsed = double(nBatchElapsed) / nBatchCount;
+        if (dElapsed < dMinTime) dMinTime = dElapsed;
+        if (dElapsed > dMaxTime) dMaxTime = dElapsed;
+    }
+    nBatchCount = 0;
+    nTimeLast = nTimeNow;
+
+    if (nTimeNow - nTimeBegin < nMaxElapsed) {
+        return true;
+    }
+
+    double dAverage = double(nTimeNow - nTimeBegin) / nCount;
+    if (dMaxTime == 0.0) {
+        dMinTime = dMaxTime = dAverage;
+    }
+    PrintToConsole("%s, %d, %.3f, %.3f, %.3f%s\n", name, nCount, dMinTime, dMaxTime, dAverage,
+            strNote.empty() ? "" : ", " + strNote);
+    return false;
+}
+
+BenchRunner::BenchRunner(const std::string& name, BenchFunction func)
+{
+    GetBenchmarks().insert(std::make_pair(name, func));
+}
+
+void BenchRunner::RunAll(const std::string& strFilter, int64_t nMaxElapsed)
+{
+    PrintToConsole("# Benchmark, iterations, min us, max us, average us\n");
+
+    std::map<std::string, BenchFunction>& benchmarks = GetBenchmarks();
+    for (std::map<std::string, BenchFunction>::iterator it = benchmarks.begin(); it != benchmarks.end(); ++it) {
+        if (it->first.find(strFilter) == std::string::npos) continue;
+        State state(it->first, nMaxElapsed);
+        it->second(state);
+    }
+}
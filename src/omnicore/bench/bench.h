@@ -0,0 +1,74 @@
+#ifndef OMNICORE_BENCH_BENCH_H
+#define OMNICORE_BENCH_BENCH_H
+
+#include <stdint.h>
+#include <string>
+
+#include <boost/function.hpp>
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+/**
+ * A minimal timing harness for Omni Core.
+ *
+ * A benchmark does its setup, and then runs the code to measure in a loop:
+ *
+ *     static void MetaDExAddOrder(benchmark::State& state)
+ *     {
+ *         ... setup, not measured ...
+ *         while (state.KeepRunning()) {
+ *             ... measured ...
+ *         }
+ *     }
+ *     BENCHMARK(MetaDExAddOrder);
+ *
+ * Each benchmark runs for about the time given by -time, and bench_omnicore reports
+ * the number of iterations, as well as the fastest, slowest and average iteration.
+ */
+namespace benchmark
+{
+/** Counts and times the iterations of one benchmark. */
+class State
+{
+private:
+    std::string name;
+    int64_t nMaxElapsed;
+    bool fStarted;
+    int64_t nTimeBegin;
+    int64_t nTimeLast;
+    //! Number of completed iterations
+    int64_t nCount;
+    //! Number of iterations between two reads of the clock
+    int64_t nBatchSize;
+    int64_t nBatchCount;
+    double dMinTime;
+    double dMaxTime;
+    std::string strNote;
+
+public:
+    State(const std::string& nameIn, int64_t nMaxElapsedIn);
+
+    /** Returns true, as long as another iteration should be run, and prints the results otherwise. */
+    bool KeepRunning();
+
+    /** Adds a result, which isn't a duration, such as the memory usage, to the report. */
+    void SetNote(const std::string& note) { strNote = note; }
+};
+
+typedef boost::function<void(State&)> BenchFunction;
+
+/** Registers benchmarks at startup, and runs them. */
+class BenchRunner
+{
+public:
+    BenchRunner(const std::string& name, BenchFunction func);
+
+    /** Runs the benchmarks whose name contains the filter, each for about the given number of microseconds. */
+    static void RunAll(const std::string& strFilter, int64_t nMaxElapsed);
+};
+}
+
+#define BENCHMARK(n) \
+    static benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n);
+
+#endif // OMNICORE_BENCH_BENCH_H
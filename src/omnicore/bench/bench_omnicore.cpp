@@ -0,0 +1,52 @@
+#include "omnicore/bench/bench.h"
+
+#include "chainparams.h"
+#include "chainparamsbase.h"
+#include "main.h"
+#include "ui_interface.h"
+#include "util.h"
+#ifdef ENABLE_WALLET
+#include "wallet.h"
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+CClientUIInterface uiInterface;
+CWallet* pwalletMain;
+
+void Shutdown(void* parg)
+{
+    exit(0);
+}
+
+void StartShutdown()
+{
+    exit(0);
+}
+
+bool ShutdownRequested()
+{
+    return false;
+}
+
+/**
+ * Runs the benchmarks of Omni Core.
+ *
+ * Options:
+ *   -filter=<name>  Only run benchmarks, whose name contains <name>
+ *   -time=<ms>      Run each benchmark for about <ms> milliseconds (default: 1000)
+ *
+ * Benchmarks may define further options of their own.
+ */
+int main(int argc, char* argv[])
+{
+    SetupEnvironment();
+    ParseParameters(argc, argv);
+    fPrintToDebugLog = false; // don't want to write to debug.log file
+    SelectParams(CBaseChainParams::MAIN);
+
+    benchmark::BenchRunner::RunAll(GetArg("-filter", ""), GetArg("-time", 1000) * 1000);
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "omnicore/bench/bench.h"
+
+#include "omnicore/mdex.h"
+#include "omnicore/mdexmath.h"
+#include "omnicore/uint256_extensions.h"
+
+#include "random.h"
+#include "uint256.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+using namespace mastercore;
+
+//! Number of random amounts, the benchmarks cycle through
+static const size_t AMOUNTS = 1024;
+
+//! Keeps the results, so the calculations are not optimized out
+static volatile int64_t nResultSink;
+
+/** Returns random positive amounts, with a random number of significant bits. */
+static std::vector<int64_t> CreateAmounts()
+{
+    seed_insecure_rand(true);
+    std::vector<int64_t> vAmounts;
+    for (size_t n = 0; n < AMOUNTS + 3; ++n) {
+        uint64_t value = (static_cast<uint64_t>(insecure_rand()) << 32) | insecure_rand();
+        value = (value >> 1) >> (insecure_rand() % 63);
+        vAmounts.push_back((value > 0) ? static_cast<int64_t>(value) : 1);
+    }
+    return vAmounts;
+}
+
+/** Compares the unit prices of two orders as rational_t, as CMPMetaDEx::unitPrice() returns them. */
+static void PriceCompareRational(benchmark::State& state)
+{
+    std::vector<int64_t> vAmounts = CreateAmounts();
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        rational_t a(vAmounts[n], vAmounts[n+1]);
+        rational_t b(vAmounts[n+2], vAmounts[n+3]);
+        nResultSink = (a < b);
+        if (++n == AMOUNTS) n = 0;
+    }
+}
+
+/** Compares the unit prices of two orders as md_Price. */
+static void PriceCompareFixed(benchmark::State& state)
+{
+    std::vector<int64_t> vAmounts = CreateAmounts();
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        md_Price a(vAmounts[n], vAmounts[n+1]);
+        md_Price b(vAmounts[n+2], vAmounts[n+3]);
+        nResultSink = (a < b);
+        if (++n == AMOUNTS) n = 0;
+    }
+}
+
+/** Calculates floor(a * b / c) with uint256, as the amounts to fill used to be calculated. */
+static void FillAmountUint256(benchmark::State& state)
+{
+    std::vector<int64_t> vAmounts = CreateAmounts();
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        uint256 result = ConvertTo256(vAmounts[n]) * ConvertTo256(vAmounts[n+1]) / ConvertTo256(vAmounts[n+2]);
+        nResultSink = result.GetLow64();
+        if (++n == AMOUNTS) n = 0;
+    }
+}
+
+/** Calculates floor(a * b / c) with MultiplyAndDivide(). */
+static void FillAmountKernel(benchmark::State& state)
+{
+    std::vector<int64_t> vAmounts = CreateAmounts();
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        int64_t result = 0;
+        MultiplyAndDivide(vAmounts[n], vAmounts[n+1], vAmounts[n+2], result);
+        nResultSink = result;
+        if (++n == AMOUNTS) n = 0;
+    }
+}
+
+BENCHMARK(PriceCompareRational);
+BENCHMARK(PriceCompareFixed);
+BENCHMARK(FillAmountUint256);
+BENCHMARK(FillAmountKernel);
@@ -0,0 +1,300 @@
+#include "omnicore/bench/bench.h"
+
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/mdex.h"
+#include "omnicore/omnicore.h"
+#include "omnicore/rpctxobject.h"
+#include "omnicore/sp.h"
+#include "omnicore/tally.h"
+
+#include "random.h"
+#include "sync.h"
+#include "tinyformat.h"
+#include "uint256.h"
+#include "util.h"
+
+#include "json/json_spirit_value.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace mastercore;
+
+//! Number of price levels per market
+static const int BOOK_LEVELS = 500;
+
+/**
+ * Fills the order book with orders selling property 3 for the properties 5, 6, 7, ...
+ * at many price levels. Every order asks for at least 1000 units per unit of property 3.
+ */
+static void CreateOrderBook(uint32_t nMarkets)
+{
+    ClearTallyMap();
+    MetaDEx_CLEAR();
+
+    int block = 100000;
+    for (uint32_t n = 0; n < nMarkets; ++n) {
+        for (int level = 0; level < BOOK_LEVELS; ++level) {
+            unsigned int idx = n * BOOK_LEVELS + level + 1;
+            update_tally_map("1Seller", 3, 1000, BALANCE);
+            MetaDEx_ADD("1Seller", 3, 1000, block, 5 + n, 1000000 + level * 1000, MakeTxid(block, idx), idx);
+        }
+    }
+}
+
+/**
+ * Places orders selling property 5 for property 3, which don't cross the order book.
+ *
+ * Only the market of property 3 for property 5 is relevant for matching, while the book
+ * of property 3 may hold orders of other markets. The orders placed by the benchmark
+ * stay in the book.
+ */
+static void AddOrders(benchmark::State& state, uint32_t nMarkets)
+{
+    LOCK(cs_tally);
+    CreateOrderBook(nMarkets);
+    update_tally_map("1Buyer", 5, 1000000000000LL, BALANCE);
+
+    int block = 200000;
+    unsigned int idx = 0;
+    while (state.KeepRunning()) {
+        ++idx;
+        MetaDEx_ADD("1Buyer", 5, 100, block, 3, 1, MakeTxid(block, idx), idx);
+    }
+
+    ClearTallyMap();
+    MetaDEx_CLEAR();
+}
+
+/** Places orders, while property 3 is only offered for property 5. */
+static void MetaDExAddOrderOneMarket(benchmark::State& state)
+{
+    AddOrders(state, 1);
+}
+
+/** Places orders, while property 3 is offered for 20 properties. */
+static void MetaDExAddOrderManyMarkets(benchmark::State& state)
+{
+    AddOrders(state, 20);
+}
+
+//! Number of orders per price level of the matched market
+static const int MATCH_ORDERS_PER_LEVEL = 2;
+//! Number of units of property 3 offered by each order of the matched market
+static const int64_t MATCH_ORDER_AMOUNT = 1000;
+//! Number of units of property 3 bought by each incoming order, which fills several orders
+static const int64_t MATCH_FILL_AMOUNT = 7500;
+//! Number of other markets of property 3, which share the price levels of the matched market
+static const uint32_t MATCH_OTHER_MARKETS = 20;
+
+/**
+ * Trade database, which is closed after it was created, so recording matched trades does
+ * nothing, and only the order book is measured.
+ */
+class CClosedTradeList : public CMPTradeList
+{
+public:
+    explicit CClosedTradeList(const boost::filesystem::path& path) : CMPTradeList(path, true)
+    {
+        Close();
+    }
+};
+
+/**
+ * Provides empty trade, transaction and property databases in a temporary directory,
+ * which are used when orders are matched, or their status is queried.
+ */
+class DatabaseScope
+{
+private:
+    boost::filesystem::path path;
+
+public:
+    explicit DatabaseScope(bool fRecordTrades) : path(GetTempPath() / strprintf("bench_omnicore_%d", GetRand(100000000)))
+    {
+        boost::filesystem::create_directories(path);
+        if (fRecordTrades) {
+            t_tradelistdb = new CMPTradeList(path / "MP_tradelist", true);
+        } else {
+            t_tradelistdb = new CClosedTradeList(path / "MP_tradelist");
+        }
+        p_txlistdb = new CMPTxList(path / "MP_txlist", true);
+        _my_sps = new CMPSPInfo(path / "MP_spinfo", true);
+    }
+
+    ~DatabaseScope()
+    {
+        delete t_tradelistdb;
+        t_tradelistdb = NULL;
+        delete p_txlistdb;
+        p_txlistdb = NULL;
+        delete _my_sps;
+        _my_sps = NULL;
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(path, ec);
+    }
+};
+
+/** Returns the number of orders of the matched market, which can be set via -metadexorders. */
+static uint32_t GetNumberOfMatchOrders()
+{
+    return std::max<int64_t>(GetArg("-metadexorders", 1000000), MATCH_ORDERS_PER_LEVEL);
+}
+
+/** Returns the price in units of property 5 per unit of property 3 of an order of the matched market. */
+static int64_t GetMatchPrice(uint32_t nOrder)
+{
+    return 1000 + nOrder / MATCH_ORDERS_PER_LEVEL;
+}
+
+/**
+ * Fills the order book with orders selling property 3 for property 5, at increasing prices,
+ * and optionally with the same number of orders selling property 3 for other properties at
+ * the same price levels.
+ */
+static void CreateMatchOrderBook(uint32_t nOrders, bool fOtherMarkets)
+{
+    ClearTallyMap();
+    MetaDEx_CLEAR();
+
+    int block = 100000;
+    unsigned int idx = 0;
+    for (uint32_t n = 0; n < nOrders; ++n) {
+        int64_t nPrice = GetMatchPrice(n);
+        update_tally_map("1Seller", 3, MATCH_ORDER_AMOUNT, BALANCE);
+        MetaDEx_ADD("1Seller", 3, MATCH_ORDER_AMOUNT, block, 5, MATCH_ORDER_AMOUNT * nPrice, MakeTxid(block, ++idx), idx);
+        if (fOtherMarkets) {
+            uint32_t propertyDesired = 6 + n % MATCH_OTHER_MARKETS;
+            update_tally_map("1Seller", 3, MATCH_ORDER_AMOUNT, BALANCE);
+            MetaDEx_ADD("1Seller", 3, MATCH_ORDER_AMOUNT, block, propertyDesired, MATCH_ORDER_AMOUNT * nPrice, MakeTxid(block, ++idx), idx);
+        }
+    }
+}
+
+/**
+ * Places orders selling property 5 for property 3, which are filled by the order book.
+ *
+ * Each order buys 7.5 orders' worth of property 3, so it fully fills the orders at the
+ * front of the book, which spans several price levels, and partially fills the last one.
+ * The order pays exactly the price of the orders, so it doesn't stay in the book. The
+ * book holds enough orders for one matching order per 7.5 orders of the matched market.
+ */
+static void MatchOrders(benchmark::State& state, bool fOtherMarkets)
+{
+    LOCK(cs_tally);
+    DatabaseScope databases(false);
+    const uint32_t nOrders = GetNumberOfMatchOrders();
+    CreateMatchOrderBook(nOrders, fOtherMarkets);
+    update_tally_map("1Buyer", 5, 1000000000000000000LL, BALANCE);
+    state.SetNote(strprintf("%d orders in the book", fOtherMarkets ? 2 * nOrders : nOrders));
+
+    // the next order of the matched market to be filled, and its remaining amount
+    uint32_t nOrder = 0;
+    int64_t nRemaining = MATCH_ORDER_AMOUNT;
+
+    int block = 200000;
+    unsigned int idx = 0;
+    while (state.KeepRunning()) {
+        int64_t nPayment = 0;
+        int64_t nPrice = 0;
+        for (int64_t nWanted = MATCH_FILL_AMOUNT; nWanted > 0;) {
+            nPrice = GetMatchPrice(nOrder);
+            int64_t nFill = std::min(nWanted, nRemaining);
+            nPayment += nFill * nPrice;
+            nWanted -= nFill;
+            nRemaining -= nFill;
+            if (nRemaining == 0) {
+                ++nOrder;
+                nRemaining = MATCH_ORDER_AMOUNT;
+            }
+        }
+        // the price limit covers the most expensive order to be filled
+        ++idx;
+        MetaDEx_ADD("1Buyer", 5, nPayment, block, 3, nPayment / nPrice, MakeTxid(block, idx), idx);
+    }
+
+    ClearTallyMap();
+    MetaDEx_CLEAR();
+}
+
+/** Matches orders, while property 3 is only offered for property 5. */
+static void MetaDExMatchOneMarket(benchmark::State& state)
+{
+    MatchOrders(state, false);
+}
+
+/** Matches orders, while property 3 is also offered for 20 other properties at the same prices. */
+static void MetaDExMatchManyMarkets(benchmark::State& state)
+{
+    MatchOrders(state, true);
+}
+
+/** Looks up open orders by transaction hash, while the order book holds 10000 orders. */
+static void MetaDExRetrieveTrade(benchmark::State& state)
+{
+    LOCK(cs_tally);
+    CreateOrderBook(20);
+
+    std::vector<uint256> vTxids;
+    for (unsigned int idx = 1; idx <= 20 * BOOK_LEVELS; ++idx) {
+        vTxids.push_back(MakeTxid(100000, idx));
+    }
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        MetaDEx_RetrieveTrade(vTxids[n]);
+        if (++n == vTxids.size()) n = 0;
+    }
+
+    ClearTallyMap();
+    MetaDEx_CLEAR();
+}
+
+/**
+ * Queries the status of orders, as omni_gettransaction and omni_gettradehistoryforaddress
+ * do for each trade, while the order book holds 100000 orders.
+ *
+ * The orders are recorded as valid transactions without matches, so their status is
+ * determined by locating them in the order book, and they are reported as open. They are
+ * queried in a random order.
+ */
+static void MetaDExTradeStatus(benchmark::State& state)
+{
+    LOCK(cs_tally);
+    DatabaseScope databases(true);
+    CreateOrderBook(200);
+
+    std::vector<uint256> vTxids;
+    for (unsigned int idx = 1; idx <= 200 * BOOK_LEVELS; ++idx) {
+        vTxids.push_back(MakeTxid(100000, idx));
+        p_txlistdb->recordTX(vTxids.back(), true, 100000, MSC_TYPE_METADEX_TRADE, 1000);
+    }
+    seed_insecure_rand(true);
+    for (size_t n = vTxids.size() - 1; n > 0; --n) {
+        std::swap(vTxids[n], vTxids[insecure_rand() % (n + 1)]);
+    }
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        json_spirit::Object txobj;
+        populateRPCExtendedTypeMetaDExTrade(vTxids[n], 3, 1000, txobj);
+        if (++n == vTxids.size()) n = 0;
+    }
+
+    ClearTallyMap();
+    MetaDEx_CLEAR();
+}
+
+BENCHMARK(MetaDExAddOrderOneMarket);
+BENCHMARK(MetaDExAddOrderManyMarkets);
+BENCHMARK(MetaDExMatchOneMarket);
+BENCHMARK(MetaDExMatchManyMarkets);
+BENCHMARK(MetaDExRetrieveTrade);
+BENCHMARK(MetaDExTradeStatus);
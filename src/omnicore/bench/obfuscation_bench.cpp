@@ -0,0 +1,48 @@
+#include "omnicore/bench/bench.h"
+
+#include "omnicore/utils.h"
+
+#include "utilstrencodings.h"
+
+#include <string>
+#include <vector>
+
+//! Sender of the benchmarked transactions
+static const std::string SENDER = "1CdighsfdfRcj4ytQSskZgQXbUEamuMUNF";
+//! Number of packets of a typical Class B transaction
+static const unsigned int PACKETS = 3;
+
+/** Generates all 255 hashes as hex strings, and decodes the ones needed, as Class B parsing used to. */
+static void ObfuscationHashesStrings(benchmark::State& state)
+{
+    std::string vstrHashes[1+MAX_SHA256_OBFUSCATION_TIMES];
+    std::vector<unsigned char> vchHash;
+    while (state.KeepRunning()) {
+        PrepareObfuscatedHashes(SENDER, vstrHashes);
+        for (unsigned int n = 1; n <= PACKETS; ++n) {
+            vchHash = ParseHex(vstrHashes[n]);
+        }
+    }
+}
+
+/** Generates only the hashes needed in binary form. */
+static void ObfuscationHashesBinary(benchmark::State& state)
+{
+    std::vector<unsigned char> vchHashes;
+    while (state.KeepRunning()) {
+        PrepareObfuscatedHashes(SENDER, PACKETS, vchHashes);
+    }
+}
+
+/** Retrieves the hashes needed of a sender, whose hashes are cached. */
+static void ObfuscationHashesCached(benchmark::State& state)
+{
+    std::vector<unsigned char> vchHashes;
+    while (state.KeepRunning()) {
+        GetObfuscatedHashes(SENDER, PACKETS, vchHashes);
+    }
+}
+
+BENCHMARK(ObfuscationHashesStrings);
+BENCHMARK(ObfuscationHashesBinary);
+BENCHMARK(ObfuscationHashesCached);
@@ -0,0 +1,96 @@
+#include "omnicore/bench/bench.h"
+
+#include "omnicore/createpayload.h"
+#include "omnicore/encoding.h"
+#include "omnicore/omnicore.h"
+#include "omnicore/rules.h"
+#include "omnicore/tx.h"
+
+#include "base58.h"
+#include "coins.h"
+#include "primitives/transaction.h"
+#include "pubkey.h"
+#include "script/script.h"
+#include "script/standard.h"
+#include "utilstrencodings.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace mastercore;
+
+//! Sender of the benchmarked transactions
+static const std::string SENDER = "1ARjWDkZ7kT9fwjPrjcQyvbXDkEySzKHwu";
+
+/** Creates a transaction with the given outputs, which spends an output of the sender. */
+static CTransaction CreateTransaction(const std::vector<std::pair<CScript, int64_t> >& vecOutputs)
+{
+    CMutableTransaction inputTx;
+    inputTx.vout.push_back(CTxOut(5000000, GetScriptForDestination(CBitcoinAddress(SENDER).Get())));
+    CTransaction prevTx(inputTx);
+
+    // the input is resolved via the coins view
+    CCoinsModifier coins = view.ModifyCoins(prevTx.GetHash());
+    coins->vout.resize(1);
+    coins->vout[0] = inputTx.vout[0];
+
+    CMutableTransaction mutableTx;
+    mutableTx.vin.push_back(CTxIn(prevTx.GetHash(), 0));
+    for (std::vector<std::pair<CScript, int64_t> >::const_iterator it = vecOutputs.begin(); it != vecOutputs.end(); ++it) {
+        mutableTx.vout.push_back(CTxOut(it->second, it->first));
+    }
+
+    return CTransaction(mutableTx);
+}
+
+/** Returns the payload of a property issuance, which spans several Class B packets. */
+static std::vector<unsigned char> CreateIssuancePayload()
+{
+    return CreatePayload_IssuanceFixed(1, 1, 0, "Companies", "Bitcoin Mining", "Quantum Miner", "www.example.com",
+            "Quantum Miner Tokens", 1000000);
+}
+
+/** Parses a simple send, which is embedded in a Class C transaction. */
+static void ParseClassC(benchmark::State& state)
+{
+    std::vector<std::pair<CScript, int64_t> > vecOutputs;
+    OmniCore_Encode_ClassC(CreatePayload_SimpleSend(1, 100000000), vecOutputs);
+    CTransaction tx = CreateTransaction(vecOutputs);
+
+    const int nBlock = ConsensusParams().NULLDATA_BLOCK;
+    CMPTransaction mptxCheck;
+    int rc = ParseTransaction(tx, nBlock, 1, mptxCheck);
+    assert(rc == 0);
+
+    while (state.KeepRunning()) {
+        CMPTransaction mptx;
+        ParseTransaction(tx, nBlock, 1, mptx);
+    }
+}
+
+/** Parses a property issuance, which is embedded in a Class B transaction. */
+static void ParseClassB(benchmark::State& state)
+{
+    std::vector<unsigned char> vchPubKey = ParseHex("02619c30f643a4679ec2f690f3d6564df7df2ae23ae4a55393ae0bef22db9dbcaf");
+    CPubKey pubKey(vchPubKey.begin(), vchPubKey.end());
+
+    std::vector<std::pair<CScript, int64_t> > vecOutputs;
+    OmniCore_Encode_ClassB(SENDER, pubKey, CreateIssuancePayload(), vecOutputs);
+    CTransaction tx = CreateTransaction(vecOutputs);
+
+    const int nBlock = ConsensusParams().NULLDATA_BLOCK;
+    CMPTransaction mptxCheck;
+    int rc = ParseTransaction(tx, nBlock, 1, mptxCheck);
+    assert(rc == 0);
+
+    while (state.KeepRunning()) {
+        CMPTransaction mptx;
+        ParseTransaction(tx, nBlock, 1, mptx);
+    }
+}
+
+BENCHMARK(ParseClassC);
+BENCHMARK(ParseClassB);
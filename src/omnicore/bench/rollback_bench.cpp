@@ -0,0 +1,152 @@
+#include "omnicore/bench/bench.h"
+
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/omnicore.h"
+
+#include "random.h"
+#include "sync.h"
+#include "tinyformat.h"
+#include "uint256.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+
+using namespace mastercore;
+
+//! Number of simple sends per block, as in the RPC test omni_reorgrollback.py
+static const int ROLLBACK_SENDS_PER_BLOCK = 20;
+//! Number of new and matched MetaDEx trades per block
+static const int ROLLBACK_TRADES_PER_BLOCK = 2;
+//! Number of receivers of the one send to owners per block
+static const int ROLLBACK_STO_RECEIVERS = 10;
+//! Height of the first block of the synthetic history
+static const int ROLLBACK_FIRST_BLOCK = 300000;
+
+/** Provides empty transaction, trade and STO databases in a temporary directory. */
+class RollbackDatabaseScope
+{
+private:
+    boost::filesystem::path path;
+
+public:
+    RollbackDatabaseScope() : path(GetTempPath() / strprintf("bench_omnicore_%d", GetRand(100000000)))
+    {
+        boost::filesystem::create_directories(path);
+        p_txlistdb = new CMPTxList(path / "MP_txlist", true);
+        t_tradelistdb = new CMPTradeList(path / "MP_tradelist", true);
+        s_stolistdb = new CMPSTOList(path / "MP_stolist", true);
+    }
+
+    ~RollbackDatabaseScope()
+    {
+        delete p_txlistdb;
+        p_txlistdb = NULL;
+        delete t_tradelistdb;
+        t_tradelistdb = NULL;
+        delete s_stolistdb;
+        s_stolistdb = NULL;
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(path, ec);
+    }
+};
+
+/** Returns the number of blocks of the synthetic history, which can be set via -rollbackblocks. */
+static int GetNumberOfRollbackBlocks()
+{
+    return std::max<int64_t>(GetArg("-rollbackblocks", 10000), 100);
+}
+
+/** Records the transactions, trades and STO receipts of one block, in one batch per database, as a connected block does. */
+static void RecordBlock(int block)
+{
+    p_txlistdb->BeginBatch();
+    t_tradelistdb->BeginBatch();
+    s_stolistdb->BeginBatch();
+
+    unsigned int idx = 0;
+    for (int n = 0; n < ROLLBACK_SENDS_PER_BLOCK; ++n) {
+        p_txlistdb->recordTX(MakeTxid(block, ++idx), true, block, 0, 1);
+    }
+    for (int n = 0; n < ROLLBACK_TRADES_PER_BLOCK; ++n) {
+        uint256 txidNew = MakeTxid(block, ++idx);
+        uint256 txidOld = MakeTxid(block - 1, idx);
+        p_txlistdb->recordTX(txidNew, true, block, 25, 1);
+        t_tradelistdb->recordNewTrade(txidNew, "1Buyer", 5, 3, block, idx);
+        t_tradelistdb->recordMatchedTrade(txidOld, txidNew, "1Seller", "1Buyer", 3, 5, 1000, 1000000, block, idx);
+    }
+    uint256 txidSTO = MakeTxid(block, ++idx);
+    p_txlistdb->recordTX(txidSTO, true, block, 3, 1);
+    for (int n = 0; n < ROLLBACK_STO_RECEIVERS; ++n) {
+        s_stolistdb->recordSTOReceive(strprintf("1Owner%d", n), txidSTO, block, 3, 100);
+    }
+
+    p_txlistdb->CommitBatch();
+    t_tradelistdb->CommitBatch();
+    s_stolistdb->CommitBatch();
+}
+
+/**
+ * Rolls back the databases by the given number of blocks, as the node does, when the first
+ * block after a reorganization is connected.
+ *
+ * Each iteration rolls back, and then records the removed blocks again, so the next iteration
+ * starts with the same history. The harness reports the time of both, while the note shows
+ * the time of the rollback alone, which corresponds to the line "Rolled back the databases to
+ * block ... in ... ms" of omnicore.log.
+ */
+static void RollbackDatabases(benchmark::State& state, int nDepth)
+{
+    LOCK(cs_tally);
+    RollbackDatabaseScope databases;
+    const int nBlocks = GetNumberOfRollbackBlocks();
+    const int nTip = ROLLBACK_FIRST_BLOCK + nBlocks - 1;
+    for (int block = ROLLBACK_FIRST_BLOCK; block <= nTip; ++block) {
+        RecordBlock(block);
+    }
+
+    int64_t nRollbacks = 0;
+    int64_t nRollbackTime = 0;
+    while (state.KeepRunning()) {
+        int64_t nStart = GetTimeMicros();
+        p_txlistdb->isMPinBlockRange(nTip - nDepth + 1, nTip, true);
+        t_tradelistdb->deleteAboveBlock(nTip - nDepth);
+        s_stolistdb->deleteAboveBlock(nTip - nDepth);
+        nRollbackTime += GetTimeMicros() - nStart;
+        ++nRollbacks;
+
+        for (int block = nTip - nDepth + 1; block <= nTip; ++block) {
+            RecordBlock(block);
+        }
+        state.SetNote(strprintf("%d blocks, rollback: %.3f ms", nBlocks, 0.001 * nRollbackTime / nRollbacks));
+    }
+}
+
+/** Rolls back the last block. */
+static void RollbackDepth1(benchmark::State& state)
+{
+    RollbackDatabases(state, 1);
+}
+
+/** Rolls back the last 10 blocks. */
+static void RollbackDepth10(benchmark::State& state)
+{
+    RollbackDatabases(state, 10);
+}
+
+/** Rolls back the last 40 blocks. */
+static void RollbackDepth40(benchmark::State& state)
+{
+    RollbackDatabases(state, 40);
+}
+
+BENCHMARK(RollbackDepth1);
+BENCHMARK(RollbackDepth10);
+BENCHMARK(RollbackDepth40);
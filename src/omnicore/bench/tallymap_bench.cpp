@@ -0,0 +1,136 @@
+#include "omnicore/bench/bench.h"
+
+#include "omnicore/tally.h"
+#include "omnicore/tallymap.h"
+
+#include "hash.h"
+#include "random.h"
+#include "tinyformat.h"
+#include "uint256.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+//! Keeps the results, so the lookups are not optimized out
+static const CMPTally* volatile pResultSink;
+
+/** Creates a synthetic, canonical base58 encoded address. */
+static std::string CreateAddress(uint32_t n)
+{
+    uint256 hash = Hash(BEGIN(n), END(n));
+    CAddressKey key;
+    key.data[0] = (n % 2) ? 0x00 : 0x05;
+    memcpy(key.data + 1, hash.begin(), CAddressKey::SIZE - 1);
+    return key.ToString();
+}
+
+/**
+ * Estimates the memory usage of the synthetic state with the previous layout, a
+ * std::map<std::string, CMPTally> with a std::map<uint32_t, BalanceRecord> per tally.
+ *
+ * A tree node has a header of three pointers and the color, and each string above the
+ * small string capacity is allocated separately.
+ */
+static size_t EstimateMapUsage(size_t nAddresses, size_t nTokens, size_t nAddressLength)
+{
+    const size_t nNodeHeader = 4 * sizeof(void*);
+    const size_t nTallySize = sizeof(std::map<uint32_t, int64_t>) + sizeof(void*);
+    const size_t nRecordSize = sizeof(uint32_t) + 4 + TALLY_TYPE_COUNT * sizeof(int64_t);
+
+    size_t nPerAddress = nNodeHeader + sizeof(std::string) + nTallySize + nAddressLength + 1;
+    size_t nPerToken = nNodeHeader + nRecordSize;
+
+    return nAddresses * nPerAddress + nTokens * nPerToken;
+}
+
+/** Returns the number of addresses of the synthetic state, which can be set via -tallyaddresses. */
+static uint32_t GetNumberOfAddresses()
+{
+    return std::max<int64_t>(GetArg("-tallyaddresses", 100000), 1);
+}
+
+/** Returns the addresses of the synthetic state in a random order, which is used to look them up. */
+static std::vector<std::string> CreateLookupOrder(uint32_t nAddresses)
+{
+    std::vector<std::string> vAddresses;
+    for (uint32_t n = 0; n < nAddresses; ++n) {
+        vAddresses.push_back(CreateAddress(n));
+    }
+    seed_insecure_rand(true);
+    for (size_t n = vAddresses.size() - 1; n > 0; --n) {
+        std::swap(vAddresses[n], vAddresses[insecure_rand() % (n + 1)]);
+    }
+    return vAddresses;
+}
+
+/**
+ * Looks up the tallies of a synthetic state in a random order, where each address holds
+ * one or two tokens, and reports the memory usage of the state.
+ *
+ * The number of addresses can be set via -tallyaddresses, for example to 5000000.
+ */
+static void TallyMapFind(benchmark::State& state)
+{
+    const uint32_t nAddresses = GetNumberOfAddresses();
+
+    CMPTallyMap tallyMap;
+    size_t nTokens = 0;
+    size_t nAddressLength = 0;
+    for (uint32_t n = 0; n < nAddresses; ++n) {
+        std::string address = CreateAddress(n);
+        nAddressLength += address.size();
+        CMPTally& tally = tallyMap[address];
+        tally.updateMoney(1, n + 1, BALANCE);
+        ++nTokens;
+        if (n % 4 == 0) {
+            tally.updateMoney(31 + n % 7, n + 1, BALANCE);
+            ++nTokens;
+        }
+    }
+
+    size_t nUsage = tallyMap.DynamicMemoryUsage();
+    size_t nEstimate = EstimateMapUsage(nAddresses, nTokens, nAddressLength / nAddresses);
+    state.SetNote(strprintf("%d addresses: %.1f bytes/address, previous layout about %.1f bytes/address",
+            nAddresses, double(nUsage) / nAddresses, double(nEstimate) / nAddresses));
+
+    std::vector<std::string> vAddresses = CreateLookupOrder(nAddresses);
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        pResultSink = tallyMap.find(vAddresses[n]);
+        if (++n == vAddresses.size()) n = 0;
+    }
+}
+
+/** Looks up the tallies of the same synthetic state, which is kept in a std::map, as it used to be. */
+static void TallyMapFindBaseline(benchmark::State& state)
+{
+    const uint32_t nAddresses = GetNumberOfAddresses();
+
+    std::map<std::string, CMPTally> tallyMap;
+    for (uint32_t n = 0; n < nAddresses; ++n) {
+        CMPTally& tally = tallyMap[CreateAddress(n)];
+        tally.updateMoney(1, n + 1, BALANCE);
+        if (n % 4 == 0) {
+            tally.updateMoney(31 + n % 7, n + 1, BALANCE);
+        }
+    }
+    state.SetNote(strprintf("%d addresses", nAddresses));
+
+    std::vector<std::string> vAddresses = CreateLookupOrder(nAddresses);
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        pResultSink = &tallyMap.find(vAddresses[n])->second;
+        if (++n == vAddresses.size()) n = 0;
+    }
+}
+
+BENCHMARK(TallyMapFind);
+BENCHMARK(TallyMapFindBaseline);
@@ -11,10 +11,16 @@
 #include "omnicore/omnicore.h"
 #include "omnicore/sp.h"
 
+#include "crypto/sha256.h"
+#include "sync.h"
+#include "uint256.h"
+
 #include <stdint.h>
+#include <map>
+#include <set>
 #include <string>
-
-#include <openssl/sha.h>
+#include <utility>
+#include <vector>
 
 namespace mastercore
 {
@@ -122,9 +128,7 @@ std::string GenerateConsensusString(const uint32_t propertyId, const std::string
  */
 uint256 GetConsensusHash()
 {
-    // allocate and init a SHA256_CTX
-    SHA256_CTX shaCtx;
-    SHA256_Init(&shaCtx);
+    CSHA256 hasher;
 
     LOCK(cs_tally);
 
@@ -132,16 +136,16 @@ uint256 GetConsensusHash()
 
     // Balances - loop through the tally map, updating the sha context with the data from each balance and tally type
     // Placeholders:  "address|propertyid|balance|selloffer_reserve|accept_reserve|metadex_reserve"
-    for (std::map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        const std::string& address = my_it->first;
-        CMPTally& tally = my_it->second;
+    for (CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+        const std::string address = my_it.getAddress();
+        CMPTally& tally = my_it.getTally();
         tally.init();
         uint32_t propertyId = 0;
         while (0 != (propertyId = (tally.next()))) {
             std::string dataStr = GenerateConsensusString(tally, address, propertyId);
             if (dataStr.empty()) continue; // skip empty balances
             if (msc_debug_consensus_hash) PrintToLog("Adding balance data to consensus hash: %s\n", dataStr);
-            SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
+            hasher.Write((const unsigned char*) dataStr.c_str(), dataStr.length());
         }
     }
 
@@ -159,7 +163,7 @@ uint256 GetConsensusHash()
     for (std::vector<std::pair<uint256, std::string> >::iterator it = vecDExOffers.begin(); it != vecDExOffers.end(); ++it) {
         const std::string& dataStr = it->second;
         if (msc_debug_consensus_hash) PrintToLog("Adding DEx offer data to consensus hash: %s\n", dataStr);
-        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
+        hasher.Write((const unsigned char*) dataStr.c_str(), dataStr.length());
     }
 
     // DEx accepts - loop through the accepts map and add each accept to the consensus hash (ordered by matchedtxid then buyer)
@@ -177,7 +181,7 @@ uint256 GetConsensusHash()
     for (std::vector<std::pair<std::string, std::string> >::iterator it = vecAccepts.begin(); it != vecAccepts.end(); ++it) {
         const std::string& dataStr = it->second;
         if (msc_debug_consensus_hash) PrintToLog("Adding DEx accept to consensus hash: %s\n", dataStr);
-        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
+        hasher.Write((const unsigned char*) dataStr.c_str(), dataStr.length());
     }
 
     // MetaDEx trades - loop through the MetaDEx maps and add each open trade to the consensus hash (ordered by txid)
@@ -198,7 +202,7 @@ uint256 GetConsensusHash()
     for (std::vector<std::pair<uint256, std::string> >::iterator it = vecMetaDExTrades.begin(); it != vecMetaDExTrades.end(); ++it) {
         const std::string& dataStr = it->second;
         if (msc_debug_consensus_hash) PrintToLog("Adding MetaDEx trade data to consensus hash: %s\n", dataStr);
-        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
+        hasher.Write((const unsigned char*) dataStr.c_str(), dataStr.length());
     }
 
     // Crowdsales - loop through open crowdsales and add to the consensus hash (ordered by property ID)
@@ -216,7 +220,7 @@ uint256 GetConsensusHash()
     for (std::vector<std::pair<uint32_t, std::string> >::iterator it = vecCrowds.begin(); it != vecCrowds.end(); ++it) {
         std::string dataStr = (*it).second;
         if (msc_debug_consensus_hash) PrintToLog("Adding Crowdsale entry to consensus hash: %s\n", dataStr);
-        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
+        hasher.Write((const unsigned char*) dataStr.c_str(), dataStr.length());
     }
 
     // Properties - loop through each property and store the issuer (to capture state changes via change issuer transactions)
@@ -233,13 +237,13 @@ uint256 GetConsensusHash()
             }
             std::string dataStr = GenerateConsensusString(propertyId, sp.issuer);
             if (msc_debug_consensus_hash) PrintToLog("Adding property to consensus hash: %s\n", dataStr);
-            SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
+            hasher.Write((const unsigned char*) dataStr.c_str(), dataStr.length());
         }
     }
 
     // extract the final result and return the hash
     uint256 consensusHash;
-    SHA256_Final((unsigned char*)&consensusHash, &shaCtx);
+    hasher.Finalize(consensusHash.begin());
     if (msc_debug_consensus_hash) PrintToLog("Finished generation of consensus hash.  Result: %s\n", consensusHash.GetHex());
 
     return consensusHash;
@@ -247,14 +251,13 @@ uint256 GetConsensusHash()
 
 uint256 GetMetaDExHash(const uint32_t propertyId)
 {
-    SHA256_CTX shaCtx;
-    SHA256_Init(&shaCtx);
+    CSHA256 hasher;
 
     LOCK(cs_tally);
 
     std::vector<std::pair<uint256, std::string> > vecMetaDExTrades;
     for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        if (propertyId == 0 || propertyId == my_it->first) {
+        if (propertyId == 0 || propertyId == my_it->first.first) {
             const md_PricesMap& prices = my_it->second;
             for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
                 const md_Set& indexes = it->second;
@@ -269,13 +272,300 @@ uint256 GetMetaDExHash(const uint32_t propertyId)
     std::sort (vecMetaDExTrades.begin(), vecMetaDExTrades.end());
     for (std::vector<std::pair<uint256, std::string> >::iterator it = vecMetaDExTrades.begin(); it != vecMetaDExTrades.end(); ++it) {
         const std::string& dataStr = it->second;
-        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
+        hasher.Write((const unsigned char*) dataStr.c_str(), dataStr.length());
     }
 
     uint256 metadexHash;
-    SHA256_Final((unsigned char*)&metadexHash, &shaCtx);
+    hasher.Finalize(metadexHash.begin());
 
     return metadexHash;
 }
 
+//! Sum of the record hashes of all balances, except for the records in setChangedBalances
+static uint256 hashBalanceRecords;
+//! Balance records, which changed since the last update of the commitment
+static std::set<std::pair<std::string, uint32_t> > setChangedBalances;
+//! Sum of the record hashes of all open MetaDEx orders, except for the orders in setChangedOrders
+static uint256 hashMetaDExRecords;
+//! MetaDEx orders, which changed since the last update of the commitment
+static std::set<uint256> setChangedOrders;
+//! Record hash of each property
+static std::map<uint32_t, uint256> mapPropertyRecords;
+//! Properties, which changed since the last update of the commitment
+static std::set<uint32_t> setChangedProperties;
+//! Whether the record hashes of all properties must be rebuilt
+static bool fPropertiesReset = true;
+
+/** Record hashes of the records of a stage, with the data they were obtained from, keyed like the records. */
+typedef std::map<std::string, std::pair<std::string, uint256> > RecordHashMap;
+
+//! Record hashes of the DEx sell offers
+static RecordHashMap mapOfferRecords;
+//! Record hashes of the DEx accepts
+static RecordHashMap mapAcceptRecords;
+//! Record hashes of the crowdsales
+static RecordHashMap mapCrowdRecords;
+
+/** Hashes a single record. Empty records are not part of the state and hash to zero. */
+static uint256 GetRecordHash(const std::string& dataStr)
+{
+    uint256 recordHash;
+    if (!dataStr.empty()) {
+        CSHA256().Write((const unsigned char*) dataStr.c_str(), dataStr.length()).Finalize(recordHash.begin());
+    }
+    return recordHash;
+}
+
+/** Determines the record hash of a property, or zero, if the property doesn't exist. */
+static uint256 GetPropertyRecordHash(uint32_t propertyId)
+{
+    uint8_t ecosystem = isTestEcosystemProperty(propertyId) ? 2 : 1;
+    if (propertyId == 0 || propertyId >= _my_sps->peekNextSPID(ecosystem)) {
+        return uint256();
+    }
+    CMPSPInfo::Entry sp;
+    if (!_my_sps->getSP(propertyId, sp)) {
+        return uint256();
+    }
+    return GetRecordHash(GenerateConsensusString(propertyId, sp.issuer));
+}
+
+/** Determines the record hash of an open MetaDEx order, or zero, if the order doesn't exist. */
+static uint256 GetOrderRecordHash(const uint256& txid)
+{
+    const CMPMetaDEx* pOrder = MetaDEx_RetrieveTrade(txid);
+    if (pOrder == NULL) {
+        return uint256();
+    }
+    return GetRecordHash(GenerateConsensusString(*pOrder));
+}
+
+/**
+ * Updates the record hashes of a stage, and returns their sum.
+ *
+ * The records are expected in ascending order of their keys. Only records, which are
+ * new, or whose data differs from the last time, are hashed, and the records, which no
+ * longer exist, are removed.
+ */
+static uint256 UpdateRecordHashes(RecordHashMap& mapRecords, const std::vector<std::pair<std::string, std::string> >& vRecords)
+{
+    uint256 sumHash;
+    RecordHashMap::iterator itRecord = mapRecords.begin();
+    for (std::vector<std::pair<std::string, std::string> >::const_iterator it = vRecords.begin(); it != vRecords.end(); ++it) {
+        while (itRecord != mapRecords.end() && itRecord->first < it->first) {
+            mapRecords.erase(itRecord++);
+        }
+        if (itRecord == mapRecords.end() || itRecord->first != it->first) {
+            itRecord = mapRecords.insert(itRecord, std::make_pair(it->first, std::make_pair(it->second, GetRecordHash(it->second))));
+        } else if (itRecord->second.first != it->second) {
+            itRecord->second = std::make_pair(it->second, GetRecordHash(it->second));
+        }
+        sumHash += itRecord->second.second;
+        ++itRecord;
+    }
+    mapRecords.erase(itRecord, mapRecords.end());
+
+    return sumHash;
+}
+
+/** Rehashes the properties, which changed since the last update. */
+static void UpdatePropertyRecords()
+{
+    for (std::set<uint32_t>::const_iterator it = setChangedProperties.begin(); it != setChangedProperties.end(); ++it) {
+        uint256 recordHash = GetPropertyRecordHash(*it);
+        if (recordHash == 0) {
+            mapPropertyRecords.erase(*it);
+        } else {
+            mapPropertyRecords[*it] = recordHash;
+        }
+    }
+    setChangedProperties.clear();
+}
+
+/**
+ * Adds the hashes of the changed balance records, MetaDEx orders and properties to the
+ * state commitment.
+ *
+ * This is done at the end of every block, so only the records changed by one block are
+ * pending at a time.
+ */
+void UpdateStateCommitment()
+{
+    LOCK(cs_tally);
+
+    // Balances - add the hashes of the records, which changed since the last time
+    for (std::set<std::pair<std::string, uint32_t> >::const_iterator it = setChangedBalances.begin(); it != setChangedBalances.end(); ++it) {
+        const CMPTally* ptally = mp_tally_map.find(it->first);
+        if (ptally) {
+            hashBalanceRecords += GetRecordHash(GenerateConsensusString(*ptally, it->first, it->second));
+        }
+    }
+    setChangedBalances.clear();
+
+    // MetaDEx trades - add the hashes of the orders, which changed since the last time
+    for (std::set<uint256>::const_iterator it = setChangedOrders.begin(); it != setChangedOrders.end(); ++it) {
+        hashMetaDExRecords += GetOrderRecordHash(*it);
+    }
+    setChangedOrders.clear();
+
+    // Properties - the records of all properties are rebuilt after a reset
+    if (!fPropertiesReset) {
+        UpdatePropertyRecords();
+    }
+}
+
+/**
+ * Obtains a commitment to the active state, which is maintained incrementally.
+ *
+ * The same records as for the consensus hash are used, but each record is hashed on its
+ * own, and the hashes of all records of a stage are added up as little-endian numbers
+ * modulo 2^256. The sum is independent of the order of the records, so no sorting is
+ * needed, and a changed record only requires to subtract its old hash and to add its
+ * new one.
+ *
+ * Balance records, MetaDEx orders and the issuers of properties are tracked as they
+ * change, and are rehashed at the end of every block, or when the commitment is
+ * obtained. Open DEx offers, accepts and crowdsales are few, and change in many places,
+ * so their data is compared with the data of the last time, and only changed records
+ * are rehashed.
+ *
+ * The commitment is the SHA256 hash of the six sums in the order of the stages:
+ *
+ *   SHA256(balances|dexoffers|dexaccepts|metadextrades|crowdsales|properties)
+ *
+ * It is not a replacement of the consensus hash, which is used for checkpoints.
+ */
+uint256 GetStateCommitment()
+{
+    LOCK(cs_tally);
+
+    // Balances, MetaDEx trades and changed properties
+    UpdateStateCommitment();
+
+    // DEx sell offers
+    std::vector<std::pair<std::string, std::string> > vRecords;
+    for (OfferMap::const_iterator it = my_offers.begin(); it != my_offers.end(); ++it) {
+        const std::string& sellCombo = it->first;
+        std::string seller = sellCombo.substr(0, sellCombo.size() - 2);
+        vRecords.push_back(std::make_pair(sellCombo, GenerateConsensusString(it->second, seller)));
+    }
+    uint256 hashOfferRecords = UpdateRecordHashes(mapOfferRecords, vRecords);
+
+    // DEx accepts
+    vRecords.clear();
+    for (AcceptMap::const_iterator it = my_accepts.begin(); it != my_accepts.end(); ++it) {
+        const std::string& acceptCombo = it->first;
+        std::string buyer = acceptCombo.substr((acceptCombo.find("+") + 1), (acceptCombo.size()-(acceptCombo.find("+") + 1)));
+        vRecords.push_back(std::make_pair(acceptCombo, GenerateConsensusString(it->second, buyer)));
+    }
+    uint256 hashAcceptRecords = UpdateRecordHashes(mapAcceptRecords, vRecords);
+
+    // Crowdsales
+    vRecords.clear();
+    for (CrowdMap::const_iterator it = my_crowds.begin(); it != my_crowds.end(); ++it) {
+        vRecords.push_back(std::make_pair(it->first, GenerateConsensusString(it->second)));
+    }
+    uint256 hashCrowdRecords = UpdateRecordHashes(mapCrowdRecords, vRecords);
+
+    // Properties - rebuild all records after a reset, otherwise only rehash the changed ones
+    if (fPropertiesReset) {
+        mapPropertyRecords.clear();
+        for (uint8_t ecosystem = 1; ecosystem <= 2; ecosystem++) {
+            uint32_t startPropertyId = (ecosystem == 1) ? 1 : TEST_ECO_PROPERTY_1;
+            for (uint32_t propertyId = startPropertyId; propertyId < _my_sps->peekNextSPID(ecosystem); propertyId++) {
+                setChangedProperties.insert(propertyId);
+            }
+        }
+        fPropertiesReset = false;
+    }
+    UpdatePropertyRecords();
+    uint256 hashPropertyRecords;
+    for (std::map<uint32_t, uint256>::const_iterator it = mapPropertyRecords.begin(); it != mapPropertyRecords.end(); ++it) {
+        hashPropertyRecords += it->second;
+    }
+
+    CSHA256 hasher;
+    hasher.Write(hashBalanceRecords.begin(), hashBalanceRecords.size());
+    hasher.Write(hashOfferRecords.begin(), hashOfferRecords.size());
+    hasher.Write(hashAcceptRecords.begin(), hashAcceptRecords.size());
+    hasher.Write(hashMetaDExRecords.begin(), hashMetaDExRecords.size());
+    hasher.Write(hashCrowdRecords.begin(), hashCrowdRecords.size());
+    hasher.Write(hashPropertyRecords.begin(), hashPropertyRecords.size());
+
+    uint256 stateCommitment;
+    hasher.Finalize(stateCommitment.begin());
+
+    return stateCommitment;
+}
+
+/**
+ * Notifies the state commitment that a balance record is about to change.
+ *
+ * The hash of the record is subtracted, before the first change, and the hash of the
+ * updated record is added, once the commitment is updated the next time.
+ */
+void NotifyTallyChange(const std::string& address, uint32_t propertyId)
+{
+    LOCK(cs_tally);
+
+    if (!setChangedBalances.insert(std::make_pair(address, propertyId)).second) {
+        return; // already subtracted
+    }
+    const CMPTally* ptally = mp_tally_map.find(address);
+    if (ptally) {
+        hashBalanceRecords -= GetRecordHash(GenerateConsensusString(*ptally, address, propertyId));
+    }
+}
+
+/**
+ * Notifies the state commitment that a MetaDEx order is about to be added, updated or removed.
+ *
+ * The hash of the order is subtracted, before the first change, and the hash of the
+ * updated order is added, once the commitment is updated the next time.
+ */
+void NotifyMetaDExOrderChange(const uint256& txid)
+{
+    LOCK(cs_tally);
+
+    if (!setChangedOrders.insert(txid).second) {
+        return; // already subtracted
+    }
+    hashMetaDExRecords -= GetOrderRecordHash(txid);
+}
+
+/** Notifies the state commitment that a property has been created or updated. */
+void NotifyPropertyChange(uint32_t propertyId)
+{
+    LOCK(cs_tally);
+
+    setChangedProperties.insert(propertyId);
+}
+
+/** Notifies the state commitment that any property may have changed. */
+void NotifyPropertiesReset()
+{
+    LOCK(cs_tally);
+
+    setChangedProperties.clear();
+    fPropertiesReset = true;
+}
+
+/** Resets the balance part of the state commitment, when the tally map is cleared. */
+void ClearTallyCommitment()
+{
+    LOCK(cs_tally);
+
+    hashBalanceRecords = 0;
+    setChangedBalances.clear();
+}
+
+/** Resets the MetaDEx part of the state commitment, when all orders are removed. */
+void ClearMetaDExCommitment()
+{
+    LOCK(cs_tally);
+
+    hashMetaDExRecords = 0;
+    setChangedOrders.clear();
+}
+
 } // namespace mastercore
@@ -3,6 +3,9 @@
 
 #include "uint256.h"
 
+#include <stdint.h>
+#include <string>
+
 namespace mastercore
 {
 /** Obtains a hash of all balances to use for consensus verification and checkpointing. */
@@ -11,6 +14,30 @@ uint256 GetConsensusHash();
 /** Obtains a hash of the overall MetaDEx state (default) or a specific orderbook (supply a property ID). */
 uint256 GetMetaDExHash(const uint32_t propertyId = 0);
 
+/** Obtains a commitment to the active state, which is maintained incrementally. */
+uint256 GetStateCommitment();
+
+/** Adds the pending changes of balances, MetaDEx orders and properties to the state commitment. */
+void UpdateStateCommitment();
+
+/** Notifies the state commitment that a balance record is about to change. */
+void NotifyTallyChange(const std::string& address, uint32_t propertyId);
+
+/** Notifies the state commitment that a MetaDEx order is about to be added, updated or removed. */
+void NotifyMetaDExOrderChange(const uint256& txid);
+
+/** Notifies the state commitment that a property has been created or updated. */
+void NotifyPropertyChange(uint32_t propertyId);
+
+/** Notifies the state commitment that any property may have changed. */
+void NotifyPropertiesReset();
+
+/** Resets the balance part of the state commitment, when the tally map is cleared. */
+void ClearTallyCommitment();
+
+/** Resets the MetaDEx part of the state commitment, when all orders are removed. */
+void ClearMetaDExCommitment();
+
 }
 
 #endif // OMNICORE_CONSENSUSHASH_H
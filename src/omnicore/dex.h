@@ -6,6 +6,7 @@
 #include "omnicore/tx.h"
 
 #include "amount.h"
+#include "serialize.h"
 #include "tinyformat.h"
 #include "uint256.h"
 
@@ -26,16 +27,6 @@ inline std::string STR_ACCEPT_ADDR_PROP_ADDR_COMBO(const std::string& seller, co
 {
     return strprintf("%s-%d+%s", seller, propertyId, buyer);
 }
-/** Lookup key to find DEx payments. */
-inline std::string STR_PAYMENT_SUBKEY_TXID_PAYMENT_COMBO(const std::string& txidStr, unsigned int paymentNumber)
-{
-    return strprintf("%s-%d", txidStr, paymentNumber);
-}
-/** Lookup key to find MetaDEx sub-records. TODO: not here! */
-inline std::string STR_REF_SUBKEY_TXID_REF_COMBO(const std::string& txidStr, unsigned int refNumber)
-{
-    return strprintf("%s%d", txidStr, refNumber);
-}
 
 /** A single outstanding offer, from one seller of one property.
  *
@@ -107,6 +98,20 @@ public:
         // write the line
         file << lineOut << std::endl;
     }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(offerBlock);
+        READWRITE(offer_amount_original);
+        READWRITE(property);
+        READWRITE(BTC_desired_original);
+        READWRITE(min_fee);
+        READWRITE(blocktimelimit);
+        READWRITE(txid);
+        READWRITE(subaction);
+    }
 };
 
 /** Accepted offer on the DEx.
@@ -143,6 +148,12 @@ public:
 
     int getAcceptBlock() const { return block; }
 
+    CMPAccept()
+      : accept_amount_original(0), accept_amount_remaining(0), blocktimelimit(0), property(0),
+        offer_amount_original(0), BTC_desired_original(0), offer_txid(0), block(0)
+    {
+    }
+
     CMPAccept(int64_t amountAccepted, int blockIn, uint8_t paymentWindow, uint32_t propertyId,
               int64_t offerAmountOriginal, int64_t amountDesired, const uint256& txid)
       : accept_amount_remaining(amountAccepted), blocktimelimit(paymentWindow),
@@ -215,6 +226,20 @@ public:
         // write the line
         file << lineOut << std::endl;
     }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(accept_amount_original);
+        READWRITE(accept_amount_remaining);
+        READWRITE(blocktimelimit);
+        READWRITE(property);
+        READWRITE(offer_amount_original);
+        READWRITE(BTC_desired_original);
+        READWRITE(offer_txid);
+        READWRITE(block);
+    }
 };
 
 namespace mastercore
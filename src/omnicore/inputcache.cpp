@@ -0,0 +1,104 @@
+#include "omnicore/inputcache.h"
+
+#include "primitives/transaction.h"
+#include "random.h"
+
+#include <stddef.h>
+#include <list>
+#include <utility>
+
+using namespace mastercore;
+
+COutPointHasher::COutPointHasher() : salt(GetRandHash()) {}
+
+CInputCache::CInputCache(size_t nMaxUsageIn)
+  : nMaxUsage(nMaxUsageIn), nUsage(0), nHits(0), nMisses(0), nEvictions(0)
+{
+}
+
+/**
+ * Estimates the memory usage of a cached output, including the list node,
+ * the index entry and the script.
+ */
+size_t CInputCache::EntryUsage(const CTxOut& txOut)
+{
+    return sizeof(EntryList::value_type) + sizeof(EntryMap::value_type)
+            + 4 * sizeof(void*) + txOut.scriptPubKey.capacity();
+}
+
+/**
+ * Looks up an output, and marks it as recently used.
+ *
+ * @param outpoint[in]   The output to look up
+ * @param txOutRet[out]  The cached output
+ * @return True, if the output was cached
+ */
+bool CInputCache::Get(const COutPoint& outpoint, CTxOut& txOutRet)
+{
+    EntryMap::iterator it = index.find(outpoint);
+    if (it == index.end()) {
+        ++nMisses;
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    txOutRet = it->second->second;
+    ++nHits;
+
+    return true;
+}
+
+/**
+ * Adds or replaces an output, and marks it as recently used.
+ *
+ * If the memory limit is exceeded, the least recently used outputs are evicted.
+ */
+void CInputCache::Put(const COutPoint& outpoint, const CTxOut& txOut)
+{
+    EntryMap::iterator it = index.find(outpoint);
+    if (it != index.end()) {
+        nUsage -= EntryUsage(it->second->second);
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    entries.push_front(std::make_pair(outpoint, txOut));
+    index.insert(std::make_pair(outpoint, entries.begin()));
+    nUsage += EntryUsage(entries.front().second);
+
+    Trim();
+}
+
+/**
+ * Evicts the least recently used outputs, until the memory limit is met.
+ */
+void CInputCache::Trim()
+{
+    while (nUsage > nMaxUsage && !entries.empty()) {
+        const std::pair<COutPoint, CTxOut>& entry = entries.back();
+        nUsage -= EntryUsage(entry.second);
+        index.erase(entry.first);
+        entries.pop_back();
+        ++nEvictions;
+    }
+}
+
+/**
+ * Sets the maximal estimated memory usage in bytes, and evicts outputs, if
+ * the new limit is exceeded.
+ */
+void CInputCache::SetMaxUsage(size_t nMaxUsageIn)
+{
+    nMaxUsage = nMaxUsageIn;
+    Trim();
+}
+
+/**
+ * Removes all outputs, but keeps the statistics.
+ */
+void CInputCache::Clear()
+{
+    index.clear();
+    entries.clear();
+    nUsage = 0;
+}
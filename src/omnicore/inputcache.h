@@ -0,0 +1,97 @@
+#ifndef OMNICORE_INPUTCACHE_H
+#define OMNICORE_INPUTCACHE_H
+
+#include "primitives/transaction.h"
+#include "uint256.h"
+
+#include <boost/unordered_map.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <utility>
+
+namespace mastercore
+{
+/** Hasher for outpoints, salted to avoid predictable collisions. */
+class COutPointHasher
+{
+private:
+    uint256 salt;
+
+public:
+    COutPointHasher();
+
+    /** Must return size_t, see CCoinsKeyHasher. */
+    size_t operator()(const COutPoint& outpoint) const {
+        return outpoint.hash.GetHash(salt) ^ outpoint.n;
+    }
+};
+
+/**
+ * Memory-bounded cache of previous transaction outputs, used to resolve the
+ * inputs of transactions.
+ *
+ * Only the script and value of an output are stored. When the estimated memory
+ * usage exceeds the limit, the least recently used outputs are evicted.
+ *
+ * The cache is not thread-safe, and guarded by cs_tx_cache.
+ */
+class CInputCache
+{
+private:
+    typedef std::list<std::pair<COutPoint, CTxOut> > EntryList;
+    typedef boost::unordered_map<COutPoint, EntryList::iterator, COutPointHasher> EntryMap;
+
+    //! Cached outputs, the most recently used first
+    EntryList entries;
+    //! Position of the cached outputs
+    EntryMap index;
+
+    //! Maximal estimated memory usage in bytes
+    size_t nMaxUsage;
+    //! Estimated memory usage in bytes
+    size_t nUsage;
+
+    //! Number of successful lookups
+    uint64_t nHits;
+    //! Number of failed lookups
+    uint64_t nMisses;
+    //! Number of evicted outputs
+    uint64_t nEvictions;
+
+    /** Estimates the memory usage of a cached output. */
+    static size_t EntryUsage(const CTxOut& txOut);
+
+    /** Evicts the least recently used outputs, until the memory limit is met. */
+    void Trim();
+
+public:
+    explicit CInputCache(size_t nMaxUsageIn);
+
+    /** Looks up an output, and marks it as recently used. */
+    bool Get(const COutPoint& outpoint, CTxOut& txOutRet);
+
+    /** Adds or replaces an output, and marks it as recently used. */
+    void Put(const COutPoint& outpoint, const CTxOut& txOut);
+
+    /** Sets the maximal estimated memory usage in bytes. */
+    void SetMaxUsage(size_t nMaxUsageIn);
+
+    /** Removes all outputs, but keeps the statistics. */
+    void Clear();
+
+    /** Returns the number of cached outputs. */
+    size_t GetSize() const { return index.size(); }
+    /** Returns the estimated memory usage in bytes. */
+    size_t GetUsage() const { return nUsage; }
+    /** Returns the number of successful lookups. */
+    uint64_t GetHits() const { return nHits; }
+    /** Returns the number of failed lookups. */
+    uint64_t GetMisses() const { return nMisses; }
+    /** Returns the number of evicted outputs. */
+    uint64_t GetEvictions() const { return nEvictions; }
+};
+}
+
+#endif // OMNICORE_INPUTCACHE_H
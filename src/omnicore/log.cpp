@@ -8,6 +8,7 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <assert.h>
 #include <stdio.h>
@@ -39,6 +40,8 @@ bool msc_debug_tokens             = 0;
 bool msc_debug_spec               = 0;
 bool msc_debug_exo                = 0;
 bool msc_debug_tally              = 1;
+//! Cross-check the maintained token supply against a full scan at checkpoint blocks
+bool msc_debug_supply             = 0;
 bool msc_debug_sp                 = 1;
 bool msc_debug_sto                = 1;
 bool msc_debug_txdb               = 0;
@@ -59,6 +62,8 @@ bool msc_debug_walletcache        = 0;
 bool msc_debug_consensus_hash     = 0;
 //! Print consensus hashes for each block when parsing
 bool msc_debug_consensus_hash_every_block = 0;
+//! Print state commitments for each block when parsing
+bool msc_debug_state_commitment_every_block = 0;
 //! Print extra info on alert processing
 bool msc_debug_alerts             = 1;
 //! Print consensus hashes for each transaction when parsing
@@ -84,6 +89,14 @@ static boost::mutex* mutexDebugLog = NULL;
 /** Flag to indicate, whether the Omni Core log file should be reopened. */
 extern volatile bool fReopenOmniCoreLog;
 
+/** The messages of a capture are owned by the CLogCapture object. */
+static void NoCleanup(std::vector<std::string>*)
+{
+}
+
+/** The active log capture of a thread, if any. */
+static boost::thread_specific_ptr<std::vector<std::string> > logCapture(&NoCleanup);
+
 /**
  * Returns path for debug log file.
  *
@@ -148,7 +161,12 @@ static std::string GetTimestamp()
 int LogFilePrint(const std::string& str)
 {
     int ret = 0; // Number of characters written
-    if (fPrintToConsole) {
+    if (logCapture.get() != NULL) {
+        // Collect the message, if captured by the current thread
+        logCapture->push_back(str);
+        ret = str.size();
+    }
+    else if (fPrintToConsole) {
         // Print to console
         ret = ConsolePrint(str);
     }
@@ -185,6 +203,22 @@ int LogFilePrint(const std::string& str)
     return ret;
 }
 
+CLogCapture::CLogCapture() : pPrevious(logCapture.get())
+{
+    logCapture.reset(&vMessages);
+}
+
+CLogCapture::~CLogCapture()
+{
+    logCapture.reset(pPrevious);
+}
+
+void CLogCapture::Take(std::vector<std::string>& vMessagesOut)
+{
+    vMessagesOut.swap(vMessages);
+    vMessages.clear();
+}
+
 /**
  * Prints to the standard output, usually the console.
  *
@@ -246,6 +280,7 @@ void InitDebugLogLevels()
         if (*it == "spec") msc_debug_spec = true;
         if (*it == "exo") msc_debug_exo = true;
         if (*it == "tally") msc_debug_tally = true;
+        if (*it == "supply") msc_debug_supply = true;
         if (*it == "sp") msc_debug_sp = true;
         if (*it == "sto") msc_debug_sto = true;
         if (*it == "txdb") msc_debug_txdb = true;
@@ -261,6 +296,7 @@ void InitDebugLogLevels()
         if (*it == "walletcache") msc_debug_walletcache = true;
         if (*it == "consensus_hash") msc_debug_consensus_hash = true;
         if (*it == "consensus_hash_every_block") msc_debug_consensus_hash_every_block = true;
+        if (*it == "state_commitment_every_block") msc_debug_state_commitment_every_block = true;
         if (*it == "alerts") msc_debug_alerts = true;
         if (*it == "consensus_hash_every_transaction") msc_debug_consensus_hash_every_transaction = true;
         if (*it == "none" || *it == "all") {
@@ -281,6 +317,7 @@ void InitDebugLogLevels()
             msc_debug_spec = allDebugState;
             msc_debug_exo = allDebugState;
             msc_debug_tally = allDebugState;
+            msc_debug_supply = allDebugState;
             msc_debug_sp = allDebugState;
             msc_debug_sto = allDebugState;
             msc_debug_txdb = allDebugState;
@@ -296,6 +333,7 @@ void InitDebugLogLevels()
             msc_debug_walletcache = allDebugState;
             msc_debug_consensus_hash = allDebugState;
             msc_debug_consensus_hash_every_block = allDebugState;
+            msc_debug_state_commitment_every_block = allDebugState;
             msc_debug_alerts = allDebugState;
             msc_debug_consensus_hash_every_transaction = allDebugState;
         }
@@ -5,6 +5,7 @@
 #include "tinyformat.h"
 
 #include <string>
+#include <vector>
 
 /** Prints to the log file. */
 int LogFilePrint(const std::string& str);
@@ -18,6 +19,26 @@ void InitDebugLogLevels();
 /** Scrolls log file, if it's getting too big. */
 void ShrinkDebugLog();
 
+/**
+ * Collects the messages, which are logged by the current thread while the capture
+ * exists, instead of printing them.
+ *
+ * This is used by worker threads, so their messages can be printed in order later.
+ */
+class CLogCapture
+{
+private:
+    std::vector<std::string>* pPrevious;
+    std::vector<std::string> vMessages;
+
+public:
+    CLogCapture();
+    ~CLogCapture();
+
+    /** Moves the collected messages into the given vector. */
+    void Take(std::vector<std::string>& vMessagesOut);
+};
+
 // Debug flags
 extern bool msc_debug_parser_data;
 extern bool msc_debug_parser_readonly;
@@ -34,6 +55,7 @@ extern bool msc_debug_tokens;
 extern bool msc_debug_spec;
 extern bool msc_debug_exo;
 extern bool msc_debug_tally;
+extern bool msc_debug_supply;
 extern bool msc_debug_sp;
 extern bool msc_debug_sto;
 extern bool msc_debug_txdb;
@@ -49,6 +71,7 @@ extern bool msc_debug_packets_readonly;
 extern bool msc_debug_walletcache;
 extern bool msc_debug_consensus_hash;
 extern bool msc_debug_consensus_hash_every_block;
+extern bool msc_debug_state_commitment_every_block;
 extern bool msc_debug_alerts;
 extern bool msc_debug_consensus_hash_every_transaction;
 
@@ -1,30 +1,35 @@
 #include "omnicore/mdex.h"
 
+#include "omnicore/consensushash.h"
 #include "omnicore/errors.h"
 #include "omnicore/log.h"
 #include "omnicore/omnicore.h"
 #include "omnicore/sp.h"
 #include "omnicore/tx.h"
-#include "omnicore/uint256_extensions.h"
 
 #include "chain.h"
 #include "main.h"
+#include "random.h"
 #include "tinyformat.h"
 #include "uint256.h"
 
 #include <boost/multiprecision/cpp_int.hpp>
 #include <boost/rational.hpp>
+#include <boost/unordered_map.hpp>
 
 #include <openssl/sha.h>
 
 #include <assert.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <fstream>
 #include <limits>
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 typedef boost::multiprecision::cpp_dec_float_100 dec_float;
 typedef boost::multiprecision::checked_int128_t int128_t;
@@ -37,9 +42,108 @@ using namespace mastercore;
 //! Global map for price and order data
 md_PropertiesMap mastercore::metadex;
 
-md_PricesMap* mastercore::get_Prices(uint32_t prop)
+/** Position of an open order in the MetaDEx maps. */
+struct md_Locator
 {
-    md_PropertiesMap::iterator it = metadex.find(prop);
+    md_PropertyPair market;
+    rational_t price;
+    int block;
+    unsigned int idx;
+};
+
+/** Hasher for transaction hashes, salted to avoid predictable collisions. */
+class md_TxidHasher
+{
+private:
+    uint256 salt;
+
+public:
+    md_TxidHasher() : salt(GetRandHash()) {}
+
+    size_t operator()(const uint256& txid) const { return txid.GetHash(salt); }
+};
+
+//! Index of the open orders by transaction hash
+static boost::unordered_map<uint256, md_Locator, md_TxidHasher> mapOrderLocators;
+//! Transaction hashes of the open orders by owner
+static std::map<std::string, std::set<uint256> > mapOwnerOrders;
+
+/** Adds an open order to the transaction hash and owner indexes. */
+static void IndexOrder(const CMPMetaDEx& order)
+{
+    md_Locator& locator = mapOrderLocators[order.getHash()];
+    locator.market = std::make_pair(order.getProperty(), order.getDesProperty());
+    locator.price = order.unitPrice();
+    locator.block = order.getBlock();
+    locator.idx = order.getIdx();
+
+    mapOwnerOrders[order.getAddr()].insert(order.getHash());
+}
+
+/** Removes an order from the transaction hash and owner indexes. */
+static void UnindexOrder(const CMPMetaDEx& order)
+{
+    mapOrderLocators.erase(order.getHash());
+
+    std::map<std::string, std::set<uint256> >::iterator it = mapOwnerOrders.find(order.getAddr());
+    if (it != mapOwnerOrders.end()) {
+        it->second.erase(order.getHash());
+        if (it->second.empty()) mapOwnerOrders.erase(it);
+    }
+}
+
+/**
+ * Locates an open order via the transaction hash index.
+ *
+ * The located order is checked against the MetaDEx maps, so the result is also
+ * correct, if the maps were modified without updating the index.
+ */
+static const CMPMetaDEx* LocateOrder(const uint256& txid)
+{
+    boost::unordered_map<uint256, md_Locator, md_TxidHasher>::const_iterator it = mapOrderLocators.find(txid);
+    if (it == mapOrderLocators.end()) return NULL;
+    const md_Locator& locator = it->second;
+
+    md_PricesMap* prices = get_Prices(locator.market.first, locator.market.second);
+    if (!prices) return NULL;
+    md_Set* indexes = get_Indexes(prices, locator.price);
+    if (!indexes) return NULL;
+
+    // orders are ordered by block and position within the block
+    CMPMetaDEx key("", locator.block, 0, 0, 0, 0, txid, locator.idx, 0);
+    md_Set::const_iterator itOrder = indexes->find(key);
+    if (itOrder == indexes->end() || itOrder->getHash() != txid) return NULL;
+
+    return &(*itOrder);
+}
+
+/**
+ * Collects the open orders of an address via the owner index.
+ *
+ * @param addr[in]     The owner of the orders
+ * @param pMarket[in]  Only orders of this market are collected (can be NULL)
+ * @param pPrice[in]   Only orders with this unit price are collected (can be NULL)
+ * @param vOrders[out] The open orders, in no particular order
+ */
+static void GetOwnerOrders(const std::string& addr, const md_PropertyPair* pMarket, const rational_t* pPrice, std::vector<CMPMetaDEx>& vOrders)
+{
+    std::map<std::string, std::set<uint256> >::const_iterator itOwner = mapOwnerOrders.find(addr);
+    if (itOwner == mapOwnerOrders.end()) return;
+
+    for (std::set<uint256>::const_iterator it = itOwner->second.begin(); it != itOwner->second.end(); ++it) {
+        boost::unordered_map<uint256, md_Locator, md_TxidHasher>::const_iterator itLocator = mapOrderLocators.find(*it);
+        if (itLocator == mapOrderLocators.end()) continue;
+        if (pMarket && itLocator->second.market != *pMarket) continue;
+        if (pPrice && itLocator->second.price != *pPrice) continue;
+
+        const CMPMetaDEx* pOrder = LocateOrder(*it);
+        if (pOrder && pOrder->getAddr() == addr) vOrders.push_back(*pOrder);
+    }
+}
+
+md_PricesMap* mastercore::get_Prices(uint32_t prop, uint32_t desprop)
+{
+    md_PropertiesMap::iterator it = metadex.find(std::make_pair(prop, desprop));
 
     if (it != metadex.end()) return &(it->second);
 
@@ -90,6 +194,14 @@ static bool rangeInt64(const rational_t& value)
     return (rangeInt64(value.numerator()) && rangeInt64(value.denominator()));
 }
 
+// Used by x_Trade
+static md_Price xToFixedPrice(const rational_t& value)
+{
+    assert(rangeInt64(value));
+
+    return md_Price(value.numerator().convert_to<int64_t>(), value.denominator().convert_to<int64_t>());
+}
+
 // Used by CMPMetaDEx::displayUnitPrice
 static int64_t xToRoundUpInt64(const rational_t& value)
 {
@@ -137,7 +249,8 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
     if (msc_debug_metadex1) PrintToLog("%s(%s: prop=%d, desprop=%d, desprice= %s);newo: %s\n",
         __FUNCTION__, pnew->getAddr(), propertyForSale, propertyDesired, xToString(pnew->inversePrice()), pnew->ToString());
 
-    md_PricesMap* const ppriceMap = get_Prices(propertyDesired);
+    // the opposite side of the market: orders selling the desired property for the property offered
+    md_PricesMap* const ppriceMap = get_Prices(propertyDesired, propertyForSale);
 
     // nothing for the desired property exists in the market, sorry!
     if (!ppriceMap) {
@@ -145,16 +258,21 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
         return NewReturn;
     }
 
-    // within the desired property map (given one property) iterate over the items looking at prices
-    for (md_PricesMap::iterator priceIt = ppriceMap->begin(); priceIt != ppriceMap->end(); ++priceIt) { // check all prices
-        const rational_t sellersPrice = priceIt->first;
+    MarkMetaDExMarketDirty(propertyDesired, propertyForSale);
+
+    const md_Price buyersPrice = pnew->fixedInversePrice();
+
+    // within the market iterate over the price levels, starting with the lowest price
+    for (md_PricesMap::iterator priceIt = ppriceMap->begin(); priceIt != ppriceMap->end();) { // check all prices
+        const md_Price sellersPrice = xToFixedPrice(priceIt->first);
 
         if (msc_debug_metadex2) PrintToLog("comparing prices: desprice %s needs to be GREATER THAN OR EQUAL TO %s\n",
-            xToString(pnew->inversePrice()), xToString(sellersPrice));
+            xToString(pnew->inversePrice()), xToString(priceIt->first));
 
         // Is the desired price check satisfied? The buyer's inverse price must be larger than that of the seller.
-        if (pnew->inversePrice() < sellersPrice) {
-            continue;
+        // Price levels are sorted in ascending order, so none of the remaining levels can be matched either.
+        if (buyersPrice < sellersPrice) {
+            break;
         }
 
         md_Set* const pofferSet = &(priceIt->second);
@@ -163,25 +281,19 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
         md_Set::iterator offerIt = pofferSet->begin();
         while (offerIt != pofferSet->end()) { // specific price, check all properties
             const CMPMetaDEx* const pold = &(*offerIt);
-            assert(pold->unitPrice() == sellersPrice);
+            assert(pold->fixedUnitPrice() == sellersPrice);
 
             if (msc_debug_metadex1) PrintToLog("Looking at existing: %s (its prop= %d, its des prop= %d) = %s\n",
-                xToString(sellersPrice), pold->getProperty(), pold->getDesProperty(), pold->ToString());
-
-            // does the desired property match?
-            if (pold->getDesProperty() != propertyForSale) {
-                ++offerIt;
-                continue;
-            }
+                xToString(priceIt->first), pold->getProperty(), pold->getDesProperty(), pold->ToString());
 
-            if (msc_debug_metadex1) PrintToLog("MATCH FOUND, Trade: %s = %s\n", xToString(sellersPrice), pold->ToString());
+            if (msc_debug_metadex1) PrintToLog("MATCH FOUND, Trade: %s = %s\n", xToString(priceIt->first), pold->ToString());
 
             // match found, execute trade now!
             const int64_t seller_amountForSale = pold->getAmountRemaining();
             const int64_t buyer_amountOffered = pnew->getAmountRemaining();
 
             if (msc_debug_metadex1) PrintToLog("$$ trading using price: %s; seller: forsale=%d, desired=%d, remaining=%d, buyer amount offered=%d\n",
-                xToString(sellersPrice), pold->getAmountForSale(), pold->getAmountDesired(), pold->getAmountRemaining(), pnew->getAmountRemaining());
+                xToString(priceIt->first), pold->getAmountForSale(), pold->getAmountDesired(), pold->getAmountRemaining(), pnew->getAmountRemaining());
             if (msc_debug_metadex1) PrintToLog("$$ old: %s\n", pold->ToString());
             if (msc_debug_metadex1) PrintToLog("$$ new: %s\n", pnew->ToString());
 
@@ -193,8 +305,8 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             assert(pnew->getProperty() != pnew->getDesProperty());
             assert(pnew->getProperty() == pold->getDesProperty());
             assert(pold->getProperty() == pnew->getDesProperty());
-            assert(pold->unitPrice() <= pnew->inversePrice());
-            assert(pnew->unitPrice() <= pold->inversePrice());
+            assert(pold->fixedUnitPrice() <= buyersPrice);
+            assert(pnew->fixedUnitPrice() <= pold->fixedInversePrice());
 
             ///////////////////////////
 
@@ -202,12 +314,9 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             // purchase from Bob, using Bob's unit price
             // This implies rounding down, since rounding up is impossible, and would
             // require more tokens than Alice has
-            uint256 iCouldBuy = (ConvertTo256(pnew->getAmountRemaining()) * ConvertTo256(pold->getAmountForSale())) / ConvertTo256(pold->getAmountDesired());
-
             int64_t nCouldBuy = 0;
-            if (iCouldBuy < ConvertTo256(pold->getAmountRemaining())) {
-                nCouldBuy = ConvertTo64(iCouldBuy);
-            } else {
+            if (!MultiplyAndDivide(pnew->getAmountRemaining(), pold->getAmountForSale(), pold->getAmountDesired(), nCouldBuy)
+                    || nCouldBuy > pold->getAmountRemaining()) {
                 nCouldBuy = pold->getAmountRemaining();
             }
 
@@ -222,16 +331,16 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             // is fractional, always round UP the amount Alice has to pay
             // This will always be better for Bob. Rounding in the other direction
             // will always be impossible, because ot would violate Bob's accepted price
-            uint256 iWouldPay = DivideAndRoundUp((ConvertTo256(nCouldBuy) * ConvertTo256(pold->getAmountDesired())), ConvertTo256(pold->getAmountForSale()));
-            int64_t nWouldPay = ConvertTo64(iWouldPay);
+            int64_t nWouldPay = 0;
+            assert(MultiplyAndDivideRoundUp(nCouldBuy, pold->getAmountDesired(), pold->getAmountForSale(), nWouldPay));
 
             // If the resulting adjusted unit price is higher than Alice' price, the
             // orders shall not execute, and no representable fill is made
-            const rational_t xEffectivePrice(nWouldPay, nCouldBuy);
+            const md_Price xEffectivePrice(nWouldPay, nCouldBuy);
 
-            if (xEffectivePrice > pnew->inversePrice()) {
+            if (xEffectivePrice > buyersPrice) {
                 if (msc_debug_metadex1) PrintToLog(
-                        "-- effective price is too expensive: %s\n", xToString(xEffectivePrice));
+                        "-- effective price is too expensive: %s\n", xToString(rational_t(nWouldPay, nCouldBuy)));
                 ++offerIt;
                 continue;
             }
@@ -247,8 +356,8 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             ///////////////////////////
 
             // postconditions
-            assert(xEffectivePrice >= pold->unitPrice());
-            assert(xEffectivePrice <= pnew->inversePrice());
+            assert(xEffectivePrice >= pold->fixedUnitPrice());
+            assert(xEffectivePrice <= buyersPrice);
             assert(0 <= seller_amountLeft);
             assert(0 <= buyer_amountLeft);
             assert(seller_amountForSale == seller_amountLeft + buyer_amountGot);
@@ -287,16 +396,19 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
 
             // record the trade in MPTradeList
             t_tradelistdb->recordMatchedTrade(pold->getHash(), pnew->getHash(), // < might just pass pold, pnew
-                pold->getAddr(), pnew->getAddr(), pold->getDesProperty(), pnew->getDesProperty(), seller_amountGot, buyer_amountGot, pnew->getBlock());
+                pold->getAddr(), pnew->getAddr(), pold->getDesProperty(), pnew->getDesProperty(), seller_amountGot, buyer_amountGot, pnew->getBlock(), pnew->getIdx());
 
             if (msc_debug_metadex1) PrintToLog("++ erased old: %s\n", offerIt->ToString());
             // erase the old seller element
+            NotifyMetaDExOrderChange(offerIt->getHash());
             pofferSet->erase(offerIt++);
 
-            // insert the updated one in place of the old
+            // insert the updated one in place of the old, which keeps its position in the index
             if (0 < seller_replacement.getAmountRemaining()) {
                 PrintToLog("++ inserting seller_replacement: %s\n", seller_replacement.ToString());
                 pofferSet->insert(seller_replacement);
+            } else {
+                UnindexOrder(seller_replacement);
             }
 
             if (bBuyerSatisfied) {
@@ -305,9 +417,21 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             }
         } // specific price, check all properties
 
+        // drop the price level, once all offers at this price are gone
+        if (pofferSet->empty()) {
+            ppriceMap->erase(priceIt++);
+        } else {
+            ++priceIt;
+        }
+
         if (bBuyerSatisfied) break;
     } // check all prices
 
+    // drop the market, once there are no price levels left
+    if (ppriceMap->empty()) {
+        metadex.erase(std::make_pair(propertyDesired, propertyForSale));
+    }
+
     PrintToLog("%s()=%d:%s\n", __FUNCTION__, NewReturn, getTradeReturnType(NewReturn));
 
     return NewReturn;
@@ -377,8 +501,8 @@ rational_t CMPMetaDEx::inversePrice() const
 int64_t CMPMetaDEx::getAmountToFill() const
 {
     // round up to ensure that the amount we present will actually result in buying all available tokens
-    uint256 iAmountNeededToFill = DivideAndRoundUp((ConvertTo256(amount_remaining) * ConvertTo256(amount_desired)), ConvertTo256(amount_forsale));
-    int64_t nAmountNeededToFill = ConvertTo64(iAmountNeededToFill);
+    int64_t nAmountNeededToFill = 0;
+    assert(MultiplyAndDivideRoundUp(amount_remaining, amount_desired, amount_forsale, nAmountNeededToFill));
     return nAmountNeededToFill;
 }
 
@@ -429,37 +553,37 @@ bool MetaDEx_compare::operator()(const CMPMetaDEx &lhs, const CMPMetaDEx &rhs) c
     else return lhs.getBlock() < rhs.getBlock();
 }
 
-bool mastercore::MetaDEx_INSERT(const CMPMetaDEx& objMetaDEx)
+/**
+ * Orders objects by unit price, and then by block and position within the block.
+ */
+bool MetaDEx_price_compare::operator()(const CMPMetaDEx& lhs, const CMPMetaDEx& rhs) const
 {
-    // Create an empty price map (to use in case price map for this property does not already exist)
-    md_PricesMap temp_prices;
-    // Attempt to obtain the price map for the property
-    md_PricesMap *p_prices = get_Prices(objMetaDEx.getProperty());
-
-    // Create an empty set of metadex objects (to use in case no set currently exists at this price)
-    md_Set temp_indexes;
-    md_Set *p_indexes = NULL;
-
-    // Prepare for return code
-    std::pair <md_Set::iterator, bool> ret;
-
-    // Attempt to obtain a set of metadex objects for this price from the price map
-    if (p_prices) p_indexes = get_Indexes(p_prices, objMetaDEx.unitPrice());
-    // See if the set was populated, if not no set exists at this price level, use the empty set that we created earlier
-    if (!p_indexes) p_indexes = &temp_indexes;
-
-    // Attempt to insert the metadex object into the set
-    ret = p_indexes->insert(objMetaDEx);
-    if (false == ret.second) return false;
+    const md_Price lhsPrice = lhs.fixedUnitPrice();
+    const md_Price rhsPrice = rhs.fixedUnitPrice();
+    if (lhsPrice != rhsPrice) return lhsPrice < rhsPrice;
+    return MetaDEx_compare()(lhs, rhs);
+}
 
-    // If a prices map did not exist for this property, set p_prices to the temp empty price map
-    if (!p_prices) p_prices = &temp_prices;
+bool mastercore::MetaDEx_INSERT(const CMPMetaDEx& objMetaDEx)
+{
+    const md_PropertyPair market = std::make_pair(objMetaDEx.getProperty(), objMetaDEx.getDesProperty());
+    const rational_t price = objMetaDEx.unitPrice();
+
+    // Look for an existing order first, so no empty market or price level is left behind
+    md_PropertiesMap::const_iterator itMarket = metadex.find(market);
+    if (itMarket != metadex.end()) {
+        md_PricesMap::const_iterator itPrice = itMarket->second.find(price);
+        if (itPrice != itMarket->second.end() && itPrice->second.count(objMetaDEx) > 0) {
+            return false;
+        }
+    }
 
-    // Update the prices map with the new set at this price
-    (*p_prices)[objMetaDEx.unitPrice()] = *p_indexes;
+    MarkMetaDExMarketDirty(objMetaDEx.getProperty(), objMetaDEx.getDesProperty());
 
-    // Set the metadex map for the property to the updated (or new if it didn't exist) price map
-    metadex[objMetaDEx.getProperty()] = *p_prices;
+    // Insert the metadex object, and create the market and price level, if none exist yet
+    NotifyMetaDExOrderChange(objMetaDEx.getHash());
+    metadex[market][price].insert(objMetaDEx);
+    IndexOrder(objMetaDEx);
 
     return true;
 }
@@ -500,12 +624,63 @@ int mastercore::MetaDEx_ADD(const std::string& sender_addr, uint32_t prop, int64
     return rc;
 }
 
+/**
+ * Orders objects by property, then by unit price, and then by block and position within the block.
+ */
+struct MetaDEx_property_price_compare
+{
+    bool operator()(const CMPMetaDEx& lhs, const CMPMetaDEx& rhs) const
+    {
+        if (lhs.getProperty() != rhs.getProperty()) return lhs.getProperty() < rhs.getProperty();
+        return MetaDEx_price_compare()(lhs, rhs);
+    }
+};
+
+/**
+ * Cancels open orders, moves the reserved tokens back to the balance, and records
+ * the cancellations in the given order.
+ */
+static void CancelOrders(const uint256& txid, unsigned int block, const std::vector<CMPMetaDEx>& vOrders, const char* pszContext)
+{
+    for (std::vector<CMPMetaDEx>::const_iterator it = vOrders.begin(); it != vOrders.end(); ++it) {
+        PrintToLog("%s(): REMOVING %s\n", pszContext, it->ToString());
+
+        // move from reserve to balance
+        assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
+        assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
+
+        // record the cancellation
+        bool bValid = true;
+        p_txlistdb->recordMetaDExCancelTX(txid, it->getHash(), bValid, block, it->getProperty(), it->getAmountRemaining());
+
+        md_PricesMap* prices = get_Prices(it->getProperty(), it->getDesProperty());
+        md_Set* indexes = get_Indexes(prices, it->unitPrice());
+        assert(indexes);
+        NotifyMetaDExOrderChange(it->getHash());
+        UnindexOrder(*it);
+        indexes->erase(*it);
+        MarkMetaDExMarketDirty(it->getProperty(), it->getDesProperty());
+
+        // drop the price level and the market, once they are empty
+        if (indexes->empty()) {
+            prices->erase(it->unitPrice());
+        }
+        if (prices->empty()) {
+            metadex.erase(std::make_pair(it->getProperty(), it->getDesProperty()));
+        }
+    }
+}
+
+/**
+ * Cancels the orders of an address in a market at the given unit price.
+ *
+ * The orders are cancelled by block and position within the block.
+ */
 int mastercore::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block, const std::string& sender_addr, uint32_t prop, int64_t amount, uint32_t property_desired, int64_t amount_desired)
 {
     int rc = METADEX_ERROR -20;
     CMPMetaDEx mdex(sender_addr, 0, prop, amount, property_desired, amount_desired, 0, 0, CMPTransaction::CANCEL_AT_PRICE);
-    md_PricesMap* prices = get_Prices(prop);
-    const CMPMetaDEx* p_mdex = NULL;
+    md_PricesMap* prices = get_Prices(prop, property_desired);
 
     if (msc_debug_metadex1) PrintToLog("%s():%s\n", __FUNCTION__, mdex.ToString());
 
@@ -516,49 +691,31 @@ int mastercore::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block,
         return rc -1;
     }
 
-    // within the desired property map (given one property) iterate over the items
-    for (md_PricesMap::iterator my_it = prices->begin(); my_it != prices->end(); ++my_it) {
-        rational_t sellers_price = my_it->first;
-
-        if (mdex.unitPrice() != sellers_price) continue;
-
-        md_Set* indexes = &(my_it->second);
+    // only the sender's own orders at the exact price level are considered
+    const md_PropertyPair market = std::make_pair(prop, property_desired);
+    const rational_t price = mdex.unitPrice();
+    std::vector<CMPMetaDEx> vecCancels;
+    GetOwnerOrders(sender_addr, &market, &price, vecCancels);
+    std::sort(vecCancels.begin(), vecCancels.end(), MetaDEx_compare());
 
-        for (md_Set::iterator iitt = indexes->begin(); iitt != indexes->end();) {
-            p_mdex = &(*iitt);
-
-            if (msc_debug_metadex3) PrintToLog("%s(): %s\n", __FUNCTION__, p_mdex->ToString());
-
-            if ((p_mdex->getDesProperty() != property_desired) || (p_mdex->getAddr() != sender_addr)) {
-                ++iitt;
-                continue;
-            }
-
-            rc = 0;
-            PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, p_mdex->ToString());
-
-            // move from reserve to main
-            assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), -p_mdex->getAmountRemaining(), METADEX_RESERVE));
-            assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), p_mdex->getAmountRemaining(), BALANCE));
-
-            // record the cancellation
-            bool bValid = true;
-            p_txlistdb->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
-
-            indexes->erase(iitt++);
-        }
-    }
+    if (!vecCancels.empty()) rc = 0;
+    CancelOrders(txid, block, vecCancels, __FUNCTION__);
 
     if (msc_debug_metadex2) MetaDEx_debug_print();
 
     return rc;
 }
 
+/**
+ * Cancels the orders of an address in a market.
+ *
+ * The orders are cancelled in the order of their prices, and then by block and
+ * position within the block.
+ */
 int mastercore::MetaDEx_CANCEL_ALL_FOR_PAIR(const uint256& txid, unsigned int block, const std::string& sender_addr, uint32_t prop, uint32_t property_desired)
 {
     int rc = METADEX_ERROR -30;
-    md_PricesMap* prices = get_Prices(prop);
-    const CMPMetaDEx* p_mdex = NULL;
+    md_PricesMap* prices = get_Prices(prop, property_desired);
 
     PrintToLog("%s(%d,%d)\n", __FUNCTION__, prop, property_desired);
 
@@ -569,34 +726,13 @@ int mastercore::MetaDEx_CANCEL_ALL_FOR_PAIR(const uint256& txid, unsigned int bl
         return rc -1;
     }
 
-    // within the desired property map (given one property) iterate over the items
-    for (md_PricesMap::iterator my_it = prices->begin(); my_it != prices->end(); ++my_it) {
-        md_Set* indexes = &(my_it->second);
-
-        for (md_Set::iterator iitt = indexes->begin(); iitt != indexes->end();) {
-            p_mdex = &(*iitt);
-
-            if (msc_debug_metadex3) PrintToLog("%s(): %s\n", __FUNCTION__, p_mdex->ToString());
-
-            if ((p_mdex->getDesProperty() != property_desired) || (p_mdex->getAddr() != sender_addr)) {
-                ++iitt;
-                continue;
-            }
-
-            rc = 0;
-            PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, p_mdex->ToString());
+    const md_PropertyPair market = std::make_pair(prop, property_desired);
+    std::vector<CMPMetaDEx> vecCancels;
+    GetOwnerOrders(sender_addr, &market, NULL, vecCancels);
+    std::sort(vecCancels.begin(), vecCancels.end(), MetaDEx_price_compare());
 
-            // move from reserve to main
-            assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), -p_mdex->getAmountRemaining(), METADEX_RESERVE));
-            assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), p_mdex->getAmountRemaining(), BALANCE));
-
-            // record the cancellation
-            bool bValid = true;
-            p_txlistdb->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
-
-            indexes->erase(iitt++);
-        }
-    }
+    if (!vecCancels.empty()) rc = 0;
+    CancelOrders(txid, block, vecCancels, __FUNCTION__);
 
     if (msc_debug_metadex3) MetaDEx_debug_print();
 
@@ -605,6 +741,10 @@ int mastercore::MetaDEx_CANCEL_ALL_FOR_PAIR(const uint256& txid, unsigned int bl
 
 /**
  * Scans the orderbook and remove everything for an address.
+ *
+ * The orders of a property are cancelled in the order of their prices, and then
+ * by block and position, independent of the desired property of the orders.
+ * Properties are handled in ascending order.
  */
 int mastercore::MetaDEx_CANCEL_EVERYTHING(const uint256& txid, unsigned int block, const std::string& sender_addr, unsigned char ecosystem)
 {
@@ -616,45 +756,31 @@ int mastercore::MetaDEx_CANCEL_EVERYTHING(const uint256& txid, unsigned int bloc
 
     PrintToLog("<<<<<<\n");
 
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        unsigned int prop = my_it->first;
-
-        // skip property, if it is not in the expected ecosystem
-        if (isMainEcosystemProperty(ecosystem) && !isMainEcosystemProperty(prop)) continue;
-        if (isTestEcosystemProperty(ecosystem) && !isTestEcosystemProperty(prop)) continue;
-
-        PrintToLog(" ## property: %u\n", prop);
-        md_PricesMap& prices = my_it->second;
-
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
-            rational_t price = it->first;
-            md_Set& indexes = it->second;
-
-            PrintToLog("  # Price Level: %s\n", xToString(price));
-
-            for (md_Set::iterator it = indexes.begin(); it != indexes.end();) {
-                PrintToLog("%s= %s\n", xToString(price), it->ToString());
-
-                if (it->getAddr() != sender_addr) {
-                    ++it;
-                    continue;
-                }
+    std::vector<CMPMetaDEx> vecOwned;
+    GetOwnerOrders(sender_addr, NULL, NULL, vecOwned);
 
-                rc = 0;
-                PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, it->ToString());
+    // skip properties, which are not in the expected ecosystem
+    std::vector<CMPMetaDEx> vecCancels;
+    for (std::vector<CMPMetaDEx>::const_iterator it = vecOwned.begin(); it != vecOwned.end(); ++it) {
+        if (isMainEcosystemProperty(ecosystem) && !isMainEcosystemProperty(it->getProperty())) continue;
+        if (isTestEcosystemProperty(ecosystem) && !isTestEcosystemProperty(it->getProperty())) continue;
+        vecCancels.push_back(*it);
+    }
+    std::sort(vecCancels.begin(), vecCancels.end(), MetaDEx_property_price_compare());
 
-                // move from reserve to balance
-                assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
-                assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
+    if (!vecCancels.empty()) rc = 0;
 
-                // record the cancellation
-                bool bValid = true;
-                p_txlistdb->recordMetaDExCancelTX(txid, it->getHash(), bValid, block, it->getProperty(), it->getAmountRemaining());
+    // cancel the orders property by property
+    std::vector<CMPMetaDEx>::const_iterator itBegin = vecCancels.begin();
+    while (itBegin != vecCancels.end()) {
+        std::vector<CMPMetaDEx>::const_iterator itEnd = itBegin;
+        while (itEnd != vecCancels.end() && itEnd->getProperty() == itBegin->getProperty()) ++itEnd;
 
-                indexes.erase(it++);
-            }
-        }
+        PrintToLog(" ## property: %u\n", itBegin->getProperty());
+        CancelOrders(txid, block, std::vector<CMPMetaDEx>(itBegin, itEnd), __FUNCTION__);
+        itBegin = itEnd;
     }
+
     PrintToLog(">>>>>>\n");
 
     if (msc_debug_metadex2) MetaDEx_debug_print();
@@ -666,18 +792,10 @@ int mastercore::MetaDEx_CANCEL_EVERYTHING(const uint256& txid, unsigned int bloc
 // allows search to be optimized if propertyIdForSale is specified
 bool mastercore::MetaDEx_isOpen(const uint256& txid, uint32_t propertyIdForSale)
 {
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        if (propertyIdForSale != 0 && propertyIdForSale != my_it->first) continue;
-        md_PricesMap & prices = my_it->second;
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
-            md_Set & indexes = (it->second);
-            for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                CMPMetaDEx obj = *it;
-                if( obj.getHash().GetHex() == txid.GetHex() ) return true;
-            }
-        }
-    }
-    return false;
+    const CMPMetaDEx* pOrder = LocateOrder(txid);
+    if (!pOrder) return false;
+
+    return (propertyIdForSale == 0 || propertyIdForSale == pOrder->getProperty());
 }
 
 /**
@@ -736,9 +854,10 @@ void mastercore::MetaDEx_debug_print(bool bShowPriceLevel, bool bDisplay)
 {
     PrintToLog("<<<\n");
     for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        uint32_t prop = my_it->first;
+        uint32_t prop = my_it->first.first;
+        uint32_t desprop = my_it->first.second;
 
-        PrintToLog(" ## property: %u\n", prop);
+        PrintToLog(" ## property: %u, desired property: %u\n", prop, desprop);
         md_PricesMap& prices = my_it->second;
 
         for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
@@ -764,14 +883,55 @@ void mastercore::MetaDEx_debug_print(bool bShowPriceLevel, bool bDisplay)
  */
 const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
 {
-    for (md_PropertiesMap::iterator propIter = metadex.begin(); propIter != metadex.end(); ++propIter) {
-        md_PricesMap & prices = propIter->second;
-        for (md_PricesMap::iterator pricesIter = prices.begin(); pricesIter != prices.end(); ++pricesIter) {
-            md_Set & indexes = pricesIter->second;
-            for (md_Set::iterator tradesIter = indexes.begin(); tradesIter != indexes.end(); ++tradesIter) {
-                if (txid == (*tradesIter).getHash()) return &(*tradesIter);
+    return LocateOrder(txid);
+}
+
+/**
+ * Removes all orders from the MetaDEx maps.
+ */
+void mastercore::MetaDEx_CLEAR()
+{
+    metadex.clear();
+    mapOrderLocators.clear();
+    mapOwnerOrders.clear();
+    ClearMetaDExCommitment();
+}
+
+/**
+ * Replaces the open orders of a market.
+ *
+ * The orders of the market are removed from the indexes, before the new ones are inserted.
+ */
+bool mastercore::MetaDEx_SET_MARKET(const md_PropertyPair& market, const std::vector<CMPMetaDEx>& orders)
+{
+    md_PropertiesMap::iterator itMarket = metadex.find(market);
+    if (itMarket != metadex.end()) {
+        for (md_PricesMap::const_iterator itPrice = itMarket->second.begin(); itPrice != itMarket->second.end(); ++itPrice) {
+            for (md_Set::const_iterator it = itPrice->second.begin(); it != itPrice->second.end(); ++it) {
+                NotifyMetaDExOrderChange(it->getHash());
+                UnindexOrder(*it);
             }
         }
+        metadex.erase(itMarket);
+        MarkMetaDExMarketDirty(market.first, market.second);
     }
-    return (CMPMetaDEx*) NULL;
+
+    for (std::vector<CMPMetaDEx>::const_iterator it = orders.begin(); it != orders.end(); ++it) {
+        if (it->getProperty() != market.first || it->getDesProperty() != market.second) {
+            return false;
+        }
+        if (!MetaDEx_INSERT(*it)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Returns the number of open orders in the transaction hash index.
+ */
+size_t mastercore::MetaDEx_getIndexSize()
+{
+    return mapOrderLocators.size();
 }
@@ -1,8 +1,10 @@
 #ifndef OMNICORE_MDEX_H
 #define OMNICORE_MDEX_H
 
+#include "omnicore/mdexmath.h"
 #include "omnicore/tx.h"
 
+#include "serialize.h"
 #include "uint256.h"
 
 #include <boost/lexical_cast.hpp>
@@ -18,6 +20,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 typedef boost::rational<boost::multiprecision::checked_int128_t> rational_t;
 
@@ -94,12 +97,33 @@ public:
     rational_t unitPrice() const;
     rational_t inversePrice() const;
 
+    /** Returns the unit price without normalization, for comparisons. */
+    mastercore::md_Price fixedUnitPrice() const { return mastercore::md_Price(amount_desired, amount_forsale); }
+    /** Returns the inverse unit price without normalization, for comparisons. */
+    mastercore::md_Price fixedInversePrice() const { return mastercore::md_Price(amount_forsale, amount_desired); }
+
     /** Used for display of unit prices to 8 decimal places at UI layer. */
     std::string displayUnitPrice() const;
     /** Used for display of unit prices with 50 decimal places at RPC layer. */
     std::string displayFullUnitPrice() const;
 
     void saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(block);
+        READWRITE(txid);
+        READWRITE(idx);
+        READWRITE(property);
+        READWRITE(amount_forsale);
+        READWRITE(desired_property);
+        READWRITE(amount_desired);
+        READWRITE(amount_remaining);
+        READWRITE(subaction);
+        READWRITE(addr);
+    }
 };
 
 namespace mastercore
@@ -109,19 +133,26 @@ struct MetaDEx_compare
     bool operator()(const CMPMetaDEx& lhs, const CMPMetaDEx& rhs) const;
 };
 
+/** Orders objects by unit price, and then by block and position within the block. */
+struct MetaDEx_price_compare
+{
+    bool operator()(const CMPMetaDEx& lhs, const CMPMetaDEx& rhs) const;
+};
+
 // ---------------
 //! Set of objects sorted by block+idx
 typedef std::set<CMPMetaDEx, MetaDEx_compare> md_Set; 
 //! Map of prices; there is a set of sorted objects for each price
 typedef std::map<rational_t, md_Set> md_PricesMap;
-//! Map of properties; there is a map of prices for each property
-typedef std::map<uint32_t, md_PricesMap> md_PropertiesMap;
+//! Pair of properties; the property for sale and the desired property
+typedef std::pair<uint32_t, uint32_t> md_PropertyPair;
+//! Map of property pairs; there is a map of prices for each market
+typedef std::map<md_PropertyPair, md_PricesMap> md_PropertiesMap;
 
 //! Global map for price and order data
 extern md_PropertiesMap metadex;
 
-// TODO: explore a property-pair, instead of a single property as map's key........
-md_PricesMap* get_Prices(uint32_t prop);
+md_PricesMap* get_Prices(uint32_t prop, uint32_t desprop);
 md_Set* get_Indexes(md_PricesMap* p, rational_t price);
 // ---------------
 
@@ -138,6 +169,15 @@ std::string MetaDEx_getStatusText(int tradeStatus);
 // Locates a trade in the MetaDEx maps via txid and returns the trade object
 const CMPMetaDEx* MetaDEx_RetrieveTrade(const uint256& txid);
 
+/** Removes all orders from the MetaDEx maps. */
+void MetaDEx_CLEAR();
+
+/** Replaces the open orders of a market, for example by persisted ones. */
+bool MetaDEx_SET_MARKET(const md_PropertyPair& market, const std::vector<CMPMetaDEx>& orders);
+
+/** Returns the number of open orders in the transaction hash index. */
+size_t MetaDEx_getIndexSize();
+
 }
 
 
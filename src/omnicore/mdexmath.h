@@ -0,0 +1,134 @@
+/**
+ * @file mdexmath.h
+ *
+ * This file provides fixed-width arithmetic for MetaDEx prices and fills.
+ *
+ * All amounts are positive int64_t values, so products of two amounts fit into
+ * 128 bit. Where the compiler provides a native 128 bit integer type, it is
+ * used, otherwise the calculations fall back to Boost.Multiprecision.
+ */
+
+#ifndef OMNICORE_MDEXMATH_H
+#define OMNICORE_MDEXMATH_H
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <limits>
+
+#if !defined(__SIZEOF_INT128__)
+#include <boost/multiprecision/cpp_int.hpp>
+#endif
+
+namespace mastercore
+{
+#if defined(__SIZEOF_INT128__)
+//! Unsigned 128 bit integer, used for products of amounts
+__extension__ typedef unsigned __int128 md_uint128_t;
+
+/** Converts a 128 bit integer, which is in range of int64_t. */
+inline int64_t ConvertFrom128(const md_uint128_t& number)
+{
+    return static_cast<int64_t>(number);
+}
+#else
+//! Unsigned 128 bit integer, used for products of amounts
+typedef boost::multiprecision::uint128_t md_uint128_t;
+
+/** Converts a 128 bit integer, which is in range of int64_t. */
+inline int64_t ConvertFrom128(const md_uint128_t& number)
+{
+    return number.convert_to<int64_t>();
+}
+#endif
+
+/**
+ * Returns the product of two positive amounts as 128 bit integer.
+ */
+inline md_uint128_t Multiply128(int64_t a, int64_t b)
+{
+    assert(a >= 0);
+    assert(b >= 0);
+    return md_uint128_t(static_cast<uint64_t>(a)) * md_uint128_t(static_cast<uint64_t>(b));
+}
+
+/**
+ * Calculates floor(a * b / c).
+ *
+ * @param result[out]  The result, if it is in range of int64_t
+ * @return True, if the result is in range of int64_t
+ */
+inline bool MultiplyAndDivide(int64_t a, int64_t b, int64_t c, int64_t& result)
+{
+    assert(c > 0);
+    md_uint128_t quotient = Multiply128(a, b) / md_uint128_t(static_cast<uint64_t>(c));
+    if (quotient > md_uint128_t(static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))) return false;
+    result = ConvertFrom128(quotient);
+    return true;
+}
+
+/**
+ * Calculates ceil(a * b / c).
+ *
+ * @param result[out]  The result, if it is in range of int64_t
+ * @return True, if the result is in range of int64_t
+ */
+inline bool MultiplyAndDivideRoundUp(int64_t a, int64_t b, int64_t c, int64_t& result)
+{
+    assert(c > 0);
+    const md_uint128_t divisor(static_cast<uint64_t>(c));
+    const md_uint128_t product = Multiply128(a, b);
+    md_uint128_t quotient = product / divisor;
+    if (quotient * divisor != product) ++quotient;
+    if (quotient > md_uint128_t(static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))) return false;
+    result = ConvertFrom128(quotient);
+    return true;
+}
+
+/**
+ * Price of a MetaDEx order, as ratio of two amounts.
+ *
+ * Unlike rational_t, the ratio is not normalized. Prices are compared by cross
+ * multiplication, so equal prices with different amounts compare equal.
+ */
+class md_Price
+{
+private:
+    int64_t numerator;
+    int64_t denominator;
+
+public:
+    /** Creates a price of zero. */
+    md_Price() : numerator(0), denominator(1) {}
+
+    /** Creates a price, which is zero, if the denominator is zero. */
+    md_Price(int64_t num, int64_t denom) : numerator(num), denominator(denom)
+    {
+        assert(num >= 0);
+        assert(denom >= 0);
+        if (denominator == 0) {
+            numerator = 0;
+            denominator = 1;
+        }
+    }
+
+    int64_t getNumerator() const { return numerator; }
+    int64_t getDenominator() const { return denominator; }
+
+    bool operator==(const md_Price& other) const
+    {
+        return Multiply128(numerator, other.denominator) == Multiply128(other.numerator, denominator);
+    }
+    bool operator!=(const md_Price& other) const { return !(*this == other); }
+
+    bool operator<(const md_Price& other) const
+    {
+        return Multiply128(numerator, other.denominator) < Multiply128(other.numerator, denominator);
+    }
+    bool operator>(const md_Price& other) const { return other < *this; }
+    bool operator<=(const md_Price& other) const { return !(other < *this); }
+    bool operator>=(const md_Price& other) const { return !(*this < other); }
+};
+} // namespace mastercore
+
+#endif // OMNICORE_MDEXMATH_H
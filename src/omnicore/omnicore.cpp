@@ -12,6 +12,7 @@
 #include "omnicore/dex.h"
 #include "omnicore/encoding.h"
 #include "omnicore/errors.h"
+#include "omnicore/inputcache.h"
 #include "omnicore/log.h"
 #include "omnicore/mdex.h"
 #include "omnicore/notifications.h"
@@ -31,17 +32,23 @@
 
 #include "base58.h"
 #include "chainparams.h"
+#include "clientversion.h"
 #include "coincontrol.h"
 #include "coins.h"
 #include "core_io.h"
+#include "crypto/common.h"
+#include "hash.h"
 #include "init.h"
 #include "main.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "script/standard.h"
+#include "serialize.h"
+#include "streams.h"
 #include "sync.h"
 #include "tinyformat.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -53,10 +60,15 @@
 #endif
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/exception/to_string.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
+#include <boost/function.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
 
 #include <openssl/sha.h>
 
@@ -64,12 +76,16 @@
 #include "json/json_spirit_writer_template.h"
 
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
+#include <algorithm>
 #include <fstream>
+#include <list>
 #include <map>
 #include <set>
 #include <string>
@@ -124,6 +140,15 @@ bool autoCommit = true;
 //! Number of "Dev MSC" of the last processed block
 static int64_t exodus_prev = 0;
 
+//! Version of the binary state snapshot format
+static const int STATE_SNAPSHOT_VERSION = 1;
+//! Block hash of the last persisted state, which changes are tracked relative to
+static uint256 hashLastPersistedState;
+//! Addresses with balances, which changed since the state was last persisted
+static std::set<std::string> setDirtyAddresses;
+//! MetaDEx markets, which changed since the state was last persisted
+static std::set<md_PropertyPair> setDirtyMarkets;
+
 static boost::filesystem::path MPPersistencePath;
 
 static int mastercoreInitialized = 0;
@@ -241,16 +266,14 @@ AcceptMap mastercore::my_accepts;
 CMPSPInfo *mastercore::_my_sps;
 CrowdMap mastercore::my_crowds;
 
-// this is the master list of all amounts for all addresses for all properties, map is sorted by Bitcoin address
-std::map<std::string, CMPTally> mastercore::mp_tally_map;
+// this is the master list of all amounts for all addresses for all properties, iterable in the order of the Bitcoin addresses
+CMPTallyMap mastercore::mp_tally_map;
+std::map<uint32_t, HolderMap> mastercore::mp_property_holders;
+std::map<uint32_t, std::vector<int64_t> > mastercore::mp_property_supply;
 
 CMPTally* mastercore::getTally(const std::string& address)
 {
-    std::map<std::string, CMPTally>::iterator it = mp_tally_map.find(address);
-
-    if (it != mp_tally_map.end()) return &(it->second);
-
-    return (CMPTally *) NULL;
+    return mp_tally_map.find(address);
 }
 
 // look at balance for an address
@@ -266,9 +289,9 @@ int64_t getMPbalance(const std::string& address, uint32_t propertyId, TallyType
     }
 
     LOCK(cs_tally);
-    const std::map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(address);
-    if (my_it != mp_tally_map.end()) {
-        balance = (my_it->second).getMoney(propertyId, ttype);
+    const CMPTally* ptally = mp_tally_map.find(address);
+    if (ptally) {
+        balance = ptally->getMoney(propertyId, ttype);
     }
 
     return balance;
@@ -319,7 +342,6 @@ std::string mastercore::getTokenLabel(uint32_t propertyId)
 // optionally counts the number of addresses who own that property: n_owners_total
 int64_t mastercore::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
 {
-    int64_t prev = 0;
     int64_t owners = 0;
     int64_t totalTokens = 0;
 
@@ -330,22 +352,19 @@ int64_t mastercore::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
         return 0; // property ID does not exist
     }
 
-    if (!property.fixed || n_owners_total) {
-        for (std::map<std::string, CMPTally>::const_iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const CMPTally& tally = it->second;
-
-            totalTokens += tally.getMoney(propertyId, BALANCE);
-            totalTokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
-            totalTokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
-            totalTokens += tally.getMoney(propertyId, METADEX_RESERVE);
-
-            if (prev != totalTokens) {
-                prev = totalTokens;
-                owners++;
-            }
+    std::map<uint32_t, std::vector<int64_t> >::const_iterator itSupply = mp_property_supply.find(propertyId);
+    if (itSupply != mp_property_supply.end()) {
+        const std::vector<int64_t>& supply = itSupply->second;
+        for (size_t n = 0; n < supply.size(); ++n) {
+            totalTokens += supply[n];
         }
     }
 
+    std::map<uint32_t, HolderMap>::const_iterator itHolders = mp_property_holders.find(propertyId);
+    if (itHolders != mp_property_holders.end()) {
+        owners = itHolders->second.size();
+    }
+
     if (property.fixed) {
         totalTokens = property.num_tokens; // only valid for TX50
     }
@@ -355,6 +374,108 @@ int64_t mastercore::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
     return totalTokens;
 }
 
+// get the total amount of a property held by all addresses for the given tally type
+int64_t mastercore::getPropertySupply(uint32_t propertyId, TallyType ttype)
+{
+    LOCK(cs_tally);
+
+    std::map<uint32_t, std::vector<int64_t> >::const_iterator it = mp_property_supply.find(propertyId);
+    if (it == mp_property_supply.end() || ttype >= TALLY_TYPE_COUNT) {
+        return 0;
+    }
+
+    return it->second[ttype];
+}
+
+/**
+ * Compares the holders and the supply of each property with the ones determined by
+ * scanning all addresses.
+ *
+ * @return True, if the maintained values match
+ */
+bool mastercore::VerifyPropertySupply()
+{
+    LOCK(cs_tally);
+
+    std::map<uint32_t, HolderMap> scannedHolders;
+    std::map<uint32_t, std::vector<int64_t> > scannedSupply;
+
+    for (CMPTallyMap::iterator it = mp_tally_map.unorderedBegin(); it != mp_tally_map.unorderedEnd(); ++it) {
+        CMPTally& tally = it.getTally();
+        tally.init();
+        uint32_t propertyId = 0;
+        while (0 != (propertyId = tally.next())) {
+            int64_t total = 0;
+            for (int ttype = 0; ttype < TALLY_TYPE_COUNT; ++ttype) {
+                if (ttype == PENDING) continue;
+                int64_t amount = tally.getMoney(propertyId, static_cast<TallyType>(ttype));
+                if (amount == 0) continue;
+                std::vector<int64_t>& supply = scannedSupply[propertyId];
+                supply.resize(TALLY_TYPE_COUNT, 0);
+                supply[ttype] += amount;
+                total += amount;
+            }
+            if (total != 0) {
+                scannedHolders[propertyId][it.getAddress()] = total;
+            }
+        }
+    }
+
+    // properties without supply are not maintained
+    std::map<uint32_t, std::vector<int64_t> > maintainedSupply;
+    for (std::map<uint32_t, std::vector<int64_t> >::const_iterator it = mp_property_supply.begin(); it != mp_property_supply.end(); ++it) {
+        if (std::count(it->second.begin(), it->second.end(), 0) != (int) it->second.size()) {
+            maintainedSupply.insert(*it);
+        }
+    }
+
+    bool fHoldersMatch = (scannedHolders == mp_property_holders);
+    bool fSupplyMatch = (scannedSupply == maintainedSupply);
+
+    if (!fHoldersMatch || !fSupplyMatch) {
+        PrintToLog("%s(): ERROR: maintained holders or supply differ from the tally (holders match: %s, supply match: %s)\n",
+                __func__, fHoldersMatch ? "yes" : "no", fSupplyMatch ? "yes" : "no");
+    }
+
+    return fHoldersMatch && fSupplyMatch;
+}
+
+/**
+ * Updates the holder index and the supply of a property.
+ *
+ * Holders without any balance are removed from the index.
+ */
+static void UpdatePropertyIndexes(const std::string& who, uint32_t propertyId, int64_t amount, TallyType ttype)
+{
+    std::vector<int64_t>& supply = mp_property_supply[propertyId];
+    supply.resize(TALLY_TYPE_COUNT, 0);
+    supply[ttype] += amount;
+
+    HolderMap& holders = mp_property_holders[propertyId];
+    int64_t& total = holders[who];
+    total += amount;
+
+    if (total == 0) {
+        holders.erase(who);
+        if (holders.empty()) {
+            mp_property_holders.erase(propertyId);
+        }
+    }
+}
+
+/**
+ * Clears the tally map, and the holder index and supply maintained along with it.
+ */
+void mastercore::ClearTallyMap()
+{
+    LOCK(cs_tally);
+
+    mp_tally_map.clear();
+    mp_property_holders.clear();
+    mp_property_supply.clear();
+    ClearTallyCommitment();
+}
+
 // return true if everything is ok
 bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, int64_t amount, TallyType ttype)
 {
@@ -373,18 +494,29 @@ bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, i
 
     LOCK(cs_tally);
 
-    before = getMPbalance(who, propertyId, ttype);
+    // an empty element is inserted, if there is none
+    // the balances are read from the tally directly, to avoid further lookups of the address
+    CMPTally& tally = mp_tally_map[who];
+    before = tally.getMoney(propertyId, ttype);
 
-    std::map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(who);
-    if (my_it == mp_tally_map.end()) {
-        // insert an empty element
-        my_it = (mp_tally_map.insert(std::make_pair(who, CMPTally()))).first;
+    // pending amounts are not part of the state commitment
+    if (ttype != PENDING) {
+        NotifyTallyChange(who, propertyId);
     }
 
-    CMPTally& tally = my_it->second;
     bRet = tally.updateMoney(propertyId, amount, ttype);
 
-    after = getMPbalance(who, propertyId, ttype);
+    // pending amounts are not considered as holdings
+    if (bRet && ttype != PENDING) {
+        UpdatePropertyIndexes(who, propertyId, amount, ttype);
+    }
+
+    // changes are only tracked, if there is a persisted state to refer to
+    if (bRet && hashLastPersistedState != 0) {
+        setDirtyAddresses.insert(who);
+    }
+
+    after = tally.getMoney(propertyId, ttype);
     if (!bRet) {
         assert(before == after);
         PrintToLog("%s(%s, %u=0x%X, %+d, ttype=%d) ERROR: insufficient balance (=%d)\n", __func__, who, propertyId, propertyId, amount, ttype, before);
@@ -396,6 +528,28 @@ bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, i
     return bRet;
 }
 
+void mastercore::MarkMetaDExMarketDirty(uint32_t propertyForSale, uint32_t propertyDesired)
+{
+    LOCK(cs_tally);
+
+    // changes are only tracked, if there is a persisted state to refer to
+    if (hashLastPersistedState != 0) {
+        setDirtyMarkets.insert(std::make_pair(propertyForSale, propertyDesired));
+    }
+}
+
+/**
+ * Starts tracking changes relative to the given persisted state.
+ *
+ * If no state is given, changes are not tracked, and the next state is persisted as a whole.
+ */
+static void ResetStateChanges(const uint256& hashPersistedState)
+{
+    hashLastPersistedState = hashPersistedState;
+    setDirtyAddresses.clear();
+    setDirtyMarkets.clear();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // some old TODOs
@@ -483,15 +637,15 @@ void CheckWalletUpdate(bool forceUpdate)
     global_balance_reserved.clear();
 
     // populate global balance totals and wallet property list - note global balances do not include additional balances from watch-only addresses
-    for (std::map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+    for (CMPTallyMap::iterator my_it = mp_tally_map.unorderedBegin(); my_it != mp_tally_map.unorderedEnd(); ++my_it) {
         // check if the address is a wallet address (including watched addresses)
-        std::string address = my_it->first;
+        std::string address = my_it.getAddress();
         int addressIsMine = IsMyAddress(address);
         if (!addressIsMine) continue;
         // iterate only those properties in the TokenMap for this address
-        my_it->second.init();
+        my_it.getTally().init();
         uint32_t propertyId;
-        while (0 != (propertyId = (my_it->second).next())) {
+        while (0 != (propertyId = (my_it.getTally()).next())) {
             // add to the global wallet property list
             global_wallet_property_list.insert(propertyId);
             // check if the address is spendable (only spendable balances are included in totals)
@@ -530,6 +684,9 @@ static bool TXExodusFundraiser(const CTransaction& tx, const std::string& sender
             assert(update_tally_map(sender, OMNI_PROPERTY_MSC, amountGenerated, BALANCE));
             assert(update_tally_map(sender, OMNI_PROPERTY_TMSC, amountGenerated, BALANCE));
 
+            // purchases have no transaction record, so the block would otherwise not be seen as seed block
+            p_txlistdb->recordExodusPurchase(tx.GetHash(), nBlock, amountGenerated);
+
             return true;
         }
     }
@@ -546,31 +703,46 @@ static bool TXExodusFundraiser(const CTransaction& tx, const std::string& sender
  *   3 Class C (op-return)
  */
 int mastercore::GetEncodingClass(const CTransaction& tx, int nBlock)
+{
+    return GetEncodingClass(tx, nBlock, ConsensusParams());
+}
+
+/**
+ * Returns the encoding class, used to embed a payload, based on the given consensus parameters.
+ *
+ * This variant doesn't access the active consensus parameters, so it can be used by
+ * worker threads with a copy of the parameters.
+ */
+int mastercore::GetEncodingClass(const CTransaction& tx, int nBlock, const CConsensusParams& params)
 {
     bool hasExodus = false;
     bool hasMultisig = false;
     bool hasOpReturn = false;
     bool hasMoney = false;
 
+    static const std::vector<unsigned char> vchMarker = GetOmMarker();
+    const CKeyID& exodusKeyID = ExodusKeyID();
+    const CKeyID& crowdsaleKeyID = ExodusCrowdsaleKeyID(nBlock);
+
     for (unsigned int n = 0; n < tx.vout.size(); ++n) {
-        const CTxOut& output = tx.vout[n];
+        const CScript& scriptPubKey = tx.vout[n].scriptPubKey;
 
-        txnouttype outType;
-        if (!GetOutputType(output.scriptPubKey, outType)) {
+        // the common pay-to-pubkey-hash outputs are identified without the solver
+        txnouttype outType = TX_PUBKEYHASH;
+        if (!IsCanonicalPubKeyHash(scriptPubKey) && !GetOutputType(scriptPubKey, outType)) {
             continue;
         }
-        if (!IsAllowedOutputType(outType, nBlock)) {
+        if (!IsAllowedOutputType(outType, nBlock, params)) {
             continue;
         }
 
         if (outType == TX_PUBKEYHASH) {
-            CTxDestination dest;
-            if (ExtractDestination(output.scriptPubKey, dest)) {
-                CBitcoinAddress address(dest);
-                if (address == ExodusAddress()) {
+            uint160 hash;
+            if (GetPubKeyHash(scriptPubKey, hash)) {
+                if (hash == exodusKeyID) {
                     hasExodus = true;
                 }
-                if (address == ExodusCrowdsaleAddress(nBlock)) {
+                if (hash == crowdsaleKeyID) {
                     hasMoney = true;
                 }
             }
@@ -581,19 +753,8 @@ int mastercore::GetEncodingClass(const CTransaction& tx, int nBlock)
         if (outType == TX_NULL_DATA) {
             // Ensure there is a payload, and the first pushed element equals,
             // or starts with the "omni" marker
-            std::vector<std::string> scriptPushes;
-            if (!GetScriptPushes(output.scriptPubKey, scriptPushes)) {
-                continue;
-            }
-            if (!scriptPushes.empty()) {
-                std::vector<unsigned char> vchMarker = GetOmMarker();
-                std::vector<unsigned char> vchPushed = ParseHex(scriptPushes[0]);
-                if (vchPushed.size() < vchMarker.size()) {
-                    continue;
-                }
-                if (std::equal(vchMarker.begin(), vchMarker.end(), vchPushed.begin())) {
-                    hasOpReturn = true;
-                }
+            if (FirstPushStartsWith(scriptPubKey, vchMarker)) {
+                hasOpReturn = true;
             }
         }
     }
@@ -618,12 +779,93 @@ CCoinsViewCache mastercore::view(&viewDummy);
 //! Guards coins view cache
 CCriticalSection mastercore::cs_tx_cache;
 
-static unsigned int nCacheHits = 0;
-static unsigned int nCacheMiss = 0;
+//! Default maximal memory usage of the input cache in MB
+static const int DEFAULT_INPUT_CACHE_SIZE = 100;
+
+//! Previous transaction outputs, which are retained across flushes of the coins view cache
+static CInputCache inputCache(DEFAULT_INPUT_CACHE_SIZE << 20);
+
+/**
+ * Logs the statistics of the input cache.
+ */
+static void LogInputCacheStats(const char* pszContext)
+{
+    LOCK(cs_tx_cache);
+    PrintToLog("%s(): input cache [outputs=%d, usage=%d kB, hit=%d, miss=%d, evicted=%d]\n",
+            pszContext, inputCache.GetSize(), inputCache.GetUsage() >> 10, inputCache.GetHits(),
+            inputCache.GetMisses(), inputCache.GetEvictions());
+}
+
+/**
+ * Adds an output to the coins view cache.
+ */
+static void AddToView(const COutPoint& outpoint, const CTxOut& txOut)
+{
+    CCoinsModifier coins = view.ModifyCoins(outpoint.hash);
+    if (outpoint.n >= coins->vout.size()) {
+        coins->vout.resize(outpoint.n+1);
+    }
+    coins->vout[outpoint.n].scriptPubKey = txOut.scriptPubKey;
+    coins->vout[outpoint.n].nValue = txOut.nValue;
+}
+
+/**
+ * Fetches the requested outputs of previous transactions, and adds them to the
+ * input cache and the coins view cache.
+ *
+ * Each previous transaction is read only once. Outputs of transactions of the
+ * current block are taken from the block itself.
+ *
+ * @param mapMissing[in]  The requested outputs per previous transaction
+ * @param pblock[in]      The current block (can be NULL)
+ * @return True, if all outputs were fetched
+ */
+static bool FetchMissingInputs(const std::map<uint256, std::vector<uint32_t> >& mapMissing, const CBlock* pblock)
+{
+    bool fSuccess = true;
+
+    std::map<uint256, const CTransaction*> mapBlockTxs;
+    if (pblock != NULL) {
+        for (std::vector<CTransaction>::const_iterator it = pblock->vtx.begin(); it != pblock->vtx.end(); ++it) {
+            mapBlockTxs.insert(std::make_pair(it->GetHash(), &(*it)));
+        }
+    }
+
+    for (std::map<uint256, std::vector<uint32_t> >::const_iterator it = mapMissing.begin(); it != mapMissing.end(); ++it) {
+        CTransaction txPrev;
+        const CTransaction* ptxPrev = &txPrev;
+
+        std::map<uint256, const CTransaction*>::const_iterator itBlock = mapBlockTxs.find(it->first);
+        if (itBlock != mapBlockTxs.end()) {
+            ptxPrev = itBlock->second;
+        } else {
+            uint256 hashBlock;
+            if (!GetTransaction(it->first, txPrev, hashBlock, true)) {
+                fSuccess = false;
+                continue;
+            }
+        }
+
+        for (std::vector<uint32_t>::const_iterator itOut = it->second.begin(); itOut != it->second.end(); ++itOut) {
+            if (*itOut >= ptxPrev->vout.size()) {
+                fSuccess = false;
+                continue;
+            }
+            COutPoint outpoint(it->first, *itOut);
+            inputCache.Put(outpoint, ptxPrev->vout[*itOut]);
+            AddToView(outpoint, ptxPrev->vout[*itOut]);
+        }
+    }
+
+    return fSuccess;
+}
 
 /**
  * Fetches transaction inputs and adds them to the coins view cache.
  *
+ * Inputs, which are neither in the coins view cache, nor in the input cache,
+ * are fetched from disk.
+ *
  * @param tx[in]  The transaction to fetch inputs for
  * @return True, if all inputs were successfully added to the cache
  */
@@ -633,37 +875,28 @@ static bool FillTxInputCache(const CTransaction& tx)
     static unsigned int nCacheSize = GetArg("-omnitxcache", 500000);
 
     if (view.GetCacheSize() > nCacheSize) {
-        PrintToLog("%s(): clearing cache before insertion [size=%d, hit=%d, miss=%d]\n",
-                __func__, view.GetCacheSize(), nCacheHits, nCacheMiss);
+        PrintToLog("%s(): clearing cache before insertion [size=%d]\n", __func__, view.GetCacheSize());
         view.Flush();
     }
 
-    for (std::vector<CTxIn>::const_iterator it = tx.vin.begin(); it != tx.vin.end(); ++it) {
-        const CTxIn& txIn = *it;
-        unsigned int nOut = txIn.prevout.n;
-        CCoinsModifier coins = view.ModifyCoins(txIn.prevout.hash);
+    std::map<uint256, std::vector<uint32_t> > mapMissing;
 
-        if (coins->IsAvailable(nOut)) {
-            ++nCacheHits;
+    for (std::vector<CTxIn>::const_iterator it = tx.vin.begin(); it != tx.vin.end(); ++it) {
+        const COutPoint& prevout = it->prevout;
+        const CCoins* coins = view.AccessCoins(prevout.hash);
+        if (coins != NULL && coins->IsAvailable(prevout.n)) {
             continue;
-        } else {
-            ++nCacheMiss;
-        }
-
-        CTransaction txPrev;
-        uint256 hashBlock;
-        if (!GetTransaction(txIn.prevout.hash, txPrev, hashBlock, true)) {
-            return false;
         }
 
-        if (nOut >= coins->vout.size()) {
-            coins->vout.resize(nOut+1);
+        CTxOut txOut;
+        if (inputCache.Get(prevout, txOut)) {
+            AddToView(prevout, txOut);
+        } else {
+            mapMissing[prevout.hash].push_back(prevout.n);
         }
-        coins->vout[nOut].scriptPubKey = txPrev.vout[nOut].scriptPubKey;
-        coins->vout[nOut].nValue = txPrev.vout[nOut].nValue;
     }
 
-    return true;
+    return FetchMissingInputs(mapMissing, NULL);
 }
 
 namespace legacy {
@@ -1176,22 +1409,49 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
     return 0;
 }
 
+/** Determines, whether to fall back to legacy transaction parsing/processing, based on the given consensus parameters. */
+static bool useLegacyProcessing(int nBlock, const CConsensusParams& params)
+{
+    static bool fDisableLegacy = GetBoolArg("-omnidisablelegacy", false);
+    return (!IsAllowedOutputType(TX_NULL_DATA, nBlock, params) && !fDisableLegacy);
+}
+
 /** Determines, whether to fall back to legacy transaction parsing/processing. */
 static bool useLegacyProcessing(int nBlock)
 {
-    static bool fDisableLegacy = GetBoolArg("-omnidisablelegacy", false);
-    return (!IsAllowedOutputType(TX_NULL_DATA, nBlock) && !fDisableLegacy);
+    return useLegacyProcessing(nBlock, ConsensusParams());
 }
 
 } // namespace legacy
 
+/** Checks, whether a pushed value looks like a Class A data packet, based on the bytes following the sequence number. */
+static bool IsClassADataPush(const ScriptPush& push)
+{
+    if (push.size() < 9) {
+        return false;
+    }
+    for (int i = 1; i < 8; ++i) {
+        if (push.pbegin[i] != 0) {
+            return false;
+        }
+    }
+    return (push.pbegin[8] == 1 || push.pbegin[8] == 2);
+}
+
+/** Formats a pushed value as hex string for logging. */
+static std::string PushToHex(const ScriptPush& push)
+{
+    return HexStr(push.pbegin, push.pend);
+}
+
 // idx is position within the block, 0-based
 // int msc_tx_push(const CTransaction &wtx, int nBlock, unsigned int idx)
 // INPUT: bRPConly -- set to true to avoid moving funds; to be called from various RPC calls like this
 // RETURNS: 0 if parsed a MP TX
 // RETURNS: < 0 if a non-MP-TX or invalid
 // RETURNS: >0 if 1 or more payments have been made
-static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock, unsigned int idx, CMPTransaction& mp_tx, unsigned int nTime)
+// If the inputs are provided, they are used instead of the global coins view cache.
+static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock, unsigned int idx, CMPTransaction& mp_tx, unsigned int nTime, const CCoinsViewCache* pInputs = NULL)
 {
     assert(bRPConly == mp_tx.isRpcOnly());
 
@@ -1215,12 +1475,13 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
     }
 
     // Add previous transaction inputs to the cache
-    if (!FillTxInputCache(wtx)) {
+    if (pInputs == NULL && !FillTxInputCache(wtx)) {
         PrintToLog("%s() ERROR: failed to get inputs for %s\n", __func__, wtx.GetHash().GetHex());
         return -101;
     }
 
-    assert(view.HaveInputs(wtx));
+    const CCoinsViewCache& inputs = (pInputs != NULL) ? *pInputs : view;
+    assert(inputs.HaveInputs(wtx));
 
     // ### SENDER IDENTIFICATION ###
     std::string strSender;
@@ -1234,7 +1495,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             if (msc_debug_vin) PrintToLog("vin=%d:%s\n", i, wtx.vin[i].scriptSig.ToString());
 
             const CTxIn& txIn = wtx.vin[i];
-            const CTxOut& txOut = view.GetOutputFor(txIn);
+            const CTxOut& txOut = inputs.GetOutputFor(txIn);
 
             assert(!txOut.IsNull());
 
@@ -1273,7 +1534,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             if (msc_debug_vin) PrintToLog("vin=%d:%s\n", vin_n, wtx.vin[vin_n].scriptSig.ToString());
 
             const CTxIn& txIn = wtx.vin[vin_n];
-            const CTxOut& txOut = view.GetOutputFor(txIn);
+            const CTxOut& txOut = inputs.GetOutputFor(txIn);
 
             assert(!txOut.IsNull());
 
@@ -1292,7 +1553,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         }
     }
 
-    int64_t inAll = view.GetValueIn(wtx);
+    int64_t inAll = inputs.GetValueIn(wtx);
     int64_t outAll = wtx.GetValueOut();
     int64_t txFee = inAll - outAll; // miner fee
 
@@ -1304,10 +1565,12 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
     }
 
     // ### DATA POPULATION ### - save output addresses, values and scripts
+    // the payload is assembled directly in the packet buffer of the transaction object,
+    // and the extracted script data refers to the scripts of the transaction
     std::string strReference;
-    unsigned char single_pkt[MAX_PACKETS * PACKET_SIZE];
+    unsigned char* single_pkt = mp_tx.getPacketBuffer();
     unsigned int packet_size = 0;
-    std::vector<std::string> script_data;
+    std::vector<ScriptPush> script_data;
     std::vector<std::string> address_data;
     std::vector<int64_t> value_data;
 
@@ -1335,22 +1598,21 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
 
     // ### CLASS A PARSING ###
     if (omniClass == OMNI_CLASS_A) {
-        std::string strScriptData;
+        const ScriptPush* pScriptData = NULL;
         std::string strDataAddress;
         std::string strRefAddress;
         unsigned char dataAddressSeq = 0xFF;
         unsigned char seq = 0xFF;
         int64_t dataAddressValue = 0;
         for (unsigned k = 0; k < script_data.size(); ++k) { // Step 1, locate the data packet
-            std::string strSub = script_data[k].substr(2,16); // retrieve bytes 1-9 of packet for peek & decode comparison
-            seq = (ParseHex(script_data[k].substr(0,2)))[0]; // retrieve sequence number
-            if ("0000000000000001" == strSub || "0000000000000002" == strSub) { // peek & decode comparison
-                if (strScriptData.empty()) { // confirm we have not already located a data address
-                    strScriptData = script_data[k].substr(2*1,2*PACKET_SIZE_CLASS_A); // populate data packet
+            seq = (script_data[k].size() > 0) ? script_data[k].pbegin[0] : 0; // retrieve sequence number
+            if (IsClassADataPush(script_data[k])) { // peek & decode comparison
+                if (pScriptData == NULL) { // confirm we have not already located a data address
+                    pScriptData = &script_data[k]; // populate data packet
                     strDataAddress = address_data[k]; // record data address
                     dataAddressSeq = seq; // record data address seq num for reference matching
                     dataAddressValue = value_data[k]; // record data address amount for reference matching
-                    if (msc_debug_parser_data) PrintToLog("Data Address located - data[%d]:%s: %s (%s)\n", k, script_data[k], address_data[k], FormatDivisibleMP(value_data[k]));
+                    if (msc_debug_parser_data) PrintToLog("Data Address located - data[%d]:%s: %s (%s)\n", k, PushToHex(script_data[k]), address_data[k], FormatDivisibleMP(value_data[k]));
                 } else { // invalidate - Class A cannot be more than one data packet - possible collision, treat as default (BTC payment)
                     strDataAddress.clear(); //empty strScriptData to block further parsing
                     if (msc_debug_parser_data) PrintToLog("Multiple Data Addresses found (collision?) Class A invalidated, defaulting to BTC payment\n");
@@ -1361,11 +1623,11 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         if (!strDataAddress.empty()) { // Step 2, try to locate address with seqnum = DataAddressSeq+1 (also verify Step 1, we should now have a valid data packet)
             unsigned char expectedRefAddressSeq = dataAddressSeq + 1;
             for (unsigned k = 0; k < script_data.size(); ++k) { // loop through outputs
-                seq = (ParseHex(script_data[k].substr(0,2)))[0]; // retrieve sequence number
+                seq = (script_data[k].size() > 0) ? script_data[k].pbegin[0] : 0; // retrieve sequence number
                 if ((address_data[k] != strDataAddress) && (address_data[k] != exodus_address) && (expectedRefAddressSeq == seq)) { // found reference address with matching sequence number
                     if (strRefAddress.empty()) { // confirm we have not already located a reference address
                         strRefAddress = address_data[k]; // set ref address
-                        if (msc_debug_parser_data) PrintToLog("Reference Address located via seqnum - data[%d]:%s: %s (%s)\n", k, script_data[k], address_data[k], FormatDivisibleMP(value_data[k]));
+                        if (msc_debug_parser_data) PrintToLog("Reference Address located via seqnum - data[%d]:%s: %s (%s)\n", k, PushToHex(script_data[k]), address_data[k], FormatDivisibleMP(value_data[k]));
                     } else { // can't trust sequence numbers to provide reference address, there is a collision with >1 address with expected seqnum
                         strRefAddress.clear(); // blank ref address
                         if (msc_debug_parser_data) PrintToLog("Reference Address sequence number collision, will fall back to evaluating matching output amounts\n");
@@ -1389,7 +1651,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
                             if (value_data[k] == ExodusValues[exodus_idx]) { //this output matches data address value and exodus address value, choose as ref
                                 if (strRefAddress.empty()) {
                                     strRefAddress = address_data[k];
-                                    if (msc_debug_parser_data) PrintToLog("Reference Address located via matching amounts - data[%d]:%s: %s (%s)\n", k, script_data[k], address_data[k], FormatDivisibleMP(value_data[k]));
+                                    if (msc_debug_parser_data) PrintToLog("Reference Address located via matching amounts - data[%d]:%s: %s (%s)\n", k, PushToHex(script_data[k]), address_data[k], FormatDivisibleMP(value_data[k]));
                                 } else {
                                     strRefAddress.clear();
                                     if (msc_debug_parser_data) PrintToLog("Reference Address collision, multiple potential candidates. Class A invalidated, defaulting to BTC payment\n");
@@ -1408,9 +1670,10 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             strDataAddress.clear(); // last validation step, if strRefAddress is empty, blank strDataAddress so we default to BTC payment
         }
         if (!strDataAddress.empty()) { // valid Class A packet almost ready
-            if (msc_debug_parser_data) PrintToLog("valid Class A:from=%s:to=%s:data=%s\n", strSender, strReference, strScriptData);
-            packet_size = PACKET_SIZE_CLASS_A;
-            memcpy(single_pkt, &ParseHex(strScriptData)[0], packet_size);
+            // the data packet follows the sequence number
+            packet_size = std::min(pScriptData->size() - 1, (size_t) PACKET_SIZE_CLASS_A);
+            memcpy(single_pkt, pScriptData->pbegin + 1, packet_size);
+            if (msc_debug_parser_data) PrintToLog("valid Class A:from=%s:to=%s:data=%s\n", strSender, strReference, HexStr(single_pkt, single_pkt + packet_size));
         } else {
             if ((!bRPConly || msc_debug_parser_readonly) && msc_debug_parser_dex) {
                 PrintToLog("!! sender: %s , receiver: %s\n", strSender, strReference);
@@ -1426,7 +1689,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         unsigned int potentialReferenceOutputs = 0; // int to hold number of potential reference outputs
         for (unsigned k = 0; k < address_data.size(); ++k) { // how many potential reference outputs do we have, if just one select it right here
             const std::string& addr = address_data[k];
-            if (msc_debug_parser_data) PrintToLog("ref? data[%d]:%s: %s (%s)\n", k, script_data[k], addr, FormatIndivisibleMP(value_data[k]));
+            if (msc_debug_parser_data) PrintToLog("ref? data[%d]:%s: %s (%s)\n", k, (k < script_data.size()) ? PushToHex(script_data[k]) : "", addr, FormatIndivisibleMP(value_data[k]));
             if (addr != exodus_address) {
                 ++potentialReferenceOutputs;
                 if (1 == potentialReferenceOutputs) {
@@ -1459,7 +1722,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
 
         // ### CLASS B SPECIFC PARSING ###
         if (omniClass == OMNI_CLASS_B) {
-            std::vector<std::string> multisig_script_data;
+            std::vector<ScriptPush> multisig_script_data;
 
             // ### POPULATE MULTISIG SCRIPT DATA ###
             for (unsigned int i = 0; i < wtx.vout.size(); ++i) {
@@ -1498,8 +1761,8 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             }
 
             // ### PREPARE A FEW VARS ###
-            std::string strObfuscatedHashes[1+MAX_SHA256_OBFUSCATION_TIMES];
-            PrepareObfuscatedHashes(strSender, strObfuscatedHashes);
+            std::vector<unsigned char> vchObfuscatedHashes;
+            GetObfuscatedHashes(strSender, nPackets, vchObfuscatedHashes);
             unsigned char packets[MAX_PACKETS][32];
             unsigned int mdata_count = 0;  // multisig data count
 
@@ -1508,29 +1771,27 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
                 assert(mdata_count < MAX_PACKETS);
                 assert(mdata_count < MAX_SHA256_OBFUSCATION_TIMES);
 
-                std::vector<unsigned char> hash = ParseHex(strObfuscatedHashes[mdata_count+1]);
-                std::vector<unsigned char> packet = ParseHex(multisig_script_data[k].substr(2*1,2*PACKET_SIZE));
-                for (unsigned int i = 0; i < packet.size(); i++) { // this is a data packet, must deobfuscate now
-                    packet[i] ^= hash[i];
+                const unsigned char* hash = &vchObfuscatedHashes[mdata_count * 32];
+                const ScriptPush& push = multisig_script_data[k];
+                assert(push.size() > PACKET_SIZE); // via IsAllowedOutputType(), public keys have at least 33 byte
+                for (unsigned int i = 0; i < PACKET_SIZE; i++) { // this is a data packet, must deobfuscate now
+                    packets[mdata_count][i] = push.pbegin[1 + i] ^ hash[i];
                 }
-                memcpy(&packets[mdata_count], &packet[0], PACKET_SIZE);
                 ++mdata_count;
 
                 if (msc_debug_parser_data) {
-                    CPubKey key(ParseHex(multisig_script_data[k]));
+                    CPubKey key(push.pbegin, push.pend);
                     CKeyID keyID = key.GetID();
                     std::string strAddress = CBitcoinAddress(keyID).ToString();
-                    PrintToLog("multisig_data[%d]:%s: %s\n", k, multisig_script_data[k], strAddress);
+                    PrintToLog("multisig_data[%d]:%s: %s\n", k, PushToHex(push), strAddress);
                 }
                 if (msc_debug_parser) {
-                    if (!packet.empty()) {
-                        std::string strPacket = HexStr(packet.begin(), packet.end());
-                        PrintToLog("packet #%d: %s\n", mdata_count, strPacket);
-                    }
+                    std::string strPacket = HexStr(packets[mdata_count - 1], packets[mdata_count - 1] + PACKET_SIZE);
+                    PrintToLog("packet #%d: %s\n", mdata_count, strPacket);
                 }
             }
             packet_size = mdata_count * (PACKET_SIZE - 1);
-            assert(packet_size <= sizeof(single_pkt));
+            assert(packet_size <= MAX_PACKETS * PACKET_SIZE);
 
             // ### FINALIZE CLASS B ###
             for (unsigned int m = 0; m < mdata_count; ++m) { // now decode mastercoin packets
@@ -1547,7 +1808,8 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
 
         // ### CLASS C SPECIFIC PARSING ###
         if (omniClass == OMNI_CLASS_C) {
-            std::vector<std::string> op_return_script_data;
+            std::vector<ScriptPush> op_return_script_data;
+            const std::vector<unsigned char> vchMarker = GetOmMarker();
 
             // ### POPULATE OP RETURN SCRIPT DATA ###
             for (unsigned int n = 0; n < wtx.vout.size(); ++n) {
@@ -1560,26 +1822,22 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
                 }
                 if (whichType == TX_NULL_DATA) {
                     // only consider outputs, which are explicitly tagged
-                    std::vector<std::string> vstrPushes;
-                    if (!GetScriptPushes(wtx.vout[n].scriptPubKey, vstrPushes)) {
+                    std::vector<ScriptPush> vPushes;
+                    if (!GetScriptPushes(wtx.vout[n].scriptPubKey, vPushes)) {
                         continue;
                     }
-                    // TODO: maybe encapsulate the following sort of messy code
-                    if (!vstrPushes.empty()) {
-                        std::vector<unsigned char> vchMarker = GetOmMarker();
-                        std::vector<unsigned char> vchPushed = ParseHex(vstrPushes[0]);
-                        if (vchPushed.size() < vchMarker.size()) {
+                    if (!vPushes.empty()) {
+                        if (vPushes[0].size() < vchMarker.size()) {
                             continue;
                         }
-                        if (std::equal(vchMarker.begin(), vchMarker.end(), vchPushed.begin())) {
-                            size_t sizeHex = vchMarker.size() * 2;
+                        if (std::equal(vchMarker.begin(), vchMarker.end(), vPushes[0].pbegin)) {
                             // strip out the marker at the very beginning
-                            vstrPushes[0] = vstrPushes[0].substr(sizeHex);
+                            vPushes[0].pbegin += vchMarker.size();
                             // add the data to the rest
-                            op_return_script_data.insert(op_return_script_data.end(), vstrPushes.begin(), vstrPushes.end());
+                            op_return_script_data.insert(op_return_script_data.end(), vPushes.begin(), vPushes.end());
 
                             if (msc_debug_parser_data) {
-                                PrintToLog("Class C transaction detected: %s parsed to %s at vout %d\n", wtx.GetHash().GetHex(), vstrPushes[0], n);
+                                PrintToLog("Class C transaction detected: %s parsed to %s at vout %d\n", wtx.GetHash().GetHex(), PushToHex(vPushes[0]), n);
                             }
                         }
                     }
@@ -1587,16 +1845,15 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             }
             // ### EXTRACT PAYLOAD FOR CLASS C ###
             for (unsigned int n = 0; n < op_return_script_data.size(); ++n) {
-                if (!op_return_script_data[n].empty()) {
-                    assert(IsHex(op_return_script_data[n])); // via GetScriptPushes()
-                    std::vector<unsigned char> vch = ParseHex(op_return_script_data[n]);
-                    unsigned int payload_size = vch.size();
+                const ScriptPush& push = op_return_script_data[n];
+                if (push.size() > 0) {
+                    unsigned int payload_size = push.size();
                     if (packet_size + payload_size > MAX_PACKETS * PACKET_SIZE) {
                         payload_size = MAX_PACKETS * PACKET_SIZE - packet_size;
                         PrintToLog("limiting payload size to %d byte\n", packet_size + payload_size);
                     }
                     if (payload_size > 0) {
-                        memcpy(single_pkt+packet_size, &vch[0], payload_size);
+                        memcpy(single_pkt+packet_size, push.pbegin, payload_size);
                         packet_size += payload_size;
                     }
                     if (MAX_PACKETS * PACKET_SIZE == packet_size) {
@@ -1609,7 +1866,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
 
     // ### SET MP TX INFO ###
     if (msc_debug_verbose) PrintToLog("single_pkt: %s\n", HexStr(single_pkt, packet_size + single_pkt));
-    mp_tx.Set(strSender, strReference, 0, wtx.GetHash(), nBlock, idx, (unsigned char *)&single_pkt, packet_size, omniClass, (inAll-outAll));
+    mp_tx.Set(strSender, strReference, 0, wtx.GetHash(), nBlock, idx, single_pkt, packet_size, omniClass, (inAll-outAll));
 
     // TODO: the following is a bit aweful
     // Provide a hint for DEx payments
@@ -1628,87 +1885,472 @@ int ParseTransaction(const CTransaction& tx, int nBlock, unsigned int idx, CMPTr
     return parseTransaction(true, tx, nBlock, idx, mptx, nTime);
 }
 
+//! Maximal number of threads used to prepare the transactions of a block
+static const int MAX_PREPARE_THREADS = 16;
+
+/** A transaction of the current block, which was parsed ahead of its execution. */
+struct PreparedTransaction
+{
+    //! The position within the block
+    unsigned int nIdx;
+    //! The result of parseTransaction()
+    int nResult;
+    //! The parsed transaction
+    CMPTransaction mp_tx;
+    //! The messages logged while parsing, which are printed, when the transaction is executed
+    std::vector<std::string> vLogMessages;
+
+    PreparedTransaction() : nIdx(0), nResult(0) {}
+};
+
+//! Transactions of the current block, which were parsed ahead of their execution, guarded by cs_tally
+static std::map<uint256, PreparedTransaction> mapPreparedTxs;
+//! The block of the prepared transactions
+static int nPreparedBlock = -1;
+
+/**
+ * Returns the number of threads used to prepare the transactions of a block.
+ */
+static int GetPrepareThreads()
+{
+    static int nThreads = std::max(0, std::min((int) GetArg("-omniparsethreads", boost::thread::hardware_concurrency()), MAX_PREPARE_THREADS));
+    return nThreads;
+}
+
 /**
- * Handles potential DEx payments.
- *
- * Note: must *not* be called outside of the transaction handler, and it does not
- * check, if a transaction marker exists.
+ * Long-lived worker threads, which run the jobs to prepare the transactions of
+ * a block along with the calling thread.
  *
- * @return True, if valid
+ * The workers are started once, and wait for the next job, so no threads are
+ * created per block.
  */
-static bool HandleDExPayments(const CTransaction& tx, int nBlock, const std::string& strSender)
+class PrepareThreadPool
 {
-    int count = 0;
+private:
+    boost::mutex m_mutex;
+    boost::condition_variable m_condWorker;
+    boost::condition_variable m_condCaller;
+    boost::thread_group m_threads;
+
+    //! The job currently run, if any
+    const boost::function<void (size_t, size_t)>* m_pJob;
+    //! Number of threads the current job is run on, including the calling thread
+    size_t m_nJobThreads;
+    //! Incremented for every job, so each worker runs a job at most once
+    uint64_t m_nGeneration;
+    //! Number of workers, which didn't finish the current job yet
+    size_t m_nPending;
+    bool m_fStop;
+
+    void worker(size_t nThread)
+    {
+        uint64_t nGeneration = 0;
+        while (true) {
+            const boost::function<void (size_t, size_t)>* pJob = NULL;
+            size_t nThreads = 0;
+            {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_fStop && m_nGeneration == nGeneration) {
+                    m_condWorker.wait(lock);
+                }
+                if (m_fStop) return;
+                nGeneration = m_nGeneration;
+                // not every job uses all workers
+                if (nThread >= m_nJobThreads) continue;
+                pJob = m_pJob;
+                nThreads = m_nJobThreads;
+            }
 
-    for (unsigned int n = 0; n < tx.vout.size(); ++n) {
-        CTxDestination dest;
-        if (ExtractDestination(tx.vout[n].scriptPubKey, dest)) {
-            CBitcoinAddress address(dest);
-            if (address == ExodusAddress()) {
-                continue;
+            (*pJob)(nThread, nThreads);
+
+            {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                --m_nPending;
             }
-            std::string strAddress = address.ToString();
-            if (msc_debug_parser_dex) PrintToLog("payment #%d %s %s\n", count, strAddress, FormatIndivisibleMP(tx.vout[n].nValue));
+            m_condCaller.notify_one();
+        }
+    }
 
-            // check everything and pay BTC for the property we are buying here...
-            if (0 == DEx_payment(tx.GetHash(), n, strAddress, strSender, tx.vout[n].nValue, nBlock)) ++count;
+public:
+    explicit PrepareThreadPool(size_t nWorkers)
+    : m_pJob(NULL), m_nJobThreads(0), m_nGeneration(0), m_nPending(0), m_fStop(false)
+    {
+        for (size_t n = 1; n <= nWorkers; ++n) {
+            m_threads.create_thread(boost::bind(&PrepareThreadPool::worker, this, n));
         }
     }
 
-    return (count > 0);
-}
+    ~PrepareThreadPool()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            m_fStop = true;
+        }
+        m_condWorker.notify_all();
+        m_threads.join_all();
+    }
+
+    /** Runs a job on the calling thread and the given number of threads in total, and waits until all are done. */
+    void run(const boost::function<void (size_t, size_t)>& job, size_t nThreads)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            m_pJob = &job;
+            m_nJobThreads = nThreads;
+            m_nPending = nThreads - 1;
+            ++m_nGeneration;
+        }
+        m_condWorker.notify_all();
+
+        job(0, nThreads);
+
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while (m_nPending > 0) {
+            m_condCaller.wait(lock);
+        }
+        m_pJob = NULL;
+    }
+};
+
+//! Workers to prepare the transactions of a block, started on first use
+static PrepareThreadPool* pPreparePool = NULL;
 
 /**
- * Handles potential Exodus crowdsale purchases.
- *
- * Note: must *not* be called outside of the transaction handler, and it does not
- * check, if a transaction marker exists.
+ * Runs a job on multiple threads, including the calling thread, and waits until
+ * all threads are done.
  *
- * @return True, if it was a valid purchase
+ * The job is called with the index of the thread and the number of threads, and
+ * is expected to process every item with a position, which is congruent to the
+ * thread index, modulo the number of threads.
  */
-static bool HandleExodusPurchase(const CTransaction& tx, int nBlock, const std::string& strSender, unsigned int nTime)
+static void RunPrepareJob(const boost::function<void (size_t, size_t)>& job, size_t nItems)
 {
-    int64_t amountInvested = 0;
-
-    for (unsigned int n = 0; n < tx.vout.size(); ++n) {
-        CTxDestination dest;
-        if (ExtractDestination(tx.vout[n].scriptPubKey, dest)) {
-            if (CBitcoinAddress(dest) == ExodusCrowdsaleAddress(nBlock)) {
-                amountInvested = tx.vout[n].nValue;
-                break; // TODO: maybe sum all values
-            }
-        }
+    size_t nThreads = std::min((size_t) GetPrepareThreads(), nItems);
+    if (nThreads <= 1) {
+        job(0, 1);
+        return;
     }
 
-    if (0 < amountInvested) {
-        return TXExodusFundraiser(tx, strSender, amountInvested, nBlock, nTime);
+    if (pPreparePool == NULL) {
+        pPreparePool = new PrepareThreadPool(GetPrepareThreads() - 1);
     }
-
-    return false;
+    pPreparePool->run(job, nThreads);
 }
 
 /**
- * Reports the progress of the initial transaction scanning.
- *
- * The progress is printed to the console, written to the debug log file, and
- * the RPC status, as well as the splash screen progress label, are updated.
+ * Reads a confirmed transaction via the transaction index.
  *
- * @see msc_initial_scan()
+ * Unlike GetTransaction(), this doesn't require cs_main, so it can be used by
+ * worker threads, while the block handlers hold the lock.
  */
-class ProgressReporter
+static bool ReadIndexedTransaction(const uint256& txid, CTransaction& txOut)
 {
-private:
-    const CBlockIndex* m_pblockFirst;
-    const CBlockIndex* m_pblockLast;
-    const int64_t m_timeStart;
+    CDiskTxPos postx;
+    if (!fTxIndex || pblocktree == NULL || !pblocktree->ReadTxIndex(txid, postx)) {
+        return false;
+    }
+    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        return false;
+    }
+    try {
+        CBlockHeader header;
+        file >> header;
+        fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+        file >> txOut;
+    } catch (const std::exception&) {
+        return false;
+    }
 
-    /** Returns the estimated remaining time in milliseconds. */
-    int64_t estimateRemainingTime(double progress) const
-    {
-        int64_t timeSinceStart = GetTimeMillis() - m_timeStart;
+    return (txOut.GetHash() == txid);
+}
 
-        double timeRemaining = 3600000.0; // 1 hour
-        if (progress > 0.0 && timeSinceStart > 0) {
+/** Reads the previous transactions assigned to a thread. */
+static void ReadPrevTxsJob(const std::vector<uint256>& vTxids, std::vector<CTransaction>& vTxs,
+        std::vector<unsigned char>& vfRead, size_t nThread, size_t nThreads)
+{
+    for (size_t n = nThread; n < vTxids.size(); n += nThreads) {
+        vfRead[n] = ReadIndexedTransaction(vTxids[n], vTxs[n]);
+    }
+}
+
+/** Parses the transactions assigned to a thread, with the inputs resolved upfront. */
+static void ParseTxsJob(const CBlock& block, int nBlock, unsigned int nTime, const std::map<COutPoint, CTxOut>& mapInputs,
+        std::vector<PreparedTransaction>& vPrepared, std::vector<unsigned char>& vfPrepared, size_t nThread, size_t nThreads)
+{
+    for (size_t n = nThread; n < vPrepared.size(); n += nThreads) {
+        PreparedTransaction& prepared = vPrepared[n];
+        const CTransaction& tx = block.vtx[prepared.nIdx];
+
+        CCoinsView viewDummy;
+        CCoinsViewCache inputs(&viewDummy);
+        bool fInputs = true;
+        for (std::vector<CTxIn>::const_iterator it = tx.vin.begin(); it != tx.vin.end() && fInputs; ++it) {
+            std::map<COutPoint, CTxOut>::const_iterator itInput = mapInputs.find(it->prevout);
+            if (itInput == mapInputs.end()) {
+                fInputs = false;
+                break;
+            }
+            CCoinsModifier coins = inputs.ModifyCoins(it->prevout.hash);
+            if (it->prevout.n >= coins->vout.size()) {
+                coins->vout.resize(it->prevout.n+1);
+            }
+            coins->vout[it->prevout.n] = itInput->second;
+        }
+        // transactions with unresolved inputs are parsed during their execution
+        if (!fInputs) continue;
+
+        try {
+            // the log of each transaction is kept, so it isn't interleaved with others
+            CLogCapture logCapture;
+            prepared.mp_tx.unlockLogic();
+            prepared.nResult = parseTransaction(false, tx, nBlock, prepared.nIdx, prepared.mp_tx, nTime, &inputs);
+            logCapture.Take(prepared.vLogMessages);
+            vfPrepared[n] = 1;
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): failed to prepare %s: %s\n", __func__, tx.GetHash().GetHex(), e.what());
+        }
+    }
+}
+
+/**
+ * Resolves the inputs of the candidate transactions of a block, and parses them
+ * ahead of their execution.
+ *
+ * Previous transactions, which are not in the input cache, are read from disk,
+ * and the transactions are parsed, on multiple threads. Neither step depends on
+ * the Omni state, and the results are consumed by the ordered execution in
+ * mastercore_handler_tx().
+ *
+ * Legacy parsing may trigger Exodus purchases and DEx payments, so transactions
+ * of blocks, which use legacy processing, are not parsed ahead.
+ *
+ * @param block[in]         The block
+ * @param nBlock[in]        The height of the block
+ * @param nTime[in]         The time of the block
+ * @param vfCandidates[in]  Whether the transaction at the given position is considered
+ */
+static void PrepareBlockTransactions(const CBlock& block, int nBlock, unsigned int nTime, const std::vector<bool>& vfCandidates)
+{
+    mapPreparedTxs.clear();
+    nPreparedBlock = nBlock;
+
+    if (GetPrepareThreads() < 1) {
+        return;
+    }
+
+    // ### COLLECT INPUTS ###
+    std::map<uint256, const CTransaction*> mapBlockTxs;
+    for (std::vector<CTransaction>::const_iterator it = block.vtx.begin(); it != block.vtx.end(); ++it) {
+        mapBlockTxs.insert(std::make_pair(it->GetHash(), &(*it)));
+    }
+
+    std::vector<unsigned int> vCandidates;
+    std::map<COutPoint, CTxOut> mapInputs;
+    std::vector<COutPoint> vMissing;
+    std::map<uint256, size_t> mapMissingTxs;
+    {
+        LOCK(cs_tx_cache);
+        // the coins view cache only holds the inputs of the current block
+        view.Flush();
+
+        for (unsigned int n = 0; n < block.vtx.size() && n < vfCandidates.size(); ++n) {
+            if (!vfCandidates[n]) continue;
+            const CTransaction& tx = block.vtx[n];
+            if (tx.IsCoinBase()) continue;
+            vCandidates.push_back(n);
+
+            for (std::vector<CTxIn>::const_iterator it = tx.vin.begin(); it != tx.vin.end(); ++it) {
+                const COutPoint& prevout = it->prevout;
+                if (mapInputs.count(prevout)) continue;
+
+                CTxOut txOut;
+                std::map<uint256, const CTransaction*>::const_iterator itBlock = mapBlockTxs.find(prevout.hash);
+                if (itBlock != mapBlockTxs.end() && prevout.n < itBlock->second->vout.size()) {
+                    mapInputs[prevout] = itBlock->second->vout[prevout.n];
+                } else if (inputCache.Get(prevout, txOut)) {
+                    mapInputs[prevout] = txOut;
+                } else {
+                    vMissing.push_back(prevout);
+                    mapMissingTxs.insert(std::make_pair(prevout.hash, mapMissingTxs.size()));
+                }
+            }
+        }
+    }
+
+    // ### READ PREVIOUS TRANSACTIONS ###
+    std::vector<uint256> vTxids(mapMissingTxs.size());
+    for (std::map<uint256, size_t>::const_iterator it = mapMissingTxs.begin(); it != mapMissingTxs.end(); ++it) {
+        vTxids[it->second] = it->first;
+    }
+    std::vector<CTransaction> vTxs(vTxids.size());
+    std::vector<unsigned char> vfRead(vTxids.size(), 0);
+    RunPrepareJob(boost::bind(&ReadPrevTxsJob, boost::cref(vTxids), boost::ref(vTxs), boost::ref(vfRead), _1, _2), vTxids.size());
+
+    {
+        LOCK(cs_tx_cache);
+        for (std::vector<COutPoint>::const_iterator it = vMissing.begin(); it != vMissing.end(); ++it) {
+            size_t nTx = mapMissingTxs[it->hash];
+            if (!vfRead[nTx] || it->n >= vTxs[nTx].vout.size()) {
+                continue;
+            }
+            mapInputs[*it] = vTxs[nTx].vout[it->n];
+            inputCache.Put(*it, vTxs[nTx].vout[it->n]);
+        }
+    }
+
+    // ### PARSE TRANSACTIONS ###
+    if (legacy::useLegacyProcessing(nBlock)) {
+        return;
+    }
+
+    std::vector<PreparedTransaction> vPrepared(vCandidates.size());
+    std::vector<unsigned char> vfPrepared(vCandidates.size(), 0);
+    for (size_t n = 0; n < vCandidates.size(); ++n) {
+        vPrepared[n].nIdx = vCandidates[n];
+    }
+    RunPrepareJob(boost::bind(&ParseTxsJob, boost::cref(block), nBlock, nTime, boost::cref(mapInputs),
+            boost::ref(vPrepared), boost::ref(vfPrepared), _1, _2), vPrepared.size());
+
+    for (size_t n = 0; n < vPrepared.size(); ++n) {
+        if (vfPrepared[n]) {
+            mapPreparedTxs.insert(std::make_pair(block.vtx[vPrepared[n].nIdx].GetHash(), vPrepared[n]));
+        }
+    }
+}
+
+/**
+ * Takes a transaction, which was parsed ahead of its execution.
+ *
+ * The messages logged while parsing the transaction are printed at this point.
+ *
+ * @return True, if the transaction was prepared for the given block and position
+ */
+static bool TakePreparedTransaction(const uint256& txid, int nBlock, unsigned int idx, CMPTransaction& mp_tx, int& nResult)
+{
+    if (nBlock != nPreparedBlock) {
+        return false;
+    }
+    std::map<uint256, PreparedTransaction>::iterator it = mapPreparedTxs.find(txid);
+    if (it == mapPreparedTxs.end() || it->second.nIdx != idx) {
+        return false;
+    }
+    mp_tx = it->second.mp_tx;
+    nResult = it->second.nResult;
+
+    // print the messages of parsing, as if the transaction were parsed now
+    const std::vector<std::string>& vLogMessages = it->second.vLogMessages;
+    for (std::vector<std::string>::const_iterator itLog = vLogMessages.begin(); itLog != vLogMessages.end(); ++itLog) {
+        LogFilePrint(*itLog);
+    }
+    mapPreparedTxs.erase(it);
+
+    return true;
+}
+
+/**
+ * Parses a transaction of a block ahead of its execution, in the same way as when
+ * the block is connected.
+ *
+ * All transactions of the block are prepared, and inputs are only resolved from
+ * the block itself, the input cache, or the transaction index.
+ *
+ * @return True, if the transaction was prepared
+ */
+bool ParsePreparedTransaction(const CBlock& block, int nBlock, unsigned int idx, CMPTransaction& mptx, int& nResult, unsigned int nTime)
+{
+    LOCK(cs_tally);
+
+    PrepareBlockTransactions(block, nBlock, nTime, std::vector<bool>(block.vtx.size(), true));
+    bool fPrepared = (idx < block.vtx.size()) && TakePreparedTransaction(block.vtx[idx].GetHash(), nBlock, idx, mptx, nResult);
+
+    mapPreparedTxs.clear();
+    nPreparedBlock = -1;
+
+    return fPrepared;
+}
+
+/**
+ * Handles potential DEx payments.
+ *
+ * Note: must *not* be called outside of the transaction handler, and it does not
+ * check, if a transaction marker exists.
+ *
+ * @return True, if valid
+ */
+static bool HandleDExPayments(const CTransaction& tx, int nBlock, const std::string& strSender)
+{
+    int count = 0;
+
+    for (unsigned int n = 0; n < tx.vout.size(); ++n) {
+        CTxDestination dest;
+        if (ExtractDestination(tx.vout[n].scriptPubKey, dest)) {
+            CBitcoinAddress address(dest);
+            if (address == ExodusAddress()) {
+                continue;
+            }
+            std::string strAddress = address.ToString();
+            if (msc_debug_parser_dex) PrintToLog("payment #%d %s %s\n", count, strAddress, FormatIndivisibleMP(tx.vout[n].nValue));
+
+            // check everything and pay BTC for the property we are buying here...
+            if (0 == DEx_payment(tx.GetHash(), n, strAddress, strSender, tx.vout[n].nValue, nBlock)) ++count;
+        }
+    }
+
+    return (count > 0);
+}
+
+/**
+ * Handles potential Exodus crowdsale purchases.
+ *
+ * Note: must *not* be called outside of the transaction handler, and it does not
+ * check, if a transaction marker exists.
+ *
+ * @return True, if it was a valid purchase
+ */
+static bool HandleExodusPurchase(const CTransaction& tx, int nBlock, const std::string& strSender, unsigned int nTime)
+{
+    int64_t amountInvested = 0;
+
+    for (unsigned int n = 0; n < tx.vout.size(); ++n) {
+        CTxDestination dest;
+        if (ExtractDestination(tx.vout[n].scriptPubKey, dest)) {
+            if (CBitcoinAddress(dest) == ExodusCrowdsaleAddress(nBlock)) {
+                amountInvested = tx.vout[n].nValue;
+                break; // TODO: maybe sum all values
+            }
+        }
+    }
+
+    if (0 < amountInvested) {
+        return TXExodusFundraiser(tx, strSender, amountInvested, nBlock, nTime);
+    }
+
+    return false;
+}
+
+/**
+ * Reports the progress of the initial transaction scanning.
+ *
+ * The progress is printed to the console, written to the debug log file, and
+ * the RPC status, as well as the splash screen progress label, are updated.
+ *
+ * @see msc_initial_scan()
+ */
+class ProgressReporter
+{
+private:
+    const CBlockIndex* m_pblockFirst;
+    const CBlockIndex* m_pblockLast;
+    const int64_t m_timeStart;
+
+    /** Returns the estimated remaining time in milliseconds. */
+    int64_t estimateRemainingTime(double progress) const
+    {
+        int64_t timeSinceStart = GetTimeMillis() - m_timeStart;
+
+        double timeRemaining = 3600000.0; // 1 hour
+        if (progress > 0.0 && timeSinceStart > 0) {
             timeRemaining = (100.0 - progress) / progress * timeSinceStart;
         }
 
@@ -1763,93 +2405,428 @@ public:
 };
 
 /**
- * Scans the blockchain for meta transactions.
+ * Checks on the raw scripts, whether a transaction may carry an Exodus or Omni marker.
  *
- * It scans the blockchain, starting at the given block index, to the current
- * tip, much like as if new block were arriving and being processed on the fly.
- *
- * Every 30 seconds the progress of the scan is reported.
- *
- * In case the current block being processed is not part of the active chain, or
- * if a block could not be retrieved from the disk, then the scan stops early.
- * Likewise, global shutdown requests are honored, and stop the scan progress.
- *
- * @see mastercore_handler_block_begin()
- * @see mastercore_handler_tx()
- * @see mastercore_handler_block_end()
- *
- * @param nFirstBlock[in]  The index of the first block to scan
- * @return An exit code, indicating success or failure
+ * Only null data outputs and outputs to the Exodus or crowdsale address can mark
+ * a transaction, so most transactions are ruled out without running the solver.
+ * Pay-to-pubkey-hash outputs in a non-canonical form are passed on to the full check.
  */
-static int msc_initial_scan(int nFirstBlock)
+static bool MayHaveMarker(const CTransaction& tx, int nBlock)
 {
-    int nTimeBetweenProgressReports = GetArg("-omniprogressfrequency", 30);  // seconds
-    int64_t nNow = GetTime();
-    unsigned int nTxsTotal = 0;
-    unsigned int nTxsFoundTotal = 0;
-    int nBlock = 999999;
-    const int nLastBlock = GetHeight();
+    const CKeyID& exodusKeyID = ExodusKeyID();
+    const CKeyID& crowdsaleKeyID = ExodusCrowdsaleKeyID(nBlock);
 
-    // this function is useless if there are not enough blocks in the blockchain yet!
-    if (nFirstBlock < 0 || nLastBlock < nFirstBlock) return -1;
-    PrintToConsole("Scanning for transactions in block %d to block %d..\n", nFirstBlock, nLastBlock);
+    for (unsigned int n = 0; n < tx.vout.size(); ++n) {
+        const CScript& scriptPubKey = tx.vout[n].scriptPubKey;
+        if (scriptPubKey.size() < 2) {
+            continue;
+        }
+        if (scriptPubKey[0] == OP_RETURN) {
+            return true;
+        }
+        if (IsCanonicalPubKeyHash(scriptPubKey)) {
+            if (memcmp(&scriptPubKey[3], exodusKeyID.begin(), 20) == 0) return true;
+            if (memcmp(&scriptPubKey[3], crowdsaleKeyID.begin(), 20) == 0) return true;
+        } else if (scriptPubKey[0] == OP_DUP && scriptPubKey[1] == OP_HASH160) {
+            return true;
+        }
+    }
 
-    // used to print the progress to the console and notifies the UI
-    ProgressReporter progressReporter(chainActive[nFirstBlock], chainActive[nLastBlock]);
+    return false;
+}
 
-    // check if using seed block filter should be disabled
-    bool seedBlockFilterEnabled = GetBoolArg("-omniseedblockfilter", true);
+/**
+ * Checks, whether a transaction carries an Exodus or Omni marker.
+ *
+ * Transactions without marker are ignored by the parser, so there is no need
+ * to pass them to mastercore_handler_tx() during the initial scan.
+ *
+ * Only the given consensus parameters are used, so worker threads can run the
+ * check with their own copy of the parameters.
+ */
+static bool HasMarker(const CTransaction& tx, int nBlock, const CConsensusParams& params)
+{
+    if (!legacy::useLegacyProcessing(nBlock, params)) {
+        return MayHaveMarker(tx, nBlock) && (GetEncodingClass(tx, nBlock, params) != NO_MARKER);
+    }
 
-    for (nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock)
-    {
-        if (ShutdownRequested()) {
-            PrintToLog("Shutdown requested, stop scan at block %d of %d\n", nBlock, nLastBlock);
-            break;
+    // legacy marker check: a send to the Exodus address, or the moneyman on testnet
+    for (unsigned int i = 0; i < tx.vout.size(); ++i) {
+        const CScript& scriptPubKey = tx.vout[i].scriptPubKey;
+
+        CKeyID keyID;
+        if (IsCanonicalPubKeyHash(scriptPubKey)) {
+            memcpy(keyID.begin(), &scriptPubKey[3], 20);
+        } else {
+            CTxDestination dest;
+            if (!ExtractDestination(scriptPubKey, dest)) continue;
+            const CKeyID* pKeyID = boost::get<CKeyID>(&dest);
+            if (NULL == pKeyID) continue;
+            keyID = *pKeyID;
         }
+        if (keyID == ExodusKeyID()) return true;
+        if (isNonMainNet() && keyID == ExodusCrowdsaleKeyID(MONEYMAN_TESTNET_BLOCK)) return true; // moneyman
+    }
 
-        CBlockIndex* pblockindex = chainActive[nBlock];
-        if (NULL == pblockindex) break;
-        std::string strBlockHash = pblockindex->GetBlockHash().GetHex();
+    return false;
+}
 
-        if (msc_debug_exo) PrintToLog("%s(%d; max=%d):%s, line %d, file: %s\n",
-            __FUNCTION__, nBlock, nLastBlock, strBlockHash, __LINE__, __FILE__);
+//! Maximum number of threads used to prefetch blocks during the initial scan
+static const int MAX_SCAN_THREADS = 16;
 
-        if (GetTime() >= nNow + nTimeBetweenProgressReports) {
-            progressReporter.update(pblockindex);
-            nNow = GetTime();
-        }
+/** A block, which was read and pre-filtered for the initial scan. */
+struct ScanBlock
+{
+    //! Whether the block was skipped by the seed block filter
+    bool fSkipped;
+    //! Whether the block was successfully read from disk
+    bool fRead;
+    //! The block itself
+    CBlock block;
+    //! Whether the transaction at the given position has a marker
+    std::vector<bool> vfMarker;
+    //! The generation of the consensus parameters, which were used to check for markers
+    uint64_t nParamsGeneration;
+
+    ScanBlock() : fSkipped(false), fRead(false), nParamsGeneration(0) {}
+};
 
-        unsigned int nTxNum = 0;
-        unsigned int nTxsFoundInBlock = 0;
-        mastercore_handler_block_begin(nBlock, pblockindex);
+/**
+ * Checks the transactions of a block for markers, based on the given consensus parameters.
+ */
+static void CheckScanBlockMarkers(int nBlock, const CConsensusParams& params, ScanBlock& scanBlock)
+{
+    scanBlock.vfMarker.resize(scanBlock.block.vtx.size());
 
-        if (!seedBlockFilterEnabled || !SkipBlock(nBlock)) {
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pblockindex)) break;
+    for (unsigned int n = 0; n < scanBlock.block.vtx.size(); ++n) {
+        scanBlock.vfMarker[n] = HasMarker(scanBlock.block.vtx[n], nBlock, params);
+    }
+}
 
-            BOOST_FOREACH(const CTransaction&tx, block.vtx) {
-                if (mastercore_handler_tx(tx, nBlock, nTxNum, pblockindex)) ++nTxsFoundInBlock;
-                ++nTxNum;
-            }
-        }
+/**
+ * Reads a block from disk, and checks the transactions for markers.
+ */
+static void PrepareScanBlock(const CBlockIndex* pblockindex, bool fSeedBlockFilter, const CConsensusParams& params, ScanBlock& scanBlock)
+{
+    int nBlock = pblockindex->nHeight;
 
-        nTxsFoundTotal += nTxsFoundInBlock;
-        nTxsTotal += nTxNum;
-        mastercore_handler_block_end(nBlock, pblockindex, nTxsFoundInBlock);
+    if (fSeedBlockFilter && SkipBlock(nBlock)) {
+        scanBlock.fSkipped = true;
+        return;
     }
-
-    if (nBlock < nLastBlock) {
-        PrintToConsole("Scan stopped early at block %d of block %d\n", nBlock, nLastBlock);
+    if (!ReadBlockFromDisk(scanBlock.block, pblockindex)) {
+        return;
     }
+    scanBlock.fRead = true;
 
-    PrintToConsole("%d transactions processed, %d meta transactions found\n", nTxsTotal, nTxsFoundTotal);
-
-    return 0;
+    CheckScanBlockMarkers(nBlock, params, scanBlock);
 }
 
-int input_msc_balances_string(const std::string& s)
+/**
+ * Reads and pre-filters the blocks of the initial scan in worker threads.
+ *
+ * The workers stay at most a fixed number of blocks ahead of the consumer, and
+ * the blocks are handed out strictly in order. Reading blocks from disk and
+ * checking transactions for markers has no side effects, so the state is only
+ * ever modified by the consumer.
+ *
+ * The consumer may modify the consensus parameters, for example when a feature
+ * is activated, so the workers never access them. They use a copy, which is
+ * refreshed by the consumer, and the markers of blocks, which were checked with
+ * outdated parameters, are checked again, when the blocks are handed out.
+ *
+ * @see msc_initial_scan()
+ */
+class BlockPrefetcher
 {
-    // "address=propertybalancedata"
+private:
+    const std::vector<const CBlockIndex*>& m_vBlockIndexes;
+    const bool m_fSeedBlockFilter;
+    const size_t m_nMaxAhead;
+
+    boost::mutex m_mutex;
+    boost::condition_variable m_condWorker;
+    boost::condition_variable m_condConsumer;
+    boost::thread_group m_threads;
+
+    //! Position of the next block to prepare
+    size_t m_nNextPrepare;
+    //! Position of the next block to hand out
+    size_t m_nNextConsume;
+    //! Prepared blocks, which were not yet handed out
+    std::map<size_t, ScanBlock*> m_mapPrepared;
+    //! Copy of the consensus parameters used by the workers
+    boost::shared_ptr<const CConsensusParams> m_pParams;
+    //! The generation of the copied consensus parameters
+    uint64_t m_nParamsGeneration;
+    bool m_fStop;
+
+    void worker()
+    {
+        while (true) {
+            size_t nPos = 0;
+            boost::shared_ptr<const CConsensusParams> pParams;
+            uint64_t nParamsGeneration = 0;
+            {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_fStop && !(m_nNextPrepare < m_vBlockIndexes.size() && m_nNextPrepare < m_nNextConsume + m_nMaxAhead)) {
+                    m_condWorker.wait(lock);
+                }
+                if (m_fStop) return;
+                nPos = m_nNextPrepare++;
+                pParams = m_pParams;
+                nParamsGeneration = m_nParamsGeneration;
+            }
+
+            ScanBlock* pScanBlock = new ScanBlock();
+            pScanBlock->nParamsGeneration = nParamsGeneration;
+            PrepareScanBlock(m_vBlockIndexes[nPos], m_fSeedBlockFilter, *pParams, *pScanBlock);
+
+            {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                m_mapPrepared[nPos] = pScanBlock;
+            }
+            m_condConsumer.notify_one();
+        }
+    }
+
+public:
+    BlockPrefetcher(const std::vector<const CBlockIndex*>& vBlockIndexes, bool fSeedBlockFilter, int nThreads)
+    : m_vBlockIndexes(vBlockIndexes), m_fSeedBlockFilter(fSeedBlockFilter), m_nMaxAhead(16 * nThreads),
+      m_nNextPrepare(0), m_nNextConsume(0), m_pParams(new CConsensusParams(ConsensusParams())),
+      m_nParamsGeneration(GetConsensusParamsGeneration()), m_fStop(false)
+    {
+        for (int i = 0; i < nThreads; ++i) {
+            m_threads.create_thread(boost::bind(&BlockPrefetcher::worker, this));
+        }
+    }
+
+    ~BlockPrefetcher()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            m_fStop = true;
+        }
+        m_condWorker.notify_all();
+        m_threads.join_all();
+
+        for (std::map<size_t, ScanBlock*>::iterator it = m_mapPrepared.begin(); it != m_mapPrepared.end(); ++it) {
+            delete it->second;
+        }
+    }
+
+    /**
+     * Waits for the next block in order, and hands it out.
+     *
+     * Must be called by the thread, which modifies the consensus parameters.
+     */
+    void next(int nBlock, ScanBlock& scanBlock)
+    {
+        const uint64_t nParamsGeneration = GetConsensusParamsGeneration();
+        ScanBlock* pScanBlock = NULL;
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            // blocks prepared from now on use the current parameters
+            if (m_nParamsGeneration != nParamsGeneration) {
+                m_pParams.reset(new CConsensusParams(ConsensusParams()));
+                m_nParamsGeneration = nParamsGeneration;
+            }
+            std::map<size_t, ScanBlock*>::iterator it;
+            while ((it = m_mapPrepared.find(m_nNextConsume)) == m_mapPrepared.end()) {
+                m_condConsumer.wait(lock);
+            }
+            pScanBlock = it->second;
+            m_mapPrepared.erase(it);
+            ++m_nNextConsume;
+        }
+        m_condWorker.notify_all();
+
+        scanBlock.fSkipped = pScanBlock->fSkipped;
+        scanBlock.fRead = pScanBlock->fRead;
+        scanBlock.block.vtx.swap(pScanBlock->block.vtx);
+        scanBlock.vfMarker.swap(pScanBlock->vfMarker);
+        scanBlock.nParamsGeneration = pScanBlock->nParamsGeneration;
+        delete pScanBlock;
+
+        // the parameters changed, after the block was checked for markers
+        if (scanBlock.fRead && scanBlock.nParamsGeneration != nParamsGeneration) {
+            CheckScanBlockMarkers(nBlock, ConsensusParams(), scanBlock);
+            scanBlock.nParamsGeneration = nParamsGeneration;
+        }
+    }
+};
+
+/**
+ * Returns the path of the persisted seed blocks.
+ *
+ * The seed blocks are stored outside of the persistence folders, and are deleted
+ * together with the databases, when the state is cleared or -startclean is used.
+ */
+static boost::filesystem::path GetSeedBlocksPath()
+{
+    return GetDataDir() / "MP_seedblocks.dat";
+}
+
+/**
+ * Covers the already processed blocks up to the given block with seed blocks.
+ *
+ * The blocks with Omni activity are collected from the block index of the
+ * transaction database, so no block needs to be read from disk.
+ */
+static void FillSeedBlocks(int nLastBlock)
+{
+    int nFirstBlock = GetSeedBlocksHeight() + 1;
+    if (nFirstBlock > nLastBlock) return;
+
+    int64_t nStart = GetTimeMillis();
+    std::set<int> setSeedBlocks = p_txlistdb->GetSeedBlocks(nFirstBlock, nLastBlock);
+
+    LOCK(cs_main);
+    for (int nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock) {
+        const CBlockIndex* pblockindex = chainActive[nBlock];
+        if (NULL == pblockindex) break;
+        UpdateSeedBlocks(pblockindex, setSeedBlocks.count(nBlock) > 0);
+    }
+
+    PrintToLog("Filled seed blocks from block %d to block %d in %dms\n", nFirstBlock, nLastBlock, GetTimeMillis() - nStart);
+}
+
+/**
+ * Scans the blockchain for meta transactions.
+ *
+ * It scans the blockchain, starting at the given block index, to the current
+ * tip, much like as if new block were arriving and being processed on the fly.
+ *
+ * Every 30 seconds the progress of the scan is reported.
+ *
+ * In case the current block being processed is not part of the active chain, or
+ * if a block could not be retrieved from the disk, then the scan stops early.
+ * Likewise, global shutdown requests are honored, and stop the scan progress.
+ *
+ * @see mastercore_handler_block_begin()
+ * @see mastercore_handler_tx()
+ * @see mastercore_handler_block_end()
+ *
+ * @param nFirstBlock[in]  The index of the first block to scan
+ * @return An exit code, indicating success or failure
+ */
+static int msc_initial_scan(int nFirstBlock)
+{
+    int nTimeBetweenProgressReports = GetArg("-omniprogressfrequency", 30);  // seconds
+    int64_t nNow = GetTime();
+    unsigned int nTxsTotal = 0;
+    unsigned int nTxsFoundTotal = 0;
+    int nBlock = 999999;
+    const int nLastBlock = GetHeight();
+
+    // this function is useless if there are not enough blocks in the blockchain yet!
+    if (nFirstBlock < 0 || nLastBlock < nFirstBlock) return -1;
+
+    // number of threads used to read and pre-filter blocks ahead of the parser
+    int nScanThreads = GetArg("-omniscanthreads", boost::thread::hardware_concurrency());
+    nScanThreads = std::max(0, std::min(nScanThreads, MAX_SCAN_THREADS));
+
+    PrintToConsole("Scanning for transactions in block %d to block %d..\n", nFirstBlock, nLastBlock);
+    PrintToLog("Scanning with %d prefetch threads\n", nScanThreads);
+
+    // used to print the progress to the console and notifies the UI
+    ProgressReporter progressReporter(chainActive[nFirstBlock], chainActive[nLastBlock]);
+
+    // check if using seed block filter should be disabled
+    bool seedBlockFilterEnabled = GetBoolArg("-omniseedblockfilter", true);
+
+    // the block indexes are collected upfront, so the prefetch threads don't access the chain
+    std::vector<const CBlockIndex*> vBlockIndexes;
+    for (nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock) {
+        const CBlockIndex* pblockindex = chainActive[nBlock];
+        if (NULL == pblockindex) break;
+        vBlockIndexes.push_back(pblockindex);
+    }
+
+    // initialize static data used by the filter, before it is accessed by multiple threads
+    legacy::useLegacyProcessing(nFirstBlock);
+    ExodusAddress();
+    ExodusCrowdsaleAddress(nLastBlock);
+    ExodusKeyID();
+    ExodusCrowdsaleKeyID(MONEYMAN_TESTNET_BLOCK);
+    ExodusCrowdsaleKeyID(nLastBlock);
+    SkipBlock(nFirstBlock);
+
+    boost::scoped_ptr<BlockPrefetcher> prefetcher;
+    if (nScanThreads > 0) {
+        prefetcher.reset(new BlockPrefetcher(vBlockIndexes, seedBlockFilterEnabled, nScanThreads));
+    }
+
+    for (nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock)
+    {
+        if (ShutdownRequested()) {
+            PrintToLog("Shutdown requested, stop scan at block %d of %d\n", nBlock, nLastBlock);
+            break;
+        }
+
+        if (nBlock - nFirstBlock >= (int) vBlockIndexes.size()) break;
+        const CBlockIndex* pblockindex = vBlockIndexes[nBlock - nFirstBlock];
+        std::string strBlockHash = pblockindex->GetBlockHash().GetHex();
+
+        if (msc_debug_exo) PrintToLog("%s(%d; max=%d):%s, line %d, file: %s\n",
+            __FUNCTION__, nBlock, nLastBlock, strBlockHash, __LINE__, __FILE__);
+
+        if (GetTime() >= nNow + nTimeBetweenProgressReports) {
+            progressReporter.update(pblockindex);
+            nNow = GetTime();
+        }
+
+        ScanBlock scanBlock;
+        if (prefetcher) {
+            prefetcher->next(nBlock, scanBlock);
+        } else {
+            PrepareScanBlock(pblockindex, seedBlockFilterEnabled, ConsensusParams(), scanBlock);
+        }
+
+        // stop before the block is begun, so no batch is left open for a block that is never ended
+        if (!scanBlock.fSkipped && !scanBlock.fRead) break;
+
+        unsigned int nTxNum = 0;
+        unsigned int nTxsFoundInBlock = 0;
+        mastercore_handler_block_begin(nBlock, pblockindex);
+
+        if (!scanBlock.fSkipped) {
+            // resolve the inputs and parse the transactions of the whole block at once
+            PrepareBlockTransactions(scanBlock.block, nBlock, pblockindex->GetBlockTime(), scanBlock.vfMarker);
+
+            BOOST_FOREACH(const CTransaction&tx, scanBlock.block.vtx) {
+                if (scanBlock.vfMarker[nTxNum]) {
+                    if (mastercore_handler_tx(tx, nBlock, nTxNum, pblockindex)) ++nTxsFoundInBlock;
+                } else {
+                    // not a meta transaction, but it may still clear pending amounts
+                    LOCK(cs_tally);
+                    PendingDelete(tx.GetHash());
+                }
+                ++nTxNum;
+            }
+        }
+
+        nTxsFoundTotal += nTxsFoundInBlock;
+        nTxsTotal += nTxNum;
+        if (mastercore_handler_block_end(nBlock, pblockindex, nTxsFoundInBlock) < 0) break;
+    }
+
+    if (nBlock < nLastBlock) {
+        PrintToConsole("Scan stopped early at block %d of block %d\n", nBlock, nLastBlock);
+    }
+
+    PrintToConsole("%d transactions processed, %d meta transactions found\n", nTxsTotal, nTxsFoundTotal);
+    LogInputCacheStats(__func__);
+
+    // persist the seed blocks, so the next scan can skip the blocks without Omni activity
+    WriteSeedBlocks(GetSeedBlocksPath());
+
+    return 0;
+}
+
+int input_msc_balances_string(const std::string& s)
+{
+    // "address=propertybalancedata"
     std::vector<std::string> addrData;
     boost::split(addrData, s, boost::is_any_of("="), boost::token_compress_on);
     if (addrData.size() != 2) return -1;
@@ -2066,7 +3043,7 @@ static int msc_file_load(const string &filename, int what, bool verifyHash = fal
   switch (what)
   {
     case FILETYPE_BALANCES:
-      mp_tally_map.clear();
+      ClearTallyMap();
       inputLineFunc = input_msc_balances_string;
       break;
 
@@ -2094,7 +3071,7 @@ static int msc_file_load(const string &filename, int what, bool verifyHash = fal
       // memory leak ... gotta unallocate inner layers first....
       // TODO
       // ...
-      metadex.clear();
+      MetaDEx_CLEAR();
       inputLineFunc = input_mp_mdexorder_string;
       break;
 
@@ -2158,31 +3135,792 @@ static int msc_file_load(const string &filename, int what, bool verifyHash = fal
     uint256 hash2;
     SHA256((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
 
-    if (false == boost::iequals(hash2.ToString(), fileHash)) {
-      PrintToLog("File %s loaded, but failed hash validation!\n", filename);
-      res = -1;
+    if (false == boost::iequals(hash2.ToString(), fileHash)) {
+      PrintToLog("File %s loaded, but failed hash validation!\n", filename);
+      res = -1;
+    }
+  }
+
+  PrintToLog("%s(%s), loaded lines= %d, res= %d\n", __FUNCTION__, filename, lines, res);
+  LogPrintf("%s(): file: %s , loaded lines= %d, res= %d\n", __FUNCTION__, filename, lines, res);
+
+  return res;
+}
+
+static char const * const statePrefix[NUM_FILETYPES] = {
+    "balances",
+    "offers",
+    "accepts",
+    "globals",
+    "crowdsales",
+    "mdexorders",
+};
+
+static char const * const STATE_SNAPSHOT_PREFIX = "snapshot";
+static char const * const STATE_DELTA_PREFIX = "delta";
+
+/** Balance types, which are persisted. */
+static const TallyType persistedTallyTypes[] = { BALANCE, SELLOFFER_RESERVE, ACCEPT_RESERVE, METADEX_RESERVE };
+static const size_t NUM_PERSISTED_TALLY_TYPES = sizeof(persistedTallyTypes) / sizeof(persistedTallyTypes[0]);
+
+//! Persisted balances of an address; the property identifier, and the amount of each persisted balance type
+typedef std::vector<std::pair<uint32_t, std::vector<int64_t> > > TallySnapshot;
+
+/**
+ * Collects the persisted balances of an address.
+ *
+ * Zero balances are not persisted, and an address without balances is stored without
+ * any records, which marks it as removed in a delta snapshot.
+ */
+static void GetTallySnapshot(const std::string& address, TallySnapshot& balances)
+{
+    balances.clear();
+
+    CMPTally* ptally = mp_tally_map.find(address);
+    if (!ptally) {
+        return;
+    }
+
+    CMPTally& tally = *ptally;
+    tally.init();
+    uint32_t propertyId = 0;
+    while (0 != (propertyId = tally.next())) {
+        std::vector<int64_t> amounts(NUM_PERSISTED_TALLY_TYPES, 0);
+        bool fEmpty = true;
+        for (size_t n = 0; n < NUM_PERSISTED_TALLY_TYPES; ++n) {
+            amounts[n] = tally.getMoney(propertyId, persistedTallyTypes[n]);
+            if (amounts[n] != 0) fEmpty = false;
+        }
+        if (!fEmpty) {
+            balances.push_back(std::make_pair(propertyId, amounts));
+        }
+    }
+}
+
+/** Replaces the balances of an address by the persisted ones. */
+static bool SetTallySnapshot(const std::string& address, const TallySnapshot& balances)
+{
+    CMPTally* ptally = mp_tally_map.find(address);
+    if (ptally) {
+        CMPTally& tally = *ptally;
+        tally.init();
+        uint32_t propertyId = 0;
+        while (0 != (propertyId = tally.next())) {
+            NotifyTallyChange(address, propertyId);
+            for (size_t n = 0; n < NUM_PERSISTED_TALLY_TYPES; ++n) {
+                int64_t amount = tally.getMoney(propertyId, persistedTallyTypes[n]);
+                if (amount != 0) UpdatePropertyIndexes(address, propertyId, -amount, persistedTallyTypes[n]);
+            }
+        }
+        mp_tally_map.erase(address);
+    }
+
+    for (TallySnapshot::const_iterator it = balances.begin(); it != balances.end(); ++it) {
+        if (it->second.size() != NUM_PERSISTED_TALLY_TYPES) {
+            return false;
+        }
+        NotifyTallyChange(address, it->first);
+        for (size_t n = 0; n < NUM_PERSISTED_TALLY_TYPES; ++n) {
+            if (it->second[n] == 0) continue;
+            if (!mp_tally_map[address].updateMoney(it->first, it->second[n], persistedTallyTypes[n])) {
+                return false;
+            }
+            UpdatePropertyIndexes(address, it->first, it->second[n], persistedTallyTypes[n]);
+        }
+    }
+
+    return true;
+}
+
+/** Collects the open orders of a MetaDEx market. */
+static void GetMarketSnapshot(const md_PropertyPair& market, std::vector<CMPMetaDEx>& orders)
+{
+    orders.clear();
+
+    md_PricesMap* prices = get_Prices(market.first, market.second);
+    if (prices == NULL) {
+        return;
+    }
+
+    for (md_PricesMap::const_iterator it = prices->begin(); it != prices->end(); ++it) {
+        const md_Set& indexes = it->second;
+        orders.insert(orders.end(), indexes.begin(), indexes.end());
+    }
+}
+
+/** A serialized state, which is waiting to be written to disk. */
+struct StateSnapshotJob
+{
+    //! The block of the state
+    uint256 hashBlock;
+    //! Whether the state is a delta to a previous state
+    bool fDelta;
+    //! The block of the previous state, which a delta is based on
+    uint256 hashPrev;
+    //! Whether the delta is merged with the states it's based on, and written as full snapshot
+    bool fCompact;
+    //! The serialized state, including the trailing hash
+    CDataStream ssState;
+    //! States, which are no longer needed, and removed once this state is written
+    std::vector<uint256> vPruned;
+
+    StateSnapshotJob() : fDelta(false), hashPrev(0), fCompact(false), ssState(SER_DISK, CLIENT_VERSION) {}
+};
+
+/**
+ * Serializes the state as of the given block in binary form.
+ *
+ * A full snapshot contains all balances and MetaDEx orders, while a delta snapshot only
+ * contains the addresses and markets, which changed since the previously persisted state,
+ * and refers to that state by its block hash. Offers, accepts, crowdsales and the global
+ * values are small, and always included as a whole.
+ *
+ * Only the first state after startup, or after a failed write, is serialized in full.
+ * Every MAX_STATE_HISTORY blocks, the delta is turned into a full snapshot by the state
+ * writer, so the whole state is not serialized while the block is being processed.
+ *
+ * The serialized state ends with the double SHA256 hash of its content.
+ */
+static void serialize_state_snapshot(const CBlockIndex* pBlockIndex, StateSnapshotJob& job)
+{
+    const uint256 hashBlock = pBlockIndex->GetBlockHash();
+
+    // deltas are chained to the last persisted state, and every MAX_STATE_HISTORY blocks compacted by the writer
+    const bool fDelta = (hashLastPersistedState != 0 && hashLastPersistedState != hashBlock);
+    const uint256 hashPrev = fDelta ? hashLastPersistedState : uint256(0);
+
+    std::vector<std::pair<std::string, TallySnapshot> > vBalances;
+    if (fDelta) {
+        for (std::set<std::string>::const_iterator it = setDirtyAddresses.begin(); it != setDirtyAddresses.end(); ++it) {
+            vBalances.push_back(std::make_pair(*it, TallySnapshot()));
+            GetTallySnapshot(*it, vBalances.back().second);
+        }
+    } else {
+        for (CMPTallyMap::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+            std::string address = it.getAddress();
+            TallySnapshot balances;
+            GetTallySnapshot(address, balances);
+            if (!balances.empty()) {
+                vBalances.push_back(std::make_pair(address, balances));
+            }
+        }
+    }
+
+    std::vector<std::pair<md_PropertyPair, std::vector<CMPMetaDEx> > > vMarkets;
+    if (fDelta) {
+        for (std::set<md_PropertyPair>::const_iterator it = setDirtyMarkets.begin(); it != setDirtyMarkets.end(); ++it) {
+            vMarkets.push_back(std::make_pair(*it, std::vector<CMPMetaDEx>()));
+            GetMarketSnapshot(*it, vMarkets.back().second);
+        }
+    } else {
+        for (md_PropertiesMap::const_iterator it = metadex.begin(); it != metadex.end(); ++it) {
+            std::vector<CMPMetaDEx> orders;
+            GetMarketSnapshot(it->first, orders);
+            if (!orders.empty()) {
+                vMarkets.push_back(std::make_pair(it->first, orders));
+            }
+        }
+    }
+
+    uint32_t nextSPID = _my_sps->peekNextSPID(OMNI_PROPERTY_MSC);
+    uint32_t nextTestSPID = _my_sps->peekNextSPID(OMNI_PROPERTY_TMSC);
+
+    CDataStream& ssState = job.ssState;
+    ssState << STATE_SNAPSHOT_VERSION << fDelta << hashBlock << hashPrev;
+    ssState << vBalances << vMarkets;
+    ssState << my_offers << my_accepts << my_crowds;
+    ssState << exodus_prev << nextSPID << nextTestSPID;
+
+    uint256 hashState = Hash(ssState.begin(), ssState.end());
+    ssState << hashState;
+
+    job.hashBlock = hashBlock;
+    job.fDelta = fDelta;
+    job.hashPrev = hashPrev;
+    job.fCompact = fDelta && (pBlockIndex->nHeight % MAX_STATE_HISTORY) == 0;
+
+    if (msc_debug_persistence) {
+        PrintToLog("%s(): serialized %s state of block %s (%d addresses, %d markets, %d bytes)\n",
+                __func__, fDelta ? "delta" : "full", hashBlock.ToString(), vBalances.size(), vMarkets.size(), ssState.size());
+    }
+}
+
+/** Removes all state files of a block. */
+static void remove_state_files(const uint256& hashBlock)
+{
+    const std::string strBlockHash = hashBlock.ToString();
+
+    for (int i = 0; i < NUM_FILETYPES; ++i) {
+        boost::filesystem::remove(MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], strBlockHash));
+    }
+    boost::filesystem::remove(MPPersistencePath / strprintf("%s-%s.dat", STATE_SNAPSHOT_PREFIX, strBlockHash));
+    boost::filesystem::remove(MPPersistencePath / strprintf("%s-%s.dat", STATE_DELTA_PREFIX, strBlockHash));
+}
+
+/**
+ * Writes a serialized state to disk.
+ *
+ * The state is written to a temporary file first, which is then renamed, so the
+ * state file of a block is either complete, or absent.
+ */
+static bool write_state_snapshot(const StateSnapshotJob& job)
+{
+    const std::string strName = strprintf("%s-%s.dat",
+            job.fDelta ? STATE_DELTA_PREFIX : STATE_SNAPSHOT_PREFIX, job.hashBlock.ToString());
+    boost::filesystem::path path = MPPersistencePath / strName;
+    boost::filesystem::path pathTmp = MPPersistencePath / (strName + ".new");
+    const std::string strFile = pathTmp.string();
+
+    FILE* file = fopen(strFile.c_str(), "wb");
+    if (file == NULL) {
+        PrintToLog("%s(): ERROR: failed to open %s\n", __func__, strFile);
+        return false;
+    }
+    bool fWritten = (fwrite(&job.ssState[0], 1, job.ssState.size(), file) == job.ssState.size());
+    if (fWritten) FileCommit(file);
+    fclose(file);
+
+    if (!fWritten || !RenameOver(pathTmp, path)) {
+        PrintToLog("%s(): ERROR: failed to write %s\n", __func__, strFile);
+        boost::filesystem::remove(pathTmp);
+        return false;
+    }
+
+    // the state of a block is persisted either as full or as delta snapshot
+    boost::filesystem::remove(MPPersistencePath / strprintf("%s-%s.dat",
+            job.fDelta ? STATE_SNAPSHOT_PREFIX : STATE_DELTA_PREFIX, job.hashBlock.ToString()));
+
+    return true;
+}
+
+/**
+ * Reads the state snapshot of a block, and verifies its integrity.
+ *
+ * The file is read as a whole, and the stream is positioned after the header.
+ */
+static bool read_state_snapshot(const uint256& hashBlock, CDataStream& ssState, bool& fDelta, uint256& hashPrev)
+{
+    boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", STATE_SNAPSHOT_PREFIX, hashBlock.ToString());
+    if (!boost::filesystem::exists(path)) {
+        path = MPPersistencePath / strprintf("%s-%s.dat", STATE_DELTA_PREFIX, hashBlock.ToString());
+    }
+    const std::string strFile = path.string();
+
+    FILE* file = fopen(strFile.c_str(), "rb");
+    if (file == NULL) {
+        if (msc_debug_persistence) PrintToLog("%s(): no state snapshot for block %s\n", __func__, hashBlock.ToString());
+        return false;
+    }
+
+    bool fRead = false;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long nSize = ftell(file);
+        if (nSize >= (long) sizeof(uint256) && fseek(file, 0, SEEK_SET) == 0) {
+            ssState.resize(nSize);
+            fRead = (fread(&ssState[0], 1, nSize, file) == (size_t) nSize);
+        }
+    }
+    fclose(file);
+
+    if (!fRead) {
+        PrintToLog("%s(): ERROR: failed to read %s\n", __func__, strFile);
+        return false;
+    }
+
+    // verify and strip the trailing hash
+    const size_t nContentSize = ssState.size() - sizeof(uint256);
+    uint256 hashState = Hash(ssState.begin(), ssState.begin() + nContentSize);
+    if (memcmp(hashState.begin(), &ssState[nContentSize], sizeof(uint256)) != 0) {
+        PrintToLog("File %s loaded, but failed hash validation!\n", strFile);
+        return false;
+    }
+    ssState.resize(nContentSize);
+
+    try {
+        int nVersion = 0;
+        uint256 hashFileBlock;
+        ssState >> nVersion >> fDelta >> hashFileBlock >> hashPrev;
+
+        if (nVersion != STATE_SNAPSHOT_VERSION || hashFileBlock != hashBlock) {
+            PrintToLog("%s(): ERROR: unexpected header in %s (version %d, block %s)\n",
+                    __func__, strFile, nVersion, hashFileBlock.ToString());
+            return false;
+        }
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: failed to read header of %s: %s\n", __func__, strFile, e.what());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Reads the state snapshot of a block, and the states it's based on.
+ *
+ * Delta snapshots are followed back to the full snapshot they are based on. The states
+ * are returned in the order they are applied, starting with the full snapshot.
+ */
+static bool read_state_chain(const uint256& hashBlock, std::list<CDataStream>& listStates)
+{
+    std::set<uint256> setVisited;
+
+    uint256 hash = hashBlock;
+    while (true) {
+        if (!setVisited.insert(hash).second) {
+            PrintToLog("%s(): ERROR: state snapshot of block %s refers to itself\n", __func__, hash.ToString());
+            return false;
+        }
+
+        bool fDelta = false;
+        uint256 hashPrev;
+        listStates.push_front(CDataStream(SER_DISK, CLIENT_VERSION));
+        if (!read_state_snapshot(hash, listStates.front(), fDelta, hashPrev)) {
+            return false;
+        }
+        if (!fDelta) break;
+
+        hash = hashPrev;
+    }
+
+    return true;
+}
+
+//! Persisted balances of all addresses
+typedef std::map<std::string, TallySnapshot> TallySnapshotMap;
+//! Persisted orders of all MetaDEx markets
+typedef std::map<md_PropertyPair, std::vector<CMPMetaDEx> > MarketSnapshotMap;
+
+/**
+ * Applies the balances and MetaDEx orders of a serialized state on top of the merged ones.
+ *
+ * Addresses and markets without records are removed. The stream is positioned after them.
+ */
+static void merge_state_snapshot(CDataStream& ssState, TallySnapshotMap& balances, MarketSnapshotMap& markets)
+{
+    std::vector<std::pair<std::string, TallySnapshot> > vBalances;
+    ssState >> vBalances;
+    for (size_t n = 0; n < vBalances.size(); ++n) {
+        if (vBalances[n].second.empty()) {
+            balances.erase(vBalances[n].first);
+        } else {
+            balances[vBalances[n].first].swap(vBalances[n].second);
+        }
+    }
+
+    std::vector<std::pair<md_PropertyPair, std::vector<CMPMetaDEx> > > vMarkets;
+    ssState >> vMarkets;
+    for (size_t n = 0; n < vMarkets.size(); ++n) {
+        if (vMarkets[n].second.empty()) {
+            markets.erase(vMarkets[n].first);
+        } else {
+            markets[vMarkets[n].first].swap(vMarkets[n].second);
+        }
+    }
+}
+
+/**
+ * Turns a serialized delta into a full snapshot of the same block.
+ *
+ * The states the delta is based on are read from disk, and merged with the delta. Offers,
+ * accepts, crowdsales and the global values are taken from the delta as they are, so the
+ * result equals a full snapshot serialized from the state as of the block.
+ */
+static bool compact_state_snapshot(StateSnapshotJob& job)
+{
+    std::list<CDataStream> listStates;
+    if (!read_state_chain(job.hashPrev, listStates)) {
+        return false;
+    }
+
+    TallySnapshotMap balances;
+    MarketSnapshotMap markets;
+    CDataStream ssState(SER_DISK, CLIENT_VERSION);
+
+    try {
+        for (std::list<CDataStream>::iterator it = listStates.begin(); it != listStates.end(); ++it) {
+            merge_state_snapshot(*it, balances, markets);
+        }
+
+        // the delta itself, without its trailing hash
+        CDataStream ssDelta(job.ssState.begin(), job.ssState.end() - sizeof(uint256), SER_DISK, CLIENT_VERSION);
+        int nVersion = 0;
+        bool fDelta = false;
+        uint256 hashBlock;
+        uint256 hashPrev;
+        ssDelta >> nVersion >> fDelta >> hashBlock >> hashPrev;
+        merge_state_snapshot(ssDelta, balances, markets);
+
+        const bool fFull = false;
+        std::vector<std::pair<std::string, TallySnapshot> > vBalances(balances.begin(), balances.end());
+        std::vector<std::pair<md_PropertyPair, std::vector<CMPMetaDEx> > > vMarkets(markets.begin(), markets.end());
+        ssState << STATE_SNAPSHOT_VERSION << fFull << job.hashBlock << uint256(0);
+        ssState << vBalances << vMarkets;
+        ssState.write(&ssDelta[0], ssDelta.size());
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: failed to merge state snapshots: %s\n", __func__, e.what());
+        return false;
+    }
+
+    uint256 hashState = Hash(ssState.begin(), ssState.end());
+    ssState << hashState;
+
+    job.ssState = ssState;
+    job.fDelta = false;
+    job.hashPrev = 0;
+
+    if (msc_debug_persistence) {
+        PrintToLog("%s(): compacted %d states of block %s (%d addresses, %d markets, %d bytes)\n",
+                __func__, listStates.size() + 1, job.hashBlock.ToString(), balances.size(), markets.size(), ssState.size());
+    }
+
+    return true;
+}
+
+//! Maximum number of serialized states waiting to be written
+static const size_t MAX_QUEUED_STATES = 16;
+
+/**
+ * Writes serialized states to disk in a dedicated thread.
+ *
+ * The states are handed over at the end of each block, and written in order, so
+ * block processing doesn't wait for the disk. States, which are no longer needed,
+ * are removed, after the state replacing them was written. The block hash of the
+ * last written state is the committed watermark.
+ *
+ * Written states are reported back, and only recorded as persisted by the producer.
+ * If a state can't be written, the deltas based on it are dropped as well.
+ *
+ * @see mastercore_save_state()
+ */
+class StateSnapshotWriter
+{
+private:
+    boost::mutex m_mutex;
+    boost::condition_variable m_condWriter;
+    boost::condition_variable m_condProducer;
+    boost::thread m_thread;
+
+    //! Serialized states, which were not yet written
+    std::list<StateSnapshotJob*> m_queue;
+    //! Written states, which were not yet taken, and whether they are full snapshots
+    std::vector<std::pair<uint256, bool> > m_vWritten;
+    //! States, which were not written, so deltas based on them are dropped
+    std::set<uint256> m_setDropped;
+    //! Whether a state is currently being written
+    bool m_fBusy;
+    //! Whether writing a state failed since this was last checked
+    bool m_fFailed;
+    bool m_fStop;
+    //! Block hash of the last state written to disk
+    uint256 m_hashCommitted;
+
+    void worker()
+    {
+        while (true) {
+            StateSnapshotJob* pJob = NULL;
+            bool fDropped = false;
+            {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_fStop && m_queue.empty()) {
+                    m_condWriter.wait(lock);
+                }
+                // remaining states are written before stopping
+                if (m_queue.empty()) return;
+                pJob = m_queue.front();
+                m_queue.pop_front();
+                m_fBusy = true;
+                fDropped = pJob->fDelta && m_setDropped.count(pJob->hashPrev) > 0;
+            }
+
+            bool fWritten = false;
+            if (fDropped) {
+                PrintToLog("%s(): dropped state of block %s, which is based on a state not written\n",
+                        __func__, pJob->hashBlock.ToString());
+            } else if (pJob->fCompact && !compact_state_snapshot(*pJob)) {
+                PrintToLog("%s(): ERROR: failed to compact state of block %s\n", __func__, pJob->hashBlock.ToString());
+            } else {
+                fWritten = write_state_snapshot(*pJob);
+            }
+
+            // the pruned states are not needed by any later state, whether this one was written or not
+            for (size_t n = 0; n < pJob->vPruned.size(); ++n) {
+                remove_state_files(pJob->vPruned[n]);
+            }
+
+            {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                if (fWritten) {
+                    m_hashCommitted = pJob->hashBlock;
+                    m_vWritten.push_back(std::make_pair(pJob->hashBlock, !pJob->fDelta));
+                } else {
+                    m_setDropped.insert(pJob->hashBlock);
+                    m_fFailed = true;
+                }
+                m_fBusy = false;
+            }
+            m_condProducer.notify_all();
+            delete pJob;
+        }
+    }
+
+public:
+    StateSnapshotWriter() : m_fBusy(false), m_fFailed(false), m_fStop(false), m_hashCommitted(0)
+    {
+        m_thread = boost::thread(boost::bind(&StateSnapshotWriter::worker, this));
+    }
+
+    ~StateSnapshotWriter()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            m_fStop = true;
+        }
+        m_condWriter.notify_all();
+        m_thread.join();
+    }
+
+    /** Hands over a serialized state, and waits, if too many states are queued already. */
+    void push(StateSnapshotJob* pJob)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            while (m_queue.size() >= MAX_QUEUED_STATES) {
+                m_condProducer.wait(lock);
+            }
+            m_queue.push_back(pJob);
+        }
+        m_condWriter.notify_one();
+    }
+
+    /** Waits until all states handed over were written, and returns the committed watermark. */
+    uint256 flush()
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while (m_fBusy || !m_queue.empty()) {
+            m_condProducer.wait(lock);
+        }
+        return m_hashCommitted;
+    }
+
+    /** Returns the states written since this was last called, and whether they are full snapshots. */
+    void takeWritten(std::vector<std::pair<uint256, bool> >& vWritten)
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        vWritten.swap(m_vWritten);
+        m_vWritten.clear();
+    }
+
+    /** Returns whether writing a state failed since this was last checked. */
+    bool checkFailed()
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        bool fFailed = m_fFailed;
+        m_fFailed = false;
+        return fFailed;
+    }
+};
+
+//! Writes the persisted state in the background
+static StateSnapshotWriter* pStateWriter = NULL;
+
+/** Applies a state snapshot on top of the current state. */
+static bool apply_state_snapshot(CDataStream& ssState, bool fDelta)
+{
+    if (!fDelta) {
+        ClearTallyMap();
+        MetaDEx_CLEAR();
+    }
+
+    try {
+        std::vector<std::pair<std::string, TallySnapshot> > vBalances;
+        ssState >> vBalances;
+        for (size_t n = 0; n < vBalances.size(); ++n) {
+            if (!SetTallySnapshot(vBalances[n].first, vBalances[n].second)) return false;
+        }
+
+        std::vector<std::pair<md_PropertyPair, std::vector<CMPMetaDEx> > > vMarkets;
+        ssState >> vMarkets;
+        for (size_t n = 0; n < vMarkets.size(); ++n) {
+            if (!MetaDEx_SET_MARKET(vMarkets[n].first, vMarkets[n].second)) return false;
+        }
+
+        ssState >> my_offers >> my_accepts >> my_crowds;
+
+        int64_t exodusPrev = 0;
+        uint32_t nextSPID = 0;
+        uint32_t nextTestSPID = 0;
+        ssState >> exodusPrev >> nextSPID >> nextTestSPID;
+
+        exodus_prev = exodusPrev;
+        _my_sps->init(nextSPID, nextTestSPID);
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: failed to read state snapshot: %s\n", __func__, e.what());
+        return false;
+    }
+
+    return ssState.empty();
+}
+
+/**
+ * Loads the persisted state as of the given block.
+ *
+ * Delta snapshots are followed back to the full snapshot they are based on, which is
+ * applied first, followed by the deltas in order. States handed over to the state
+ * writer are written, before they are read.
+ *
+ * @return 0 if the state was loaded, or -1 if no complete and valid state is available
+ */
+int load_state_snapshot(const uint256& hashBlock)
+{
+    pStateWriter->flush();
+
+    std::list<CDataStream> listStates;
+    if (!read_state_chain(hashBlock, listStates)) {
+        return -1;
+    }
+
+    bool fDelta = false;
+    for (std::list<CDataStream>::iterator it = listStates.begin(); it != listStates.end(); ++it) {
+        if (!apply_state_snapshot(*it, fDelta)) {
+            PrintToLog("%s(): ERROR: failed to apply state snapshot of block %s\n", __func__, hashBlock.ToString());
+            return -1;
+        }
+        fDelta = true;
+    }
+
+    PrintToLog("%s(): loaded state of block %s from %d snapshot files\n", __func__, hashBlock.ToString(), listStates.size());
+
+    return 0;
+}
+
+static bool is_state_prefix( std::string const &str )
+{
+  for (int i = 0; i < NUM_FILETYPES; ++i) {
+    if (boost::equals(str,  statePrefix[i])) {
+      return true;
+    }
+  }
+
+  return boost::equals(str, STATE_SNAPSHOT_PREFIX) || boost::equals(str, STATE_DELTA_PREFIX);
+}
+
+//! Blocks with persisted state, and whether the state is a full snapshot
+static std::map<uint256, bool> mapPersistedStates;
+//! Whether the persistence directory was scanned for state files
+static bool fPersistedStatesScanned = false;
+
+/**
+ * Scans the persistence directory for state files once, after which the set of
+ * persisted states is kept up to date in memory.
+ */
+static void scan_state_files()
+{
+  if (fPersistedStatesScanned) {
+    return;
+  }
+
+  boost::filesystem::directory_iterator dIter(MPPersistencePath);
+  boost::filesystem::directory_iterator endIter;
+  for (; dIter != endIter; ++dIter) {
+    std::string fName = dIter->path().empty() ? "<invalid>" : (*--dIter->path().end()).string();
+    if (false == boost::filesystem::is_regular_file(dIter->status())) {
+      // skip funny business
+      PrintToLog("Non-regular file found in persistence directory : %s\n", fName);
+      continue;
+    }
+
+    std::vector<std::string> vstr;
+    boost::split(vstr, fName, boost::is_any_of("-."), token_compress_on);
+    if (  vstr.size() == 3 &&
+          is_state_prefix(vstr[0]) &&
+          boost::equals(vstr[2], "dat")) {
+      uint256 blockHash;
+      blockHash.SetHex(vstr[1]);
+      mapPersistedStates[blockHash] |= boost::equals(vstr[0], STATE_SNAPSHOT_PREFIX);
+    } else {
+      PrintToLog("None state file found in persistence directory : %s\n", fName);
+    }
+  }
+
+  fPersistedStatesScanned = true;
+}
+
+/**
+ * Determines the persisted states, which are no longer needed, and removes them from
+ * the set of persisted states. The files are removed by the state writer.
+ */
+static void prune_state_files( CBlockIndex const *topIndex, std::vector<uint256>& vPruned )
+{
+  scan_state_files();
+
+  // delta snapshots depend on the states before them, so the newest full snapshot in the
+  // active chain, which is at least MAX_STATE_HISTORY blocks old, is kept with all later states
+  int minHeight = topIndex->nHeight - MAX_STATE_HISTORY;
+  int baseHeight = -1;
+  std::map<uint256, bool>::iterator iter;
+  for (iter = mapPersistedStates.begin(); iter != mapPersistedStates.end(); ++iter) {
+    if (!iter->second) continue;
+    CBlockIndex const *curIndex = GetBlockIndex(iter->first);
+    if (NULL != curIndex && chainActive.Contains(curIndex) &&
+        curIndex->nHeight <= minHeight && curIndex->nHeight > baseHeight) {
+      baseHeight = curIndex->nHeight;
+    }
+  }
+  if (baseHeight >= 0) minHeight = baseHeight;
+
+  // for each blockHash in the set, determine the distance from the given block
+  for (iter = mapPersistedStates.begin(); iter != mapPersistedStates.end(); ) {
+    // look up the CBlockIndex for height info
+    CBlockIndex const *curIndex = GetBlockIndex(iter->first);
+
+    // if we have nothing int the index, or this block is too old..
+    if (NULL == curIndex || curIndex->nHeight < minHeight) {
+     if (msc_debug_persistence)
+     {
+      if (curIndex) {
+        PrintToLog("State from Block:%s is no longer need, removing files (age-from-tip: %d)\n", iter->first.ToString(), topIndex->nHeight - curIndex->nHeight);
+      } else {
+        PrintToLog("State from Block:%s is no longer need, removing files (not in index)\n", iter->first.ToString());
+      }
+     }
+
+      vPruned.push_back(iter->first);
+      mapPersistedStates.erase(iter++);
+    } else {
+      ++iter;
     }
   }
+}
 
-  PrintToLog("%s(%s), loaded lines= %d, res= %d\n", __FUNCTION__, filename, lines, res);
-  LogPrintf("%s(): file: %s , loaded lines= %d, res= %d\n", __FUNCTION__, filename, lines, res);
+/**
+ * Records the states, which were written by the state writer since this was last
+ * called, and moves the watermark of the SP database to the newest one.
+ */
+static void record_state_files()
+{
+  scan_state_files();
 
-  return res;
-}
+  std::vector<std::pair<uint256, bool> > vWritten;
+  pStateWriter->takeWritten(vWritten);
+  if (vWritten.empty()) {
+    return;
+  }
 
-static char const * const statePrefix[NUM_FILETYPES] = {
-    "balances",
-    "offers",
-    "accepts",
-    "globals",
-    "crowdsales",
-    "mdexorders",
-};
+  for (size_t n = 0; n < vWritten.size(); ++n) {
+    mapPersistedStates[vWritten[n].first] = vWritten[n].second;
+  }
+  _my_sps->setWatermark(vWritten.back().first);
+}
 
 // returns the height of the state loaded
 static int load_most_relevant_state()
 {
   int res = -1;
+
+  // only consider completely written states
+  uint256 hashCommitted = pStateWriter->flush();
+  record_state_files();
+  if (msc_debug_persistence) PrintToLog("Persisted state committed up to block %s\n", hashCommitted.ToString());
   // check the SP database and roll it back to its latest valid state
   // according to the active chain
   uint256 spWatermark;
@@ -2247,15 +3985,22 @@ static int load_most_relevant_state()
   int abortRollBackBlock;
   if (curTip != NULL) abortRollBackBlock = curTip->nHeight - (MAX_STATE_HISTORY+1);
   while (NULL != curTip && persistedBlocks.size() > 0 && curTip->nHeight > abortRollBackBlock) {
-    if (persistedBlocks.find(spBlockIndex->GetBlockHash()) != persistedBlocks.end()) {
-      int success = -1;
-      for (int i = 0; i < NUM_FILETYPES; ++i) {
-        boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], curTip->GetBlockHash().ToString());
-        const std::string strFile = path.string();
-        success = msc_file_load(strFile, i, true);
-        if (success < 0) {
-          break;
+    if (persistedBlocks.find(curTip->GetBlockHash()) != persistedBlocks.end()) {
+      int success = load_state_snapshot(curTip->GetBlockHash());
+      if (success >= 0) {
+        ResetStateChanges(curTip->GetBlockHash());
+      } else {
+        // fall back to the text based state files of earlier versions
+        for (int i = 0; i < NUM_FILETYPES; ++i) {
+          boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], curTip->GetBlockHash().ToString());
+          const std::string strFile = path.string();
+          success = msc_file_load(strFile, i, true);
+          if (success < 0) {
+            break;
+          }
         }
+        // the next state is persisted as full snapshot
+        ResetStateChanges(0);
       }
 
       if (success >= 0) {
@@ -2264,7 +4009,7 @@ static int load_most_relevant_state()
       }
 
       // remove this from the persistedBlock Set
-      persistedBlocks.erase(spBlockIndex->GetBlockHash());
+      persistedBlocks.erase(curTip->GetBlockHash());
     }
 
     // go to the previous block
@@ -2287,259 +4032,30 @@ static int load_most_relevant_state()
   return res;
 }
 
-static int write_msc_balances(std::ofstream& file, SHA256_CTX* shaCtx)
-{
-    std::map<std::string, CMPTally>::iterator iter;
-    for (iter = mp_tally_map.begin(); iter != mp_tally_map.end(); ++iter) {
-        bool emptyWallet = true;
-
-        std::string lineOut = (*iter).first;
-        lineOut.append("=");
-        CMPTally& curAddr = (*iter).second;
-        curAddr.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = curAddr.next())) {
-            int64_t balance = (*iter).second.getMoney(propertyId, BALANCE);
-            int64_t sellReserved = (*iter).second.getMoney(propertyId, SELLOFFER_RESERVE);
-            int64_t acceptReserved = (*iter).second.getMoney(propertyId, ACCEPT_RESERVE);
-            int64_t metadexReserved = (*iter).second.getMoney(propertyId, METADEX_RESERVE);
-
-            // we don't allow 0 balances to read in, so if we don't write them
-            // it makes things match up better between persisted state and processed state
-            if (0 == balance && 0 == sellReserved && 0 == acceptReserved && 0 == metadexReserved) {
-                continue;
-            }
-
-            emptyWallet = false;
-
-            lineOut.append(strprintf("%d:%d,%d,%d,%d;",
-                    propertyId,
-                    balance,
-                    sellReserved,
-                    acceptReserved,
-                    metadexReserved));
-        }
-
-        if (false == emptyWallet) {
-            // add the line to the hash
-            SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
-
-            // write the line
-            file << lineOut << endl;
-        }
-    }
-
-    return 0;
-}
-
-static int write_mp_offers(ofstream &file, SHA256_CTX *shaCtx)
-{
-  OfferMap::const_iterator iter;
-  for (iter = my_offers.begin(); iter != my_offers.end(); ++iter) {
-    // decompose the key for address
-    std::vector<std::string> vstr;
-    boost::split(vstr, (*iter).first, boost::is_any_of("-"), token_compress_on);
-    CMPOffer const &offer = (*iter).second;
-    offer.saveOffer(file, shaCtx, vstr[0]);
-  }
-
-
-  return 0;
-}
-
-static int write_mp_metadex(ofstream &file, SHA256_CTX *shaCtx)
-{
-  for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it)
-  {
-    md_PricesMap & prices = my_it->second;
-    for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it)
-    {
-      md_Set & indexes = (it->second);
-      for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it)
-      {
-        CMPMetaDEx meta = *it;
-        meta.saveOffer(file, shaCtx);
-      }
-    }
-  }
-
-  return 0;
-}
-
-static int write_mp_accepts(ofstream &file, SHA256_CTX *shaCtx)
-{
-  AcceptMap::const_iterator iter;
-  for (iter = my_accepts.begin(); iter != my_accepts.end(); ++iter) {
-    // decompose the key for address
-    std::vector<std::string> vstr;
-    boost::split(vstr, (*iter).first, boost::is_any_of("-+"), token_compress_on);
-    CMPAccept const &accept = (*iter).second;
-    accept.saveAccept(file, shaCtx, vstr[0], vstr[1]);
-  }
-
-  return 0;
-}
-
-static int write_globals_state(ofstream &file, SHA256_CTX *shaCtx)
-{
-  unsigned int nextSPID = _my_sps->peekNextSPID(OMNI_PROPERTY_MSC);
-  unsigned int nextTestSPID = _my_sps->peekNextSPID(OMNI_PROPERTY_TMSC);
-  std::string lineOut = strprintf("%d,%d,%d",
-    exodus_prev,
-    nextSPID,
-    nextTestSPID);
-
-  // add the line to the hash
-  SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
-
-  // write the line
-  file << lineOut << endl;
-
-  return 0;
-}
-
-static int write_mp_crowdsales(std::ofstream& file, SHA256_CTX* shaCtx)
-{
-    for (CrowdMap::const_iterator it = my_crowds.begin(); it != my_crowds.end(); ++it) {
-        // decompose the key for address
-        const CMPCrowd& crowd = it->second;
-        crowd.saveCrowdSale(file, shaCtx, it->first);
-    }
-
-    return 0;
-}
-
-static int write_state_file( CBlockIndex const *pBlockIndex, int what )
-{
-  boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[what], pBlockIndex->GetBlockHash().ToString());
-  const std::string strFile = path.string();
-
-  std::ofstream file;
-  file.open(strFile.c_str());
-
-  SHA256_CTX shaCtx;
-  SHA256_Init(&shaCtx);
-
-  int result = 0;
-
-  switch(what) {
-  case FILETYPE_BALANCES:
-    result = write_msc_balances(file, &shaCtx);
-    break;
-
-  case FILETYPE_OFFERS:
-    result = write_mp_offers(file, &shaCtx);
-    break;
-
-  case FILETYPE_ACCEPTS:
-    result = write_mp_accepts(file, &shaCtx);
-    break;
-
-  case FILETYPE_GLOBALS:
-    result = write_globals_state(file, &shaCtx);
-    break;
-
-  case FILETYPE_CROWDSALES:
-      result = write_mp_crowdsales(file, &shaCtx);
-      break;
-
-  case FILETYPE_MDEXORDERS:
-      result = write_mp_metadex(file, &shaCtx);
-      break;
-  }
-
-  // generate and wite the double hash of all the contents written
-  uint256 hash1;
-  SHA256_Final((unsigned char*)&hash1, &shaCtx);
-  uint256 hash2;
-  SHA256((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
-  file << "!" << hash2.ToString() << endl;
-
-  file.flush();
-  file.close();
-  return result;
-}
-
-static bool is_state_prefix( std::string const &str )
-{
-  for (int i = 0; i < NUM_FILETYPES; ++i) {
-    if (boost::equals(str,  statePrefix[i])) {
-      return true;
-    }
-  }
-
-  return false;
-}
-
-static void prune_state_files( CBlockIndex const *topIndex )
+/**
+ * Persists the state as of the given block.
+ *
+ * The state is serialized while the block is being processed, and written to disk
+ * in the background. States are recorded as persisted, and considered for pruning,
+ * once they were written.
+ */
+int mastercore_save_state( CBlockIndex const *pBlockIndex )
 {
-  // build a set of blockHashes for which we have any state files
-  std::set<uint256> statefulBlockHashes;
-
-  boost::filesystem::directory_iterator dIter(MPPersistencePath);
-  boost::filesystem::directory_iterator endIter;
-  for (; dIter != endIter; ++dIter) {
-    std::string fName = dIter->path().empty() ? "<invalid>" : (*--dIter->path().end()).string();
-    if (false == boost::filesystem::is_regular_file(dIter->status())) {
-      // skip funny business
-      PrintToLog("Non-regular file found in persistence directory : %s\n", fName);
-      continue;
+    // write a full snapshot, if a previous state could not be written
+    if (pStateWriter->checkFailed()) {
+        ResetStateChanges(0);
     }
 
-    std::vector<std::string> vstr;
-    boost::split(vstr, fName, boost::is_any_of("-."), token_compress_on);
-    if (  vstr.size() == 3 &&
-          is_state_prefix(vstr[0]) &&
-          boost::equals(vstr[2], "dat")) {
-      uint256 blockHash;
-      blockHash.SetHex(vstr[1]);
-      statefulBlockHashes.insert(blockHash);
-    } else {
-      PrintToLog("None state file found in persistence directory : %s\n", fName);
-    }
-  }
-
-  // for each blockHash in the set, determine the distance from the given block
-  std::set<uint256>::const_iterator iter;
-  for (iter = statefulBlockHashes.begin(); iter != statefulBlockHashes.end(); ++iter) {
-    // look up the CBlockIndex for height info
-    CBlockIndex const *curIndex = GetBlockIndex(*iter);
-
-    // if we have nothing int the index, or this block is too old..
-    if (NULL == curIndex || (topIndex->nHeight - curIndex->nHeight) > MAX_STATE_HISTORY ) {
-     if (msc_debug_persistence)
-     {
-      if (curIndex) {
-        PrintToLog("State from Block:%s is no longer need, removing files (age-from-tip: %d)\n", (*iter).ToString(), topIndex->nHeight - curIndex->nHeight);
-      } else {
-        PrintToLog("State from Block:%s is no longer need, removing files (not in index)\n", (*iter).ToString());
-      }
-     }
-
-      // destroy the associated files!
-      std::string strBlockHash = iter->ToString();
-      for (int i = 0; i < NUM_FILETYPES; ++i) {
-        boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], strBlockHash);
-        boost::filesystem::remove(path);
-      }
-    }
-  }
-}
-
-int mastercore_save_state( CBlockIndex const *pBlockIndex )
-{
-    // write the new state as of the given block
-    write_state_file(pBlockIndex, FILETYPE_BALANCES);
-    write_state_file(pBlockIndex, FILETYPE_OFFERS);
-    write_state_file(pBlockIndex, FILETYPE_ACCEPTS);
-    write_state_file(pBlockIndex, FILETYPE_GLOBALS);
-    write_state_file(pBlockIndex, FILETYPE_CROWDSALES);
-    write_state_file(pBlockIndex, FILETYPE_MDEXORDERS);
+    // serialize the new state as of the given block
+    StateSnapshotJob* pJob = new StateSnapshotJob();
+    serialize_state_snapshot(pBlockIndex, *pJob);
+    ResetStateChanges(pBlockIndex->GetBlockHash());
 
-    // clean-up the directory
-    prune_state_files(pBlockIndex);
+    // clean-up the directory, based on the states written so far
+    record_state_files();
+    prune_state_files(pBlockIndex, pJob->vPruned);
 
-    _my_sps->setWatermark(pBlockIndex->GetBlockHash());
+    pStateWriter->push(pJob);
 
     return 0;
 }
@@ -2552,11 +4068,11 @@ void clear_all_state()
     LOCK2(cs_tally, cs_pending);
 
     // Memory based storage
-    mp_tally_map.clear();
+    ClearTallyMap();
     my_offers.clear();
     my_accepts.clear();
     my_crowds.clear();
-    metadex.clear();
+    MetaDEx_CLEAR();
     my_pending.clear();
     ResetConsensusParams();
     ClearActivations();
@@ -2569,6 +4085,15 @@ void clear_all_state()
     t_tradelistdb->Clear();
     assert(p_txlistdb->setDBVersion() == DB_VERSION); // new set of databases, set DB version
     exodus_prev = 0;
+    ResetStateChanges(0);
+
+    // the persisted seed blocks were derived from the cleared databases
+    ClearSeedBlocks();
+    try {
+        boost::filesystem::remove(GetSeedBlocksPath());
+    } catch (const boost::filesystem::filesystem_error& e) {
+        PrintToLog("Failed to delete the seed blocks: %s\n", e.what());
+    }
 }
 
 /**
@@ -2594,6 +4119,12 @@ int mastercore_init()
     InitDebugLogLevels();
     ShrinkDebugLog();
 
+    {
+        LOCK(cs_tx_cache);
+        int64_t nInputCacheSize = std::max(GetArg("-omniinputcache", DEFAULT_INPUT_CACHE_SIZE), (int64_t) 1);
+        inputCache.SetMaxUsage(nInputCacheSize << 20);
+    }
+
     if (isNonMainNet()) {
         exodus_address = exodus_testnet;
     }
@@ -2615,11 +4146,13 @@ int mastercore_init()
             boost::filesystem::path tradePath = GetDataDir() / "MP_tradelist";
             boost::filesystem::path spPath = GetDataDir() / "MP_spinfo";
             boost::filesystem::path stoPath = GetDataDir() / "MP_stolist";
+            boost::filesystem::path seedBlocksPath = GetSeedBlocksPath();
             if (boost::filesystem::exists(persistPath)) boost::filesystem::remove_all(persistPath);
             if (boost::filesystem::exists(txlistPath)) boost::filesystem::remove_all(txlistPath);
             if (boost::filesystem::exists(tradePath)) boost::filesystem::remove_all(tradePath);
             if (boost::filesystem::exists(spPath)) boost::filesystem::remove_all(spPath);
             if (boost::filesystem::exists(stoPath)) boost::filesystem::remove_all(stoPath);
+            if (boost::filesystem::exists(seedBlocksPath)) boost::filesystem::remove(seedBlocksPath);
             PrintToLog("Success clearing persistence files in datadir %s\n", GetDataDir().string());
             startClean = true;
         } catch (const boost::filesystem::filesystem_error& e) {
@@ -2635,6 +4168,7 @@ int mastercore_init()
 
     MPPersistencePath = GetDataDir() / "MP_persist";
     TryCreateDirectory(MPPersistencePath);
+    pStateWriter = new StateSnapshotWriter();
 
     bool wrongDBVersion = (p_txlistdb->getDBVersion() != DB_VERSION);
 
@@ -2675,6 +4209,10 @@ int mastercore_init()
     // advance the waterline so that we start on the next unaccounted for block
     nWaterlineBlock += 1;
 
+    // load the seed blocks, and cover the blocks processed so far from the transaction database
+    LoadSeedBlocks(GetSeedBlocksPath());
+    FillSeedBlocks(nWaterlineBlock - 1);
+
     // collect the real Exodus balances available at the snapshot time
     // redundant? do we need to show it both pre-parse and post-parse?  if so let's label the printfs accordingly
     if (msc_debug_exo) {
@@ -2713,6 +4251,22 @@ int mastercore_shutdown()
 {
     LOCK(cs_tally);
 
+    if (pStateWriter) {
+        // finish writing the persisted state
+        pStateWriter->flush();
+        record_state_files();
+        delete pStateWriter;
+        pStateWriter = NULL;
+    }
+
+    if (pPreparePool) {
+        delete pPreparePool;
+        pPreparePool = NULL;
+    }
+
+    WriteSeedBlocks(GetSeedBlocksPath());
+    LogInputCacheStats(__func__);
+
     if (p_txlistdb) {
         delete p_txlistdb;
         p_txlistdb = NULL;
@@ -2765,7 +4319,10 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
     mp_obj.unlockLogic();
 
     bool fFoundTx = false;
-    int pop_ret = parseTransaction(false, tx, nBlock, idx, mp_obj, nBlockTime);
+    int pop_ret = 0;
+    if (!TakePreparedTransaction(tx.GetHash(), nBlock, idx, mp_obj, pop_ret)) {
+        pop_ret = parseTransaction(false, tx, nBlock, idx, mp_obj, nBlockTime);
+    }
 
     if (!legacy::useLegacyProcessing(nBlock))
     {
@@ -2797,7 +4354,7 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
         // PKT_ERROR - 2 = interpret_Transaction failed, structurally invalid payload
         if (interp_ret != PKT_ERROR - 2) {
             bool bValid = (0 <= interp_ret);
-            p_txlistdb->recordTX(tx.GetHash(), bValid, nBlock, mp_obj.getType(), mp_obj.getNewAmount());
+            p_txlistdb->recordTX(tx.GetHash(), bValid, nBlock, mp_obj.getType(), mp_obj.getNewAmount(), &mp_obj);
         }
         fFoundTx |= (interp_ret == 0);
     }
@@ -2898,23 +4455,122 @@ int mastercore::ClassAgnosticWalletTXBuilder(const std::string& senderAddress, c
 #endif
 }
 
+/**
+ * The transaction database stores binary records, which are serialized with CDataStream. Each key
+ * starts with a character, which identifies the type of the record, followed by the raw txid:
+ *
+ *   "T" + txid = CMPTxRecord (transactions and DEx payments)
+ *   "S" + txid + number = propertyid, amount (sends of a "send all")
+ *   "P" + txid + number = vout, buyer, seller, propertyid, amount (DEx payments)
+ *   "C" + txid = CMPTxRecord (MetaDEx cancels)
+ *   "D" + txid + number = cancelled txid, propertyid, amount (orders of a MetaDEx cancel)
+ *   "E" + txid = amount (Exodus purchases)
+ *
+ * Besides the records, the transaction database holds an index of all records by block, an index
+ * of valid activations and alerts by type, and the number of transaction records:
+ *
+ *   "B" + block (big endian) + key = ""
+ *   "Y" + type (big endian) + block (big endian) + txid = decoded payload
+ *   "txcount" = number of transaction records
+ *
+ * They are updated in the same batch as the records. The block index is ordered by height, so
+ * records can be rolled back without scanning the whole database. The type index holds the
+ * decoded payloads of valid activations and alerts, which are replayed at startup. Other
+ * transaction types have no entry in the type index.
+ */
+static const char TX_RECORD = 'T';
+static const char TX_RECORD_SENDALL = 'S';
+static const char TX_RECORD_PAYMENT = 'P';
+static const char TX_RECORD_CANCEL = 'C';
+static const char TX_RECORD_CANCEL_DETAILS = 'D';
+static const char TX_RECORD_EXODUS = 'E';
+static const char TX_INDEX_BLOCK = 'B';
+static const char TX_INDEX_TYPE = 'Y';
+static const std::string TX_COUNTER_KEY = "txcount";
+
+/** Returns the key of a record. */
+static std::string GetTxRecordKey(char type, const uint256& txid)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << type;
+    ssKey << txid;
+    return std::string(ssKey.begin(), ssKey.end());
+}
+
+/** Returns the key of a numbered sub record. */
+static std::string GetTxRecordKey(char type, const uint256& txid, uint32_t number)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << type;
+    ssKey << txid;
+    ssKey << number;
+    return std::string(ssKey.begin(), ssKey.end());
+}
+
+/** Returns the common key prefix of the records of a block. */
+static std::string GetTxBlockPrefix(int block)
+{
+    unsigned char height[4];
+    WriteBE32(height, block);
+    std::string strPrefix(1, TX_INDEX_BLOCK);
+    strPrefix.append((const char*) height, sizeof(height));
+    return strPrefix;
+}
+
+/** Returns the common key prefix of the transactions of a type. */
+static std::string GetTxTypePrefix(uint32_t type)
+{
+    unsigned char typeBytes[4];
+    WriteBE32(typeBytes, type);
+    std::string strPrefix(1, TX_INDEX_TYPE);
+    strPrefix.append((const char*) typeBytes, sizeof(typeBytes));
+    return strPrefix;
+}
+
+/** Returns the key of a transaction in the type index. */
+static std::string GetTxTypeKey(uint32_t type, int block, const uint256& txid)
+{
+    std::string strKey = GetTxTypePrefix(type) + GetTxBlockPrefix(block).substr(1);
+    strKey.append((const char*) txid.begin(), txid.size());
+    return strKey;
+}
+
+/** Adds a record and its entry in the block index to a batch. */
+static void PutTxRecord(leveldb::WriteBatch& batch, int block, const std::string& key, const CDataStream& ssValue)
+{
+    batch.Put(key, leveldb::Slice(ssValue.empty() ? NULL : &ssValue[0], ssValue.size()));
+    batch.Put(GetTxBlockPrefix(block) + key, "");
+}
+
+/** Deserializes a value, and returns false, if it is malformed. */
+static bool ReadTxValue(const leveldb::Slice& slValue, CMPTxRecord& record)
+{
+    try {
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> record;
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+        return false;
+    }
+    return true;
+}
+
 std::set<int> CMPTxList::GetSeedBlocks(int startHeight, int endHeight)
 {
     std::set<int> setSeedBlocks;
 
     if (!pdb) return setSeedBlocks;
 
+    const std::string strEnd = GetTxBlockPrefix(endHeight + 1);
+
     Iterator* it = NewIterator();
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        int block = atoi(vstr[1]);
-        if (block >= startHeight && block <= endHeight) {
-            setSeedBlocks.insert(block);
-        }
+    // only the first record of a block is visited, then the iterator jumps to the next block
+    it->Seek(GetTxBlockPrefix(startHeight));
+    while (it->Valid() && it->key().compare(strEnd) < 0) {
+        int nBlock = ReadBE32((const unsigned char*) it->key().data() + 1);
+        setSeedBlocks.insert(nBlock);
+        it->Seek(GetTxBlockPrefix(nBlock + 1));
     }
 
     delete it;
@@ -2926,60 +4582,35 @@ void CMPTxList::LoadActivations(int blockHeight)
 {
     if (!pdb) return;
 
-    Slice skey, svalue;
-    Iterator* it = NewIterator();
-
     PrintToLog("Loading feature activations from levelDB\n");
 
-    std::vector<std::pair<int64_t, uint256> > loadOrder;
-
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        if (atoi(vstr[2]) != OMNICORE_MESSAGE_TYPE_ACTIVATION || atoi(vstr[0]) != 1) continue; // we only care about valid activations
-        uint256 txid(it->key().ToString());;
-        loadOrder.push_back(std::make_pair(atoi(vstr[1]), txid));
-    }
-
-    std::sort (loadOrder.begin(), loadOrder.end());
-
-    for (std::vector<std::pair<int64_t, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
-        uint256 hash = (*it).second;
-        uint256 blockHash = 0;
-        CTransaction wtx;
-        CMPTransaction mp_obj;
+    // the type index is ordered by block, so activations are replayed in the order they were made
+    const std::string strPrefix = GetTxTypePrefix(OMNICORE_MESSAGE_TYPE_ACTIVATION);
+    Iterator* it = NewIterator();
 
-        if (!GetTransaction(hash, wtx, blockHash, true)) {
-            PrintToLog("ERROR: While loading activation transaction %s: tx in levelDB but does not exist.\n", hash.GetHex());
-            continue;
-        }
-        if ((0 == blockHash) || (NULL == GetBlockIndex(blockHash))) {
-            PrintToLog("ERROR: While loading activation transaction %s: failed to retrieve block hash.\n", hash.GetHex());
-            continue;
-        }
-        CBlockIndex* pBlockIndex = GetBlockIndex(blockHash);
-        if (NULL == pBlockIndex) {
-            PrintToLog("ERROR: While loading activation transaction %s: failed to retrieve block index.\n", hash.GetHex());
-            continue;
-        }
-        int blockHeight = pBlockIndex->nHeight;
-        if (0 != ParseTransaction(wtx, blockHeight, 0, mp_obj)) {
-            PrintToLog("ERROR: While loading activation transaction %s: failed ParseTransaction.\n", hash.GetHex());
-            continue;
-        }
-        if (!mp_obj.interpret_Transaction()) {
-            PrintToLog("ERROR: While loading activation transaction %s: failed interpret_Transaction.\n", hash.GetHex());
+    for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next()) {
+        if (it->value().empty()) continue; // we only care about valid activations
+        const int transactionBlock = ReadBE32((const unsigned char*) it->key().data() + strPrefix.size());
+        std::string sender;
+        uint16_t featureId = 0;
+        uint32_t activationBlock = 0;
+        uint32_t minClientVersion = 0;
+        try {
+            CDataStream ssValue(it->value().data(), it->value().data() + it->value().size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> sender;
+            ssValue >> featureId;
+            ssValue >> activationBlock;
+            ssValue >> minClientVersion;
+        } catch (const std::exception& e) {
+            PrintToLog("ERROR: While loading activation in block %d: %s\n", transactionBlock, e.what());
             continue;
         }
-        if (OMNICORE_MESSAGE_TYPE_ACTIVATION != mp_obj.getType()) {
-            PrintToLog("ERROR: While loading activation transaction %s: levelDB type mismatch, not an activation.\n", hash.GetHex());
+        if (!CheckActivationAuthorization(sender)) {
+            PrintToLog("ERROR: While loading activation in block %d: sender %s is not authorized for feature activations.\n", transactionBlock, sender);
             continue;
         }
-        mp_obj.unlockLogic();
-        if (0 != mp_obj.interpretPacket()) {
-            PrintToLog("ERROR: While loading activation transaction %s: non-zero return from interpretPacket\n", hash.GetHex());
+        if (!ActivateFeature(featureId, activationBlock, minClientVersion, transactionBlock)) {
+            PrintToLog("ERROR: While loading activation in block %d: ActivateFeature failed to activate feature %d.\n", transactionBlock, featureId);
             continue;
         }
     }
@@ -2996,53 +4627,37 @@ void CMPTxList::LoadActivations(int blockHeight)
 void CMPTxList::LoadAlerts(int blockHeight)
 {
     if (!pdb) return;
-    Slice skey, svalue;
-    Iterator* it = NewIterator();
 
-    std::vector<std::pair<int64_t, uint256> > loadOrder;
-
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        if (atoi(vstr[2]) != OMNICORE_MESSAGE_TYPE_ALERT || atoi(vstr[0]) != 1) continue; // not a valid alert
-        uint256 txid(it->key().ToString());;
-        loadOrder.push_back(std::make_pair(atoi(vstr[1]), txid));
-    }
-
-    std::sort (loadOrder.begin(), loadOrder.end());
+    // the type index is ordered by block, so alerts are replayed in the order they were sent
+    const std::string strPrefix = GetTxTypePrefix(OMNICORE_MESSAGE_TYPE_ALERT);
+    Iterator* it = NewIterator();
 
-    for (std::vector<std::pair<int64_t, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
-        uint256 txid = (*it).second;
-        uint256 blockHash = 0;
-        CTransaction wtx;
-        CMPTransaction mp_obj;
-        if (!GetTransaction(txid, wtx, blockHash, true)) {
-            PrintToLog("ERROR: While loading alert %s: tx in levelDB but does not exist.\n", txid.GetHex());
-            continue;
-        }
-        if (0 != ParseTransaction(wtx, blockHeight, 0, mp_obj)) {
-            PrintToLog("ERROR: While loading alert %s: failed ParseTransaction.\n", txid.GetHex());
-            continue;
-        }
-        if (!mp_obj.interpret_Transaction()) {
-            PrintToLog("ERROR: While loading alert %s: failed interpret_Transaction.\n", txid.GetHex());
-            continue;
-        }
-        if (OMNICORE_MESSAGE_TYPE_ALERT != mp_obj.getType()) {
-            PrintToLog("ERROR: While loading alert %s: levelDB type mismatch, not an alert.\n", txid.GetHex());
+    for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next()) {
+        if (it->value().empty()) continue; // not a valid alert
+        const int transactionBlock = ReadBE32((const unsigned char*) it->key().data() + strPrefix.size());
+        std::string sender;
+        uint16_t alertType = 0;
+        uint32_t alertExpiry = 0;
+        std::string alertMessage;
+        try {
+            CDataStream ssValue(it->value().data(), it->value().data() + it->value().size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> sender;
+            ssValue >> alertType;
+            ssValue >> alertExpiry;
+            ssValue >> alertMessage;
+        } catch (const std::exception& e) {
+            PrintToLog("ERROR: While loading alert in block %d: %s\n", transactionBlock, e.what());
             continue;
         }
-        if (!CheckAlertAuthorization(mp_obj.getSender())) {
-            PrintToLog("ERROR: While loading alert %s: sender is not authorized to send alerts.\n", txid.GetHex());
+        if (!CheckAlertAuthorization(sender)) {
+            PrintToLog("ERROR: While loading alert in block %d: sender %s is not authorized to send alerts.\n", transactionBlock, sender);
             continue;
         }
 
-        if (mp_obj.getAlertType() == 65535) { // set alert type to FFFF to clear previously sent alerts
-            DeleteAlerts(mp_obj.getSender());
+        if (alertType == 65535) { // set alert type to FFFF to clear previously sent alerts
+            DeleteAlerts(sender);
         } else {
-            AddAlert(mp_obj.getSender(), mp_obj.getAlertType(), mp_obj.getAlertExpiry(), mp_obj.getAlertMessage());
+            AddAlert(sender, alertType, alertExpiry, alertMessage);
         }
     }
 
@@ -3062,21 +4677,16 @@ void CMPTxList::LoadAlerts(int blockHeight)
 
 uint256 CMPTxList::findMetaDExCancel(const uint256 txid)
 {
-  std::vector<std::string> vstr;
-  string txidStr = txid.ToString();
-  Slice skey, svalue;
+  const std::string strPrefix(1, TX_RECORD_CANCEL_DETAILS);
   uint256 cancelTxid;
   Iterator* it = NewIterator();
-  for(it->SeekToFirst(); it->Valid(); it->Next())
+  for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next())
   {
-      skey = it->key();
-      svalue = it->value();
-      string svalueStr = svalue.ToString();
-      boost::split(vstr, svalueStr, boost::is_any_of(":"), token_compress_on);
-      // obtain the existing affected tx count
-      if (3 <= vstr.size())
-      {
-          if (vstr[0] == txidStr) { delete it; cancelTxid.SetHex(skey.ToString()); return cancelTxid; }
+      // the cancelled txid is the first field of the value
+      if (it->value().size() >= txid.size() && memcmp(it->value().data(), txid.begin(), txid.size()) == 0) {
+          memcpy(cancelTxid.begin(), it->key().data() + 1, cancelTxid.size());
+          delete it;
+          return cancelTxid;
       }
   }
 
@@ -3123,18 +4733,13 @@ int CMPTxList::getNumberOfMetaDExCancels(const uint256 txid)
 {
     if (!pdb) return 0;
     int numberOfCancels = 0;
-    std::vector<std::string> vstr;
-    string strValue;
-    Status status = pdb->Get(readoptions, txid.ToString() + "-C", &strValue);
-    if (status.ok())
+    std::string strValue;
+    Status status = Read(GetTxRecordKey(TX_RECORD_CANCEL, txid), &strValue);
+    CMPTxRecord record;
+    if (status.ok() && ReadTxValue(strValue, record))
     {
-        // parse the string returned
-        boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
         // obtain the number of cancels
-        if (4 <= vstr.size())
-        {
-            numberOfCancels = atoi(vstr[3]);
-        }
+        numberOfCancels = record.nValue;
     }
     return numberOfCancels;
 }
@@ -3146,14 +4751,9 @@ int CMPTxList::getNumberOfSubRecords(const uint256& txid)
 {
     int numberOfSubRecords = 0;
 
-    std::string strValue;
-    Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
-    if (status.ok()) {
-        std::vector<std::string> vstr;
-        boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 <= vstr.size()) {
-            numberOfSubRecords = boost::lexical_cast<int>(vstr[3]);
-        }
+    CMPTxRecord record;
+    if (getTX(txid, record)) {
+        numberOfSubRecords = record.nValue;
     }
 
     return numberOfSubRecords;
@@ -3161,48 +4761,40 @@ int CMPTxList::getNumberOfSubRecords(const uint256& txid)
 
 int CMPTxList::getMPTransactionCountTotal()
 {
-    int count = 0;
-    Slice skey, svalue;
-    Iterator* it = NewIterator();
-    for(it->SeekToFirst(); it->Valid(); it->Next())
-    {
-        skey = it->key();
-        if (skey.ToString().length() == 64) { ++count; } //extra entries for cancels and purchases are more than 64 chars long
-    }
-    delete it;
-    return count;
+    return ReadCounter(TX_COUNTER_KEY);
 }
 
 int CMPTxList::getMPTransactionCountBlock(int block)
 {
     int count = 0;
-    Slice skey, svalue;
+    const std::string strPrefix = GetTxBlockPrefix(block);
     Iterator* it = NewIterator();
-    for(it->SeekToFirst(); it->Valid(); it->Next())
-    {
-        skey = it->key();
-        svalue = it->value();
-        if (skey.ToString().length() == 64)
-        {
-            string strValue = svalue.ToString();
-            std::vector<std::string> vstr;
-            boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
-            if (4 == vstr.size())
-            {
-                if (atoi(vstr[1]) == block) { ++count; }
-            }
-        }
+    for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next()) {
+        if (it->key()[strPrefix.size()] == TX_RECORD) ++count; // sub records are not counted
     }
     delete it;
     return count;
 }
 
-string CMPTxList::getKeyValue(string key)
+/**
+ * Retrieves details about a cancelled order of a MetaDEx cancel.
+ */
+bool CMPTxList::getMetaDExCancelDetails(const uint256& txid, int refNumber, uint256& cancelledTxid, uint32_t& propertyId, int64_t& amount)
 {
-    if (!pdb) return "";
-    string strValue;
-    Status status = pdb->Get(readoptions, key, &strValue);
-    if (status.ok()) { return strValue; } else { return ""; }
+    if (!pdb) return false;
+    std::string strValue;
+    leveldb::Status status = Read(GetTxRecordKey(TX_RECORD_CANCEL_DETAILS, txid, refNumber), &strValue);
+    if (!status.ok()) return false;
+    try {
+        CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> cancelledTxid;
+        ssValue >> propertyId;
+        ssValue >> amount;
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+        return false;
+    }
+    return true;
 }
 
 /**
@@ -3210,43 +4802,42 @@ string CMPTxList::getKeyValue(string key)
  */
 bool CMPTxList::getSendAllDetails(const uint256& txid, int subSend, uint32_t& propertyId, int64_t& amount)
 {
-    std::string strKey = strprintf("%s-%d", txid.ToString(), subSend);
     std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, strKey, &strValue);
-    if (status.ok()) {
-        std::vector<std::string> vstr;
-        boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-        if (2 == vstr.size()) {
-            propertyId = boost::lexical_cast<uint32_t>(vstr[0]);
-            amount = boost::lexical_cast<int64_t>(vstr[1]);
-            return true;
-        }
+    leveldb::Status status = Read(GetTxRecordKey(TX_RECORD_SENDALL, txid, subSend), &strValue);
+    if (!status.ok()) return false;
+    try {
+        CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> propertyId;
+        ssValue >> amount;
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+        return false;
     }
-    return false;
+    return true;
 }
 
 bool CMPTxList::getPurchaseDetails(const uint256 txid, int purchaseNumber, string *buyer, string *seller, uint64_t *vout, uint64_t *propertyId, uint64_t *nValue)
 {
-    if (!pdb) return 0;
-    std::vector<std::string> vstr;
-    string strValue;
-    Status status = pdb->Get(readoptions, txid.ToString()+"-"+to_string(purchaseNumber), &strValue);
-    if (status.ok())
-    {
-        // parse the string returned
-        boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
-        // obtain the requisite details
-        if (5 == vstr.size())
-        {
-            *vout = atoi(vstr[0]);
-            *buyer = vstr[1];
-            *seller = vstr[2];
-            *propertyId = atoi(vstr[3]);
-            *nValue = boost::lexical_cast<boost::uint64_t>(vstr[4]);;
-            return true;
-        }
+    if (!pdb) return false;
+    std::string strValue;
+    Status status = Read(GetTxRecordKey(TX_RECORD_PAYMENT, txid, purchaseNumber), &strValue);
+    if (!status.ok()) return false;
+    try {
+        uint32_t nOut = 0;
+        uint32_t nProperty = 0;
+        CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> nOut;
+        ssValue >> *buyer;
+        ssValue >> *seller;
+        ssValue >> nProperty;
+        ssValue >> *nValue;
+        *vout = nOut;
+        *propertyId = nProperty;
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+        return false;
     }
-    return false;
+    return true;
 }
 
 void CMPTxList::recordMetaDExCancelTX(const uint256 &txidMaster, const uint256 &txidSub, bool fValid, int nBlock, unsigned int propertyId, uint64_t nValue)
@@ -3256,62 +4847,71 @@ void CMPTxList::recordMetaDExCancelTX(const uint256 &txidMaster, const uint256 &
        // Prep - setup vars
        unsigned int type = 99992104;
        unsigned int refNumber = 1;
-       uint64_t existingAffectedTXCount = 0;
-       string txidMasterStr = txidMaster.ToString() + "-C";
+       const string key = GetTxRecordKey(TX_RECORD_CANCEL, txidMaster);
 
        // Step 1 - Check TXList to see if this cancel TXID exists
        // Step 2a - If doesn't exist leave number of affected txs & ref set to 1
        // Step 2b - If does exist add +1 to existing ref and set this ref as new number of affected
-       std::vector<std::string> vstr;
        string strValue;
-       Status status = pdb->Get(readoptions, txidMasterStr, &strValue);
-       if (status.ok())
+       CMPTxRecord existing;
+       Status status = Read(key, &strValue);
+       if (status.ok() && ReadTxValue(strValue, existing))
        {
-           // parse the string returned
-           boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
-
            // obtain the existing affected tx count
-           if (4 <= vstr.size())
-           {
-               existingAffectedTXCount = atoi(vstr[3]);
-               refNumber = existingAffectedTXCount + 1;
-           }
+           refNumber = existing.nValue + 1;
        }
 
        // Step 3 - Create new/update master record for cancel tx in TXList
-       const string key = txidMasterStr;
-       const string value = strprintf("%u:%d:%u:%lu", fValid ? 1:0, nBlock, type, refNumber);
+       CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+       ssValue << CMPTxRecord(fValid, nBlock, type, refNumber);
        PrintToLog("METADEXCANCELDEBUG : Writing master record %s(%s, valid=%s, block= %d, type= %d, number of affected transactions= %d)\n", __FUNCTION__, txidMaster.ToString(), fValid ? "YES":"NO", nBlock, type, refNumber);
-       if (pdb)
-       {
-           status = pdb->Put(writeoptions, key, value);
-           PrintToLog("METADEXCANCELDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
-       }
 
        // Step 4 - Write sub-record with cancel details
-       const string txidStr = txidMaster.ToString() + "-C";
-       const string subKey = STR_REF_SUBKEY_TXID_REF_COMBO(txidStr, refNumber);
-       const string subValue = strprintf("%s:%d:%lu", txidSub.ToString(), propertyId, nValue);
-       Status subStatus;
-       PrintToLog("METADEXCANCELDEBUG : Writing sub-record %s with value %s\n", subKey, subValue);
+       const string subKey = GetTxRecordKey(TX_RECORD_CANCEL_DETAILS, txidMaster, refNumber);
+       CDataStream ssSubValue(SER_DISK, CLIENT_VERSION);
+       ssSubValue << txidSub;
+       ssSubValue << (uint32_t) propertyId;
+       ssSubValue << nValue;
+       PrintToLog("METADEXCANCELDEBUG : Writing sub-record %s-C%d with value %s:%d:%lu\n", txidMaster.ToString(), refNumber, txidSub.ToString(), propertyId, nValue);
        if (pdb)
        {
-           subStatus = pdb->Put(writeoptions, subKey, subValue);
-           PrintToLog("METADEXCANCELDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, subStatus.ToString(), __LINE__, __FILE__);
+           leveldb::WriteBatch batch;
+           PutTxRecord(batch, nBlock, key, ssValue);
+           PutTxRecord(batch, nBlock, subKey, ssSubValue);
+           status = Write(batch);
+           PrintToLog("METADEXCANCELDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
        }
 }
 
 /**
  * Records a "send all" sub record.
  */
-void CMPTxList::recordSendAllSubRecord(const uint256& txid, int subRecordNumber, uint32_t propertyId, int64_t nValue)
+void CMPTxList::recordSendAllSubRecord(const uint256& txid, int subRecordNumber, uint32_t propertyId, int64_t nValue, int nBlock)
+{
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    ssValue << propertyId;
+    ssValue << nValue;
+
+    leveldb::WriteBatch batch;
+    PutTxRecord(batch, nBlock, GetTxRecordKey(TX_RECORD_SENDALL, txid, subRecordNumber), ssValue);
+    leveldb::Status status = Write(batch);
+    ++nWritten;
+    if (msc_debug_txdb) PrintToLog("%s(): store: %s-%d=%d:%d, status: %s\n", __func__, txid.ToString(), subRecordNumber, propertyId, nValue, status.ToString());
+}
+
+/**
+ * Records an Exodus purchase.
+ */
+void CMPTxList::recordExodusPurchase(const uint256& txid, int nBlock, int64_t amountGenerated)
 {
-    std::string strKey = strprintf("%s-%d", txid.ToString(), subRecordNumber);
-    std::string strValue = strprintf("%d:%d", propertyId, nValue);
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    ssValue << amountGenerated;
 
-    leveldb::Status status = pdb->Put(writeoptions, strKey, strValue);
+    leveldb::WriteBatch batch;
+    PutTxRecord(batch, nBlock, GetTxRecordKey(TX_RECORD_EXODUS, txid), ssValue);
+    leveldb::Status status = Write(batch);
     ++nWritten;
-    if (msc_debug_txdb) PrintToLog("%s(): store: %s=%s, status: %s\n", __func__, strKey, strValue, status.ToString());
+    if (msc_debug_txdb) PrintToLog("%s(): store: %s=%d, status: %s\n", __func__, txid.ToString(), amountGenerated, status.ToString());
 }
 
 void CMPTxList::recordPaymentTX(const uint256 &txid, bool fValid, int nBlock, unsigned int vout, unsigned int propertyId, uint64_t nValue, string buyer, string seller)
@@ -3322,76 +4922,83 @@ void CMPTxList::recordPaymentTX(const uint256 &txid, bool fValid, int nBlock, un
        unsigned int type = 99999999;
        uint64_t numberOfPayments = 1;
        unsigned int paymentNumber = 1;
-       uint64_t existingNumberOfPayments = 0;
 
        // Step 1 - Check TXList to see if this payment TXID exists
-       bool paymentEntryExists = p_txlistdb->exists(txid);
-
        // Step 2a - If doesn't exist leave number of payments & paymentNumber set to 1
        // Step 2b - If does exist add +1 to existing number of payments and set this paymentNumber as new numberOfPayments
+       CMPTxRecord existing;
+       bool paymentEntryExists = getTX(txid, existing);
        if (paymentEntryExists)
        {
-           //retrieve old numberOfPayments
-           std::vector<std::string> vstr;
-           string strValue;
-           Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
-           if (status.ok())
-           {
-               // parse the string returned
-               boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
-
-               // obtain the existing number of payments
-               if (4 <= vstr.size())
-               {
-                   existingNumberOfPayments = atoi(vstr[3]);
-                   paymentNumber = existingNumberOfPayments + 1;
-                   numberOfPayments = existingNumberOfPayments + 1;
-               }
-           }
+           paymentNumber = existing.nValue + 1;
+           numberOfPayments = existing.nValue + 1;
        }
 
        // Step 3 - Create new/update master record for payment tx in TXList
-       const string key = txid.ToString();
-       const string value = strprintf("%u:%d:%u:%lu", fValid ? 1:0, nBlock, type, numberOfPayments); 
+       const string key = GetTxRecordKey(TX_RECORD, txid);
+       CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+       ssValue << CMPTxRecord(fValid, nBlock, type, numberOfPayments);
        Status status;
        PrintToLog("DEXPAYDEBUG : Writing master record %s(%s, valid=%s, block= %d, type= %d, number of payments= %lu)\n", __FUNCTION__, txid.ToString(), fValid ? "YES":"NO", nBlock, type, numberOfPayments);
-       if (pdb)
-       {
-           status = pdb->Put(writeoptions, key, value);
-           PrintToLog("DEXPAYDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
-       }
 
        // Step 4 - Write sub-record with payment details
-       const string txidStr = txid.ToString();
-       const string subKey = STR_PAYMENT_SUBKEY_TXID_PAYMENT_COMBO(txidStr, paymentNumber);
-       const string subValue = strprintf("%d:%s:%s:%d:%lu", vout, buyer, seller, propertyId, nValue);
-       Status subStatus;
-       PrintToLog("DEXPAYDEBUG : Writing sub-record %s with value %s\n", subKey, subValue);
+       const string subKey = GetTxRecordKey(TX_RECORD_PAYMENT, txid, paymentNumber);
+       CDataStream ssSubValue(SER_DISK, CLIENT_VERSION);
+       ssSubValue << (uint32_t) vout;
+       ssSubValue << buyer;
+       ssSubValue << seller;
+       ssSubValue << (uint32_t) propertyId;
+       ssSubValue << nValue;
+       PrintToLog("DEXPAYDEBUG : Writing sub-record %s-%d with value %d:%s:%s:%d:%lu\n", txid.ToString(), paymentNumber, vout, buyer, seller, propertyId, nValue);
        if (pdb)
        {
-           subStatus = pdb->Put(writeoptions, subKey, subValue);
-           PrintToLog("DEXPAYDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, subStatus.ToString(), __LINE__, __FILE__);
+           leveldb::WriteBatch batch;
+           PutTxRecord(batch, nBlock, key, ssValue);
+           PutTxRecord(batch, nBlock, subKey, ssSubValue);
+           if (!paymentEntryExists) UpdateCounter(batch, TX_COUNTER_KEY, 1);
+           status = Write(batch);
+           PrintToLog("DEXPAYDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
        }
 }
 
-void CMPTxList::recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned int type, uint64_t nValue)
+void CMPTxList::recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned int type, uint64_t nValue, const CMPTransaction* pMPTx)
 {
   if (!pdb) return;
 
   // overwrite detection, we should never be overwriting a tx, as that means we have redone something a second time
   // reorgs delete all txs from levelDB above reorg_chain_height
-  if (p_txlistdb->exists(txid)) PrintToLog("LEVELDB TX OVERWRITE DETECTION - %s\n", txid.ToString());
+  bool fOverwrite = p_txlistdb->exists(txid);
+  if (fOverwrite) PrintToLog("LEVELDB TX OVERWRITE DETECTION - %s\n", txid.ToString());
 
-const string key = txid.ToString();
-const string value = strprintf("%u:%d:%u:%lu", fValid ? 1:0, nBlock, type, nValue);
+const string key = GetTxRecordKey(TX_RECORD, txid);
+CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+ssValue << CMPTxRecord(fValid, nBlock, type, nValue);
 Status status;
 
+  // activations and alerts are persisted in decoded form, so they can be replayed at startup
+  CDataStream ssPayload(SER_DISK, CLIENT_VERSION);
+  if (fValid && pMPTx && type == OMNICORE_MESSAGE_TYPE_ACTIVATION) {
+    ssPayload << pMPTx->getSender();
+    ssPayload << pMPTx->getFeatureId();
+    ssPayload << pMPTx->getActivationBlock();
+    ssPayload << pMPTx->getMinClientVersion();
+  } else if (fValid && pMPTx && type == OMNICORE_MESSAGE_TYPE_ALERT) {
+    ssPayload << pMPTx->getSender();
+    ssPayload << pMPTx->getAlertType();
+    ssPayload << pMPTx->getAlertExpiry();
+    ssPayload << pMPTx->getAlertMessage();
+  }
+
   PrintToLog("%s(%s, valid=%s, block= %d, type= %d, value= %lu)\n",
    __FUNCTION__, txid.ToString(), fValid ? "YES":"NO", nBlock, type, nValue);
 
   if (pdb)
   {
-    status = pdb->Put(writeoptions, key, value);
+    leveldb::WriteBatch batch;
+    PutTxRecord(batch, nBlock, key, ssValue);
+    if (!ssPayload.empty()) PutTxRecord(batch, nBlock, GetTxTypeKey(type, nBlock, txid), ssPayload);
+    if (!fOverwrite) UpdateCounter(batch, TX_COUNTER_KEY, 1);
+    status = Write(batch);
     ++nWritten;
     if (msc_debug_txdb) PrintToLog("%s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
   }
@@ -3402,7 +5009,7 @@ bool CMPTxList::exists(const uint256 &txid)
   if (!pdb) return false;
 
 string strValue;
-Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
+Status status = Read(GetTxRecordKey(TX_RECORD, txid), &strValue);
 
   if (!status.ok())
   {
@@ -3412,15 +5019,16 @@ Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
   return true;
 }
 
-bool CMPTxList::getTX(const uint256 &txid, string &value)
+bool CMPTxList::getTX(const uint256 &txid, CMPTxRecord &record)
 {
-Status status = pdb->Get(readoptions, txid.ToString(), &value);
+string strValue;
+Status status = Read(GetTxRecordKey(TX_RECORD, txid), &strValue);
 
   ++nRead;
 
   if (status.ok())
   {
-    return true;
+    return ReadTxValue(strValue, record);
   }
 
   return false;
@@ -3442,7 +5050,7 @@ Slice skey, svalue;
     skey = it->key();
     svalue = it->value();
     ++count;
-    PrintToConsole("entry #%8d= %s:%s\n", count, skey.ToString(), svalue.ToString());
+    PrintToConsole("entry #%8d= %s:%s\n", count, HexStr(skey.data(), skey.data() + skey.size()), HexStr(svalue.data(), svalue.data() + svalue.size()));
   }
 
   delete it;
@@ -3453,74 +5061,114 @@ Slice skey, svalue;
 // pass in bDeleteFound = true to erase each entry found within the block range
 bool CMPTxList::isMPinBlockRange(int starting_block, int ending_block, bool bDeleteFound)
 {
-leveldb::Slice skey, svalue;
-unsigned int count = 0;
-std::vector<std::string> vstr;
-int block;
-unsigned int n_found = 0;
+  unsigned int n_found = 0;
+  int64_t nDeletedTxs = 0;
+  leveldb::WriteBatch batch;
+
+  // walk the block index from the starting block, instead of scanning the whole database
+  const std::string strStart = GetTxBlockPrefix(starting_block);
+  const std::string strEnd = GetTxBlockPrefix(ending_block + 1);
 
   leveldb::Iterator* it = NewIterator();
 
-  for(it->SeekToFirst(); it->Valid(); it->Next())
+  for (it->Seek(strStart); it->Valid() && it->key().compare(strEnd) < 0; it->Next())
   {
-    skey = it->key();
-    svalue = it->value();
-
-    ++count;
-
-    string strvalue = it->value().ToString();
+    const leveldb::Slice slKey(it->key().data() + strStart.size(), it->key().size() - strStart.size());
 
-    // parse the string returned, find the validity flag/bit & other parameters
-    boost::split(vstr, strvalue, boost::is_any_of(":"), token_compress_on);
+    ++n_found;
+    PrintToLog("%s() DELETING: %s\n", __FUNCTION__, HexStr(slKey.data(), slKey.data() + slKey.size()));
 
-    // only care about the block number/height here
-    if (2 <= vstr.size())
+    if (bDeleteFound)
     {
-      block = atoi(vstr[1]);
-
-      if ((starting_block <= block) && (block <= ending_block))
-      {
-        ++n_found;
-        PrintToLog("%s() DELETING: %s=%s\n", __FUNCTION__, skey.ToString(), svalue.ToString());
-        if (bDeleteFound) pdb->Delete(writeoptions, skey);
-      }
+      batch.Delete(it->key());
+      batch.Delete(slKey);
+      if (slKey[0] == TX_RECORD) ++nDeletedTxs; // sub records are not counted
     }
   }
 
-  PrintToLog("%s(%d, %d); n_found= %d\n", __FUNCTION__, starting_block, ending_block, n_found);
-
   delete it;
 
+  if (bDeleteFound && n_found > 0)
+  {
+    if (nDeletedTxs > 0) UpdateCounter(batch, TX_COUNTER_KEY, -nDeletedTxs);
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    if (!status.ok()) PrintToLog("%s(): ERROR: %s\n", __FUNCTION__, status.ToString());
+  }
+
+  PrintToLog("%s(%d, %d); n_found= %d\n", __FUNCTION__, starting_block, ending_block, n_found);
+
   return (n_found);
 }
 
 // MPSTOList here
+
+/**
+ * Each received STO is stored as one record, which is keyed by the txid and the recipient, and
+ * indexed by the recipient and the block:
+ *
+ *   "T" + txid + "|" + address = "block:propertyid:amount"
+ *   "A" + address + "|" + block + txid = "propertyid:amount"
+ *   "U" + block + txid + "|" + address = ""
+ *
+ * The recipients of an STO, as well as the receipts of an address, are obtained by prefix seeks.
+ * The undo index "U" is ordered by block, and the other keys can be derived from it, so a
+ * rollback only visits the receipts above the fork.
+ */
+static const char STO_RECEIPT = 'T';
+static const char STO_INDEX_ADDRESS = 'A';
+static const char STO_INDEX_UNDO = 'U';
+
+/** Returns the common key prefix of the receipts of an STO. */
+static std::string GetSTOReceiptPrefix(const uint256& txid)
+{
+    return strprintf("%c%s|", STO_RECEIPT, txid.ToString());
+}
+
+/** Returns the common key prefix of the receipts of an address. */
+static std::string GetSTOAddressPrefix(const std::string& address)
+{
+    return strprintf("%c%s|", STO_INDEX_ADDRESS, address);
+}
+
+/** Returns the common key prefix of the undo entries of a block. */
+static std::string GetSTOUndoPrefix(int block)
+{
+    return strprintf("%c%010d", STO_INDEX_UNDO, block);
+}
+
 std::string CMPSTOList::getMySTOReceipts(string filterAddress)
 {
   if (!pdb) return "";
   string mySTOReceipts = "";
-  Slice skey, svalue;
+  std::set<std::string> seenTxids;
+  const std::string strPrefix = filterAddress.empty() ? std::string(1, STO_INDEX_ADDRESS) : GetSTOAddressPrefix(filterAddress);
   Iterator* it = NewIterator();
-  for(it->SeekToFirst(); it->Valid(); it->Next()) {
-      skey = it->key();
-      string recipientAddress = skey.ToString();
-      if(!IsMyAddress(recipientAddress)) continue; // not ours, not interested
-      if((!filterAddress.empty()) && (filterAddress != recipientAddress)) continue; // not the filtered address
+  it->Seek(strPrefix);
+  while (it->Valid() && it->key().starts_with(strPrefix)) {
+      // key: "A" + address + "|" + block + txid
+      string strKey = it->key().ToString();
+      size_t pos = strKey.find('|');
+      if (pos == std::string::npos || strKey.size() != pos + 1 + 10 + 64) {
+          PrintToLog("STODB Error - unexpected index key (%s)\n", strKey);
+          it->Next();
+          continue;
+      }
+      string recipientAddress = strKey.substr(1, pos - 1);
+      if (!IsMyAddress(recipientAddress)) {
+          // not ours, skip all receipts of this address
+          it->Seek(strKey.substr(0, pos + 1) + "~");
+          continue;
+      }
       // ours, get info
-      svalue = it->value();
-      string strValue = svalue.ToString();
-      // break into individual receipts
-      std::vector<std::string> vstr;
-      boost::split(vstr, strValue, boost::is_any_of(","), token_compress_on);
-      for(uint32_t i = 0; i<vstr.size(); i++) {
-          // add to array
-          std::vector<std::string> svstr;
-          boost::split(svstr, vstr[i], boost::is_any_of(":"), token_compress_on);
-          if(4 == svstr.size()) {
-              size_t txidMatch = mySTOReceipts.find(svstr[0]);
-              if(txidMatch==std::string::npos) mySTOReceipts += svstr[0]+":"+svstr[1]+":"+recipientAddress+":"+svstr[2]+",";
-          }
+      int block = atoi(strKey.substr(pos + 1, 10));
+      string txidStr = strKey.substr(pos + 1 + 10);
+      std::vector<std::string> svstr;
+      string strValue = it->value().ToString();
+      boost::split(svstr, strValue, boost::is_any_of(":"), token_compress_on);
+      if (2 == svstr.size() && seenTxids.insert(txidStr).second) {
+          mySTOReceipts += strprintf("%s:%d:%s:%s,", txidStr, block, recipientAddress, svstr[0]);
       }
+      it->Next();
   }
   delete it;
   // above code will leave a trailing comma - strip it
@@ -3539,72 +5187,52 @@ void CMPSTOList::getRecipients(const uint256 txid, string filterAddress, Array *
   if (filterAddress == "*") filter = false;
   if ((filterAddress != "") && (filterAddress != "*")) { filterByWallet = false; filterByAddress = true; }
 
-  // iterate through SDB, dropping all records where key is not filterAddress (if filtering)
-  int count = 0;
-
   // ugly way to do this, really we should store the fee used but for now since we know it is
   // always num_addresses * 0.00000001 MSC we can recalculate it on the fly
   *stoFee = 0;
 
-  Slice skey, svalue;
+  // iterate through the receipts of the STO, dropping all records where the address is not filterAddress (if filtering)
+  const std::string strPrefix = GetSTOReceiptPrefix(txid);
   Iterator* it = NewIterator();
-  for(it->SeekToFirst(); it->Valid(); it->Next())
+  for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next())
   {
-      skey = it->key();
-      string recipientAddress = skey.ToString();
-      svalue = it->value();
-      string strValue = svalue.ToString();
-      // see if txid is in the data
-      size_t txidMatch = strValue.find(txid.ToString());
-      if(txidMatch!=std::string::npos)
+      ++*stoFee;
+      string recipientAddress = it->key().ToString().substr(strPrefix.size());
+      if(filter)
       {
-          ++*stoFee;
-          // the txid exists inside the data, this address was a recipient of this STO, check filter and add the details
-          if(filter)
-          {
-              if( ( (filterByAddress) && (filterAddress == recipientAddress) ) || ( (filterByWallet) && (IsMyAddress(recipientAddress)) ) )
-              { } else { continue; } // move on if no filter match (but counter still increased for fee)
-          }
-          std::vector<std::string> vstr;
-          boost::split(vstr, strValue, boost::is_any_of(","), token_compress_on);
-          for(uint32_t i = 0; i<vstr.size(); i++)
-          {
-              std::vector<std::string> svstr;
-              boost::split(svstr, vstr[i], boost::is_any_of(":"), token_compress_on);
-              if(4 == svstr.size())
-              {
-                  if(svstr[0] == txid.ToString())
-                  {
-                      //add data to array
-                      uint64_t amount = 0;
-                      uint64_t propertyId = 0;
-                      try
-                      {
-                          amount = boost::lexical_cast<uint64_t>(svstr[3]);
-                          propertyId = boost::lexical_cast<uint64_t>(svstr[2]);
-                      } catch (const boost::bad_lexical_cast &e)
-                      {
-                          PrintToLog("DEBUG STO - error in converting values from leveldb\n");
-                          delete it;
-                          return; //(something went wrong)
-                      }
-                      Object recipient;
-                      recipient.push_back(Pair("address", recipientAddress));
-                      if(isPropertyDivisible(propertyId))
-                      {
-                         recipient.push_back(Pair("amount", FormatDivisibleMP(amount)));
-                      }
-                      else
-                      {
-                         recipient.push_back(Pair("amount", FormatIndivisibleMP(amount)));
-                      }
-                      *total += amount;
-                      recipientArray->push_back(recipient);
-                      ++count;
-                  }
-              }
-          }
+          if( ( (filterByAddress) && (filterAddress == recipientAddress) ) || ( (filterByWallet) && (IsMyAddress(recipientAddress)) ) )
+          { } else { continue; } // move on if no filter match (but counter still increased for fee)
+      }
+      std::vector<std::string> svstr;
+      string strValue = it->value().ToString();
+      boost::split(svstr, strValue, boost::is_any_of(":"), token_compress_on);
+      if (3 != svstr.size()) continue;
+
+      //add data to array
+      uint64_t amount = 0;
+      uint64_t propertyId = 0;
+      try
+      {
+          amount = boost::lexical_cast<uint64_t>(svstr[2]);
+          propertyId = boost::lexical_cast<uint64_t>(svstr[1]);
+      } catch (const boost::bad_lexical_cast &e)
+      {
+          PrintToLog("DEBUG STO - error in converting values from leveldb\n");
+          delete it;
+          return; //(something went wrong)
+      }
+      Object recipient;
+      recipient.push_back(Pair("address", recipientAddress));
+      if(isPropertyDivisible(propertyId))
+      {
+         recipient.push_back(Pair("amount", FormatDivisibleMP(amount)));
+      }
+      else
+      {
+         recipient.push_back(Pair("amount", FormatIndivisibleMP(amount)));
       }
+      *total += amount;
+      recipientArray->push_back(recipient);
   }
 
   delete it;
@@ -3615,58 +5243,35 @@ bool CMPSTOList::exists(string address)
 {
   if (!pdb) return false;
 
-  string strValue;
-  Status status = pdb->Get(readoptions, address, &strValue);
-
-  if (!status.ok())
-  {
-    if (status.IsNotFound()) return false;
-  }
+  const std::string strPrefix = GetSTOAddressPrefix(address);
+  Iterator* it = NewIterator();
+  it->Seek(strPrefix);
+  bool found = it->Valid() && it->key().starts_with(strPrefix);
+  delete it;
 
-  return true;
+  return found;
 }
 
 void CMPSTOList::recordSTOReceive(string address, const uint256 &txid, int nBlock, unsigned int propertyId, uint64_t amount)
 {
   if (!pdb) return;
 
-  bool addressExists = s_stolistdb->exists(address);
-  if (addressExists)
-  {
-      //retrieve existing record
-      std::vector<std::string> vstr;
-      string strValue;
-      Status status = pdb->Get(readoptions, address, &strValue);
-      if (status.ok())
-      {
-          // add details to record
-          // see if we are overwriting (check)
-          size_t txidMatch = strValue.find(txid.ToString());
-          if(txidMatch!=std::string::npos) PrintToLog("STODEBUG : Duplicating entry for %s : %s\n",address,txid.ToString());
-
-          const string key = address;
-          const string newValue = strprintf("%s:%d:%u:%lu,", txid.ToString(), nBlock, propertyId, amount);
-          strValue += newValue;
-          // write updated record
-          Status status;
-          if (pdb)
-          {
-              status = pdb->Put(writeoptions, key, strValue);
-              PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
-          }
-      }
-  }
-  else
-  {
-      const string key = address;
-      const string value = strprintf("%s:%d:%u:%lu,", txid.ToString(), nBlock, propertyId, amount);
-      Status status;
-      if (pdb)
-      {
-          status = pdb->Put(writeoptions, key, value);
-          PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
-      }
-  }
+  const string key = GetSTOReceiptPrefix(txid) + address;
+  const string value = strprintf("%d:%u:%lu", nBlock, propertyId, amount);
+  const string indexKey = GetSTOAddressPrefix(address) + strprintf("%010d", nBlock) + txid.ToString();
+  const string indexValue = strprintf("%u:%lu", propertyId, amount);
+
+  // see if we are overwriting (check)
+  string strValue;
+  if (Read(key, &strValue).ok()) PrintToLog("STODEBUG : Duplicating entry for %s : %s\n",address,txid.ToString());
+
+  leveldb::WriteBatch batch;
+  batch.Put(key, value);
+  batch.Put(indexKey, indexValue);
+  batch.Put(GetSTOUndoPrefix(nBlock) + txid.ToString() + "|" + address, "");
+  Status status = Write(batch);
+  ++nWritten;
+  if (msc_debug_sto) PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
 }
 
 void CMPSTOList::printAll()
@@ -3694,46 +5299,93 @@ void CMPSTOList::printStats()
 /**
  * This function deletes records of STO receivers above a specific block from the STO database.
  *
- * Returns the number of records changed.
+ * Returns the number of records deleted.
  *
- * NOTE: The blockNum parameter is inclusive, so deleteAboveBlock(1000) will delete records in block 1000 and above.
+ * NOTE: Records in block blockNum are kept, so deleteAboveBlock(1000) will delete records in block 1001 and above.
  */
 int CMPSTOList::deleteAboveBlock(int blockNum)
 {
   unsigned int n_found = 0;
-  std::vector<std::string> vecSTORecords;
+  leveldb::WriteBatch batch;
   leveldb::Iterator* it = NewIterator();
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-      std::string newValue;
-      std::string oldValue = it->value().ToString();
-      bool needsUpdate = false;
-      boost::split(vecSTORecords, oldValue, boost::is_any_of(","), boost::token_compress_on);
-      for (uint32_t i = 0; i<vecSTORecords.size(); i++) {
-          std::vector<std::string> vecSTORecordFields;
-          boost::split(vecSTORecordFields, vecSTORecords[i], boost::is_any_of(":"), boost::token_compress_on);
-          if (4 != vecSTORecordFields.size()) continue;
-          if (atoi(vecSTORecordFields[1]) <= blockNum) {
-              newValue += vecSTORecords[i].append(","); // STO before the reorg, add data back to new value string
-          } else {
-              needsUpdate = true;
-          }
-      }
-      if (needsUpdate) { // rewrite record with existing key and new value
-          ++n_found;
-          leveldb::Status status = pdb->Put(writeoptions, it->key().ToString(), newValue);
-          PrintToLog("DEBUG STO - rewriting STO data after reorg\n");
-          PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
-      }
-  }
 
-  PrintToLog("%s(%d); stodb updated records= %d\n", __FUNCTION__, blockNum, n_found);
+  // undo entries: "U" + block + txid + "|" + address
+  for (it->Seek(GetSTOUndoPrefix(blockNum + 1)); it->Valid() && it->key()[0] == STO_INDEX_UNDO; it->Next()) {
+      const std::string strKey = it->key().ToString();
+      if (strKey.size() < 76 || strKey[75] != '|') continue;
+      const std::string strBlock = strKey.substr(1, 10);
+      const std::string strTxid = strKey.substr(11, 64);
+      const std::string strAddress = strKey.substr(76);
+      batch.Delete(it->key());
+      batch.Delete(strprintf("%c%s|%s", STO_RECEIPT, strTxid, strAddress));
+      batch.Delete(GetSTOAddressPrefix(strAddress) + strBlock + strTxid);
+      ++n_found;
+  }
 
   delete it;
 
+  if (n_found > 0) {
+      leveldb::Status status = pdb->Write(writeoptions, &batch);
+      if (!status.ok()) {
+          PrintToLog("%s(): ERROR: %s\n", __FUNCTION__, status.ToString());
+      }
+  }
+
+  PrintToLog("%s(%d); stodb deleted records= %d\n", __FUNCTION__, blockNum, n_found);
+
   return (n_found);
 }
 
 // MPTradeList here
+
+/**
+ * Besides the trade records, which are keyed by txid or "txid+txid", the trade database holds
+ * secondary indexes. Their keys start with a character, which is not a hex digit, followed by
+ * zero padded numbers, so they are ordered by block and transaction index:
+ *
+ *   "P" + propertyid (lower) + propertyid (higher) + block + index + "txid+txid" = "txid+txid"
+ *   "A" + address + "|" + block + index = "txid:propertyidforsale:propertyiddesired"
+ *   "M" + txid + "|" + "txid+txid" = "txid+txid"
+ *   "U" + block + trade key = index key [+ "," + index key ...]
+ *
+ * The match index "M" lists the matches of an order under the txids of both participants, in
+ * the order of the trade keys.
+ *
+ * The index entries are written and deleted together with the trade records. The undo index
+ * "U" lists the records of each block, so a rollback only visits the records above the fork.
+ */
+static const char TRADE_INDEX_PAIR = 'P';
+static const char TRADE_INDEX_ADDRESS = 'A';
+static const char TRADE_INDEX_MATCH = 'M';
+static const char TRADE_INDEX_UNDO = 'U';
+
+//! Key of the number of trade records
+static const std::string TRADE_COUNTER_KEY = "tradecount";
+
+/** Returns the common key prefix of the undo entries of a block. */
+static std::string GetTradeUndoPrefix(int block)
+{
+    return strprintf("%c%010d", TRADE_INDEX_UNDO, block);
+}
+
+/** Returns the common key prefix of the matches of a pair, in either direction. */
+static std::string GetTradePairPrefix(uint32_t propertyIdSideA, uint32_t propertyIdSideB)
+{
+    return strprintf("%c%010u%010u", TRADE_INDEX_PAIR, std::min(propertyIdSideA, propertyIdSideB), std::max(propertyIdSideA, propertyIdSideB));
+}
+
+/** Returns the common key prefix of the trades of an address. */
+static std::string GetTradeAddressPrefix(const std::string& address)
+{
+    return strprintf("%c%s|", TRADE_INDEX_ADDRESS, address);
+}
+
+/** Returns the common key prefix of the matches of an order. */
+static std::string GetTradeMatchPrefix(const uint256& txid)
+{
+    return strprintf("%c%s|", TRADE_INDEX_MATCH, txid.ToString());
+}
+
 bool CMPTradeList::getMatchingTrades(const uint256& txid, uint32_t propertyId, Array& tradeArray, int64_t& totalSold, int64_t& totalReceived)
 {
   if (!pdb) return false;
@@ -3745,10 +5397,16 @@ bool CMPTradeList::getMatchingTrades(const uint256& txid, uint32_t propertyId, A
   std::vector<std::string> vstr;
   string txidStr = txid.ToString();
   leveldb::Iterator* it = NewIterator();
-  for(it->SeekToFirst(); it->Valid(); it->Next()) {
-      // search key to see if this is a matching trade
-      std::string strKey = it->key().ToString();
-      std::string strValue = it->value().ToString();
+  const std::string strPrefix = GetTradeMatchPrefix(txid);
+  for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next()) {
+      std::string strKey = it->value().ToString();
+      std::string strValue;
+      leveldb::Status status = Read(strKey, &strValue);
+      ++nRead;
+      if (!status.ok()) {
+          PrintToLog("TRADEDB error - missing trade for index entry (%s): %s\n", it->key().ToString(), status.ToString());
+          continue;
+      }
       std::string matchTxid;
       size_t txidMatch = strKey.find(txidStr);
       if (txidMatch == std::string::npos) continue; // no match
@@ -3803,22 +5461,32 @@ bool CMPTradeList::getMatchingTrades(const uint256& txid, uint32_t propertyId, A
   if (count) { return true; } else { return false; }
 }
 
-bool CompareTradePair(const std::pair<int64_t, Object>& firstJSONObj, const std::pair<int64_t, Object>& secondJSONObj)
-{
-    return firstJSONObj.first > secondJSONObj.first;
-}
-
 // obtains an array of matching trades with pricing and volume details for a pair sorted by blocknumber
 void CMPTradeList::getTradesForPair(uint32_t propertyIdSideA, uint32_t propertyIdSideB, Array& responseArray, uint64_t count)
 {
   if (!pdb) return;
   leveldb::Iterator* it = NewIterator();
-  std::vector<std::pair<int64_t,Object> > vecResponse;
+  std::vector<Object> vecResponse;
   bool propertyIdSideAIsDivisible = isPropertyDivisible(propertyIdSideA);
   bool propertyIdSideBIsDivisible = isPropertyDivisible(propertyIdSideB);
-  for(it->SeekToFirst(); it->Valid(); it->Next()) {
-      std::string strKey = it->key().ToString();
-      std::string strValue = it->value().ToString();
+
+  // walk the pair index backwards, starting with the most recent match
+  const std::string strPrefix = GetTradePairPrefix(propertyIdSideA, propertyIdSideB);
+  it->Seek(strPrefix + "~");
+  if (it->Valid()) {
+      it->Prev();
+  } else {
+      it->SeekToLast();
+  }
+  for (; it->Valid() && it->key().starts_with(strPrefix); it->Prev()) {
+      std::string strKey = it->value().ToString();
+      std::string strValue;
+      leveldb::Status status = Read(strKey, &strValue);
+      ++nRead;
+      if (!status.ok()) {
+          PrintToLog("TRADEDB error - missing trade for index entry (%s): %s\n", it->key().ToString(), status.ToString());
+          continue;
+      }
       std::vector<std::string> vecKeys;
       std::vector<std::string> vecValues;
       uint256 sellerTxid = 0, matchingTxid = 0;
@@ -3878,19 +5546,15 @@ void CMPTradeList::getTradesForPair(uint32_t propertyIdSideA, uint32_t propertyI
       }
       trade.push_back(Pair("matchingtxid", matchingTxid.GetHex()));
       trade.push_back(Pair("matchingaddress", matchingAddress));
-      vecResponse.push_back(make_pair(blockNum, trade));
+      vecResponse.push_back(trade);
+      if (vecResponse.size() >= count) break;
   }
+  delete it;
 
-  // sort the response most recent first before adding to the array
-  std::sort(vecResponse.begin(), vecResponse.end(), CompareTradePair);
-  uint64_t processed = 0;
-  for (std::vector<std::pair<int64_t,Object> >::iterator it = vecResponse.begin(); it != vecResponse.end(); ++it) {
-      responseArray.push_back(it->second);
-      processed++;
-      if (processed >= count) break;
+  // the most recent trades were collected first, but are returned in ascending order
+  for (std::vector<Object>::reverse_iterator it = vecResponse.rbegin(); it != vecResponse.rend(); ++it) {
+      responseArray.push_back(*it);
   }
-  std::reverse(responseArray.begin(), responseArray.end());
-  delete it;
 }
 
 // obtains a vector of txids where the supplied address participated in a trade (needed for gettradehistory_MP)
@@ -3899,87 +5563,111 @@ void CMPTradeList::getTradesForPair(uint32_t propertyIdSideA, uint32_t propertyI
 void CMPTradeList::getTradesForAddress(std::string address, std::vector<uint256>& vecTransactions, uint32_t propertyIdFilter)
 {
   if (!pdb) return;
-  std::map<std::string,uint256> mapTrades;
   leveldb::Iterator* it = NewIterator();
-  for(it->SeekToFirst(); it->Valid(); it->Next()) {
-      std::string strKey = it->key().ToString();
+  const std::string strPrefix = GetTradeAddressPrefix(address);
+  for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next()) {
       std::string strValue = it->value().ToString();
       std::vector<std::string> vecValues;
-      if (strKey.size() != 64) continue; // only interested in trades
-      uint256 txid(strKey);
-      size_t addressMatch = strValue.find(address);
-      if (addressMatch == std::string::npos) continue;
       boost::split(vecValues, strValue, boost::is_any_of(":"), token_compress_on);
-      if (vecValues.size() != 5) {
-          PrintToLog("TRADEDB error - unexpected number of tokens in value (%s)\n", strValue);
+      if (vecValues.size() != 3) {
+          PrintToLog("TRADEDB error - unexpected number of tokens in index value (%s)\n", strValue);
           continue;
       }
       uint32_t propertyIdForSale = boost::lexical_cast<uint32_t>(vecValues[1]);
       uint32_t propertyIdDesired = boost::lexical_cast<uint32_t>(vecValues[2]);
-      int64_t blockNum = boost::lexical_cast<uint32_t>(vecValues[3]);
-      int64_t txIndex = boost::lexical_cast<uint32_t>(vecValues[4]);
       if (propertyIdFilter != 0 && propertyIdFilter != propertyIdForSale && propertyIdFilter != propertyIdDesired) continue;
-      std::string sortKey = strprintf("%06d%010d", blockNum, txIndex);
-      mapTrades.insert(std::make_pair(sortKey, txid));
+      vecTransactions.push_back(uint256(vecValues[0]));
   }
   delete it;
-  for (std::map<std::string,uint256>::iterator it = mapTrades.begin(); it != mapTrades.end(); it++) {
-      vecTransactions.push_back(it->second);
-  }
 }
 
 void CMPTradeList::recordNewTrade(const uint256& txid, const std::string& address, uint32_t propertyIdForSale, uint32_t propertyIdDesired, int blockNum, int blockIndex)
 {
   if (!pdb) return;
   std::string strValue = strprintf("%s:%d:%d:%d:%d", address, propertyIdForSale, propertyIdDesired, blockNum, blockIndex);
-  Status status = pdb->Put(writeoptions, txid.ToString(), strValue);
+  std::string strIndexKey = GetTradeAddressPrefix(address) + strprintf("%010d%010d", blockNum, blockIndex);
+  std::string strIndexValue = strprintf("%s:%d:%d", txid.ToString(), propertyIdForSale, propertyIdDesired);
+
+  leveldb::WriteBatch batch;
+  std::string strExisting;
+  if (Read(txid.ToString(), &strExisting).IsNotFound()) UpdateCounter(batch, TRADE_COUNTER_KEY, 1);
+  batch.Put(txid.ToString(), strValue);
+  batch.Put(strIndexKey, strIndexValue);
+  batch.Put(GetTradeUndoPrefix(blockNum) + txid.ToString(), strIndexKey);
+  Status status = Write(batch);
   ++nWritten;
   if (msc_debug_tradedb) PrintToLog("%s(): %s\n", __FUNCTION__, status.ToString());
 }
 
-void CMPTradeList::recordMatchedTrade(const uint256 txid1, const uint256 txid2, string address1, string address2, unsigned int prop1, unsigned int prop2, uint64_t amount1, uint64_t amount2, int blockNum)
+void CMPTradeList::recordMatchedTrade(const uint256 txid1, const uint256 txid2, string address1, string address2, unsigned int prop1, unsigned int prop2, uint64_t amount1, uint64_t amount2, int blockNum, int blockIndex)
 {
   if (!pdb) return;
   const string key = txid1.ToString() + "+" + txid2.ToString();
   const string value = strprintf("%s:%s:%u:%u:%lu:%lu:%d", address1, address2, prop1, prop2, amount1, amount2, blockNum);
+  const string indexKey = GetTradePairPrefix(prop1, prop2) + strprintf("%010d%010d", blockNum, blockIndex) + key;
   Status status;
   if (pdb)
   {
-    status = pdb->Put(writeoptions, key, value);
+    leveldb::WriteBatch batch;
+    std::string strExisting;
+    if (Read(key, &strExisting).IsNotFound()) UpdateCounter(batch, TRADE_COUNTER_KEY, 1);
+    const string matchKey1 = GetTradeMatchPrefix(txid1) + key;
+    const string matchKey2 = GetTradeMatchPrefix(txid2) + key;
+    batch.Put(key, value);
+    batch.Put(indexKey, key);
+    batch.Put(matchKey1, key);
+    batch.Put(matchKey2, key);
+    batch.Put(GetTradeUndoPrefix(blockNum) + key, indexKey + "," + matchKey1 + "," + matchKey2);
+    status = Write(batch);
     ++nWritten;
     if (msc_debug_tradedb) PrintToLog("%s(): %s\n", __FUNCTION__, status.ToString());
   }
 }
 
-// delete any trades after blockNum
+/**
+ * This function deletes trades above a specific block from the trade database, along with their
+ * index entries.
+ *
+ * Returns the number of records deleted.
+ *
+ * NOTE: Records in block blockNum are kept, so deleteAboveBlock(1000) will delete records in block 1001 and above.
+ */
 int CMPTradeList::deleteAboveBlock(int blockNum)
 {
-  leveldb::Slice skey, svalue;
-  unsigned int count = 0;
-  std::vector<std::string> vstr;
-  int block = 0;
   unsigned int n_found = 0;
+  std::set<std::string> setDeleted;
+  leveldb::WriteBatch batch;
   leveldb::Iterator* it = NewIterator();
-  for(it->SeekToFirst(); it->Valid(); it->Next())
+
+  // the undo index is ordered by block, so everything from the first block after blockNum is deleted
+  for (it->Seek(GetTradeUndoPrefix(blockNum + 1)); it->Valid() && it->key()[0] == TRADE_INDEX_UNDO; it->Next())
   {
-    skey = it->key();
-    svalue = it->value();
-    ++count;
-    string strvalue = it->value().ToString();
-    boost::split(vstr, strvalue, boost::is_any_of(":"), token_compress_on);
-    if (7 == vstr.size()) block = atoi(vstr[6]); // trade matches have 7 tokens, key is txid+txid, only care about block
-    if (5 == vstr.size()) block = atoi(vstr[3]); // trades have 5 tokens, key is txid, only care about block
-    if (block >= blockNum) {
-        ++n_found;
-        PrintToLog("%s() DELETING FROM TRADEDB: %s=%s\n", __FUNCTION__, skey.ToString(), svalue.ToString());
-        pdb->Delete(writeoptions, skey);
-    }
+    const std::string strKey = it->key().ToString().substr(11);
+    const std::string strValue = it->value().ToString();
+    std::vector<std::string> vecIndexKeys;
+    boost::split(vecIndexKeys, strValue, boost::is_any_of(","), token_compress_on);
+    batch.Delete(it->key());
+    for (std::vector<std::string>::const_iterator itKey = vecIndexKeys.begin(); itKey != vecIndexKeys.end(); ++itKey) {
+        batch.Delete(*itKey);
+    }
+    if (!setDeleted.insert(strKey).second) continue; // recorded more than once
+    ++n_found;
+    if (msc_debug_tradedb) PrintToLog("%s() DELETING FROM TRADEDB: %s\n", __FUNCTION__, strKey);
+    batch.Delete(strKey);
   }
 
-  PrintToLog("%s(%d); tradedb n_found= %d\n", __FUNCTION__, blockNum, n_found);
-
   delete it;
 
+  if (n_found > 0) {
+      UpdateCounter(batch, TRADE_COUNTER_KEY, -(int64_t) n_found);
+      leveldb::Status status = pdb->Write(writeoptions, &batch);
+      if (!status.ok()) {
+          PrintToLog("%s(): ERROR: %s\n", __FUNCTION__, status.ToString());
+      }
+  }
+
+  PrintToLog("%s(%d); tradedb n_found= %d\n", __FUNCTION__, blockNum, n_found);
+
   return (n_found);
 }
 
@@ -3990,15 +5678,7 @@ void CMPTradeList::printStats()
 
 int CMPTradeList::getMPTradeCountTotal()
 {
-    int count = 0;
-    Slice skey, svalue;
-    Iterator* it = NewIterator();
-    for(it->SeekToFirst(); it->Valid(); it->Next())
-    {
-        ++count;
-    }
-    delete it;
-    return count;
+    return ReadCounter(TRADE_COUNTER_KEY);
 }
 
 void CMPTradeList::printAll()
@@ -4037,46 +5717,22 @@ bool mastercore::isMPinBlockRange(int starting_block, int ending_block, bool bDe
 //
 bool mastercore::getValidMPTX(const uint256 &txid, int *block, unsigned int *type, uint64_t *nAmended)
 {
-string result;
-int validity = 0;
-
   if (msc_debug_txdb) PrintToLog("%s()\n", __FUNCTION__);
 
   if (!p_txlistdb) return false;
 
-  if (!p_txlistdb->getTX(txid, result)) return false;
-
-  // parse the string returned, find the validity flag/bit & other parameters
-  std::vector<std::string> vstr;
-  boost::split(vstr, result, boost::is_any_of(":"), token_compress_on);
-
-  if (msc_debug_txdb) PrintToLog("%s() size=%lu : %s\n", __FUNCTION__, vstr.size(), result);
-
-  if (1 <= vstr.size()) validity = atoi(vstr[0]);
+  CMPTxRecord record;
+  if (!p_txlistdb->getTX(txid, record)) return false;
 
-  if (block)
-  {
-    if (2 <= vstr.size()) *block = atoi(vstr[1]);
-    else *block = 0;
-  }
-
-  if (type)
-  {
-    if (3 <= vstr.size()) *type = atoi(vstr[2]);
-    else *type = 0;
-  }
+  if (msc_debug_txdb) PrintToLog("%s() %s : %d:%d:%d:%lu\n", __FUNCTION__, txid.GetHex(), record.fValid, record.nBlock, record.type, record.nValue);
 
-  if (nAmended)
-  {
-    if (4 <= vstr.size()) *nAmended = boost::lexical_cast<boost::uint64_t>(vstr[3]);
-    else nAmended = 0;
-  }
+  if (block) *block = record.nBlock;
+  if (type) *type = record.type;
+  if (nAmended) *nAmended = record.nValue;
 
   if (msc_debug_txdb) p_txlistdb->printStats();
 
-  if ((int)0 == validity) return false;
-
-  return true;
+  return record.fValid;
 }
 
 int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockIndex)
@@ -4086,9 +5742,12 @@ int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockInd
     if (reorgRecoveryMode > 0) {
         reorgRecoveryMode = 0; // clear reorgRecovery here as this is likely re-entrant
 
+        int64_t nRollbackStart = GetTimeMicros();
+        if (pBlockIndex->pprev) TruncateSeedBlocks(pBlockIndex->pprev);
         p_txlistdb->isMPinBlockRange(pBlockIndex->nHeight, reorgRecoveryMaxHeight, true); // inclusive
         t_tradelistdb->deleteAboveBlock(pBlockIndex->nHeight - 1); // deleteAboveBlock functions are non-inclusive (>blocknum not >=blocknum)
         s_stolistdb->deleteAboveBlock(pBlockIndex->nHeight - 1);
+        PrintToLog("Rolled back the databases to block %d in %.3f ms\n", pBlockIndex->nHeight - 1, 0.001 * (GetTimeMicros() - nRollbackStart));
         reorgRecoveryMaxHeight = 0;
 
         nWaterlineBlock = ConsensusParams().GENESIS_BLOCK - 1;
@@ -4112,6 +5771,14 @@ int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockInd
         }
     }
 
+    // collect the records of this block, so they are written at once, when the block is complete
+    // if Omni Core is not yet initialized, the records of this block are written immediately
+    if (mastercoreInitialized) {
+        p_txlistdb->BeginBatch();
+        s_stolistdb->BeginBatch();
+        t_tradelistdb->BeginBatch();
+    }
+
     // handle any features that go live with this block
     CheckLiveActivations(pBlockIndex->nHeight);
 
@@ -4120,6 +5787,35 @@ int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockInd
     return 0;
 }
 
+/**
+ * This handler is called once per block, after the block begin notification and
+ * before the transactions of the block are handled.
+ *
+ * The inputs of the transactions are resolved, and the transactions are parsed
+ * ahead of their execution on multiple threads.
+ */
+int mastercore_handler_block_prepare(int nBlockPrev, CBlockIndex const * pBlockIndex, const CBlock& block)
+{
+    LOCK(cs_tally);
+
+    if (!mastercoreInitialized) {
+        mastercore_init();
+    }
+
+    int nBlock = pBlockIndex->nHeight;
+
+    // transactions prior to the waterline are not parsed
+    if (nBlock < nWaterlineBlock) return 0;
+
+    std::vector<bool> vfCandidates(block.vtx.size());
+    for (unsigned int n = 0; n < block.vtx.size(); ++n) {
+        vfCandidates[n] = HasMarker(block.vtx[n], nBlock, ConsensusParams());
+    }
+    PrepareBlockTransactions(block, nBlock, pBlockIndex->GetBlockTime(), vfCandidates);
+
+    return 0;
+}
+
 // called once per block, after the block has been processed
 // TODO: consolidate into *handler_block_begin() << need to adjust Accept expiry check.............
 // it performs cleanup and other functions
@@ -4132,6 +5828,10 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         mastercore_init();
     }
 
+    // prepared transactions, which were not handled, are no longer needed
+    mapPreparedTxs.clear();
+    nPreparedBlock = -1;
+
     // for every new received block must do:
     // 1) remove expired entries from the accept list (per spec accept entries are
     //    valid until their blocklimit expiration; because the customer can keep
@@ -4156,6 +5856,28 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
     // check the alert status, do we need to do anything else here?
     CheckExpiredAlerts(nBlockNow, pBlockIndex->GetBlockTime());
 
+    // write the records of this block
+    int64_t nCommitStart = GetTimeMicros();
+    bool fCommitted = p_txlistdb->CommitBatch().ok();
+    fCommitted &= s_stolistdb->CommitBatch().ok();
+    fCommitted &= t_tradelistdb->CommitBatch().ok();
+    if (!fCommitted) {
+        // the tally is ahead of the persisted records of this block - shutdown client
+        const std::string& msg = strprintf("Shutting down due to failure to write the records of block %d\n", nBlockNow);
+        PrintToLog(msg);
+        AbortNode(msg, msg);
+        return -1;
+    }
+    if (msc_debug_persistence) {
+        PrintToLog("Wrote the records of block %d in %.3f ms\n", nBlockNow, 0.001 * (GetTimeMicros() - nCommitStart));
+    }
+
+    // fold the changes of this block into the state commitment, so they don't pile up
+    UpdateStateCommitment();
+
+    // remember, whether the block has Omni activity, to skip it during the next scan otherwise
+    UpdateSeedBlocks(pBlockIndex, !p_txlistdb->GetSeedBlocks(nBlockNow, nBlockNow).empty());
+
     // transactions were found in the block, signal the UI accordingly
     if (countMP > 0) CheckWalletUpdate(true);
 
@@ -4165,6 +5887,12 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         PrintToLog("Consensus hash for block %d: %s\n", nBlockNow, consensusHash.GetHex());
     }
 
+    // calculate and print a state commitment if required
+    if (msc_debug_state_commitment_every_block) {
+        uint256 stateCommitment = GetStateCommitment();
+        PrintToLog("State commitment for block %d: %s\n", nBlockNow, stateCommitment.GetHex());
+    }
+
     // request checkpoint verification
     bool checkpointValid = VerifyCheckpoint(nBlockNow, pBlockIndex->GetBlockHash());
     if (!checkpointValid) {
@@ -4186,6 +5914,9 @@ int mastercore_handler_disc_begin(int nBlockNow, CBlockIndex const * pBlockIndex
 {
     LOCK(cs_tally);
 
+    mapPreparedTxs.clear();
+    nPreparedBlock = -1;
+
     reorgRecoveryMode = 1;
     reorgRecoveryMaxHeight = (pBlockIndex->nHeight > reorgRecoveryMaxHeight) ? pBlockIndex->nHeight: reorgRecoveryMaxHeight;
     return 0;
@@ -4246,6 +5977,53 @@ const CBitcoinAddress ExodusCrowdsaleAddress(int nBlock)
     return ExodusAddress();
 }
 
+/**
+ * Returns the key identifier of a pay-to-pubkey-hash address.
+ */
+static CKeyID GetAddressKeyID(const std::string& strAddress)
+{
+    CKeyID keyID;
+    assert(CBitcoinAddress(strAddress).GetKeyID(keyID));
+    return keyID;
+}
+
+/**
+ * Returns the key identifier of the Exodus address.
+ *
+ * The key identifier is used to match outputs, without converting their
+ * destinations into base58 encoded addresses.
+ *
+ * @return The Exodus key identifier
+ */
+const CKeyID& ExodusKeyID()
+{
+    if (isNonMainNet()) {
+        static const CKeyID testKeyID = GetAddressKeyID(exodus_testnet);
+        return testKeyID;
+    } else {
+        static const CKeyID mainKeyID = GetAddressKeyID(exodus_mainnet);
+        return mainKeyID;
+    }
+}
+
+/**
+ * Returns the key identifier of the Exodus crowdsale address.
+ *
+ * @see ExodusCrowdsaleAddress()
+ *
+ * @return The Exodus fundraiser key identifier
+ */
+const CKeyID& ExodusCrowdsaleKeyID(int nBlock)
+{
+    if ((MONEYMAN_TESTNET_BLOCK <= nBlock && isNonMainNet()) ||
+            (MONEYMAN_REGTEST_BLOCK <= nBlock && RegTest())) {
+        static const CKeyID moneyKeyID = GetAddressKeyID(getmoney_testnet);
+        return moneyKeyID;
+    }
+
+    return ExodusKeyID();
+}
+
 /**
  * @return The marker for class C transactions.
  */
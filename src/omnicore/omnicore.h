@@ -2,15 +2,20 @@
 #define OMNICORE_OMNICORE_H
 
 class CBitcoinAddress;
+class CBlock;
 class CBlockIndex;
 class CCoinsView;
 class CCoinsViewCache;
+class CKeyID;
+class CMPTransaction;
 class CTransaction;
 
 #include "omnicore/log.h"
 #include "omnicore/persistence.h"
 #include "omnicore/tally.h"
+#include "omnicore/tallymap.h"
 
+#include "serialize.h"
 #include "sync.h"
 #include "uint256.h"
 #include "util.h"
@@ -37,7 +42,7 @@ int const MAX_STATE_HISTORY = 50;
 #define TEST_ECO_PROPERTY_1 (0x80000003UL)
 
 // increment this value to force a refresh of the state (similar to --startclean)
-#define DB_VERSION 3
+#define DB_VERSION 11
 
 // could probably also use: int64_t maxInt64 = std::numeric_limits<int64_t>::max();
 // maximum numeric values from the spec:
@@ -143,6 +148,12 @@ const CBitcoinAddress ExodusAddress();
 /** Returns the Exodus crowdsale address. */
 const CBitcoinAddress ExodusCrowdsaleAddress(int nBlock = 0);
 
+/** Returns the key identifier of the Exodus address. */
+const CKeyID& ExodusKeyID();
+
+/** Returns the key identifier of the Exodus crowdsale address. */
+const CKeyID& ExodusCrowdsaleKeyID(int nBlock = 0);
+
 /** Returns the marker for class C transactions. */
 const std::vector<unsigned char> GetOmMarker();
 
@@ -193,7 +204,7 @@ public:
         if (msc_debug_persistence) PrintToLog("CMPTradeList closed\n");
     }
 
-    void recordMatchedTrade(const uint256 txid1, const uint256 txid2, string address1, string address2, unsigned int prop1, unsigned int prop2, uint64_t amount1, uint64_t amount2, int blockNum);
+    void recordMatchedTrade(const uint256 txid1, const uint256 txid2, string address1, string address2, unsigned int prop1, unsigned int prop2, uint64_t amount1, uint64_t amount2, int blockNum, int blockIndex);
     void recordNewTrade(const uint256& txid, const std::string& address, uint32_t propertyIdForSale, uint32_t propertyIdDesired, int blockNum, int blockIndex);
     int deleteAboveBlock(int blockNum);
     bool exists(const uint256 &txid);
@@ -205,7 +216,36 @@ public:
     int getMPTradeCountTotal();
 };
 
-/** LevelDB based storage for transactions, with txid as key and validity bit, and other data as value.
+/** The master record of a transaction, DEx payment or MetaDEx cancel in the transaction database.
+ */
+class CMPTxRecord
+{
+public:
+    bool fValid;
+    int nBlock;
+    uint32_t type;
+    //! Amount, or number of sub records
+    uint64_t nValue;
+
+    CMPTxRecord() : fValid(false), nBlock(0), type(0), nValue(0) {}
+
+    CMPTxRecord(bool fValidIn, int nBlockIn, uint32_t typeIn, uint64_t nValueIn)
+      : fValid(fValidIn), nBlock(nBlockIn), type(typeIn), nValue(nValueIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(fValid);
+        READWRITE(nBlock);
+        READWRITE(type);
+        READWRITE(nValue);
+    }
+};
+
+/** LevelDB based storage for transactions, with the record type and txid as key, and a binary
+ * CMPTxRecord or sub record as value. It also holds an index of the records by block, an index
+ * of the activations and alerts, and the number of transactions.
  */
 class CMPTxList : public CDBBase
 {
@@ -221,17 +261,20 @@ public:
         if (msc_debug_persistence) PrintToLog("CMPTxList closed\n");
     }
 
-    void recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned int type, uint64_t nValue);
+    void recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned int type, uint64_t nValue, const CMPTransaction* pMPTx = NULL);
     void recordPaymentTX(const uint256 &txid, bool fValid, int nBlock, unsigned int vout, unsigned int propertyId, uint64_t nValue, string buyer, string seller);
     void recordMetaDExCancelTX(const uint256 &txidMaster, const uint256 &txidSub, bool fValid, int nBlock, unsigned int propertyId, uint64_t nValue);
     /** Records a "send all" sub record. */
-    void recordSendAllSubRecord(const uint256& txid, int subRecordNumber, uint32_t propertyId, int64_t nvalue);
+    void recordSendAllSubRecord(const uint256& txid, int subRecordNumber, uint32_t propertyId, int64_t nvalue, int nBlock);
+    /** Records an Exodus purchase. */
+    void recordExodusPurchase(const uint256& txid, int nBlock, int64_t amountGenerated);
 
-    string getKeyValue(string key);
     uint256 findMetaDExCancel(const uint256 txid);
     /** Returns the number of sub records. */
     int getNumberOfSubRecords(const uint256& txid);
     int getNumberOfMetaDExCancels(const uint256 txid);
+    /** Retrieves details about a cancelled order of a MetaDEx cancel. */
+    bool getMetaDExCancelDetails(const uint256& txid, int refNumber, uint256& cancelledTxid, uint32_t& propertyId, int64_t& amount);
     bool getPurchaseDetails(const uint256 txid, int purchaseNumber, string *buyer, string *seller, uint64_t *vout, uint64_t *propertyId, uint64_t *nValue);
     /** Retrieves details about a "send all" record. */
     bool getSendAllDetails(const uint256& txid, int subSend, uint32_t& propertyId, int64_t& amount);
@@ -242,7 +285,7 @@ public:
     int setDBVersion();
 
     bool exists(const uint256 &txid);
-    bool getTX(const uint256 &txid, string &value);
+    bool getTX(const uint256 &txid, CMPTxRecord &record);
 
     std::set<int> GetSeedBlocks(int startHeight, int endHeight);
     void LoadAlerts(int blockHeight);
@@ -276,13 +319,23 @@ void CheckWalletUpdate(bool forceUpdate = false);
 int mastercore_handler_disc_begin(int nBlockNow, CBlockIndex const * pBlockIndex);
 int mastercore_handler_disc_end(int nBlockNow, CBlockIndex const * pBlockIndex);
 int mastercore_handler_block_begin(int nBlockNow, CBlockIndex const * pBlockIndex);
+int mastercore_handler_block_prepare(int nBlockPrev, CBlockIndex const * pBlockIndex, const CBlock& block);
 int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex, unsigned int);
 bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, const CBlockIndex* pBlockIndex);
 int mastercore_save_state( CBlockIndex const *pBlockIndex );
 
 namespace mastercore
 {
-extern std::map<std::string, CMPTally> mp_tally_map;
+class CConsensusParams;
+
+//! Total balance of each holder of a property, excluding pending amounts
+typedef std::map<std::string, int64_t> HolderMap;
+
+extern CMPTallyMap mp_tally_map;
+//! Holders of each property, maintained along with mp_tally_map
+extern std::map<uint32_t, HolderMap> mp_property_holders;
+//! Total amounts of each property by tally type, maintained along with mp_tally_map
+extern std::map<uint32_t, std::vector<int64_t> > mp_property_supply;
 extern CMPTxList *p_txlistdb;
 extern CMPTradeList *t_tradelistdb;
 extern CMPSTOList *s_stolistdb;
@@ -310,10 +363,21 @@ CMPTally* getTally(const std::string& address);
 
 int64_t getTotalTokens(uint32_t propertyId, int64_t* n_owners_total = NULL);
 
+/** Returns the total amount of a property held by all addresses for the given tally type. */
+int64_t getPropertySupply(uint32_t propertyId, TallyType ttype);
+
+/** Compares the maintained holders and supply of each property with a full scan of the tally map. */
+bool VerifyPropertySupply();
+
+/** Clears the tally map, and the holder index and supply maintained along with it. */
+void ClearTallyMap();
+
 std::string strTransactionType(uint16_t txType);
 
 /** Returns the encoding class, used to embed a payload. */
 int GetEncodingClass(const CTransaction& tx, int nBlock);
+/** Returns the encoding class, used to embed a payload, based on the given consensus parameters. */
+int GetEncodingClass(const CTransaction& tx, int nBlock, const CConsensusParams& params);
 
 /** Determines, whether it is valid to use a Class C transaction for a given payload size. */
 bool UseEncodingClassC(size_t nDataSize);
@@ -322,6 +386,9 @@ bool getValidMPTX(const uint256 &txid, int *block = NULL, unsigned int *type = N
 
 bool update_tally_map(const std::string& who, uint32_t propertyId, int64_t amount, TallyType ttype);
 
+/** Records that the orders of a MetaDEx market changed since the state was last persisted. */
+void MarkMetaDExMarketDirty(uint32_t propertyForSale, uint32_t propertyDesired);
+
 std::string getTokenLabel(uint32_t propertyId);
 }
 
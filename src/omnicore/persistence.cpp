@@ -2,7 +2,9 @@
 
 #include "omnicore/log.h"
 
+#include "tinyformat.h"
 #include "util.h"
+#include "utilstrencodings.h"
 
 #include "leveldb/db.h"
 #include "leveldb/write_batch.h"
@@ -11,6 +13,30 @@
 
 #include <stdint.h>
 
+#include <map>
+#include <string>
+#include <utility>
+
+/** Collects the updates of a write batch as pending writes. */
+class CBatchCollector : public leveldb::WriteBatch::Handler
+{
+private:
+    std::map<std::string, std::pair<bool, std::string> >& mapBatch;
+
+public:
+    explicit CBatchCollector(std::map<std::string, std::pair<bool, std::string> >& mapBatchIn) : mapBatch(mapBatchIn) {}
+
+    void Put(const leveldb::Slice& key, const leveldb::Slice& value)
+    {
+        mapBatch[key.ToString()] = std::make_pair(true, value.ToString());
+    }
+
+    void Delete(const leveldb::Slice& key)
+    {
+        mapBatch[key.ToString()] = std::make_pair(false, std::string());
+    }
+};
+
 /**
  * Opens or creates a LevelDB based database.
  */
@@ -43,6 +69,11 @@ void CDBBase::Clear()
 
     delete it;
 
+    {
+        LOCK(cs_batch);
+        mapBatch.clear();
+    }
+
     leveldb::Status status = pdb->Write(writeoptions, &batch);
     nRead = 0;
     nWritten = 0;
@@ -53,6 +84,110 @@ void CDBBase::Clear()
             n, status.ToString(), (n > 0 ? (0.001 * nTime / n) : 0), 0.001 * nTime);
 }
 
+/**
+ * Reads an entry, including the pending writes of the batch.
+ */
+leveldb::Status CDBBase::Read(const std::string& key, std::string* value) const
+{
+    assert(pdb != NULL);
+    {
+        LOCK(cs_batch);
+        std::map<std::string, std::pair<bool, std::string> >::const_iterator it = mapBatch.find(key);
+        if (it != mapBatch.end()) {
+            if (!it->second.first) return leveldb::Status::NotFound(key);
+            *value = it->second.second;
+            return leveldb::Status::OK();
+        }
+    }
+
+    return pdb->Get(readoptions, key, value);
+}
+
+/**
+ * Writes the updates of a write batch, or adds them to the open batch.
+ */
+leveldb::Status CDBBase::Write(leveldb::WriteBatch& batch)
+{
+    assert(pdb != NULL);
+    {
+        LOCK(cs_batch);
+        if (fBatching) {
+            CBatchCollector collector(mapBatch);
+            return batch.Iterate(&collector);
+        }
+    }
+
+    return pdb->Write(writeoptions, &batch);
+}
+
+/**
+ * Opens a batch, which collects all writes, until it's committed.
+ */
+void CDBBase::BeginBatch()
+{
+    LOCK(cs_batch);
+    fBatching = true;
+}
+
+/**
+ * Writes the pending writes of the batch atomically, and closes the batch.
+ */
+leveldb::Status CDBBase::CommitBatch()
+{
+    assert(pdb != NULL);
+    LOCK(cs_batch);
+    if (mapBatch.empty()) {
+        fBatching = false;
+        return leveldb::Status::OK();
+    }
+
+    leveldb::WriteBatch batch;
+    std::map<std::string, std::pair<bool, std::string> >::const_iterator it;
+    for (it = mapBatch.begin(); it != mapBatch.end(); ++it) {
+        if (it->second.first) {
+            batch.Put(it->first, it->second.second);
+        } else {
+            batch.Delete(it->first);
+        }
+    }
+
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    if (!status.ok()) {
+        // the batch stays open, so the pending writes are neither lost, nor overtaken by later writes
+        PrintToLog("%s(): ERROR: failed to write %d entries: %s\n", __func__, mapBatch.size(), status.ToString());
+        return status;
+    }
+    if (msc_debug_persistence) PrintToLog("%s(): wrote %d entries\n", __func__, mapBatch.size());
+    mapBatch.clear();
+    fBatching = false;
+
+    return status;
+}
+
+/**
+ * Reads a counter, which is persisted as decimal number.
+ */
+int64_t CDBBase::ReadCounter(const std::string& key) const
+{
+    assert(pdb != NULL);
+    std::string strValue;
+    leveldb::Status status = Read(key, &strValue);
+    if (!status.ok()) {
+        if (!status.IsNotFound()) PrintToLog("%s(%s): ERROR: %s\n", __func__, key, status.ToString());
+        return 0;
+    }
+
+    return atoi64(strValue);
+}
+
+/**
+ * Adds an update of a counter to a batch, so it's written atomically with the entries counted.
+ */
+void CDBBase::UpdateCounter(leveldb::WriteBatch& batch, const std::string& key, int64_t delta) const
+{
+    batch.Put(key, strprintf("%d", ReadCounter(key) + delta));
+}
+
 /**
  * Deinitializes and closes the database.
  */
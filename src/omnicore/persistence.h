@@ -1,12 +1,20 @@
 #ifndef OMNICORE_PERSISTENCE_H
 #define OMNICORE_PERSISTENCE_H
 
+#include "sync.h"
+
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 
 #include <boost/filesystem/path.hpp>
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
 
 /** Base class for LevelDB based storage.
  */
@@ -16,6 +24,15 @@ private:
     //! Options used when iterating over values of the database
     leveldb::ReadOptions iteroptions;
 
+    //! Guards the pending writes of the batch
+    mutable CCriticalSection cs_batch;
+
+    //! Whether writes are collected in a batch, instead of being written immediately
+    bool fBatching;
+
+    //! Pending writes of the batch, with a flag, whether the entry is present or erased
+    std::map<std::string, std::pair<bool, std::string> > mapBatch;
+
 protected:
     //! Database options used
     leveldb::Options options;
@@ -38,7 +55,7 @@ protected:
     //! Number of entries written
     unsigned int nWritten;
 
-    CDBBase() : pdb(NULL), nRead(0), nWritten(0)
+    CDBBase() : fBatching(false), pdb(NULL), nRead(0), nWritten(0)
     {
         options.paranoid_checks = true;
         options.create_if_missing = true;
@@ -69,6 +86,26 @@ protected:
         return pdb->NewIterator(iteroptions);
     }
 
+    /**
+     * Reads an entry, including the pending writes of the batch.
+     *
+     * @param key    The key of the entry
+     * @param value  The value of the entry
+     * @return A Status object, which is NotFound, if the entry doesn't exist or was erased
+     */
+    leveldb::Status Read(const std::string& key, std::string* value) const;
+
+    /**
+     * Writes the updates of a write batch.
+     *
+     * If a batch is open, the updates are added to it, and readable via Read(), but not yet
+     * written to the database.
+     *
+     * @param batch  The updates to write
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status Write(leveldb::WriteBatch& batch);
+
     /**
      * Opens or creates a LevelDB based database.
      *
@@ -86,11 +123,50 @@ protected:
      */
     void Close();
 
+    /**
+     * Reads a counter, which is persisted as decimal number.
+     *
+     * @param key  The key of the counter
+     * @return The value of the counter, or 0, if it doesn't exist
+     */
+    int64_t ReadCounter(const std::string& key) const;
+
+    /**
+     * Adds an update of a counter to a batch, so it's written atomically with the entries counted.
+     *
+     * @param batch  The batch to add the update to
+     * @param key    The key of the counter
+     * @param delta  The value to add to the persisted value
+     */
+    void UpdateCounter(leveldb::WriteBatch& batch, const std::string& key, int64_t delta) const;
+
 public:
     /**
      * Deletes all entries of the database, and resets the counters.
+     *
+     * Pending writes of the batch are discarded.
      */
     void Clear();
+
+    /**
+     * Opens a batch, which collects all writes, until it's committed.
+     *
+     * If a batch is already open, the writes are collected in the open batch.
+     *
+     * Pending writes are visible to Read(), but not to iterators, which only see committed
+     * entries. Callers, which don't hold cs_main, may therefore observe a block, which is
+     * still being connected, in the same way as they observe the tally of such a block.
+     */
+    void BeginBatch();
+
+    /**
+     * Writes the pending writes of the batch atomically, and closes the batch.
+     *
+     * If the write fails, the pending writes are kept, and the batch remains open.
+     *
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status CommitBatch();
 };
 
 
@@ -43,6 +43,7 @@
 #include "json/json_spirit_value.h"
 
 #include <stdint.h>
+#include <algorithm>
 #include <map>
 #include <stdexcept>
 #include <string>
@@ -286,9 +287,9 @@ Value mscrpc(const Array& params, bool fHelp)
             LOCK(cs_tally);
             int64_t total = 0;
             // display all balances
-            for (std::map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-                PrintToConsole("%34s => ", my_it->first);
-                total += (my_it->second).print(extra2, bDivisible);
+            for (CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+                PrintToConsole("%34s => ", my_it.getAddress());
+                total += (my_it.getTally()).print(extra2, bDivisible);
             }
             PrintToConsole("total for property %d  = %X is %s\n", extra2, extra2, FormatDivisibleMP(total));
             break;
@@ -313,11 +314,11 @@ Value mscrpc(const Array& params, bool fHelp)
             LOCK(cs_tally);
             uint32_t id = 0;
             // for each address display all currencies it holds
-            for (std::map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-                PrintToConsole("%34s => ", my_it->first);
-                (my_it->second).print(extra2);
-                (my_it->second).init();
-                while (0 != (id = (my_it->second).next())) {
+            for (CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+                PrintToConsole("%34s => ", my_it.getAddress());
+                (my_it.getTally()).print(extra2);
+                (my_it.getTally()).init();
+                while (0 != (id = (my_it.getTally()).next())) {
                     PrintToConsole("Id: %u=0x%X ", id, id);
                 }
                 PrintToConsole("\n");
@@ -497,20 +498,14 @@ Value omni_getallbalancesforid(const Array& params, bool fHelp)
 
     LOCK(cs_tally);
 
-    for (std::map<std::string, CMPTally>::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-        uint32_t id = 0;
-        bool includeAddress = false;
-        std::string address = it->first;
-        (it->second).init();
-        while (0 != (id = (it->second).next())) {
-            if (id == propertyId) {
-                includeAddress = true;
-                break;
-            }
-        }
-        if (!includeAddress) {
-            continue; // ignore this address, has never transacted in this propertyId
-        }
+    std::map<uint32_t, HolderMap>::const_iterator itHolders = mp_property_holders.find(propertyId);
+    if (itHolders == mp_property_holders.end()) {
+        return response; // no address holds this propertyId
+    }
+
+    const HolderMap& holders = itHolders->second;
+    for (HolderMap::const_iterator it = holders.begin(); it != holders.end(); ++it) {
+        const std::string& address = it->first;
         Object balanceObj;
         balanceObj.push_back(Pair("address", address));
         bool nonEmptyBalance = BalanceToJSON(address, propertyId, balanceObj, isDivisible);
@@ -1026,19 +1021,25 @@ Value omni_getorderbook(const Array& params, bool fHelp)
     std::vector<CMPMetaDEx> vecMetaDexObjects;
     {
         LOCK(cs_tally);
-        for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
+        // the markets of a property for sale are adjacent in the order book
+        md_PropertiesMap::const_iterator my_it = metadex.lower_bound(std::make_pair(propertyIdForSale, filterDesired ? propertyIdDesired : 0));
+        for (; my_it != metadex.end() && my_it->first.first == propertyIdForSale; ++my_it) {
+            if (filterDesired && my_it->first.second != propertyIdDesired) break;
             const md_PricesMap& prices = my_it->second;
             for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
                 const md_Set& indexes = it->second;
                 for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                    const CMPMetaDEx& obj = *it;
-                    if (obj.getProperty() != propertyIdForSale) continue;
-                    if (!filterDesired || obj.getDesProperty() == propertyIdDesired) vecMetaDexObjects.push_back(obj);
+                    vecMetaDexObjects.push_back(*it);
                 }
             }
         }
     }
 
+    // orders of all desired properties are listed by unit price, and then by block and position
+    if (!filterDesired) {
+        std::sort(vecMetaDexObjects.begin(), vecMetaDexObjects.end(), MetaDEx_price_compare());
+    }
+
     Array response;
     MetaDexObjectsToJSON(vecMetaDexObjects, response);
     return response;
@@ -1805,6 +1806,42 @@ Value omni_getcurrentconsensushash(const Array& params, bool fHelp)
     return response;
 }
 
+Value omni_getcurrentstatecommitment(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "omni_getcurrentstatecommitment\n"
+            "\nReturns a commitment to the state for the current block, which is maintained incrementally.\n"
+            "\nThe commitment covers the same records as the consensus hash, but it is not used for checkpoints.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"block\" : nnnnnn,          (number) the index of the block this commitment applies to\n"
+            "  \"blockhash\" : \"hash\",      (string) the hash of the corresponding block\n"
+            "  \"commitment\" : \"hash\"      (string) the state commitment for the block\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("omni_getcurrentstatecommitment", "")
+            + HelpExampleRpc("omni_getcurrentstatecommitment", "")
+        );
+
+    LOCK(cs_main);
+
+    int block = GetHeight();
+
+    CBlockIndex* pblockindex = chainActive[block];
+    uint256 blockHash = pblockindex->GetBlockHash();
+
+    uint256 stateCommitment = GetStateCommitment();
+
+    Object response;
+    response.push_back(Pair("block", block));
+    response.push_back(Pair("blockhash", blockHash.GetHex()));
+    response.push_back(Pair("commitment", stateCommitment.GetHex()));
+
+    return response;
+}
+
 Value omni_getmetadexhash(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
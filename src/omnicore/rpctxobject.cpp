@@ -25,9 +25,6 @@
 #include "json/json_spirit_reader_template.h"
 #include "json/json_spirit_value.h"
 
-#include <boost/algorithm/string.hpp>
-#include <boost/lexical_cast.hpp>
-
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -534,17 +531,11 @@ void populateRPCExtendedTypeMetaDExCancel(const uint256& txid, Object& txobj)
     if (0<numberOfCancels) {
         for(int refNumber = 1; refNumber <= numberOfCancels; refNumber++) {
             Object cancelTx;
-            std::string strValue = p_txlistdb->getKeyValue(txid.ToString() + "-C" + strprintf("%d",refNumber));
-            if (strValue.empty()) continue;
-            std::vector<std::string> vstr;
-            boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-            if (vstr.size() != 3) {
-                PrintToLog("TXListDB Error - trade cancel number of tokens is not as expected (%s)\n", strValue);
-                continue;
-            }
-            uint32_t propId = boost::lexical_cast<uint32_t>(vstr[1]);
-            int64_t amountUnreserved = boost::lexical_cast<int64_t>(vstr[2]);
-            cancelTx.push_back(Pair("txid", vstr[0]));
+            uint256 cancelledTxid;
+            uint32_t propId = 0;
+            int64_t amountUnreserved = 0;
+            if (!p_txlistdb->getMetaDExCancelDetails(txid, refNumber, cancelledTxid, propId, amountUnreserved)) continue;
+            cancelTx.push_back(Pair("txid", cancelledTxid.GetHex()));
             cancelTx.push_back(Pair("propertyid", (uint64_t) propId));
             cancelTx.push_back(Pair("amountunreserved", FormatMP(propId, amountUnreserved)));
             cancelArray.push_back(cancelTx);
@@ -241,6 +241,8 @@ static CMainConsensusParams mainConsensusParams;
 static CTestNetConsensusParams testNetConsensusParams;
 //! Consensus parameters for regtest mode
 static CRegTestConsensusParams regTestConsensusParams;
+//! Incremented, whenever the consensus parameters are accessed for modification
+static uint64_t nConsensusParamsGeneration = 0;
 
 /**
  * Returns consensus parameters for the given network.
@@ -276,6 +278,7 @@ const CConsensusParams& ConsensusParams()
 CConsensusParams& MutableConsensusParams()
 {
     const std::string& network = Params().NetworkIDString();
+    ++nConsensusParamsGeneration;
 
     return ConsensusParams(network);
 }
@@ -288,6 +291,18 @@ void ResetConsensusParams()
     mainConsensusParams = CMainConsensusParams();
     testNetConsensusParams = CTestNetConsensusParams();
     regTestConsensusParams = CRegTestConsensusParams();
+    ++nConsensusParamsGeneration;
+}
+
+/**
+ * Returns a counter, which changes, whenever the consensus parameters may have been modified.
+ *
+ * This allows to detect, whether results based on a copy of the parameters are outdated.
+ * Like the parameters themselves, it must not be accessed concurrently.
+ */
+uint64_t GetConsensusParamsGeneration()
+{
+    return nConsensusParamsGeneration;
 }
 
 /**
@@ -314,8 +329,14 @@ bool IsAllowedInputType(int whichType, int nBlock)
  */
 bool IsAllowedOutputType(int whichType, int nBlock)
 {
-    const CConsensusParams& params = ConsensusParams();
+    return IsAllowedOutputType(whichType, nBlock, ConsensusParams());
+}
 
+/**
+ * Checks, if the script type qualifies as output, based on the given consensus parameters.
+ */
+bool IsAllowedOutputType(int whichType, int nBlock, const CConsensusParams& params)
+{
     switch (whichType)
     {
         case TX_PUBKEYHASH:
@@ -503,6 +524,11 @@ bool VerifyCheckpoint(int block, const uint256& blockHash)
             return false;
         }
 
+        // the maintained token supply is not covered by the consensus hash
+        if (msc_debug_supply) {
+            VerifyPropertySupply();
+        }
+
         // only verify if there is a checkpoint to verify against
         uint256 consensusHash = GetConsensusHash();
         if (consensusHash != checkpoint.consensusHash) {
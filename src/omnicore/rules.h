@@ -170,6 +170,8 @@ const CConsensusParams& ConsensusParams();
 CConsensusParams& MutableConsensusParams();
 /** Resets consensus paramters. */
 void ResetConsensusParams();
+/** Returns a counter, which changes, whenever the consensus parameters may have been modified. */
+uint64_t GetConsensusParamsGeneration();
 
 /** Activates a feature at a specific block height. */
 bool ActivateFeature(uint16_t featureId, int activationBlock, uint32_t minClientVersion, int transactionBlock);
@@ -179,6 +181,8 @@ bool IsFeatureActivated(uint16_t featureId, int transactionBlock);
 bool IsAllowedInputType(int whichType, int nBlock);
 /** Checks, if the script type qualifies as output. */
 bool IsAllowedOutputType(int whichType, int nBlock);
+/** Checks, if the script type qualifies as output, based on the given consensus parameters. */
+bool IsAllowedOutputType(int whichType, int nBlock, const CConsensusParams& params);
 /** Checks, if the transaction type and version is supported and enabled. */
 bool IsTransactionTypeAllowed(int txBlock, uint32_t txProperty, uint16_t txType, uint16_t version);
 
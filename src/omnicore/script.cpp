@@ -4,10 +4,14 @@
 #include "script/script.h"
 #include "script/standard.h"
 #include "serialize.h"
+#include "uint256.h"
 #include "utilstrencodings.h"
 
 #include <boost/foreach.hpp>
 
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -60,6 +64,56 @@ bool GetOutputType(const CScript& scriptPubKey, txnouttype& whichTypeRet)
     return false;
 }
 
+/**
+ * Returns the position of the data pushed by an operation, which is located
+ * between the size prefix of the operation and the next operation.
+ *
+ * @param pcOp[in]    The position of the push operation
+ * @param opcode[in]  The push operation
+ * @return The position of the pushed data
+ */
+static CScript::const_iterator GetPushedData(CScript::const_iterator pcOp, opcodetype opcode)
+{
+    if (opcode == OP_PUSHDATA1) return pcOp + 2;
+    if (opcode == OP_PUSHDATA2) return pcOp + 3;
+    if (opcode == OP_PUSHDATA4) return pcOp + 5;
+    return pcOp + 1;
+}
+
+/**
+ * Extracts the pushed data from a script.
+ *
+ * The extracted data refers to the bytes of the script, so the script must
+ * outlive the extracted data.
+ *
+ * @param script[in]       The script
+ * @param vPushesRet[out]  The extracted pushed data
+ * @param fSkipFirst[in]   Whether the first push operation should be skipped (default: false)
+ * @return True if the extraction was successful (result can be empty)
+ */
+bool GetScriptPushes(const CScript& script, std::vector<ScriptPush>& vPushesRet, bool fSkipFirst)
+{
+    int count = 0;
+    CScript::const_iterator pc = script.begin();
+
+    while (pc < script.end()) {
+        CScript::const_iterator pcOp = pc;
+        opcodetype opcode;
+        if (!script.GetOp(pc, opcode))
+            return false;
+        if (0x00 <= opcode && opcode <= OP_PUSHDATA4) {
+            if (count++ || !fSkipFirst) {
+                ScriptPush push;
+                push.pbegin = &script[0] + (GetPushedData(pcOp, opcode) - script.begin());
+                push.pend = &script[0] + (pc - script.begin());
+                vPushesRet.push_back(push);
+            }
+        }
+    }
+
+    return true;
+}
+
 /**
  * Extracts the pushed data as hex-encoded string from a script.
  *
@@ -70,19 +124,93 @@ bool GetOutputType(const CScript& scriptPubKey, txnouttype& whichTypeRet)
  */
 bool GetScriptPushes(const CScript& script, std::vector<std::string>& vstrRet, bool fSkipFirst)
 {
-    int count = 0;
+    std::vector<ScriptPush> vPushes;
+    bool fSuccess = GetScriptPushes(script, vPushes, fSkipFirst);
+
+    for (size_t n = 0; n < vPushes.size(); ++n) {
+        vstrRet.push_back(HexStr(vPushes[n].pbegin, vPushes[n].pend));
+    }
+
+    return fSuccess;
+}
+
+/**
+ * Checks, whether a script is a pay-to-pubkey-hash script in its canonical form:
+ *
+ *   OP_DUP OP_HASH160 20 [20 byte hash] OP_EQUALVERIFY OP_CHECKSIG
+ *
+ * The check is done on the raw bytes, so the script is not parsed.
+ *
+ * @param script[in]  The script
+ * @return True, if the script is a canonical pay-to-pubkey-hash script
+ */
+bool IsCanonicalPubKeyHash(const CScript& script)
+{
+    return (script.size() == 25 &&
+            script[0] == OP_DUP &&
+            script[1] == OP_HASH160 &&
+            script[2] == 20 &&
+            script[23] == OP_EQUALVERIFY &&
+            script[24] == OP_CHECKSIG);
+}
+
+/**
+ * Extracts the hash of a pay-to-pubkey-hash script.
+ *
+ * The hash of a canonical script is copied from the raw bytes, and only other
+ * encodings of the pushed hash are passed to the solver.
+ *
+ * @param script[in]    The script
+ * @param hashRet[out]  The extracted hash
+ * @return True, if the script is a pay-to-pubkey-hash script
+ */
+bool GetPubKeyHash(const CScript& script, uint160& hashRet)
+{
+    if (IsCanonicalPubKeyHash(script)) {
+        memcpy(hashRet.begin(), &script[3], 20);
+        return true;
+    }
+
+    txnouttype whichType;
+    std::vector<std::vector<unsigned char> > vSolutions;
+    if (!SafeSolver(script, whichType, vSolutions) || whichType != TX_PUBKEYHASH) {
+        return false;
+    }
+    hashRet = uint160(vSolutions[0]);
+
+    return true;
+}
+
+/**
+ * Checks, whether the first pushed data of a script starts with the given bytes.
+ *
+ * Operations, which don't push data, such as OP_RETURN, are skipped. The pushed
+ * data is compared in place, so it is neither copied, nor converted.
+ *
+ * @param script[in]     The script
+ * @param vchPrefix[in]  The expected first bytes
+ * @return True, if the first pushed data starts with the given bytes
+ */
+bool FirstPushStartsWith(const CScript& script, const std::vector<unsigned char>& vchPrefix)
+{
     CScript::const_iterator pc = script.begin();
 
     while (pc < script.end()) {
+        CScript::const_iterator pcOp = pc;
         opcodetype opcode;
-        std::vector<unsigned char> data;
-        if (!script.GetOp(pc, opcode, data))
+        if (!script.GetOp(pc, opcode))
+            return false;
+        if (opcode > OP_PUSHDATA4)
+            continue;
+
+        CScript::const_iterator pcData = GetPushedData(pcOp, opcode);
+        if ((size_t) (pc - pcData) < vchPrefix.size())
             return false;
-        if (0x00 <= opcode && opcode <= OP_PUSHDATA4)
-            if (count++ || !fSkipFirst) vstrRet.push_back(HexStr(data));
+
+        return std::equal(vchPrefix.begin(), vchPrefix.end(), pcData);
     }
 
-    return true;
+    return false;
 }
 
 /**
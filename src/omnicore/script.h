@@ -1,10 +1,12 @@
 #ifndef OMNICORE_SCRIPT_H
 #define OMNICORE_SCRIPT_H
 
+#include <stddef.h>
 #include <string>
 #include <vector>
 
 class CScript;
+class uint160;
 
 #include "script/standard.h"
 
@@ -14,9 +16,33 @@ int64_t GetDustThreshold(const CScript& scriptPubKey);
 /** Identifies standard output types based on a scriptPubKey. */
 bool GetOutputType(const CScript& scriptPubKey, txnouttype& whichTypeRet);
 
+/** Data pushed by a script, which refers to the bytes of the script. */
+struct ScriptPush
+{
+    //! First byte of the pushed data
+    const unsigned char* pbegin;
+    //! End of the pushed data
+    const unsigned char* pend;
+
+    /** Returns the number of pushed bytes. */
+    size_t size() const { return pend - pbegin; }
+};
+
+/** Extracts the pushed data from a script, without copying it. */
+bool GetScriptPushes(const CScript& script, std::vector<ScriptPush>& vPushesRet, bool fSkipFirst = false);
+
 /** Extracts the pushed data as hex-encoded string from a script. */
 bool GetScriptPushes(const CScript& script, std::vector<std::string>& vstrRet, bool fSkipFirst = false);
 
+/** Checks, whether a script is a pay-to-pubkey-hash script in its canonical form. */
+bool IsCanonicalPubKeyHash(const CScript& script);
+
+/** Extracts the hash of a pay-to-pubkey-hash script. */
+bool GetPubKeyHash(const CScript& script, uint160& hashRet);
+
+/** Checks, whether the first pushed data of a script starts with the given bytes. */
+bool FirstPushStartsWith(const CScript& script, const std::vector<unsigned char>& vchPrefix);
+
 /** Returns public keys or hashes from scriptPubKey, for standard transaction types. */
 bool SafeSolver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet);
 
@@ -1,21 +1,46 @@
 #include "omnicore/seedblocks.h"
 
 #include "omnicore/log.h"
+#include "omnicore/rules.h"
+#include "omnicore/version.h"
 
+#include "chain.h"
 #include "chainparams.h"
+#include "clientversion.h"
+#include "hash.h"
+#include "main.h"
+#include "serialize.h"
+#include "streams.h"
+#include "sync.h"
+#include "uint256.h"
+#include "util.h"
 #include "utiltime.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <stdint.h>
+#include <stdio.h>
+#include <exception>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
 
 const int MAX_SEED_BLOCK = 390000;
 
+/** Version of the seed blocks file format. */
+static const int SEED_BLOCKS_FILE_VERSION = 2;
+
+//! Guards the seed blocks, which are accessed by the prefetch threads of the initial scan
+static CCriticalSection cs_seedblocks;
+//! Whether a block contains Omni activity, indexed by height
+static std::vector<bool> vfSeedBlocks;
+//! Hash of the highest block covered by the seed blocks
+static uint256 hashSeedBlocksTip;
+
 static std::set<int> GetBlockList()
 {
     int blocks[] = {249498, 249536, 249559, 249560, 249571, 249590, 249595, 249601, 249603, 249611, 249638, 249639, 249682, 249689, 249704,
@@ -1259,6 +1284,13 @@ bool SkipBlock(int nBlock)
 {
     static std::set<int> blockList = GetBlockList();
 
+    // Use the seed blocks of the active chain, if they cover the block:
+    {
+        LOCK(cs_seedblocks);
+        if (nBlock >= 0 && nBlock < (int) vfSeedBlocks.size()) {
+            return !vfSeedBlocks[nBlock];
+        }
+    }
     // Scan all non mainnet blocks:
     if (Params().NetworkIDString() != "main") {
         return false;
@@ -1271,3 +1303,224 @@ bool SkipBlock(int nBlock)
     return (blockList.find(nBlock) == blockList.end());
 }
 
+/**
+ * Returns the sorted values of a startup option, which may be given more than once.
+ */
+static std::set<std::string> GetMultiArgSet(const std::string& strArg)
+{
+    std::set<std::string> setValues;
+    std::map<std::string, std::vector<std::string> >::const_iterator it = mapMultiArgs.find(strArg);
+    if (it != mapMultiArgs.end()) {
+        setValues.insert(it->second.begin(), it->second.end());
+    }
+    return setValues;
+}
+
+/**
+ * Returns a hash of the network, the consensus parameters and the overrides of
+ * the activation senders, which determine whether a block contains Omni activity.
+ */
+static uint256 GetSeedBlocksParamsHash()
+{
+    const mastercore::CConsensusParams& params = mastercore::ConsensusParams();
+
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << Params().NetworkIDString();
+    ss << Params().HashGenesisBlock();
+    ss << params.GENESIS_BLOCK;
+    ss << params.LAST_EXODUS_BLOCK;
+    ss << params.PUBKEYHASH_BLOCK;
+    ss << params.SCRIPTHASH_BLOCK;
+    ss << params.MULTISIG_BLOCK;
+    ss << params.NULLDATA_BLOCK;
+    ss << GetMultiArgSet("-omniactivationallowsender");
+    ss << GetMultiArgSet("-omniactivationignoresender");
+
+    return ss.GetHash();
+}
+
+/**
+ * Loads the persisted seed blocks.
+ *
+ * The seed blocks are only used, if they were created by the same version of
+ * Omni Core, for the same network and consensus parameters, and if the highest
+ * covered block is part of the active chain.
+ *
+ * @return True, if the seed blocks were loaded
+ */
+bool LoadSeedBlocks(const boost::filesystem::path& path)
+{
+    CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    // Allowed to fail as this file IS missing on first startup.
+    if (filein.IsNull()) {
+        return false;
+    }
+
+    int nFileVersion = 0;
+    int nOmniCoreVersion = 0;
+    uint256 hashParams;
+    int nHeight = -1;
+    uint256 hashBlock;
+    std::vector<unsigned char> vchBits;
+
+    try {
+        filein >> nFileVersion;
+        filein >> nOmniCoreVersion;
+        filein >> hashParams;
+        filein >> nHeight;
+        filein >> hashBlock;
+        filein >> vchBits;
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): failed to read seed blocks: %s\n", __func__, e.what());
+        return false;
+    }
+
+    if (nFileVersion != SEED_BLOCKS_FILE_VERSION || nOmniCoreVersion != OMNICORE_VERSION) {
+        PrintToLog("Seed blocks were created by a different version, ignoring them\n");
+        return false;
+    }
+    if (hashParams != GetSeedBlocksParamsHash()) {
+        PrintToLog("Seed blocks were created for different consensus parameters, ignoring them\n");
+        return false;
+    }
+    if (nHeight < 0 || vchBits.size() != (size_t) (nHeight / 8 + 1)) {
+        PrintToLog("Seed blocks are malformed, ignoring them\n");
+        return false;
+    }
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = chainActive[nHeight];
+        if (NULL == pindex || pindex->GetBlockHash() != hashBlock) {
+            PrintToLog("Seed blocks do not match the active chain, ignoring them\n");
+            return false;
+        }
+    }
+
+    LOCK(cs_seedblocks);
+    vfSeedBlocks.assign(nHeight + 1, false);
+    for (int n = 0; n <= nHeight; ++n) {
+        vfSeedBlocks[n] = (vchBits[n / 8] >> (n % 8)) & 1;
+    }
+    hashSeedBlocksTip = hashBlock;
+
+    PrintToLog("Loaded seed blocks up to block %d\n", nHeight);
+
+    return true;
+}
+
+/**
+ * Persists the seed blocks.
+ *
+ * The seed blocks are written to a temporary file first, which is then renamed,
+ * so the file is either complete, or absent.
+ *
+ * @return True, if the seed blocks were written
+ */
+bool WriteSeedBlocks(const boost::filesystem::path& path)
+{
+    CDataStream ssSeedBlocks(SER_DISK, CLIENT_VERSION);
+    {
+        LOCK(cs_seedblocks);
+
+        if (vfSeedBlocks.empty()) {
+            return false;
+        }
+
+        int nHeight = vfSeedBlocks.size() - 1;
+        std::vector<unsigned char> vchBits(nHeight / 8 + 1, 0);
+        for (int n = 0; n <= nHeight; ++n) {
+            if (vfSeedBlocks[n]) vchBits[n / 8] |= (1 << (n % 8));
+        }
+
+        ssSeedBlocks << SEED_BLOCKS_FILE_VERSION;
+        ssSeedBlocks << OMNICORE_VERSION;
+        ssSeedBlocks << GetSeedBlocksParamsHash();
+        ssSeedBlocks << nHeight;
+        ssSeedBlocks << hashSeedBlocksTip;
+        ssSeedBlocks << vchBits;
+    }
+
+    boost::filesystem::path pathTmp(path.string() + ".new");
+    const std::string strFile = pathTmp.string();
+
+    FILE* file = fopen(strFile.c_str(), "wb");
+    if (file == NULL) {
+        PrintToLog("%s(): ERROR: failed to open %s\n", __func__, strFile);
+        return false;
+    }
+    bool fWritten = (fwrite(&ssSeedBlocks[0], 1, ssSeedBlocks.size(), file) == ssSeedBlocks.size());
+    if (fWritten) FileCommit(file);
+    fclose(file);
+
+    if (!fWritten || !RenameOver(pathTmp, path)) {
+        PrintToLog("%s(): ERROR: failed to write %s\n", __func__, strFile);
+        boost::filesystem::remove(pathTmp);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Records, whether a block contains Omni activity.
+ *
+ * The seed blocks are only extended by the block on top of the highest covered
+ * block, so they never have gaps.
+ */
+void UpdateSeedBlocks(const CBlockIndex* pindex, bool fActivity)
+{
+    LOCK(cs_seedblocks);
+
+    int nHeight = pindex->nHeight;
+
+    if (nHeight < (int) vfSeedBlocks.size()) {
+        vfSeedBlocks[nHeight] = fActivity;
+        return;
+    }
+    if (nHeight > (int) vfSeedBlocks.size()) {
+        return;
+    }
+    if (nHeight > 0 && (NULL == pindex->pprev || pindex->pprev->GetBlockHash() != hashSeedBlocksTip)) {
+        PrintToLog("%s(): block %d does not extend the seed blocks, clearing them\n", __func__, nHeight);
+        vfSeedBlocks.clear();
+        hashSeedBlocksTip = 0;
+        return;
+    }
+
+    vfSeedBlocks.push_back(fActivity);
+    hashSeedBlocksTip = pindex->GetBlockHash();
+}
+
+/**
+ * Forgets the seed blocks above a block, for example after a reorganization.
+ */
+void TruncateSeedBlocks(const CBlockIndex* pindex)
+{
+    LOCK(cs_seedblocks);
+
+    if (pindex->nHeight + 1 < (int) vfSeedBlocks.size()) {
+        vfSeedBlocks.resize(pindex->nHeight + 1);
+        hashSeedBlocksTip = pindex->GetBlockHash();
+    }
+}
+
+/**
+ * Forgets all seed blocks.
+ */
+void ClearSeedBlocks()
+{
+    LOCK(cs_seedblocks);
+
+    vfSeedBlocks.clear();
+    hashSeedBlocksTip = 0;
+}
+
+/**
+ * Returns the height up to which the seed blocks are known, or -1, if none are known.
+ */
+int GetSeedBlocksHeight()
+{
+    LOCK(cs_seedblocks);
+
+    return vfSeedBlocks.size() - 1;
+}
@@ -1,7 +1,24 @@
 #ifndef OMNICORE_SEEDBLOCKS_H
 #define OMNICORE_SEEDBLOCKS_H
 
+#include <boost/filesystem/path.hpp>
+
+class CBlockIndex;
+
 bool SkipBlock(int nBlock);
 
+/** Loads the persisted seed blocks of the active chain. */
+bool LoadSeedBlocks(const boost::filesystem::path& path);
+/** Persists the seed blocks. */
+bool WriteSeedBlocks(const boost::filesystem::path& path);
+/** Records, whether a block contains Omni activity. */
+void UpdateSeedBlocks(const CBlockIndex* pindex, bool fActivity);
+/** Forgets the seed blocks above a block. */
+void TruncateSeedBlocks(const CBlockIndex* pindex);
+/** Forgets all seed blocks. */
+void ClearSeedBlocks();
+/** Returns the height up to which the seed blocks are known, or -1. */
+int GetSeedBlocksHeight();
+
 
 #endif // OMNICORE_SEEDBLOCKS_H
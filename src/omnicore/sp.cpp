@@ -2,6 +2,7 @@
 
 #include "omnicore/sp.h"
 
+#include "omnicore/consensushash.h"
 #include "omnicore/log.h"
 #include "omnicore/omnicore.h"
 #include "omnicore/uint256_extensions.h"
@@ -102,6 +103,8 @@ void CMPSPInfo::init(uint32_t nextSPID, uint32_t nextTestSPID)
 {
     next_spid = nextSPID;
     next_test_spid = nextTestSPID;
+
+    NotifyPropertiesReset();
 }
 
 uint32_t CMPSPInfo::peekNextSPID(uint8_t ecosystem) const
@@ -162,6 +165,8 @@ bool CMPSPInfo::updateSP(uint32_t propertyId, const Entry& info)
         return false;
     }
 
+    NotifyPropertyChange(propertyId);
+
     PrintToLog("%s(): updated entry for SP %d successfully\n", __func__, propertyId);
     return true;
 }
@@ -223,6 +228,8 @@ uint32_t CMPSPInfo::putSP(uint8_t ecosystem, const Entry& info)
         PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, status.ToString());
     }
 
+    NotifyPropertyChange(propertyId);
+
     return propertyId;
 }
 
@@ -381,6 +388,9 @@ int64_t CMPSPInfo::popBlock(const uint256& block_hash)
 
     leveldb::Status status = pdb->Write(syncoptions, &commitBatch);
 
+    // restored and removed entries are not tracked individually
+    NotifyPropertiesReset();
+
     if (!status.ok()) {
         PrintToLog("%s(): ERROR: %s\n", __func__, status.ToString());
         return -4;
@@ -39,29 +39,27 @@ OwnerAddrType STO_GetReceivers(const std::string& sender, uint32_t property, int
 
     {
         LOCK(cs_tally);
-        std::map<std::string, CMPTally>::reverse_iterator it;
-
-        for (it = mp_tally_map.rbegin(); it != mp_tally_map.rend(); ++it) {
-            const std::string& address = it->first;
-            const CMPTally& tally = it->second;
-
-            int64_t tokens = 0;
-            tokens += tally.getMoney(property, BALANCE);
-            tokens += tally.getMoney(property, SELLOFFER_RESERVE);
-            tokens += tally.getMoney(property, ACCEPT_RESERVE);
-            tokens += tally.getMoney(property, METADEX_RESERVE);
-
-            // Do not include the sender
-            if (address == sender) {
-                senderTokens = tokens;
-                continue;
-            }
+        std::map<uint32_t, HolderMap>::const_iterator itHolders = mp_property_holders.find(property);
+
+        if (itHolders != mp_property_holders.end()) {
+            const HolderMap& holders = itHolders->second;
+
+            for (HolderMap::const_iterator it = holders.begin(); it != holders.end(); ++it) {
+                const std::string& address = it->first;
+                int64_t tokens = it->second;
+
+                // Do not include the sender
+                if (address == sender) {
+                    senderTokens = tokens;
+                    continue;
+                }
 
-            totalTokens += tokens;
+                totalTokens += tokens;
 
-            // Only holders with balance are relevant
-            if (0 < tokens) {
-                ownerAddrSet.insert(std::make_pair(tokens, address));
+                // Only holders with balance are relevant
+                if (0 < tokens) {
+                    ownerAddrSet.insert(std::make_pair(tokens, address));
+                }
             }
         }
     }
@@ -3,15 +3,136 @@
 #include "omnicore/log.h"
 #include "omnicore/omnicore.h"
 
+#include <stddef.h>
 #include <stdint.h>
-#include <map>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
 
 /**
  * Creates an empty tally.
  */
-CMPTally::CMPTally()
+CMPTally::CMPTally() : nTokens(0), nCapacity(0), my_pos(0)
+{
+}
+
+/**
+ * Creates a copy of another tally.
+ *
+ * The copy stores its records inline, if there is at most one.
+ */
+CMPTally::CMPTally(const CMPTally& other) : nTokens(other.nTokens), nCapacity(0), my_pos(other.my_pos)
 {
-    my_it = mp_token.begin();
+    if (nTokens > 1) {
+        nCapacity = nTokens;
+        mp_token.pRecords = new TokenRecord[nCapacity];
+    }
+    if (nTokens > 0) {
+        memcpy(records(), other.records(), nTokens * sizeof(TokenRecord));
+    }
+}
+
+/**
+ * Releases the balance records stored on the heap.
+ */
+CMPTally::~CMPTally()
+{
+    if (nCapacity > 0) {
+        delete[] mp_token.pRecords;
+    }
+}
+
+/**
+ * Replaces the balance records by the ones of another tally.
+ */
+CMPTally& CMPTally::operator=(const CMPTally& other)
+{
+    if (this != &other) {
+        CMPTally copy(other);
+        std::swap(nTokens, copy.nTokens);
+        std::swap(nCapacity, copy.nCapacity);
+        std::swap(my_pos, copy.my_pos);
+        std::swap(mp_token, copy.mp_token);
+    }
+    return *this;
+}
+
+/**
+ * Returns the number of bytes allocated on the heap.
+ */
+size_t CMPTally::DynamicMemoryUsage() const
+{
+    return nCapacity * sizeof(TokenRecord);
+}
+
+/**
+ * Inserts an empty balance record at the given position.
+ *
+ * The heap storage grows by doubling its capacity, once the inline record is taken.
+ *
+ * @param nPos        The position of the new record
+ * @param propertyId  The identifier of the token
+ */
+void CMPTally::insertRecord(size_t nPos, uint32_t propertyId)
+{
+    if (nTokens > 0 && nTokens >= std::max<uint32_t>(nCapacity, 1)) {
+        uint32_t nNewCapacity = std::max<uint32_t>(2, nCapacity * 2);
+        TokenRecord* pNewRecords = new TokenRecord[nNewCapacity];
+        memcpy(pNewRecords, records(), nTokens * sizeof(TokenRecord));
+        if (nCapacity > 0) {
+            delete[] mp_token.pRecords;
+        }
+        mp_token.pRecords = pNewRecords;
+        nCapacity = nNewCapacity;
+    }
+
+    TokenRecord* pRecords = records();
+    memmove(pRecords + nPos + 1, pRecords + nPos, (nTokens - nPos) * sizeof(TokenRecord));
+    memset(&pRecords[nPos], 0, sizeof(TokenRecord));
+    pRecords[nPos].propertyId = propertyId;
+    ++nTokens;
+}
+
+/**
+ * Returns the position of the first balance record, which is not ordered
+ * before the given token.
+ *
+ * @param propertyId  The identifier of the token
+ * @return The position, or the number of records, if all are ordered before
+ */
+size_t CMPTally::lowerBound(uint32_t propertyId) const
+{
+    const TokenRecord* pRecords = records();
+    size_t nFirst = 0;
+    size_t nCount = nTokens;
+
+    while (nCount > 0) {
+        size_t nStep = nCount / 2;
+        if (pRecords[nFirst + nStep].propertyId < propertyId) {
+            nFirst += nStep + 1;
+            nCount -= nStep + 1;
+        } else {
+            nCount = nStep;
+        }
+    }
+
+    return nFirst;
+}
+
+/**
+ * Returns the balance record of a token.
+ *
+ * @param propertyId  The identifier of the token
+ * @return The balance record, or NULL, if there is none
+ */
+const CMPTally::BalanceRecord* CMPTally::findRecord(uint32_t propertyId) const
+{
+    size_t nPos = lowerBound(propertyId);
+    if (nPos < nTokens && records()[nPos].propertyId == propertyId) {
+        return &records()[nPos].record;
+    }
+    return NULL;
 }
 
 /**
@@ -22,9 +143,9 @@ CMPTally::CMPTally()
 uint32_t CMPTally::init()
 {
     uint32_t propertyId = 0;
-    my_it = mp_token.begin();
-    if (my_it != mp_token.end()) {
-        propertyId = my_it->first;
+    my_pos = 0;
+    if (my_pos < nTokens) {
+        propertyId = records()[my_pos].propertyId;
     }
     return propertyId;
 }
@@ -37,9 +158,9 @@ uint32_t CMPTally::init()
 uint32_t CMPTally::next()
 {
     uint32_t ret = 0;
-    if (my_it != mp_token.end()) {
-        ret = my_it->first;
-        ++my_it;
+    if (my_pos < nTokens) {
+        ret = records()[my_pos].propertyId;
+        ++my_pos;
     }
     return ret;
 }
@@ -73,7 +194,12 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
         return false;
     }
     bool fUpdated = false;
-    int64_t now64 = mp_token[propertyId].balance[ttype];
+    size_t nPos = lowerBound(propertyId);
+    if (nPos == nTokens || records()[nPos].propertyId != propertyId) {
+        insertRecord(nPos, propertyId);
+    }
+    int64_t& balance = records()[nPos].record.balance[ttype];
+    int64_t now64 = balance;
 
     if (isOverflow(now64, amount)) {
         PrintToLog("%s(): ERROR: arithmetic overflow [%d + %d]\n", __func__, now64, amount);
@@ -85,7 +211,7 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
         // Negative balances are only permitted for pending balances
     } else {
         now64 += amount;
-        mp_token[propertyId].balance[ttype] = now64;
+        balance = now64;
 
         fUpdated = true;
     }
@@ -106,11 +232,10 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
         return 0;
     }
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* pRecord = findRecord(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        money = record.balance[ttype];
+    if (pRecord) {
+        money = pRecord->balance[ttype];
     }
 
     return money;
@@ -127,14 +252,13 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
  */
 int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 {
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* pRecord = findRecord(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        if (record.balance[PENDING] < 0) {
-            return record.balance[BALANCE] + record.balance[PENDING];
+    if (pRecord) {
+        if (pRecord->balance[PENDING] < 0) {
+            return pRecord->balance[BALANCE] + pRecord->balance[PENDING];
         } else {
-            return record.balance[BALANCE];
+            return pRecord->balance[BALANCE];
         }
     }
 
@@ -153,13 +277,12 @@ int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 int64_t CMPTally::getMoneyReserved(uint32_t propertyId) const
 {
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* pRecord = findRecord(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        money += record.balance[SELLOFFER_RESERVE];
-        money += record.balance[ACCEPT_RESERVE];
-        money += record.balance[METADEX_RESERVE];
+    if (pRecord) {
+        money += pRecord->balance[SELLOFFER_RESERVE];
+        money += pRecord->balance[ACCEPT_RESERVE];
+        money += pRecord->balance[METADEX_RESERVE];
     }
 
     return money;
@@ -173,31 +296,23 @@ int64_t CMPTally::getMoneyReserved(uint32_t propertyId) const
  */
 bool CMPTally::operator==(const CMPTally& rhs) const
 {
-    if (mp_token.size() != rhs.mp_token.size()) {
+    if (nTokens != rhs.nTokens) {
         return false;
     }
-    TokenMap::const_iterator pc1 = mp_token.begin();
-    TokenMap::const_iterator pc2 = rhs.mp_token.begin();
-
-    for (unsigned int i = 0; i < mp_token.size(); ++i) {
-        if (pc1->first != pc2->first) {
+    for (size_t i = 0; i < nTokens; ++i) {
+        if (records()[i].propertyId != rhs.records()[i].propertyId) {
             return false;
         }
-        const BalanceRecord& record1 = pc1->second;
-        const BalanceRecord& record2 = pc2->second;
+        const BalanceRecord& record1 = records()[i].record;
+        const BalanceRecord& record2 = rhs.records()[i].record;
 
         for (int ttype = 0; ttype < TALLY_TYPE_COUNT; ++ttype) {
             if (record1.balance[ttype] != record2.balance[ttype]) {
                 return false;
             }
         }
-        ++pc1;
-        ++pc2;
     }
 
-    assert(pc1 == mp_token.end());
-    assert(pc2 == rhs.mp_token.end());
-
     return true;
 }
 
@@ -227,15 +342,14 @@ int64_t CMPTally::print(uint32_t propertyId, bool bDivisible) const
     int64_t pending = 0;
     int64_t metadex_reserve = 0;
 
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* pRecord = findRecord(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        balance = record.balance[BALANCE];
-        selloffer_reserve = record.balance[SELLOFFER_RESERVE];
-        accept_reserve = record.balance[ACCEPT_RESERVE];
-        pending = record.balance[PENDING];
-        metadex_reserve = record.balance[METADEX_RESERVE];
+    if (pRecord) {
+        balance = pRecord->balance[BALANCE];
+        selloffer_reserve = pRecord->balance[SELLOFFER_RESERVE];
+        accept_reserve = pRecord->balance[ACCEPT_RESERVE];
+        pending = pRecord->balance[PENDING];
+        metadex_reserve = pRecord->balance[METADEX_RESERVE];
     }
 
     if (bDivisible) {
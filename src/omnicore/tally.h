@@ -1,8 +1,8 @@
 #ifndef OMNICORE_TALLY_H
 #define OMNICORE_TALLY_H
 
+#include <stddef.h>
 #include <stdint.h>
-#include <map>
 
 //! Balance record types
 enum TallyType {
@@ -15,6 +15,10 @@ enum TallyType {
 };
 
 /** Balance records of a single entity.
+ *
+ * Most entities hold only a single token, so the first balance record is stored
+ * inline, and further records are kept on the heap. The records are ordered by
+ * property identifier.
  */
 class CMPTally
 {
@@ -23,17 +27,55 @@ private:
         int64_t balance[TALLY_TYPE_COUNT];
     } BalanceRecord;
 
-    //! Map of balance records
-    typedef std::map<uint32_t, BalanceRecord> TokenMap;
+    //! Balance record of a token
+    typedef struct {
+        uint32_t propertyId;
+        BalanceRecord record;
+    } TokenRecord;
+
+    //! Number of balance records
+    uint32_t nTokens;
+    //! Number of balance records the heap storage can hold, or 0, if the record is stored inline
+    uint32_t nCapacity;
+    //! Position of the internal iterator
+    uint32_t my_pos;
+    //! Storage of the balance records; a single record inline, or more on the heap
+    union TokenStorage {
+        TokenRecord single;
+        TokenRecord* pRecords;
+    };
     //! Balance records for different tokens
-    TokenMap mp_token;
-    //! Internal iterator pointing to a balance record
-    TokenMap::iterator my_it;
+    TokenStorage mp_token;
+
+    /** Returns the balance records. */
+    TokenRecord* records() { return (nCapacity == 0) ? &mp_token.single : mp_token.pRecords; }
+    const TokenRecord* records() const { return (nCapacity == 0) ? &mp_token.single : mp_token.pRecords; }
+
+    /** Inserts an empty balance record at the given position. */
+    void insertRecord(size_t nPos, uint32_t propertyId);
+
+    /** Returns the position of the first balance record not ordered before the token. */
+    size_t lowerBound(uint32_t propertyId) const;
+
+    /** Returns the balance record of a token, or NULL, if there is none. */
+    const BalanceRecord* findRecord(uint32_t propertyId) const;
 
 public:
     /** Creates an empty tally. */
     CMPTally();
 
+    /** Creates a copy of another tally. */
+    CMPTally(const CMPTally& other);
+
+    /** Releases the balance records stored on the heap. */
+    ~CMPTally();
+
+    /** Replaces the balance records by the ones of another tally. */
+    CMPTally& operator=(const CMPTally& other);
+
+    /** Returns the number of bytes allocated on the heap. */
+    size_t DynamicMemoryUsage() const;
+
     /** Resets the internal iterator. */
     uint32_t init();
 
@@ -0,0 +1,533 @@
+#include "omnicore/tallymap.h"
+
+#include "omnicore/tally.h"
+
+#include "base58.h"
+#include "hash.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+//! Initial number of slots of the hash table; must be a power of two
+static const size_t INITIAL_SLOTS = 64;
+
+const uint32_t CMPTallyMap::NO_ENTRY;
+const size_t CMPTallyMap::CHECKSUM_SIZE;
+
+bool CAddressKey::operator==(const CAddressKey& other) const
+{
+    return memcmp(data, other.data, SIZE) == 0;
+}
+
+//! Number of bytes encoded by an address: the compact identifier, followed by the checksum
+static const size_t DECODED_SIZE = CAddressKey::SIZE + CMPTallyMap::CHECKSUM_SIZE;
+
+//! Values of the base58 characters, or -1 for other characters
+static const int8_t mapBase58[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8, -1, -1, -1, -1, -1, -1,
+    -1,  9, 10, 11, 12, 13, 14, 15, 16, -1, 17, 18, 19, 20, 21, -1,
+    22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, -1, -1, -1, -1, -1,
+    -1, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, -1, 44, 45, 46,
+    47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/**
+ * Decodes a base58 string, which encodes exactly 25 bytes.
+ *
+ * This is equivalent to DecodeBase58() for such strings, except that whitespace is
+ * not skipped. Every sequence of 25 bytes has exactly one such encoding, so strings,
+ * which are decoded into the same bytes, are equal.
+ *
+ * The value is accumulated in 32 bit limbs, so no big number arithmetic on bytes,
+ * and no allocation is needed.
+ */
+static bool DecodeAddress(const std::string& address, unsigned char (&vch)[DECODED_SIZE])
+{
+    // 25 bytes are encoded with at most 35 characters
+    if (address.empty() || address.size() > 35) {
+        return false;
+    }
+
+    // leading zero bytes are encoded as '1'
+    size_t nZeros = 0;
+    while (nZeros < address.size() && address[nZeros] == '1') {
+        ++nZeros;
+    }
+
+    // little endian limbs of 224 bits
+    uint32_t limbs[7] = { 0 };
+    for (size_t i = nZeros; i < address.size(); ++i) {
+        int8_t digit = mapBase58[(unsigned char) address[i]];
+        if (digit < 0) {
+            return false;
+        }
+        uint64_t carry = digit;
+        for (size_t j = 0; j < 7; ++j) {
+            carry += (uint64_t) limbs[j] * 58;
+            limbs[j] = (uint32_t) carry;
+            carry >>= 32;
+        }
+        if (carry != 0) {
+            return false;
+        }
+    }
+    // the value must fit into 200 bits
+    if ((limbs[6] >> 8) != 0) {
+        return false;
+    }
+
+    for (size_t k = 0; k < DECODED_SIZE; ++k) {
+        size_t nByte = DECODED_SIZE - 1 - k;
+        vch[k] = (unsigned char) (limbs[nByte / 4] >> (8 * (nByte % 4)));
+    }
+
+    // each leading zero byte must be encoded as '1', and not be part of the value
+    size_t nLeading = 0;
+    while (nLeading < DECODED_SIZE && vch[nLeading] == 0) {
+        ++nLeading;
+    }
+    return (nLeading == nZeros);
+}
+
+/**
+ * Decodes a base58 encoded address, and checks its checksum.
+ */
+static bool DecodeCanonicalAddress(const std::string& address, unsigned char (&vch)[DECODED_SIZE])
+{
+    if (!DecodeAddress(address, vch)) {
+        return false;
+    }
+    uint256 hash = Hash(vch, vch + CAddressKey::SIZE);
+    return (memcmp(hash.begin(), vch + CAddressKey::SIZE, CMPTallyMap::CHECKSUM_SIZE) == 0);
+}
+
+/**
+ * Converts a base58 encoded address into its compact identifier.
+ *
+ * Leading and trailing whitespace is not accepted, as such strings would otherwise
+ * be identified with the address without whitespace.
+ */
+bool CAddressKey::FromString(const std::string& address, CAddressKey& key)
+{
+    unsigned char vch[DECODED_SIZE];
+    if (!DecodeCanonicalAddress(address, vch)) {
+        return false;
+    }
+
+    memcpy(key.data, vch, SIZE);
+    return true;
+}
+
+/**
+ * Returns the base58 encoded address.
+ */
+std::string CAddressKey::ToString() const
+{
+    return EncodeBase58Check(std::vector<unsigned char>(data, data + SIZE));
+}
+
+/**
+ * Returns the first characters of an address as number, which is ordered like the
+ * addresses, as long as the characters differ.
+ */
+static uint64_t GetOrderPrefix(const std::string& address)
+{
+    uint64_t nPrefix = 0;
+    for (size_t n = 0; n < sizeof(nPrefix); ++n) {
+        unsigned char ch = (n < address.size()) ? address[n] : 0;
+        nPrefix = (nPrefix << 8) | ch;
+    }
+    return nPrefix;
+}
+
+CMPTallyMap::CMPTallyMap() : nSlotsUsed(0), nSize(0), salt(GetRandHash()), fOrderStale(false)
+{
+}
+
+CMPTallyMap::iterator::iterator(CMPTallyMap* pMapIn, const std::vector<uint32_t>* pOrderIn, size_t nPosIn)
+  : pMap(pMapIn), pOrder(pOrderIn), nPos(nPosIn)
+{
+    skipUnused();
+}
+
+/**
+ * Skips the entries on the free list, when iterating over all entries.
+ */
+void CMPTallyMap::iterator::skipUnused()
+{
+    if (pOrder) return;
+    while (nPos < pMap->vEntries.size() && !pMap->vEntries[nPos].fUsed) {
+        ++nPos;
+    }
+}
+
+CMPTallyMap::iterator& CMPTallyMap::iterator::operator++()
+{
+    ++nPos;
+    skipUnused();
+    return *this;
+}
+
+/**
+ * Returns the salted hash of a compact identifier.
+ */
+size_t CMPTallyMap::hashKey(const CAddressKey& key) const
+{
+    uint256 value;
+    memcpy(value.begin(), key.data, CAddressKey::SIZE);
+    return value.GetHash(salt);
+}
+
+/**
+ * Returns the slot of a compact identifier, or NO_ENTRY, if it's not in the table.
+ */
+uint32_t CMPTallyMap::findSlot(const CAddressKey& key) const
+{
+    if (vSlots.empty()) return NO_ENTRY;
+
+    const size_t nMask = vSlots.size() - 1;
+    for (size_t nSlot = hashKey(key) & nMask; ; nSlot = (nSlot + 1) & nMask) {
+        uint32_t nEntry = vSlots[nSlot];
+        if (nEntry == NO_ENTRY) return NO_ENTRY;
+        if (vEntries[nEntry].key == key) return nSlot;
+    }
+}
+
+/**
+ * Adds an entry to the hash table, which grows, once it's three quarters full.
+ */
+void CMPTallyMap::insertSlot(uint32_t nEntry)
+{
+    if ((nSlotsUsed + 1) * 4 > vSlots.size() * 3) {
+        resizeSlots(std::max(INITIAL_SLOTS, vSlots.size() * 2));
+    }
+
+    const size_t nMask = vSlots.size() - 1;
+    size_t nSlot = hashKey(vEntries[nEntry].key) & nMask;
+    while (vSlots[nSlot] != NO_ENTRY) {
+        nSlot = (nSlot + 1) & nMask;
+    }
+    vSlots[nSlot] = nEntry;
+    ++nSlotsUsed;
+}
+
+/**
+ * Removes an entry from the hash table.
+ *
+ * The following entries of the probe sequence are shifted back, so no tombstones
+ * are needed.
+ */
+void CMPTallyMap::eraseSlot(uint32_t nSlot)
+{
+    const size_t nMask = vSlots.size() - 1;
+    size_t nHole = nSlot;
+    vSlots[nHole] = NO_ENTRY;
+    --nSlotsUsed;
+
+    for (size_t nNext = (nHole + 1) & nMask; vSlots[nNext] != NO_ENTRY; nNext = (nNext + 1) & nMask) {
+        size_t nHome = hashKey(vEntries[vSlots[nNext]].key) & nMask;
+        // the entry stays, if its home slot is cyclically within (hole, next]
+        bool fStays = (nHole < nNext) ? (nHome > nHole && nHome <= nNext) : (nHome > nHole || nHome <= nNext);
+        if (!fStays) {
+            vSlots[nHole] = vSlots[nNext];
+            vSlots[nNext] = NO_ENTRY;
+            nHole = nNext;
+        }
+    }
+}
+
+/**
+ * Rebuilds the hash table with the given number of slots.
+ */
+void CMPTallyMap::resizeSlots(size_t nNewSize)
+{
+    std::vector<uint32_t> vOldSlots(nNewSize, NO_ENTRY);
+    vSlots.swap(vOldSlots);
+    nSlotsUsed = 0;
+
+    for (size_t n = 0; n < vOldSlots.size(); ++n) {
+        if (vOldSlots[n] != NO_ENTRY) insertSlot(vOldSlots[n]);
+    }
+}
+
+/**
+ * Returns the position of the entry of an address, or NO_ENTRY, if there is none.
+ *
+ * The address is decoded, but the checksum is compared with the one of the entry,
+ * instead of hashing the compact identifier, so no hash needs to be computed.
+ */
+uint32_t CMPTallyMap::findEntry(const std::string& address) const
+{
+    unsigned char vch[DECODED_SIZE];
+    if (DecodeAddress(address, vch)) {
+        CAddressKey key;
+        memcpy(key.data, vch, CAddressKey::SIZE);
+        uint32_t nSlot = findSlot(key);
+        if (nSlot != NO_ENTRY) {
+            uint32_t nEntry = vSlots[nSlot];
+            if (memcmp(vEntries[nEntry].checksum, vch + CAddressKey::SIZE, CHECKSUM_SIZE) == 0) {
+                return nEntry;
+            }
+        }
+    }
+
+    // the address may be raw, for example, if its checksum is invalid
+    if (mapRawEntries.empty()) return NO_ENTRY;
+
+    std::map<std::string, uint32_t>::const_iterator it = mapRawEntries.find(address);
+    return (it == mapRawEntries.end()) ? NO_ENTRY : it->second;
+}
+
+/**
+ * Returns the position of an unused entry, which is taken from the free list, if possible.
+ */
+uint32_t CMPTallyMap::allocateEntry()
+{
+    uint32_t nEntry = 0;
+    if (!vFree.empty()) {
+        nEntry = vFree.back();
+        vFree.pop_back();
+    } else {
+        nEntry = vEntries.size();
+        vEntries.push_back(Entry());
+    }
+
+    Entry& entry = vEntries[nEntry];
+    entry.fUsed = true;
+    entry.fRaw = false;
+    entry.tally = CMPTally();
+    ++nSize;
+
+    return nEntry;
+}
+
+/**
+ * Returns the address of an entry.
+ */
+std::string CMPTallyMap::getAddress(uint32_t nEntry) const
+{
+    const Entry& entry = vEntries[nEntry];
+    if (entry.fRaw) {
+        uint32_t nRaw = 0;
+        memcpy(&nRaw, entry.key.data, sizeof(nRaw));
+        return vRawAddresses[nRaw];
+    }
+    return entry.key.ToString();
+}
+
+/**
+ * Compares the addresses of two entries.
+ *
+ * The addresses are only encoded, if their first characters are equal.
+ */
+bool CMPTallyMap::lessByAddress(uint32_t nLeft, uint32_t nRight) const
+{
+    uint64_t nLeftPrefix = vEntries[nLeft].nOrderPrefix;
+    uint64_t nRightPrefix = vEntries[nRight].nOrderPrefix;
+    if (nLeftPrefix != nRightPrefix) return nLeftPrefix < nRightPrefix;
+
+    return getAddress(nLeft) < getAddress(nRight);
+}
+
+/** Orders positions of entries by address. */
+struct CompareByAddress
+{
+    const CMPTallyMap& map;
+    bool (CMPTallyMap::*pLess)(uint32_t, uint32_t) const;
+
+    CompareByAddress(const CMPTallyMap& mapIn, bool (CMPTallyMap::*pLessIn)(uint32_t, uint32_t) const)
+      : map(mapIn), pLess(pLessIn) {}
+
+    bool operator()(uint32_t nLeft, uint32_t nRight) const { return (map.*pLess)(nLeft, nRight); }
+};
+
+/**
+ * Returns the positions of the entries ordered by address.
+ *
+ * Entries inserted since the order was last built are sorted and merged into it.
+ * Once an entry was erased, the order is built from scratch.
+ */
+const std::vector<uint32_t>& CMPTallyMap::getOrder()
+{
+    CompareByAddress compare(*this, &CMPTallyMap::lessByAddress);
+
+    if (fOrderStale) {
+        vOrdered.clear();
+        vUnordered.clear();
+        for (uint32_t n = 0; n < vEntries.size(); ++n) {
+            if (vEntries[n].fUsed) vOrdered.push_back(n);
+        }
+        std::sort(vOrdered.begin(), vOrdered.end(), compare);
+        fOrderStale = false;
+    }
+
+    if (!vUnordered.empty()) {
+        std::sort(vUnordered.begin(), vUnordered.end(), compare);
+        size_t nMiddle = vOrdered.size();
+        vOrdered.insert(vOrdered.end(), vUnordered.begin(), vUnordered.end());
+        std::inplace_merge(vOrdered.begin(), vOrdered.begin() + nMiddle, vOrdered.end(), compare);
+        vUnordered.clear();
+    }
+
+    return vOrdered;
+}
+
+/**
+ * Returns the tally of an address, or NULL, if there is none.
+ */
+CMPTally* CMPTallyMap::find(const std::string& address)
+{
+    uint32_t nEntry = findEntry(address);
+    return (nEntry == NO_ENTRY) ? NULL : &vEntries[nEntry].tally;
+}
+
+const CMPTally* CMPTallyMap::find(const std::string& address) const
+{
+    uint32_t nEntry = findEntry(address);
+    return (nEntry == NO_ENTRY) ? NULL : &vEntries[nEntry].tally;
+}
+
+/**
+ * Returns the tally of an address, which is inserted, if there is none.
+ */
+CMPTally& CMPTallyMap::operator[](const std::string& address)
+{
+    uint32_t nFound = findEntry(address);
+    if (nFound != NO_ENTRY) return vEntries[nFound].tally;
+
+    unsigned char vch[DECODED_SIZE];
+    bool fRaw = !DecodeCanonicalAddress(address, vch);
+
+    uint32_t nEntry = allocateEntry();
+    Entry& entry = vEntries[nEntry];
+    entry.fRaw = fRaw;
+    entry.nOrderPrefix = GetOrderPrefix(address);
+
+    if (!fRaw) {
+        memcpy(entry.key.data, vch, CAddressKey::SIZE);
+        memcpy(entry.checksum, vch + CAddressKey::SIZE, CHECKSUM_SIZE);
+        insertSlot(nEntry);
+    } else {
+        uint32_t nRaw = vRawAddresses.size();
+        if (!vFreeRaw.empty()) {
+            nRaw = vFreeRaw.back();
+            vFreeRaw.pop_back();
+            vRawAddresses[nRaw] = address;
+        } else {
+            vRawAddresses.push_back(address);
+        }
+        memset(entry.key.data, 0, CAddressKey::SIZE);
+        memcpy(entry.key.data, &nRaw, sizeof(nRaw));
+        memset(entry.checksum, 0, CHECKSUM_SIZE);
+        mapRawEntries.insert(std::make_pair(address, nEntry));
+    }
+
+    if (!fOrderStale) vUnordered.push_back(nEntry);
+
+    return entry.tally;
+}
+
+/**
+ * Removes an address and its tally.
+ *
+ * The entry, and the position of a raw address, are put on free lists, so other
+ * entries are not moved.
+ */
+bool CMPTallyMap::erase(const std::string& address)
+{
+    uint32_t nEntry = findEntry(address);
+    if (nEntry == NO_ENTRY) return false;
+
+    Entry& entry = vEntries[nEntry];
+    if (!entry.fRaw) {
+        eraseSlot(findSlot(entry.key));
+    } else {
+        mapRawEntries.erase(address);
+
+        uint32_t nRaw = 0;
+        memcpy(&nRaw, entry.key.data, sizeof(nRaw));
+        std::string().swap(vRawAddresses[nRaw]);
+        vFreeRaw.push_back(nRaw);
+    }
+
+    entry.fUsed = false;
+    entry.tally = CMPTally();
+    vFree.push_back(nEntry);
+    --nSize;
+    fOrderStale = true;
+
+    return true;
+}
+
+/**
+ * Removes all addresses.
+ */
+void CMPTallyMap::clear()
+{
+    std::deque<Entry>().swap(vEntries);
+    std::vector<uint32_t>().swap(vFree);
+    std::vector<uint32_t>().swap(vSlots);
+    std::vector<std::string>().swap(vRawAddresses);
+    std::vector<uint32_t>().swap(vFreeRaw);
+    std::vector<uint32_t>().swap(vOrdered);
+    std::vector<uint32_t>().swap(vUnordered);
+    mapRawEntries.clear();
+    nSlotsUsed = 0;
+    nSize = 0;
+    fOrderStale = false;
+}
+
+CMPTallyMap::iterator CMPTallyMap::begin()
+{
+    return iterator(this, &getOrder(), 0);
+}
+
+CMPTallyMap::iterator CMPTallyMap::end()
+{
+    return iterator(this, &vOrdered, vOrdered.size());
+}
+
+CMPTallyMap::iterator CMPTallyMap::unorderedBegin()
+{
+    return iterator(this, NULL, 0);
+}
+
+CMPTallyMap::iterator CMPTallyMap::unorderedEnd()
+{
+    return iterator(this, NULL, vEntries.size());
+}
+
+/**
+ * Returns the approximate number of bytes allocated on the heap.
+ *
+ * Raw addresses are not expected to be used outside of tests, and not included.
+ */
+size_t CMPTallyMap::DynamicMemoryUsage() const
+{
+    size_t nUsage = vEntries.size() * sizeof(Entry);
+    nUsage += (vFree.capacity() + vSlots.capacity() + vOrdered.capacity() + vUnordered.capacity()) * sizeof(uint32_t);
+    for (std::deque<Entry>::const_iterator it = vEntries.begin(); it != vEntries.end(); ++it) {
+        nUsage += it->tally.DynamicMemoryUsage();
+    }
+    return nUsage;
+}
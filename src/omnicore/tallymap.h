@@ -0,0 +1,172 @@
+#ifndef OMNICORE_TALLYMAP_H
+#define OMNICORE_TALLYMAP_H
+
+#include "omnicore/tally.h"
+
+#include "uint256.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+/** Compact identifier of an address: the version byte, followed by the hash160.
+ */
+struct CAddressKey
+{
+    static const size_t SIZE = 21;
+
+    unsigned char data[SIZE];
+
+    bool operator==(const CAddressKey& other) const;
+    bool operator!=(const CAddressKey& other) const { return !operator==(other); }
+
+    /**
+     * Converts a base58 encoded address into its compact identifier.
+     *
+     * @return True, if the address is the canonical encoding of a version and hash160
+     */
+    static bool FromString(const std::string& address, CAddressKey& key);
+
+    /** Returns the base58 encoded address. */
+    std::string ToString() const;
+};
+
+/** Balance records of all addresses.
+ *
+ * Addresses are interned by their compact 21 byte identifier, and the tallies are
+ * located via an open-addressing hash table with linear probing, which is salted
+ * to avoid predictable collisions. Strings, which are not canonical base58 encoded
+ * addresses, are supported as well, but kept separately.
+ *
+ * References to tallies remain valid, until the address is erased, or the map is
+ * cleared. The map can be iterated in the order of the addresses, which is used
+ * wherever consensus depends on it, or in no particular order, which is faster.
+ */
+class CMPTallyMap
+{
+public:
+    //! Number of bytes of the checksum of an address
+    static const size_t CHECKSUM_SIZE = 4;
+
+private:
+    //! Marker of an empty slot of the hash table
+    static const uint32_t NO_ENTRY = 0xFFFFFFFF;
+
+    /** An address with its balance records. */
+    struct Entry
+    {
+        //! The compact identifier, or the position of the raw address
+        CAddressKey key;
+        //! The checksum of the address, so lookups don't need to hash the identifier
+        unsigned char checksum[CHECKSUM_SIZE];
+        //! Whether the entry is in use, or on the free list
+        bool fUsed;
+        //! Whether the address is raw, and not a compact identifier
+        bool fRaw;
+        //! The first characters of the address, to order the addresses quickly
+        uint64_t nOrderPrefix;
+        //! The balance records of the address
+        CMPTally tally;
+    };
+
+    //! Entries, which are never moved, so references to the tallies remain valid
+    std::deque<Entry> vEntries;
+    //! Positions of entries, which are unused
+    std::vector<uint32_t> vFree;
+    //! Hash table of the positions of entries with compact identifiers
+    std::vector<uint32_t> vSlots;
+    //! Number of entries in the hash table
+    size_t nSlotsUsed;
+    //! Number of entries in use
+    size_t nSize;
+    //! Salt of the hash function
+    uint256 salt;
+
+    //! Addresses, which are not canonical base58 encoded addresses
+    std::vector<std::string> vRawAddresses;
+    //! Positions of raw addresses, which are unused
+    std::vector<uint32_t> vFreeRaw;
+    //! Positions of entries by raw address
+    std::map<std::string, uint32_t> mapRawEntries;
+
+    //! Positions of the entries ordered by address; rebuilt on demand
+    std::vector<uint32_t> vOrdered;
+    //! Positions of entries, which were inserted after the order was built
+    std::vector<uint32_t> vUnordered;
+    //! Whether an entry was erased after the order was built
+    bool fOrderStale;
+
+    size_t hashKey(const CAddressKey& key) const;
+    uint32_t findSlot(const CAddressKey& key) const;
+    void insertSlot(uint32_t nEntry);
+    void eraseSlot(uint32_t nSlot);
+    void resizeSlots(size_t nNewSize);
+
+    uint32_t findEntry(const std::string& address) const;
+    uint32_t allocateEntry();
+    std::string getAddress(uint32_t nEntry) const;
+    bool lessByAddress(uint32_t nLeft, uint32_t nRight) const;
+    const std::vector<uint32_t>& getOrder();
+
+public:
+    /** Iterates over the addresses and their tallies. */
+    class iterator
+    {
+    private:
+        CMPTallyMap* pMap;
+        //! Positions of entries in the order to iterate, or NULL, to iterate all entries
+        const std::vector<uint32_t>* pOrder;
+        size_t nPos;
+
+        uint32_t entry() const { return pOrder ? (*pOrder)[nPos] : nPos; }
+        void skipUnused();
+
+    public:
+        iterator(CMPTallyMap* pMapIn, const std::vector<uint32_t>* pOrderIn, size_t nPosIn);
+
+        /** Returns the address. */
+        std::string getAddress() const { return pMap->getAddress(entry()); }
+        /** Returns the tally of the address. */
+        CMPTally& getTally() const { return pMap->vEntries[entry()].tally; }
+
+        iterator& operator++();
+        bool operator==(const iterator& other) const { return nPos == other.nPos && pOrder == other.pOrder; }
+        bool operator!=(const iterator& other) const { return !operator==(other); }
+    };
+
+    CMPTallyMap();
+
+    /** Returns the number of addresses. */
+    size_t size() const { return nSize; }
+
+    /** Returns the tally of an address, or NULL, if there is none. */
+    CMPTally* find(const std::string& address);
+    const CMPTally* find(const std::string& address) const;
+
+    /** Returns the tally of an address, which is inserted, if there is none. */
+    CMPTally& operator[](const std::string& address);
+
+    /** Removes an address and its tally, and returns true, if it was found. */
+    bool erase(const std::string& address);
+
+    /** Removes all addresses. */
+    void clear();
+
+    /** Iterates over the addresses in ascending order. */
+    iterator begin();
+    iterator end();
+
+    /** Iterates over the addresses in no particular order. */
+    iterator unorderedBegin();
+    iterator unorderedEnd();
+
+    /** Returns the approximate number of bytes allocated on the heap. */
+    size_t DynamicMemoryUsage() const;
+};
+
+
+#endif // OMNICORE_TALLYMAP_H
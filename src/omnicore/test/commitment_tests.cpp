@@ -0,0 +1,113 @@
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/consensushash.h"
+#include "omnicore/mdex.h"
+#include "omnicore/omnicore.h"
+#include "omnicore/tally.h"
+
+#include "sync.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_commitment_tests, StateTestingSetup)
+
+BOOST_AUTO_TEST_CASE(commitment_order_independent)
+{
+    LOCK(cs_tally);
+
+    BOOST_CHECK(update_tally_map("1Alice", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("1Bob", 3, 50, SELLOFFER_RESERVE));
+    BOOST_CHECK(update_tally_map("1Carol", 4, 7, BALANCE));
+    uint256 commitment = GetStateCommitment();
+
+    ClearTallyMap();
+    BOOST_CHECK(commitment != GetStateCommitment());
+
+    BOOST_CHECK(update_tally_map("1Carol", 4, 7, BALANCE));
+    BOOST_CHECK(update_tally_map("1Bob", 3, 50, SELLOFFER_RESERVE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, 100, BALANCE));
+    BOOST_CHECK_EQUAL(commitment.GetHex(), GetStateCommitment().GetHex());
+
+    // pending amounts are not part of the state
+    BOOST_CHECK(update_tally_map("1Alice", 3, -20, PENDING));
+    BOOST_CHECK_EQUAL(commitment.GetHex(), GetStateCommitment().GetHex());
+}
+
+BOOST_AUTO_TEST_CASE(commitment_reverted_changes)
+{
+    LOCK(cs_tally);
+
+    uint256 emptyCommitment = GetStateCommitment();
+
+    BOOST_CHECK(update_tally_map("1Alice", 3, 100, BALANCE));
+    uint256 commitment = GetStateCommitment();
+    BOOST_CHECK(commitment != emptyCommitment);
+
+    // several changes of the same record between two commitments
+    BOOST_CHECK(update_tally_map("1Alice", 3, -60, BALANCE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, 60, METADEX_RESERVE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, -60, METADEX_RESERVE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, 60, BALANCE));
+    BOOST_CHECK_EQUAL(commitment.GetHex(), GetStateCommitment().GetHex());
+
+    BOOST_CHECK_EQUAL(0, AddOrder("1Bob", 3, 50, 4, 100, 400000, 1));
+    uint256 orderCommitment = GetStateCommitment();
+    BOOST_CHECK(orderCommitment != commitment);
+
+    BOOST_CHECK_EQUAL(0, MetaDEx_CANCEL_EVERYTHING(uint256(2), 400001, "1Bob", 1));
+    BOOST_CHECK(update_tally_map("1Bob", 3, -50, BALANCE));
+    BOOST_CHECK_EQUAL(commitment.GetHex(), GetStateCommitment().GetHex());
+
+    BOOST_CHECK(update_tally_map("1Alice", 3, -100, BALANCE));
+    BOOST_CHECK_EQUAL(emptyCommitment.GetHex(), GetStateCommitment().GetHex());
+}
+
+BOOST_AUTO_TEST_CASE(commitment_randomized_differential)
+{
+    LOCK(cs_tally);
+
+    SeedRandomUpdates();
+
+    for (int n = 0; n < 5000; ++n) {
+        ApplyRandomTallyUpdate();
+
+        // the pending changes are folded in at the end of every block
+        if (n % 100 == 50) UpdateStateCommitment();
+
+        if (n % 500 != 0) continue;
+
+        uint256 commitment = GetStateCommitment();
+
+        // rebuild the same balances from scratch
+        std::vector<std::pair<std::string, CMPTally> > vTallies;
+        for (CMPTallyMap::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+            vTallies.push_back(std::make_pair(it.getAddress(), it.getTally()));
+        }
+        ClearTallyMap();
+        for (size_t i = 0; i < vTallies.size(); ++i) {
+            CMPTally& tally = vTallies[i].second;
+            tally.init();
+            uint32_t id = 0;
+            while (0 != (id = tally.next())) {
+                for (int t = 0; t < TALLY_TYPE_COUNT; ++t) {
+                    int64_t money = tally.getMoney(id, TallyType(t));
+                    if (money != 0) BOOST_CHECK(update_tally_map(vTallies[i].first, id, money, TallyType(t)));
+                }
+            }
+        }
+
+        BOOST_CHECK_EQUAL(commitment.GetHex(), GetStateCommitment().GetHex());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,175 @@
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/omnicore.h"
+#include "omnicore/sto.h"
+#include "omnicore/tally.h"
+#include "omnicore/uint256_extensions.h"
+
+#include "random.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+/** Determines the total balance of each holder of a property by scanning all addresses. */
+static HolderMap ScanHolders(uint32_t propertyId)
+{
+    HolderMap holders;
+
+    for (CMPTallyMap::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+        const CMPTally& tally = it.getTally();
+
+        int64_t tokens = 0;
+        tokens += tally.getMoney(propertyId, BALANCE);
+        tokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
+        tokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
+        tokens += tally.getMoney(propertyId, METADEX_RESERVE);
+
+        if (tokens != 0) {
+            holders.insert(std::make_pair(it.getAddress(), tokens));
+        }
+    }
+
+    return holders;
+}
+
+/** Determines the receivers of a send to owners by scanning all addresses. */
+static OwnerAddrType ScanReceivers(const std::string& sender, uint32_t propertyId, int64_t amount)
+{
+    int64_t totalTokens = 0;
+    OwnerAddrType ownerAddrSet;
+
+    for (CMPTallyMap::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+        const std::string address = it.getAddress();
+        const CMPTally& tally = it.getTally();
+
+        int64_t tokens = 0;
+        tokens += tally.getMoney(propertyId, BALANCE);
+        tokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
+        tokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
+        tokens += tally.getMoney(propertyId, METADEX_RESERVE);
+
+        if (address == sender) continue;
+
+        totalTokens += tokens;
+        if (0 < tokens) ownerAddrSet.insert(std::make_pair(tokens, address));
+    }
+
+    int64_t sent_so_far = 0;
+    OwnerAddrType receiversSet;
+
+    for (OwnerAddrType::reverse_iterator it = ownerAddrSet.rbegin(); it != ownerAddrSet.rend(); ++it) {
+        uint256 temp = ConvertTo256(it->first) * ConvertTo256(amount);
+        int64_t should_receive = ConvertTo64(DivideAndRoundUp(temp, ConvertTo256(totalTokens)));
+        int64_t will_really_receive = std::min(should_receive, amount - sent_so_far);
+
+        sent_so_far += will_really_receive;
+        if (will_really_receive <= 0) break;
+        receiversSet.insert(std::make_pair(will_really_receive, it->second));
+    }
+
+    return receiversSet;
+}
+
+/** Returns the holders of a property according to the holder index. */
+static HolderMap IndexedHolders(uint32_t propertyId)
+{
+    std::map<uint32_t, HolderMap>::const_iterator it = mp_property_holders.find(propertyId);
+    if (it == mp_property_holders.end()) {
+        return HolderMap();
+    }
+    return it->second;
+}
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_holders_tests, StateTestingSetup)
+
+BOOST_AUTO_TEST_CASE(holders_updated)
+{
+    LOCK(cs_tally);
+
+    BOOST_CHECK(update_tally_map("1Alice", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, 50, METADEX_RESERVE));
+    BOOST_CHECK(update_tally_map("1Bob", 3, -20, PENDING));
+    BOOST_CHECK(!update_tally_map("1Bob", 3, -20, BALANCE));
+
+    HolderMap holders = IndexedHolders(3);
+    BOOST_CHECK_EQUAL(1U, holders.size());
+    BOOST_CHECK_EQUAL(150, holders["1Alice"]);
+
+    BOOST_CHECK(update_tally_map("1Alice", 3, -100, BALANCE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, -50, METADEX_RESERVE));
+    BOOST_CHECK(mp_property_holders.find(3) == mp_property_holders.end());
+}
+
+BOOST_AUTO_TEST_CASE(holders_randomized_differential)
+{
+    LOCK(cs_tally);
+
+    SeedRandomUpdates();
+
+    for (int n = 0; n < 20000; ++n) {
+        ApplyRandomTallyUpdate();
+
+        if (n % 1000 != 0) continue;
+
+        for (int i = 0; i < NUM_RANDOM_PROPERTIES; ++i) {
+            uint32_t propertyId = RANDOM_PROPERTIES[i];
+            BOOST_CHECK(IndexedHolders(propertyId) == ScanHolders(propertyId));
+
+            std::string sender = GetRandomAddress();
+            int64_t amountToSend = 1 + insecure_rand() % 100000;
+            BOOST_CHECK(STO_GetReceivers(sender, propertyId, amountToSend) == ScanReceivers(sender, propertyId, amountToSend));
+        }
+
+        int64_t owners = 0;
+        getTotalTokens(1, &owners);
+        BOOST_CHECK_EQUAL(ScanHolders(1).size(), (size_t) owners);
+        BOOST_CHECK(VerifyPropertySupply());
+
+        int64_t scannedTokens = 0;
+        HolderMap holders = ScanHolders(2);
+        for (HolderMap::const_iterator it = holders.begin(); it != holders.end(); ++it) {
+            scannedTokens += it->second;
+        }
+        int64_t totalTokens = getPropertySupply(2, BALANCE) + getPropertySupply(2, SELLOFFER_RESERVE)
+                + getPropertySupply(2, ACCEPT_RESERVE) + getPropertySupply(2, METADEX_RESERVE);
+        BOOST_CHECK_EQUAL(scannedTokens, totalTokens);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(supply_by_tally_type)
+{
+    LOCK(cs_tally);
+
+    BOOST_CHECK(update_tally_map("1Alice", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, 30, SELLOFFER_RESERVE));
+    BOOST_CHECK(update_tally_map("1Bob", 3, 50, BALANCE));
+    BOOST_CHECK(update_tally_map("1Bob", 3, 20, METADEX_RESERVE));
+    BOOST_CHECK(update_tally_map("1Bob", 3, -10, PENDING));
+    BOOST_CHECK(update_tally_map("1Carol", 4, 7, ACCEPT_RESERVE));
+
+    BOOST_CHECK_EQUAL(150, getPropertySupply(3, BALANCE));
+    BOOST_CHECK_EQUAL(30, getPropertySupply(3, SELLOFFER_RESERVE));
+    BOOST_CHECK_EQUAL(0, getPropertySupply(3, ACCEPT_RESERVE));
+    BOOST_CHECK_EQUAL(0, getPropertySupply(3, PENDING));
+    BOOST_CHECK_EQUAL(20, getPropertySupply(3, METADEX_RESERVE));
+    BOOST_CHECK_EQUAL(7, getPropertySupply(4, ACCEPT_RESERVE));
+    BOOST_CHECK_EQUAL(0, getPropertySupply(5, BALANCE));
+
+    BOOST_CHECK(update_tally_map("1Alice", 3, -30, SELLOFFER_RESERVE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, 30, BALANCE));
+    BOOST_CHECK_EQUAL(180, getPropertySupply(3, BALANCE));
+    BOOST_CHECK_EQUAL(0, getPropertySupply(3, SELLOFFER_RESERVE));
+    BOOST_CHECK(VerifyPropertySupply());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
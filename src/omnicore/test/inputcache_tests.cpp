@@ -0,0 +1,95 @@
+#include "omnicore/inputcache.h"
+
+#include "primitives/transaction.h"
+#include "script/script.h"
+#include "uint256.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_AUTO_TEST_SUITE(omnicore_inputcache_tests)
+
+/** Creates an output with a script of the given size. */
+static CTxOut CreateOutput(int64_t nValue, size_t nScriptSize)
+{
+    CTxOut txOut;
+    txOut.nValue = nValue;
+    txOut.scriptPubKey.resize(nScriptSize, OP_NOP);
+    return txOut;
+}
+
+BOOST_AUTO_TEST_CASE(inputcache_get_put)
+{
+    CInputCache cache(1 << 20);
+    COutPoint outpoint(uint256(1), 2);
+    CTxOut txOut;
+
+    BOOST_CHECK(!cache.Get(outpoint, txOut));
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 1U);
+
+    cache.Put(outpoint, CreateOutput(5000, 25));
+    BOOST_CHECK_EQUAL(cache.GetSize(), 1U);
+    BOOST_CHECK(cache.GetUsage() > 0);
+
+    BOOST_CHECK(cache.Get(outpoint, txOut));
+    BOOST_CHECK_EQUAL(txOut.nValue, 5000);
+    BOOST_CHECK_EQUAL(txOut.scriptPubKey.size(), 25U);
+    BOOST_CHECK_EQUAL(cache.GetHits(), 1U);
+
+    // other outputs of the same transaction are not cached
+    BOOST_CHECK(!cache.Get(COutPoint(uint256(1), 3), txOut));
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 2U);
+
+    // replacing an output doesn't add a new entry
+    size_t nUsage = cache.GetUsage();
+    cache.Put(outpoint, CreateOutput(7000, 25));
+    BOOST_CHECK_EQUAL(cache.GetSize(), 1U);
+    BOOST_CHECK_EQUAL(cache.GetUsage(), nUsage);
+    BOOST_CHECK(cache.Get(outpoint, txOut));
+    BOOST_CHECK_EQUAL(txOut.nValue, 7000);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.GetSize(), 0U);
+    BOOST_CHECK_EQUAL(cache.GetUsage(), 0U);
+    BOOST_CHECK(!cache.Get(outpoint, txOut));
+    BOOST_CHECK_EQUAL(cache.GetEvictions(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(inputcache_eviction)
+{
+    CInputCache cache(1 << 20);
+    cache.Put(COutPoint(uint256(1), 0), CreateOutput(1, 25));
+    size_t nEntryUsage = cache.GetUsage();
+
+    // limit the cache to three outputs
+    cache.SetMaxUsage(3 * nEntryUsage);
+    cache.Put(COutPoint(uint256(2), 0), CreateOutput(2, 25));
+    cache.Put(COutPoint(uint256(3), 0), CreateOutput(3, 25));
+    BOOST_CHECK_EQUAL(cache.GetSize(), 3U);
+
+    // the first output was used recently, so the second one is evicted
+    CTxOut txOut;
+    BOOST_CHECK(cache.Get(COutPoint(uint256(1), 0), txOut));
+    cache.Put(COutPoint(uint256(4), 0), CreateOutput(4, 25));
+    BOOST_CHECK_EQUAL(cache.GetSize(), 3U);
+    BOOST_CHECK_EQUAL(cache.GetEvictions(), 1U);
+    BOOST_CHECK(cache.GetUsage() <= 3 * nEntryUsage);
+
+    BOOST_CHECK(cache.Get(COutPoint(uint256(1), 0), txOut));
+    BOOST_CHECK(!cache.Get(COutPoint(uint256(2), 0), txOut));
+    BOOST_CHECK(cache.Get(COutPoint(uint256(3), 0), txOut));
+    BOOST_CHECK(cache.Get(COutPoint(uint256(4), 0), txOut));
+
+    // shrinking the limit evicts the least recently used outputs
+    cache.SetMaxUsage(nEntryUsage);
+    BOOST_CHECK_EQUAL(cache.GetSize(), 1U);
+    BOOST_CHECK_EQUAL(cache.GetEvictions(), 3U);
+    BOOST_CHECK(cache.Get(COutPoint(uint256(4), 0), txOut));
+    BOOST_CHECK_EQUAL(txOut.nValue, 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -311,4 +311,21 @@ BOOST_AUTO_TEST_CASE(class_class_c)
 }
 
 
+BOOST_AUTO_TEST_CASE(class_class_c_given_params)
+{
+    int nBlock = ConsensusParams().NULLDATA_BLOCK;
+
+    CMutableTransaction mutableTx;
+    mutableTx.vout.push_back(OpReturn_PlainMarker());
+    CTransaction tx(mutableTx);
+
+    // a copy of the parameters, where Class C is activated one block later
+    CConsensusParams params(ConsensusParams());
+    params.NULLDATA_BLOCK = nBlock + 1;
+
+    BOOST_CHECK_EQUAL(GetEncodingClass(tx, nBlock, params), NO_MARKER);
+    BOOST_CHECK_EQUAL(GetEncodingClass(tx, nBlock + 1, params), OMNI_CLASS_C);
+    BOOST_CHECK_EQUAL(GetEncodingClass(tx, nBlock), OMNI_CLASS_C);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
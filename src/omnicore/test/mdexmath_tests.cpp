@@ -0,0 +1,159 @@
+#include "omnicore/mdex.h"
+#include "omnicore/mdexmath.h"
+#include "omnicore/uint256_extensions.h"
+
+#include "random.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_AUTO_TEST_SUITE(omnicore_mdexmath_tests)
+
+/** Returns the unit price as calculated by CMPMetaDEx::unitPrice(). */
+static rational_t RationalPrice(int64_t num, int64_t denom)
+{
+    return (denom != 0) ? rational_t(num, denom) : rational_t(0);
+}
+
+/** Returns a random positive amount, with a random number of significant bits. */
+static int64_t RandomAmount()
+{
+    uint64_t value = (static_cast<uint64_t>(insecure_rand()) << 32) | insecure_rand();
+    value = (value >> 1) >> (insecure_rand() % 63);
+    return (value > 0) ? static_cast<int64_t>(value) : 1;
+}
+
+/** Checks the fill kernels against the calculation with uint256. */
+static void CheckKernels(int64_t a, int64_t b, int64_t c)
+{
+    uint256 product = ConvertTo256(a) * ConvertTo256(b);
+    uint256 expectedFloor = product / ConvertTo256(c);
+
+    int64_t result = 0;
+    bool fInRange = MultiplyAndDivide(a, b, c, result);
+    BOOST_CHECK_EQUAL(fInRange, expectedFloor <= uint256_const::max_int64);
+    if (fInRange) BOOST_CHECK_EQUAL(result, ConvertTo64(expectedFloor));
+
+    if (product == 0) {
+        BOOST_CHECK(MultiplyAndDivideRoundUp(a, b, c, result));
+        BOOST_CHECK_EQUAL(result, 0);
+        return;
+    }
+
+    uint256 expectedCeil = DivideAndRoundUp(product, ConvertTo256(c));
+    fInRange = MultiplyAndDivideRoundUp(a, b, c, result);
+    BOOST_CHECK_EQUAL(fInRange, expectedCeil <= uint256_const::max_int64);
+    if (fInRange) BOOST_CHECK_EQUAL(result, ConvertTo64(expectedCeil));
+}
+
+/** Checks the price comparisons against the comparisons of rational_t. */
+static void CheckPrices(int64_t numA, int64_t denomA, int64_t numB, int64_t denomB)
+{
+    md_Price a(numA, denomA);
+    md_Price b(numB, denomB);
+    rational_t x = RationalPrice(numA, denomA);
+    rational_t y = RationalPrice(numB, denomB);
+
+    BOOST_CHECK_EQUAL(a == b, x == y);
+    BOOST_CHECK_EQUAL(a != b, x != y);
+    BOOST_CHECK_EQUAL(a < b, x < y);
+    BOOST_CHECK_EQUAL(a > b, x > y);
+    BOOST_CHECK_EQUAL(a <= b, x <= y);
+    BOOST_CHECK_EQUAL(a >= b, x >= y);
+}
+
+BOOST_AUTO_TEST_CASE(kernels_exhaustive)
+{
+    for (int64_t a = 0; a <= 16; ++a) {
+        for (int64_t b = 0; b <= 16; ++b) {
+            for (int64_t c = 1; c <= 16; ++c) {
+                CheckKernels(a, b, c);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(kernels_limits)
+{
+    const int64_t nMax = std::numeric_limits<int64_t>::max();
+
+    CheckKernels(nMax, nMax, nMax);
+    CheckKernels(nMax, nMax, 1);
+    CheckKernels(nMax, 2, 2);
+    CheckKernels(nMax, 2, 3);
+    CheckKernels(nMax - 1, nMax, nMax);
+    CheckKernels(nMax, 1, nMax - 1);
+
+    int64_t result = 0;
+    BOOST_CHECK(!MultiplyAndDivide(nMax, 2, 1, result));
+    BOOST_CHECK(MultiplyAndDivide(nMax, nMax, nMax, result));
+    BOOST_CHECK_EQUAL(result, nMax);
+    BOOST_CHECK(!MultiplyAndDivideRoundUp(nMax, nMax - 1, nMax - 2, result));
+    BOOST_CHECK(MultiplyAndDivideRoundUp(nMax - 1, nMax, nMax, result));
+    BOOST_CHECK_EQUAL(result, nMax - 1);
+}
+
+BOOST_AUTO_TEST_CASE(kernels_randomized)
+{
+    seed_insecure_rand(true);
+
+    for (int n = 0; n < 100000; ++n) {
+        CheckKernels(RandomAmount(), RandomAmount(), RandomAmount());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(prices_exhaustive)
+{
+    for (int64_t numA = 0; numA <= 12; ++numA) {
+        for (int64_t denomA = 0; denomA <= 12; ++denomA) {
+            for (int64_t numB = 0; numB <= 12; ++numB) {
+                for (int64_t denomB = 0; denomB <= 12; ++denomB) {
+                    CheckPrices(numA, denomA, numB, denomB);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(prices_randomized)
+{
+    seed_insecure_rand(true);
+
+    const int64_t nMax = std::numeric_limits<int64_t>::max();
+    CheckPrices(nMax, nMax - 1, nMax - 1, nMax - 2);
+    CheckPrices(nMax, 1, nMax - 1, 1);
+    CheckPrices(1, nMax, 1, nMax - 1);
+
+    for (int n = 0; n < 100000; ++n) {
+        int64_t numA = RandomAmount();
+        int64_t denomA = RandomAmount();
+        CheckPrices(numA, denomA, RandomAmount(), RandomAmount());
+
+        // equal prices with different amounts
+        int64_t nFactor = 1 + insecure_rand() % 1000;
+        if (numA <= nMax / nFactor && denomA <= nMax / nFactor) {
+            CheckPrices(numA, denomA, numA * nFactor, denomA * nFactor);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(prices_of_orders)
+{
+    CMPMetaDEx order("1Alice", 0, 3, 300, 5, 100, 0, 0, 0);
+    BOOST_CHECK(order.fixedUnitPrice() == md_Price(1, 3));
+    BOOST_CHECK(order.fixedInversePrice() == md_Price(3, 1));
+    BOOST_CHECK(order.fixedUnitPrice() < order.fixedInversePrice());
+
+    // equal to the normalized prices
+    CMPMetaDEx other("1Bob", 0, 3, 3, 5, 1, 0, 0, 0);
+    BOOST_CHECK(order.fixedUnitPrice() == other.fixedUnitPrice());
+    BOOST_CHECK(order.unitPrice() == other.unitPrice());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
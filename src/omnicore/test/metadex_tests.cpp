@@ -0,0 +1,255 @@
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/mdex.h"
+#include "omnicore/omnicore.h"
+#include "omnicore/tally.h"
+#include "omnicore/tx.h"
+
+#include "sync.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+/** Returns the number of open orders in the market. */
+static size_t CountOrders(uint32_t propertyForSale, uint32_t propertyDesired)
+{
+    size_t count = 0;
+    md_PricesMap* prices = get_Prices(propertyForSale, propertyDesired);
+    if (prices) {
+        for (md_PricesMap::const_iterator it = prices->begin(); it != prices->end(); ++it) {
+            count += it->second.size();
+        }
+    }
+    return count;
+}
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_metadex_tests, StateTestingSetup)
+
+BOOST_AUTO_TEST_CASE(orders_keyed_by_pair)
+{
+    LOCK(cs_tally);
+
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 100, 10, 1));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 7, 200, 10, 2));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Bob", 5, 100, 7, 300, 10, 3));
+
+    BOOST_CHECK_EQUAL(3U, metadex.size());
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 5));
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 7));
+    BOOST_CHECK_EQUAL(1U, CountOrders(5, 7));
+    BOOST_CHECK(get_Prices(5, 3) == NULL);
+    BOOST_CHECK(get_Prices(7, 3) == NULL);
+
+    BOOST_CHECK(MetaDEx_isOpen(uint256(10) << 32 | uint256(2), 3));
+    BOOST_CHECK(!MetaDEx_isOpen(uint256(10) << 32 | uint256(2), 5));
+    BOOST_CHECK_EQUAL(200, getMPbalance("1Alice", 3, METADEX_RESERVE));
+}
+
+BOOST_AUTO_TEST_CASE(match_other_desired_property_ignored)
+{
+    LOCK(cs_tally);
+
+    // Alice sells property 3 for property 7, which is not offered by Bob
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 7, 100, 10, 1));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Bob", 5, 100, 3, 100, 10, 2));
+
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 7));
+    BOOST_CHECK_EQUAL(1U, CountOrders(5, 3));
+    BOOST_CHECK_EQUAL(0, getMPbalance("1Bob", 3, BALANCE));
+    BOOST_CHECK_EQUAL(0, getMPbalance("1Alice", 5, BALANCE));
+}
+
+BOOST_AUTO_TEST_CASE(match_lowest_price_first)
+{
+    LOCK(cs_tally);
+
+    // sell offers for property 3 at unit prices 1, 2 and 4
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 400, 10, 1));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Carol", 3, 100, 5, 100, 10, 2));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Dave", 3, 100, 5, 200, 10, 3));
+
+    // Bob pays at most 2 units of property 5 per unit of property 3
+    BOOST_CHECK_EQUAL(0, AddOrder("1Bob", 5, 400, 3, 200, 11, 1));
+
+    // the offers of Carol and Dave were filled, Alice's price was never reached
+    BOOST_CHECK_EQUAL(200, getMPbalance("1Bob", 3, BALANCE));
+    BOOST_CHECK_EQUAL(100, getMPbalance("1Carol", 5, BALANCE));
+    BOOST_CHECK_EQUAL(200, getMPbalance("1Dave", 5, BALANCE));
+    BOOST_CHECK_EQUAL(0, getMPbalance("1Alice", 5, BALANCE));
+    BOOST_CHECK_EQUAL(100, getMPbalance("1Alice", 3, METADEX_RESERVE));
+
+    // the remainder of Bob's order was added to the book
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 5));
+    BOOST_CHECK_EQUAL(1U, CountOrders(5, 3));
+    BOOST_CHECK_EQUAL(100, getMPbalance("1Bob", 5, METADEX_RESERVE));
+
+    // filled price levels are removed
+    md_PricesMap* prices = get_Prices(3, 5);
+    BOOST_REQUIRE(prices != NULL);
+    BOOST_CHECK_EQUAL(1U, prices->size());
+    BOOST_CHECK(prices->begin()->first == rational_t(4, 1));
+}
+
+BOOST_AUTO_TEST_CASE(cancel_everything_all_markets)
+{
+    LOCK(cs_tally);
+
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 7, 300, 10, 1));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 100, 10, 2));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 5, 100, 7, 100, 10, 3));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Bob", 3, 100, 5, 200, 10, 4));
+
+    uint256 txid = uint256(11) << 32;
+    BOOST_CHECK_EQUAL(0, MetaDEx_CANCEL_EVERYTHING(txid, 11, "1Alice", 1));
+
+    BOOST_CHECK_EQUAL(3, p_txlistdb->getNumberOfMetaDExCancels(txid));
+    BOOST_CHECK_EQUAL(0U, CountOrders(3, 7));
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 5));
+    BOOST_CHECK_EQUAL(0U, CountOrders(5, 7));
+    BOOST_CHECK_EQUAL(200, getMPbalance("1Alice", 3, BALANCE));
+    BOOST_CHECK_EQUAL(100, getMPbalance("1Alice", 5, BALANCE));
+    BOOST_CHECK_EQUAL(0, getMPbalance("1Alice", 3, METADEX_RESERVE));
+    BOOST_CHECK_EQUAL(100, getMPbalance("1Bob", 3, METADEX_RESERVE));
+
+    // markets without orders are removed
+    BOOST_CHECK_EQUAL(1U, metadex.size());
+    BOOST_CHECK(get_Prices(3, 7) == NULL);
+    BOOST_CHECK(get_Prices(5, 7) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(cancel_only_own_orders)
+{
+    LOCK(cs_tally);
+
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 100, 20, 1));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Bob", 3, 100, 5, 100, 20, 2));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 200, 20, 3));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 100, 20, 4));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 7, 100, 20, 5));
+
+    // only Alice's orders at the given price are cancelled
+    uint256 txidPrice = uint256(21) << 32;
+    BOOST_CHECK_EQUAL(0, MetaDEx_CANCEL_AT_PRICE(txidPrice, 21, "1Alice", 3, 100, 5, 100));
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getNumberOfMetaDExCancels(txidPrice));
+    BOOST_CHECK_EQUAL(2U, CountOrders(3, 5));
+    BOOST_CHECK(MetaDEx_isOpen(uint256(20) << 32 | uint256(2)));
+    BOOST_CHECK(MetaDEx_isOpen(uint256(20) << 32 | uint256(3)));
+
+    // no open orders of Carol
+    BOOST_CHECK(MetaDEx_CANCEL_AT_PRICE(uint256(22) << 32, 22, "1Carol", 3, 100, 5, 100) != 0);
+    BOOST_CHECK(MetaDEx_CANCEL_ALL_FOR_PAIR(uint256(22) << 32, 22, "1Carol", 3, 5) != 0);
+
+    // Alice's remaining order of the pair is cancelled, other markets are untouched
+    uint256 txidPair = uint256(23) << 32;
+    BOOST_CHECK_EQUAL(0, MetaDEx_CANCEL_ALL_FOR_PAIR(txidPair, 23, "1Alice", 3, 5));
+    BOOST_CHECK_EQUAL(1, p_txlistdb->getNumberOfMetaDExCancels(txidPair));
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 5));
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 7));
+    BOOST_CHECK_EQUAL(100, getMPbalance("1Alice", 3, METADEX_RESERVE));
+    BOOST_CHECK_EQUAL(300, getMPbalance("1Alice", 3, BALANCE));
+    BOOST_CHECK_EQUAL(100, getMPbalance("1Bob", 3, METADEX_RESERVE));
+
+    // the price level of Alice's cancelled order is removed
+    md_PricesMap* prices = get_Prices(3, 5);
+    BOOST_REQUIRE(prices != NULL);
+    BOOST_CHECK_EQUAL(1U, prices->size());
+}
+
+BOOST_AUTO_TEST_CASE(retrieve_open_orders)
+{
+    LOCK(cs_tally);
+
+    uint256 txidAlice = uint256(10) << 32 | uint256(1);
+    uint256 txidCarol = uint256(10) << 32 | uint256(2);
+    uint256 txidBob = uint256(11) << 32 | uint256(1);
+
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 100, 10, 1));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Carol", 3, 100, 5, 200, 10, 2));
+    BOOST_CHECK(MetaDEx_isOpen(txidAlice));
+    BOOST_CHECK(MetaDEx_isOpen(txidCarol, 3));
+    BOOST_CHECK(!MetaDEx_isOpen(txidCarol, 5));
+
+    // Bob fills Alice's order, and Carol's order partially
+    BOOST_CHECK_EQUAL(0, AddOrder("1Bob", 5, 200, 3, 100, 11, 1));
+    BOOST_CHECK(!MetaDEx_isOpen(txidAlice));
+    BOOST_CHECK(MetaDEx_RetrieveTrade(txidAlice) == NULL);
+    BOOST_CHECK(!MetaDEx_isOpen(txidBob));
+
+    const CMPMetaDEx* pOrder = MetaDEx_RetrieveTrade(txidCarol);
+    BOOST_REQUIRE(pOrder != NULL);
+    BOOST_CHECK(pOrder->getHash() == txidCarol);
+    BOOST_CHECK_EQUAL(50, pOrder->getAmountRemaining());
+    BOOST_CHECK_EQUAL("1Carol", pOrder->getAddr());
+
+    // cancelled orders are no longer open
+    uint256 txidCancel = uint256(12) << 32;
+    BOOST_CHECK_EQUAL(0, MetaDEx_CANCEL_AT_PRICE(txidCancel, 12, "1Carol", 3, 100, 5, 200));
+    BOOST_CHECK(!MetaDEx_isOpen(txidCarol));
+    BOOST_CHECK(MetaDEx_RetrieveTrade(txidCarol) == NULL);
+
+    BOOST_CHECK_EQUAL(0, AddOrder("1Dave", 3, 100, 7, 100, 12, 1));
+    BOOST_CHECK(MetaDEx_isOpen(uint256(12) << 32 | uint256(1)));
+    MetaDEx_CLEAR();
+    BOOST_CHECK(!MetaDEx_isOpen(uint256(12) << 32 | uint256(1)));
+}
+
+BOOST_AUTO_TEST_CASE(duplicate_insert_rejected)
+{
+    LOCK(cs_tally);
+
+    uint256 txid = uint256(20) << 32 | uint256(1);
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 100, 20, 1));
+
+    const CMPMetaDEx* pOrder = MetaDEx_RetrieveTrade(txid);
+    BOOST_REQUIRE(pOrder != NULL);
+    CMPMetaDEx order(*pOrder);
+    BOOST_CHECK(!MetaDEx_INSERT(order));
+
+    BOOST_CHECK_EQUAL(1U, metadex.size());
+    BOOST_CHECK_EQUAL(1U, get_Prices(3, 5)->size());
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 5));
+    BOOST_CHECK_EQUAL(1U, MetaDEx_getIndexSize());
+}
+
+BOOST_AUTO_TEST_CASE(set_market_removes_orders)
+{
+    LOCK(cs_tally);
+
+    uint256 txidFirst = uint256(30) << 32 | uint256(1);
+    uint256 txidSecond = uint256(30) << 32 | uint256(2);
+
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 100, 30, 1));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 200, 30, 2));
+    BOOST_CHECK_EQUAL(2U, MetaDEx_getIndexSize());
+
+    // a persisted delta of the market, which no longer has the first order
+    const CMPMetaDEx* pSecond = MetaDEx_RetrieveTrade(txidSecond);
+    BOOST_REQUIRE(pSecond != NULL);
+    std::vector<CMPMetaDEx> orders(1, *pSecond);
+    BOOST_CHECK(MetaDEx_SET_MARKET(std::make_pair(3, 5), orders));
+    BOOST_CHECK_EQUAL(1U, MetaDEx_getIndexSize());
+    BOOST_CHECK_EQUAL(1U, CountOrders(3, 5));
+    BOOST_CHECK(!MetaDEx_isOpen(txidFirst));
+    BOOST_CHECK(MetaDEx_RetrieveTrade(txidFirst) == NULL);
+
+    // only the remaining order is cancelled
+    uint256 txidCancel = uint256(31) << 32;
+    BOOST_CHECK_EQUAL(0, MetaDEx_CANCEL_ALL_FOR_PAIR(txidCancel, 31, "1Alice", 3, 5));
+    BOOST_CHECK_EQUAL(1, p_txlistdb->getNumberOfMetaDExCancels(txidCancel));
+    BOOST_CHECK_EQUAL(0U, MetaDEx_getIndexSize());
+    BOOST_CHECK_EQUAL(0U, CountOrders(3, 5));
+    BOOST_CHECK(!MetaDEx_isOpen(txidSecond));
+
+    // an empty market is removed
+    BOOST_CHECK(MetaDEx_SET_MARKET(std::make_pair(3, 5), std::vector<CMPMetaDEx>()));
+    BOOST_CHECK(get_Prices(3, 5) == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
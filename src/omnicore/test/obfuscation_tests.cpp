@@ -1,9 +1,31 @@
 #include "omnicore/utils.h"
 
+#include "tinyformat.h"
+#include "utilstrencodings.h"
+
+#include <boost/algorithm/string.hpp>
+
 #include <string>
 #include <vector>
 
+#include <boost/bind.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+/** Requests hashes of a few seeds, and counts the results that differ from the uncached ones. */
+static void GetObfuscatedHashesThread(unsigned int nThread, int* pnMismatches)
+{
+    std::vector<unsigned char> vchExpected;
+    std::vector<unsigned char> vchObfuscatedHashes;
+
+    for (unsigned int n = 0; n < 200; ++n) {
+        std::string strSeed = strprintf("thread seed%d", n % 8);
+        unsigned int nHashes = 1 + (n * 7 + nThread) % 40;
+        PrepareObfuscatedHashes(strSeed, nHashes, vchExpected);
+        GetObfuscatedHashes(strSeed, nHashes, vchObfuscatedHashes);
+        if (vchObfuscatedHashes != vchExpected) ++(*pnMismatches);
+    }
+}
 
 BOOST_AUTO_TEST_SUITE(omnicore_obfuscation_tests)
 
@@ -23,5 +45,71 @@ BOOST_AUTO_TEST_CASE(prepare_obfuscated_hashes)
             "AA3F890D32864BEA31EE9BD57D2247D8F8CE07B5ABAED9372F0B8999D28DB963");
 }
 
+BOOST_AUTO_TEST_CASE(prepare_obfuscated_hashes_binary)
+{
+    std::string strSeed("1CdighsfdfRcj4ytQSskZgQXbUEamuMUNF");
+    std::string vstrObfuscatedHashes[1+MAX_SHA256_OBFUSCATION_TIMES];
+    PrepareObfuscatedHashes(strSeed, vstrObfuscatedHashes);
+
+    std::vector<unsigned char> vchObfuscatedHashes;
+    PrepareObfuscatedHashes(strSeed, 0, vchObfuscatedHashes);
+    BOOST_CHECK(vchObfuscatedHashes.empty());
+
+    PrepareObfuscatedHashes(strSeed, 3, vchObfuscatedHashes);
+    BOOST_CHECK_EQUAL(vchObfuscatedHashes.size(), 3 * 32);
+
+    PrepareObfuscatedHashes(strSeed, MAX_SHA256_OBFUSCATION_TIMES, vchObfuscatedHashes);
+    BOOST_CHECK_EQUAL(vchObfuscatedHashes.size(), MAX_SHA256_OBFUSCATION_TIMES * 32);
+
+    for (unsigned int n = 1; n <= MAX_SHA256_OBFUSCATION_TIMES; ++n) {
+        std::vector<unsigned char>::const_iterator it = vchObfuscatedHashes.begin() + (n - 1) * 32;
+        BOOST_CHECK_EQUAL(boost::to_upper_copy(HexStr(it, it + 32)), vstrObfuscatedHashes[n]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(get_obfuscated_hashes_cached)
+{
+    std::string strSeed("1CdighsfdfRcj4ytQSskZgQXbUEamuMUNF");
+    std::vector<unsigned char> vchExpected;
+    PrepareObfuscatedHashes(strSeed, 20, vchExpected);
+
+    // the cached hashes are extended, when more are requested
+    std::vector<unsigned char> vchObfuscatedHashes;
+    GetObfuscatedHashes(strSeed, 2, vchObfuscatedHashes);
+    BOOST_CHECK(vchObfuscatedHashes == std::vector<unsigned char>(vchExpected.begin(), vchExpected.begin() + 2 * 32));
+    GetObfuscatedHashes(strSeed, 20, vchObfuscatedHashes);
+    BOOST_CHECK(vchObfuscatedHashes == vchExpected);
+    GetObfuscatedHashes(strSeed, 5, vchObfuscatedHashes);
+    BOOST_CHECK(vchObfuscatedHashes == std::vector<unsigned char>(vchExpected.begin(), vchExpected.begin() + 5 * 32));
+
+    // results are not mixed up, even after the seed was evicted from the cache
+    for (unsigned int n = 0; n < 2000; ++n) {
+        GetObfuscatedHashes(strprintf("seed%d", n), 1, vchObfuscatedHashes);
+    }
+    GetObfuscatedHashes(strSeed, 20, vchObfuscatedHashes);
+    BOOST_CHECK(vchObfuscatedHashes == vchExpected);
+
+    std::string vstrObfuscatedHashes[1+MAX_SHA256_OBFUSCATION_TIMES];
+    PrepareObfuscatedHashes("seed1999", vstrObfuscatedHashes);
+    GetObfuscatedHashes("seed1999", 1, vchObfuscatedHashes);
+    BOOST_CHECK_EQUAL(boost::to_upper_copy(HexStr(vchObfuscatedHashes)), vstrObfuscatedHashes[1]);
+}
+
+BOOST_AUTO_TEST_CASE(get_obfuscated_hashes_multithread)
+{
+    const unsigned int nThreads = 4;
+    std::vector<int> vnMismatches(nThreads, 0);
+
+    boost::thread_group threadGroup;
+    for (unsigned int i = 0; i < nThreads; ++i) {
+        threadGroup.create_thread(boost::bind(&GetObfuscatedHashesThread, i, &vnMismatches[i]));
+    }
+    threadGroup.join_all();
+
+    for (unsigned int i = 0; i < nThreads; ++i) {
+        BOOST_CHECK_EQUAL(vnMismatches[i], 0);
+    }
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
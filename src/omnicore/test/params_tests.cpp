@@ -90,4 +90,20 @@ BOOST_AUTO_TEST_CASE(update_feature)
 }
 
 
+BOOST_AUTO_TEST_CASE(params_generation)
+{
+    uint64_t nGeneration = GetConsensusParamsGeneration();
+
+    // reading the parameters doesn't change the generation
+    ConsensusParams();
+    BOOST_CHECK_EQUAL(nGeneration, GetConsensusParamsGeneration());
+
+    MutableConsensusParams();
+    BOOST_CHECK(nGeneration != GetConsensusParamsGeneration());
+
+    nGeneration = GetConsensusParamsGeneration();
+    ResetConsensusParams();
+    BOOST_CHECK(nGeneration != GetConsensusParamsGeneration());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+#include "omnicore/test/utils_tx.h"
+
+#include "omnicore/log.h"
+#include "omnicore/omnicore.h"
+#include "omnicore/rules.h"
+#include "omnicore/tx.h"
+
+#include "base58.h"
+#include "coins.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "script/script.h"
+#include "script/standard.h"
+#include "uint256.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_AUTO_TEST_SUITE(omnicore_preparetx_tests)
+
+/** Helper to create a CTxOut object. */
+static CTxOut createTxOut(int64_t amount, const std::string& dest)
+{
+    return CTxOut(amount, GetScriptForDestination(CBitcoinAddress(dest).Get()));
+}
+
+/** Creates a transaction, which spends an output of the given transaction. */
+static CTransaction createSpend(const CTransaction& txPrev, unsigned int nOut, const std::vector<CTxOut>& txOuts)
+{
+    CMutableTransaction mutableTx;
+    mutableTx.vin.push_back(CTxIn(txPrev.GetHash(), nOut));
+    mutableTx.vout = txOuts;
+
+    return CTransaction(mutableTx);
+}
+
+BOOST_AUTO_TEST_CASE(prepared_equals_sequential)
+{
+    int nBlock = ConsensusParams().NULLDATA_BLOCK + 1000;
+    unsigned int nTime = 1450000000;
+
+    CBlock block;
+
+    CMutableTransaction coinbaseTx;
+    coinbaseTx.vin.resize(1);
+    coinbaseTx.vin[0].prevout.SetNull();
+    coinbaseTx.vout.push_back(createTxOut(2500000000LL, "1NNQKWM8mC35pBNPxV1noWFZEw7A5X6zXz"));
+    block.vtx.push_back(CTransaction(coinbaseTx));
+
+    // the inputs of the following transactions are resolved from within the block,
+    // while the input of the funding transaction is unknown, so it's not compared
+    CMutableTransaction fundingTx;
+    fundingTx.vin.push_back(CTxIn(uint256(1), 0));
+    fundingTx.vout.push_back(createTxOut(5000000, "1NNQKWM8mC35pBNPxV1noWFZEw7A5X6zXz"));
+    fundingTx.vout.push_back(createTxOut(80000, "3NfRfUekDSzgSyohRro9jXD1AqDALN321P"));
+    fundingTx.vout.push_back(createTxOut(6000, "1M773vkrQDtBpkorfHTdctRo6kHxb4fXuT"));
+    CTransaction funding(fundingTx);
+    block.vtx.push_back(funding);
+
+    std::vector<CTxOut> txOuts;
+    txOuts.push_back(OpReturn_SimpleSend());
+    txOuts.push_back(createTxOut(2700000, ExodusAddress().ToString()));
+    block.vtx.push_back(createSpend(funding, 0, txOuts));
+
+    txOuts.clear();
+    txOuts.push_back(OpReturn_SimpleSend());
+    txOuts.push_back(createTxOut(6000, "3QHw8qKf1vQkMnSVXarq7N4PYzz1G3mAK4"));
+    block.vtx.push_back(createSpend(funding, 1, txOuts));
+
+    txOuts.clear();
+    txOuts.push_back(PayToPubKeyHash_Unrelated());
+    txOuts.push_back(OpReturn_Unrelated());
+    block.vtx.push_back(createSpend(funding, 2, txOuts));
+
+    // prepare first, because preparing resets the coins view
+    std::vector<CMPTransaction> vPrepared(block.vtx.size());
+    std::vector<int> vResults(block.vtx.size(), 0);
+    for (unsigned int idx = 2; idx < block.vtx.size(); ++idx) {
+        BOOST_CHECK(ParsePreparedTransaction(block, nBlock, idx, vPrepared[idx], vResults[idx], nTime));
+    }
+
+    // the sequential parser resolves the inputs via the coins view
+    for (unsigned int n = 0; n < funding.vout.size(); ++n) {
+        CCoinsModifier coins = view.ModifyCoins(funding.GetHash());
+        if (n >= coins->vout.size()) {
+            coins->vout.resize(n+1);
+        }
+        coins->vout[n] = funding.vout[n];
+    }
+
+    for (unsigned int idx = 2; idx < block.vtx.size(); ++idx) {
+        CMPTransaction metaTx;
+        int nResult = ParseTransaction(block.vtx[idx], nBlock, idx, metaTx, nTime);
+
+        BOOST_CHECK_EQUAL(vResults[idx], nResult);
+        BOOST_CHECK_EQUAL(vPrepared[idx].getHash().GetHex(), metaTx.getHash().GetHex());
+        BOOST_CHECK_EQUAL(vPrepared[idx].getEncodingClass(), metaTx.getEncodingClass());
+        BOOST_CHECK_EQUAL(vPrepared[idx].getSender(), metaTx.getSender());
+        BOOST_CHECK_EQUAL(vPrepared[idx].getReceiver(), metaTx.getReceiver());
+        BOOST_CHECK_EQUAL(vPrepared[idx].getPayload(), metaTx.getPayload());
+        BOOST_CHECK_EQUAL(vPrepared[idx].getFeePaid(), metaTx.getFeePaid());
+    }
+
+    // spot check the parsed Omni transactions
+    BOOST_CHECK_EQUAL(vResults[2], 0);
+    BOOST_CHECK_EQUAL(vPrepared[2].getSender(), "1NNQKWM8mC35pBNPxV1noWFZEw7A5X6zXz");
+    BOOST_CHECK_EQUAL(vPrepared[2].getFeePaid(), 2300000);
+    BOOST_CHECK_EQUAL(vResults[3], 0);
+    BOOST_CHECK_EQUAL(vPrepared[3].getSender(), "3NfRfUekDSzgSyohRro9jXD1AqDALN321P");
+    BOOST_CHECK_EQUAL(vPrepared[3].getReceiver(), "3QHw8qKf1vQkMnSVXarq7N4PYzz1G3mAK4");
+    BOOST_CHECK(vResults[4] < 0);
+
+    view.Flush();
+}
+
+BOOST_AUTO_TEST_CASE(log_capture)
+{
+    std::vector<std::string> vMessages;
+    std::vector<std::string> vInner;
+    {
+        CLogCapture logCapture;
+        PrintToLog("first %d\n", 1);
+        {
+            // a nested capture collects its own messages
+            CLogCapture innerCapture;
+            PrintToLog("inner\n");
+            innerCapture.Take(vInner);
+        }
+        PrintToLog("second %d\n", 2);
+        logCapture.Take(vMessages);
+    }
+
+    BOOST_CHECK_EQUAL(vInner.size(), 1U);
+    BOOST_REQUIRE_EQUAL(vMessages.size(), 2U);
+    BOOST_CHECK_EQUAL(vMessages[0], "first 1\n");
+    BOOST_CHECK_EQUAL(vMessages[1], "second 2\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
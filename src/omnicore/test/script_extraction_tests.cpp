@@ -3,8 +3,10 @@
 #include "base58.h"
 #include "pubkey.h"
 #include "script/script.h"
+#include "uint256.h"
 #include "utilstrencodings.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -285,5 +287,129 @@ BOOST_AUTO_TEST_CASE(extract_anypush_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(match_pubkeyhash_test)
+{
+    std::vector<unsigned char> vchHash = ParseHex("946cb2e08075bcbaf157e47bcb67eb2b2339d242");
+
+    // Canonical pay-to-pubkey-hash script
+    CScript script;
+    script << OP_DUP << OP_HASH160 << vchHash << OP_EQUALVERIFY << OP_CHECKSIG;
+    BOOST_CHECK(IsCanonicalPubKeyHash(script));
+
+    uint160 hash;
+    BOOST_CHECK(GetPubKeyHash(script, hash));
+    BOOST_CHECK(hash == uint160(vchHash));
+
+    // The hash is pushed with OP_PUSHDATA1
+    CScript scriptPushData;
+    scriptPushData << OP_DUP << OP_HASH160 << OP_PUSHDATA1;
+    scriptPushData.push_back(20);
+    scriptPushData.insert(scriptPushData.end(), vchHash.begin(), vchHash.end());
+    scriptPushData << OP_EQUALVERIFY << OP_CHECKSIG;
+    BOOST_CHECK(!IsCanonicalPubKeyHash(scriptPushData));
+
+    txnouttype outtype;
+    BOOST_CHECK(GetOutputType(scriptPushData, outtype));
+    BOOST_CHECK_EQUAL(outtype, TX_PUBKEYHASH);
+
+    uint160 hashPushData;
+    BOOST_CHECK(GetPubKeyHash(scriptPushData, hashPushData));
+    BOOST_CHECK(hashPushData == uint160(vchHash));
+
+    // Pay-to-script-hash script
+    CScript scriptHash;
+    scriptHash << OP_HASH160 << vchHash << OP_EQUAL;
+    BOOST_CHECK(!IsCanonicalPubKeyHash(scriptHash));
+    BOOST_CHECK(!GetPubKeyHash(scriptHash, hash));
+}
+
+BOOST_AUTO_TEST_CASE(match_first_push_test)
+{
+    std::vector<unsigned char> vchMarker = ParseHex("6f6d6e69");
+
+    CScript script;
+    script << OP_RETURN << ParseHex("6f6d6e690000000000000001") << ParseHex("ffff");
+    BOOST_CHECK(FirstPushStartsWith(script, vchMarker));
+
+    // Operations, which don't push data, are skipped
+    CScript scriptSmallInt;
+    scriptSmallInt << OP_RETURN << OP_1 << ParseHex("6f6d6e69");
+    BOOST_CHECK(FirstPushStartsWith(scriptSmallInt, vchMarker));
+
+    // Only the first pushed data is considered
+    CScript scriptSecond;
+    scriptSecond << OP_RETURN << ParseHex("ffff") << ParseHex("6f6d6e69");
+    BOOST_CHECK(!FirstPushStartsWith(scriptSecond, vchMarker));
+
+    // The pushed data is too short
+    CScript scriptShort;
+    scriptShort << OP_RETURN << ParseHex("6f6d6e");
+    BOOST_CHECK(!FirstPushStartsWith(scriptShort, vchMarker));
+
+    // The pushed data is empty
+    CScript scriptEmpty;
+    scriptEmpty << OP_RETURN << OP_0;
+    BOOST_CHECK(!FirstPushStartsWith(scriptEmpty, vchMarker));
+
+    // Large pushes use OP_PUSHDATA2
+    std::vector<unsigned char> vchLarge(300, 0x00);
+    std::copy(vchMarker.begin(), vchMarker.end(), vchLarge.begin());
+    CScript scriptLarge;
+    scriptLarge << OP_RETURN << vchLarge;
+    BOOST_CHECK(scriptLarge[1] == OP_PUSHDATA2);
+    BOOST_CHECK(FirstPushStartsWith(scriptLarge, vchMarker));
+
+    // The script has no pushes at all
+    CScript scriptNoPush;
+    scriptNoPush << OP_RETURN;
+    BOOST_CHECK(!FirstPushStartsWith(scriptNoPush, vchMarker));
+
+    // The script is malformed
+    CScript scriptMalformed;
+    scriptMalformed << OP_RETURN << OP_PUSHDATA1;
+    BOOST_CHECK(!FirstPushStartsWith(scriptMalformed, vchMarker));
+}
+
+BOOST_AUTO_TEST_CASE(extract_push_span_test)
+{
+    std::vector<unsigned char> vchPayload(300, 0x07);
+    std::vector<unsigned char> vchSmall = ParseHex("6f6d6e69");
+
+    CScript script;
+    script << OP_RETURN << vchSmall << OP_0 << vchPayload << OP_1;
+    BOOST_CHECK(script[7] == OP_PUSHDATA2);
+
+    std::vector<ScriptPush> vPushes;
+    BOOST_CHECK(GetScriptPushes(script, vPushes));
+    BOOST_CHECK_EQUAL(vPushes.size(), 3);
+
+    // The extracted data refers to the bytes of the script
+    BOOST_CHECK(vPushes[0].pbegin == &script[2]);
+    BOOST_CHECK_EQUAL(HexStr(vPushes[0].pbegin, vPushes[0].pend), "6f6d6e69");
+    BOOST_CHECK_EQUAL(vPushes[1].size(), 0);
+    BOOST_CHECK_EQUAL(vPushes[2].size(), vchPayload.size());
+    BOOST_CHECK(std::equal(vchPayload.begin(), vchPayload.end(), vPushes[2].pbegin));
+
+    // The hex-encoded extraction yields the same data
+    std::vector<std::string> vstrPushes;
+    BOOST_CHECK(GetScriptPushes(script, vstrPushes));
+    BOOST_CHECK_EQUAL(vstrPushes.size(), vPushes.size());
+    for (size_t n = 0; n < vPushes.size(); ++n) {
+        BOOST_CHECK_EQUAL(vstrPushes[n], HexStr(vPushes[n].pbegin, vPushes[n].pend));
+    }
+
+    // The first push can be skipped
+    std::vector<ScriptPush> vPushesSkipped;
+    BOOST_CHECK(GetScriptPushes(script, vPushesSkipped, true));
+    BOOST_CHECK_EQUAL(vPushesSkipped.size(), 2);
+    BOOST_CHECK(vPushesSkipped[0].pbegin == vPushes[1].pbegin);
+
+    // The script is malformed
+    CScript scriptMalformed;
+    scriptMalformed << OP_RETURN << OP_PUSHDATA1;
+    std::vector<ScriptPush> vPushesMalformed;
+    BOOST_CHECK(!GetScriptPushes(scriptMalformed, vPushesMalformed));
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
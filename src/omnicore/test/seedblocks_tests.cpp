@@ -0,0 +1,141 @@
+#include "omnicore/seedblocks.h"
+
+#include "chain.h"
+#include "random.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(omnicore_seedblocks_tests)
+
+/** Creates a chain of block indexes with distinct hashes. */
+static void CreateChain(std::vector<uint256>& vHashes, std::vector<CBlockIndex>& vIndexes, int nBlocks, int nSeed)
+{
+    vHashes.resize(nBlocks);
+    vIndexes.resize(nBlocks);
+    for (int n = 0; n < nBlocks; ++n) {
+        vHashes[n] = uint256(nSeed * 1000 + n + 1);
+        vIndexes[n].nHeight = n;
+        vIndexes[n].phashBlock = &vHashes[n];
+        vIndexes[n].pprev = (n > 0) ? &vIndexes[n - 1] : NULL;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(seedblocks_skip)
+{
+    ClearSeedBlocks();
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), -1);
+
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndexes;
+    CreateChain(vHashes, vIndexes, 10, 1);
+
+    // blocks above the covered height fall back to the hardcoded filter
+    bool fFallback = SkipBlock(6);
+
+    UpdateSeedBlocks(&vIndexes[0], false);
+    UpdateSeedBlocks(&vIndexes[1], true);
+    UpdateSeedBlocks(&vIndexes[2], false);
+    UpdateSeedBlocks(&vIndexes[3], true);
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), 3);
+
+    BOOST_CHECK(SkipBlock(0));
+    BOOST_CHECK(!SkipBlock(1));
+    BOOST_CHECK(SkipBlock(2));
+    BOOST_CHECK(!SkipBlock(3));
+    BOOST_CHECK_EQUAL(SkipBlock(6), fFallback);
+
+    // blocks, which would leave a gap, are ignored
+    UpdateSeedBlocks(&vIndexes[6], true);
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), 3);
+
+    ClearSeedBlocks();
+}
+
+BOOST_AUTO_TEST_CASE(seedblocks_truncate)
+{
+    ClearSeedBlocks();
+
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndexes;
+    CreateChain(vHashes, vIndexes, 6, 2);
+    for (int n = 0; n < 6; ++n) {
+        UpdateSeedBlocks(&vIndexes[n], true);
+    }
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), 5);
+
+    // a competing chain forks off after block 2
+    std::vector<uint256> vForkHashes;
+    std::vector<CBlockIndex> vForkIndexes;
+    CreateChain(vForkHashes, vForkIndexes, 6, 3);
+    vForkIndexes[3].pprev = &vIndexes[2];
+
+    TruncateSeedBlocks(vForkIndexes[3].pprev);
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), 2);
+
+    UpdateSeedBlocks(&vForkIndexes[3], false);
+    UpdateSeedBlocks(&vForkIndexes[4], true);
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), 4);
+    BOOST_CHECK(!SkipBlock(2));
+    BOOST_CHECK(SkipBlock(3));
+    BOOST_CHECK(!SkipBlock(4));
+
+    // truncating above the covered height has no effect
+    TruncateSeedBlocks(&vForkIndexes[5]);
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), 4);
+
+    ClearSeedBlocks();
+}
+
+BOOST_AUTO_TEST_CASE(seedblocks_unconnected)
+{
+    ClearSeedBlocks();
+
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndexes;
+    CreateChain(vHashes, vIndexes, 4, 4);
+    UpdateSeedBlocks(&vIndexes[0], true);
+    UpdateSeedBlocks(&vIndexes[1], true);
+
+    // a block on top of an unknown block invalidates the seed blocks
+    std::vector<uint256> vOtherHashes;
+    std::vector<CBlockIndex> vOtherIndexes;
+    CreateChain(vOtherHashes, vOtherIndexes, 4, 5);
+    UpdateSeedBlocks(&vOtherIndexes[2], true);
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), -1);
+
+    ClearSeedBlocks();
+}
+
+BOOST_AUTO_TEST_CASE(seedblocks_persistence)
+{
+    ClearSeedBlocks();
+
+    boost::filesystem::path path = GetTempPath() / strprintf("omnicore_seedblocks_%lu.dat", (unsigned long) GetRand(1ULL << 32));
+
+    // nothing to persist yet
+    BOOST_CHECK(!WriteSeedBlocks(path));
+    BOOST_CHECK(!LoadSeedBlocks(path));
+
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndexes;
+    CreateChain(vHashes, vIndexes, 3, 6);
+    for (int n = 0; n < 3; ++n) {
+        UpdateSeedBlocks(&vIndexes[n], n != 1);
+    }
+    BOOST_CHECK(WriteSeedBlocks(path));
+    BOOST_CHECK(boost::filesystem::exists(path));
+
+    // the covered blocks are not part of the active chain
+    ClearSeedBlocks();
+    BOOST_CHECK(!LoadSeedBlocks(path));
+    BOOST_CHECK_EQUAL(GetSeedBlocksHeight(), -1);
+
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/consensushash.h"
+#include "omnicore/dex.h"
+#include "omnicore/mdex.h"
+#include "omnicore/omnicore.h"
+#include "omnicore/tally.h"
+
+#include "chain.h"
+#include "main.h"
+#include "sync.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+extern void clear_all_state();
+extern int load_state_snapshot(const uint256& hashBlock);
+
+using namespace mastercore;
+
+/** Provides block indexes, which are known to the block index map, so their states are not pruned. */
+struct SnapshotTestingSetup : public StateTestingSetup
+{
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndexes;
+
+    SnapshotTestingSetup() : vHashes(4), vIndexes(4)
+    {
+        LOCK(cs_main);
+        for (size_t n = 0; n < vIndexes.size(); ++n) {
+            // the third block is a multiple of MAX_STATE_HISTORY, so its delta is compacted
+            vHashes[n] = uint256(0x5a000 + n);
+            vIndexes[n].nHeight = 20 * MAX_STATE_HISTORY - 2 + n;
+            vIndexes[n].phashBlock = &vHashes[n];
+            vIndexes[n].pprev = (n > 0) ? &vIndexes[n - 1] : NULL;
+            mapBlockIndex[vHashes[n]] = &vIndexes[n];
+        }
+        // the first state is persisted as full snapshot
+        clear_all_state();
+    }
+
+    ~SnapshotTestingSetup()
+    {
+        clear_all_state();
+        LOCK(cs_main);
+        for (size_t n = 0; n < vHashes.size(); ++n) {
+            mapBlockIndex.erase(vHashes[n]);
+        }
+    }
+};
+
+/** Returns the path of the state file of a block. */
+static boost::filesystem::path GetStateFile(const std::string& prefix, const uint256& hashBlock)
+{
+    return GetDataDir() / "MP_persist" / strprintf("%s-%s.dat", prefix, hashBlock.ToString());
+}
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_snapshot_tests, SnapshotTestingSetup)
+
+BOOST_AUTO_TEST_CASE(snapshot_delta_chain_roundtrip)
+{
+    LOCK(cs_tally);
+
+    std::vector<uint256> vExpected;
+
+    // full snapshot: balances, a DEx offer and two MetaDEx markets
+    BOOST_CHECK(update_tally_map("1Alice", 3, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map("1Bob", 5, 500, BALANCE));
+    BOOST_CHECK(update_tally_map("1Dave", 1, 70, SELLOFFER_RESERVE));
+    my_offers.insert(std::make_pair(STR_SELLOFFER_ADDR_PROP_COMBO("1Dave", 1), CMPOffer(10, 70, 1, 5000, 1000, 10, uint256(0xd1))));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Alice", 3, 100, 5, 200, 10, 1));
+    BOOST_CHECK_EQUAL(0, AddOrder("1Carol", 3, 100, 7, 100, 10, 2));
+    BOOST_CHECK_EQUAL(0, mastercore_save_state(&vIndexes[0]));
+    vExpected.push_back(GetConsensusHash());
+
+    // delta: a partial match, a new address, and the offer is gone
+    BOOST_CHECK_EQUAL(0, AddOrder("1Bob", 5, 100, 3, 50, 11, 1));
+    BOOST_CHECK(update_tally_map("1Eve", 7, 25, BALANCE));
+    BOOST_CHECK(update_tally_map("1Dave", 1, -70, SELLOFFER_RESERVE));
+    my_offers.clear();
+    BOOST_CHECK_EQUAL(0, mastercore_save_state(&vIndexes[1]));
+    vExpected.push_back(GetConsensusHash());
+
+    // compacted delta: a market and an address are emptied
+    BOOST_CHECK_EQUAL(0, MetaDEx_CANCEL_EVERYTHING(uint256(12) << 32, 12, "1Carol", 1));
+    BOOST_CHECK(update_tally_map("1Carol", 3, -100, BALANCE));
+    BOOST_CHECK(update_tally_map("1Alice", 3, -900, BALANCE));
+    BOOST_CHECK_EQUAL(0, mastercore_save_state(&vIndexes[2]));
+    vExpected.push_back(GetConsensusHash());
+
+    // delta based on the compacted snapshot
+    BOOST_CHECK_EQUAL(0, AddOrder("1Eve", 7, 25, 3, 25, 13, 1));
+    BOOST_CHECK(update_tally_map("1Bob", 5, 1, BALANCE));
+    BOOST_CHECK_EQUAL(0, mastercore_save_state(&vIndexes[3]));
+    vExpected.push_back(GetConsensusHash());
+
+    BOOST_CHECK(MetaDEx_isOpen(uint256(10) << 32 | uint256(1), 3));
+    BOOST_CHECK(MetaDEx_isOpen(uint256(13) << 32 | uint256(1), 7));
+
+    // every state reproduces the tallies, offers and order book it was serialized from
+    for (size_t n = vExpected.size(); n-- > 0; ) {
+        ClearTallyMap();
+        MetaDEx_CLEAR();
+        my_offers.clear();
+        BOOST_CHECK_EQUAL(0, load_state_snapshot(vHashes[n]));
+        BOOST_CHECK_EQUAL(vExpected[n].GetHex(), GetConsensusHash().GetHex());
+    }
+
+    // the first state is loaded last
+    BOOST_CHECK_EQUAL(1U, my_offers.size());
+    BOOST_CHECK_EQUAL(1100, getMPbalance("1Alice", 3, BALANCE) + getMPbalance("1Alice", 3, METADEX_RESERVE));
+    BOOST_CHECK(MetaDEx_isOpen(uint256(10) << 32 | uint256(2), 3));
+
+    // the delta of the third block was written as full snapshot
+    BOOST_CHECK(boost::filesystem::exists(GetStateFile("snapshot", vHashes[0])));
+    BOOST_CHECK(boost::filesystem::exists(GetStateFile("delta", vHashes[1])));
+    BOOST_CHECK(boost::filesystem::exists(GetStateFile("snapshot", vHashes[2])));
+    BOOST_CHECK(!boost::filesystem::exists(GetStateFile("delta", vHashes[2])));
+    BOOST_CHECK(boost::filesystem::exists(GetStateFile("delta", vHashes[3])));
+
+    // the compacted snapshot doesn't depend on the states before it
+    boost::filesystem::remove(GetStateFile("snapshot", vHashes[0]));
+    boost::filesystem::remove(GetStateFile("delta", vHashes[1]));
+    BOOST_CHECK_EQUAL(-1, load_state_snapshot(vHashes[1]));
+    BOOST_CHECK_EQUAL(0, load_state_snapshot(vHashes[3]));
+    BOOST_CHECK_EQUAL(vExpected[3].GetHex(), GetConsensusHash().GetHex());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
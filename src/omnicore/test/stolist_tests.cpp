@@ -0,0 +1,99 @@
+#include "omnicore/omnicore.h"
+
+#include "sync.h"
+#include "tinyformat.h"
+#include "uint256.h"
+
+#include "json/json_spirit_utils.h"
+#include "json/json_spirit_value.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+using namespace json_spirit;
+
+/** Provides an empty STO database. */
+struct STOListTestingSetup
+{
+    STOListTestingSetup()
+    {
+        LOCK(cs_tally);
+        s_stolistdb->Clear();
+    }
+
+    ~STOListTestingSetup()
+    {
+        LOCK(cs_tally);
+        s_stolistdb->Clear();
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_stolist_tests, STOListTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sto_recipients)
+{
+    LOCK(cs_tally);
+
+    uint256 txidA = uint256(400000) << 32 | uint256(1);
+    uint256 txidB = uint256(400001) << 32 | uint256(1);
+
+    for (int n = 0; n < 100; ++n) {
+        s_stolistdb->recordSTOReceive(strprintf("1Address%03d", n), txidA, 400000, 1, 100 + n);
+    }
+    s_stolistdb->recordSTOReceive("1Address000", txidB, 400001, 1, 7);
+    s_stolistdb->recordSTOReceive("1Other", txidB, 400001, 1, 8);
+
+    Array recipients;
+    uint64_t total = 0;
+    uint64_t stoFee = 0;
+    s_stolistdb->getRecipients(txidA, "*", &recipients, &total, &stoFee);
+    BOOST_CHECK_EQUAL(100U, recipients.size());
+    BOOST_CHECK_EQUAL(100U, stoFee);
+    BOOST_CHECK_EQUAL(14950U, total);
+    BOOST_CHECK_EQUAL("1Address000", find_value(recipients[0].get_obj(), "address").get_str());
+    BOOST_CHECK_EQUAL("0.00000100", find_value(recipients[0].get_obj(), "amount").get_str());
+
+    // the fee covers all recipients, even if only one is returned
+    recipients.clear();
+    total = 0;
+    s_stolistdb->getRecipients(txidB, "1Other", &recipients, &total, &stoFee);
+    BOOST_CHECK_EQUAL(1U, recipients.size());
+    BOOST_CHECK_EQUAL(2U, stoFee);
+    BOOST_CHECK_EQUAL(8U, total);
+
+    BOOST_CHECK(s_stolistdb->exists("1Other"));
+    BOOST_CHECK(!s_stolistdb->exists("1Othe"));
+}
+
+BOOST_AUTO_TEST_CASE(sto_deleted_above_block)
+{
+    LOCK(cs_tally);
+
+    uint256 txidA = uint256(400000) << 32 | uint256(1);
+    uint256 txidB = uint256(400001) << 32 | uint256(1);
+
+    s_stolistdb->recordSTOReceive("1Alice", txidA, 400000, 1, 5);
+    s_stolistdb->recordSTOReceive("1Bob", txidA, 400000, 1, 6);
+    s_stolistdb->recordSTOReceive("1Alice", txidB, 400001, 1, 7);
+    s_stolistdb->recordSTOReceive("1Carol", txidB, 400001, 1, 8);
+
+    BOOST_CHECK_EQUAL(2, s_stolistdb->deleteAboveBlock(400000));
+
+    Array recipients;
+    uint64_t total = 0;
+    uint64_t stoFee = 0;
+    s_stolistdb->getRecipients(txidB, "*", &recipients, &total, &stoFee);
+    BOOST_CHECK_EQUAL(0U, recipients.size());
+    BOOST_CHECK_EQUAL(0U, stoFee);
+
+    s_stolistdb->getRecipients(txidA, "*", &recipients, &total, &stoFee);
+    BOOST_CHECK_EQUAL(2U, recipients.size());
+    BOOST_CHECK(s_stolistdb->exists("1Alice"));
+    BOOST_CHECK(!s_stolistdb->exists("1Carol"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
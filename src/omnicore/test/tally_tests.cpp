@@ -317,4 +317,28 @@ BOOST_AUTO_TEST_CASE(tally_overflow)
 }
 
 
+BOOST_AUTO_TEST_CASE(tally_insufficient_balance)
+{
+    CMPTally tally;
+    BOOST_CHECK(tally.updateMoney(7, 10, BALANCE));
+    BOOST_CHECK(tally.updateMoney(2, 10, BALANCE));
+
+    // a failed update still creates an empty record, which is iterated
+    BOOST_CHECK(!tally.updateMoney(5, -1, BALANCE));
+    BOOST_CHECK(!tally.updateMoney(2, -11, BALANCE));
+    BOOST_CHECK_EQUAL(0, tally.getMoney(5, BALANCE));
+    BOOST_CHECK_EQUAL(10, tally.getMoney(2, BALANCE));
+
+    BOOST_CHECK_EQUAL(2, tally.init());
+    BOOST_CHECK_EQUAL(2, tally.next());
+    BOOST_CHECK_EQUAL(5, tally.next());
+    BOOST_CHECK_EQUAL(7, tally.next());
+    BOOST_CHECK_EQUAL(0, tally.next());
+
+    CMPTally other;
+    BOOST_CHECK(other.updateMoney(2, 10, BALANCE));
+    BOOST_CHECK(other.updateMoney(7, 10, BALANCE));
+    BOOST_CHECK(tally != other);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,272 @@
+#include "omnicore/tally.h"
+#include "omnicore/tallymap.h"
+
+#include "base58.h"
+#include "hash.h"
+#include "random.h"
+#include "tinyformat.h"
+#include "uint256.h"
+#include "utilstrencodings.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(omnicore_tallymap_tests)
+
+/** Creates a synthetic, canonical base58 encoded address. */
+static std::string CreateAddress(uint32_t n)
+{
+    uint256 hash = Hash(BEGIN(n), END(n));
+    CAddressKey key;
+    key.data[0] = (n % 2) ? 0x00 : 0x05;
+    memcpy(key.data + 1, hash.begin(), CAddressKey::SIZE - 1);
+    return key.ToString();
+}
+
+/** Returns the addresses of a tally map in the order of iteration. */
+static std::vector<std::string> GetAddresses(CMPTallyMap& tallyMap)
+{
+    std::vector<std::string> vAddresses;
+    for (CMPTallyMap::iterator it = tallyMap.begin(); it != tallyMap.end(); ++it) {
+        vAddresses.push_back(it.getAddress());
+    }
+    return vAddresses;
+}
+
+BOOST_AUTO_TEST_CASE(address_key_conversion)
+{
+    CAddressKey key;
+    BOOST_CHECK(CAddressKey::FromString("1BoatSLRHtKNngkdXEeobR76b53LETtpyT", key));
+    BOOST_CHECK_EQUAL(key.ToString(), "1BoatSLRHtKNngkdXEeobR76b53LETtpyT");
+    BOOST_CHECK(CAddressKey::FromString("3CK4fEwbMP7heJarmU4eqA3sMbVJyEnU3V", key));
+    BOOST_CHECK_EQUAL(key.ToString(), "3CK4fEwbMP7heJarmU4eqA3sMbVJyEnU3V");
+
+    BOOST_CHECK(!CAddressKey::FromString("", key));
+    BOOST_CHECK(!CAddressKey::FromString(" 1BoatSLRHtKNngkdXEeobR76b53LETtpyT", key));
+    BOOST_CHECK(!CAddressKey::FromString("1BoatSLRHtKNngkdXEeobR76b53LETtpyT ", key));
+    BOOST_CHECK(!CAddressKey::FromString("1BoatSLRHtKNngkdXEeobR76b53LETtpyU", key));
+    BOOST_CHECK(!CAddressKey::FromString("1Address0", key));
+}
+
+/** Converts an address with the generic base58 decoder, which serves as reference. */
+static bool ReferenceFromString(const std::string& address, CAddressKey& key)
+{
+    if (address.empty() || isspace(address[0]) || isspace(address[address.size() - 1])) {
+        return false;
+    }
+    std::vector<unsigned char> vch;
+    if (!DecodeBase58(address, vch) || vch.size() != CAddressKey::SIZE + 4) {
+        return false;
+    }
+    uint256 hash = Hash(vch.begin(), vch.begin() + CAddressKey::SIZE);
+    if (memcmp(hash.begin(), &vch[CAddressKey::SIZE], 4) != 0) {
+        return false;
+    }
+    memcpy(key.data, &vch[0], CAddressKey::SIZE);
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(address_key_reference_decoder)
+{
+    static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+    seed_insecure_rand(true);
+
+    std::vector<std::string> vCandidates;
+    vCandidates.push_back("1111111111111111111114oLvT2");
+    vCandidates.push_back("11111111111111111111111111");
+    vCandidates.push_back("1111111111111111111111111");
+    vCandidates.push_back("zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz");
+    vCandidates.push_back("zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz");
+    for (uint32_t n = 0; n < 2000; ++n) {
+        std::string address = CreateAddress(n);
+        vCandidates.push_back(address);
+        vCandidates.push_back("1" + address);
+        vCandidates.push_back(address.substr(1));
+        vCandidates.push_back(address + " ");
+        vCandidates.push_back(address.substr(0, address.size() - 1));
+
+        std::string changed = address;
+        changed[insecure_rand() % changed.size()] = pszBase58[insecure_rand() % 58];
+        vCandidates.push_back(changed);
+
+        std::string inserted = address;
+        inserted.insert(insecure_rand() % inserted.size(), 1, pszBase58[insecure_rand() % 58]);
+        vCandidates.push_back(inserted);
+
+        std::string invalid = address;
+        invalid[insecure_rand() % invalid.size()] = "0OIl+ \n"[insecure_rand() % 7];
+        vCandidates.push_back(invalid);
+    }
+
+    size_t nValid = 0;
+    for (std::vector<std::string>::const_iterator it = vCandidates.begin(); it != vCandidates.end(); ++it) {
+        CAddressKey key;
+        CAddressKey keyExpected;
+        bool fValid = CAddressKey::FromString(*it, key);
+        BOOST_CHECK_EQUAL(fValid, ReferenceFromString(*it, keyExpected));
+        if (fValid) {
+            BOOST_CHECK(key == keyExpected);
+            BOOST_CHECK_EQUAL(key.ToString(), *it);
+            ++nValid;
+        }
+    }
+    BOOST_CHECK(nValid >= 2000);
+}
+
+BOOST_AUTO_TEST_CASE(raw_and_canonical_addresses)
+{
+    CMPTallyMap tallyMap;
+    std::string address = CreateAddress(1);
+
+    // same decoded identifier, but an invalid checksum
+    std::vector<unsigned char> vch;
+    BOOST_REQUIRE(DecodeBase58(address, vch));
+    vch[CAddressKey::SIZE] ^= 0x01;
+    std::string raw = EncodeBase58(vch);
+
+    BOOST_CHECK(tallyMap[address].updateMoney(1, 5, BALANCE));
+    BOOST_CHECK(tallyMap.find(raw) == NULL);
+    BOOST_CHECK(tallyMap[raw].updateMoney(1, 7, BALANCE));
+    BOOST_CHECK_EQUAL(tallyMap.size(), 2U);
+    BOOST_CHECK_EQUAL(tallyMap.find(address)->getMoney(1, BALANCE), 5);
+    BOOST_CHECK_EQUAL(tallyMap.find(raw)->getMoney(1, BALANCE), 7);
+
+    BOOST_CHECK(tallyMap.erase(address));
+    BOOST_CHECK(tallyMap.find(address) == NULL);
+    BOOST_REQUIRE(tallyMap.find(raw) != NULL);
+    BOOST_CHECK_EQUAL(tallyMap.find(raw)->getMoney(1, BALANCE), 7);
+    BOOST_CHECK(tallyMap.erase(raw));
+    BOOST_CHECK_EQUAL(tallyMap.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(raw_addresses_reused)
+{
+    CMPTallyMap tallyMap;
+    for (int n = 0; n < 10; ++n) {
+        tallyMap[strprintf("1Address%d", n)].updateMoney(1, n + 1, BALANCE);
+    }
+    // the positions of erased raw addresses are reused by new ones
+    for (int n = 0; n < 10; n += 2) {
+        BOOST_CHECK(tallyMap.erase(strprintf("1Address%d", n)));
+    }
+    for (int n = 10; n < 15; ++n) {
+        tallyMap[strprintf("1Address%d", n)].updateMoney(1, n + 1, BALANCE);
+    }
+
+    std::vector<std::string> vExpected;
+    for (int n = 1; n < 15; ++n) {
+        if (n < 10 && n % 2 == 0) continue;
+        std::string address = strprintf("1Address%d", n);
+        vExpected.push_back(address);
+        BOOST_REQUIRE(tallyMap.find(address) != NULL);
+        BOOST_CHECK_EQUAL(tallyMap.find(address)->getMoney(1, BALANCE), n + 1);
+    }
+    std::sort(vExpected.begin(), vExpected.end());
+    BOOST_CHECK(GetAddresses(tallyMap) == vExpected);
+    BOOST_CHECK_EQUAL(tallyMap.size(), 10U);
+}
+
+BOOST_AUTO_TEST_CASE(insert_find_erase)
+{
+    CMPTallyMap tallyMap;
+    BOOST_CHECK_EQUAL(tallyMap.size(), 0U);
+    BOOST_CHECK(tallyMap.find(CreateAddress(0)) == NULL);
+    BOOST_CHECK(!tallyMap.erase(CreateAddress(0)));
+
+    for (uint32_t n = 0; n < 2000; ++n) {
+        BOOST_CHECK(tallyMap[CreateAddress(n)].updateMoney(n + 1, n + 1, BALANCE));
+    }
+    BOOST_CHECK(tallyMap["1Address0"].updateMoney(1, 7, BALANCE));
+    BOOST_CHECK_EQUAL(tallyMap.size(), 2001U);
+
+    // erasing entries shifts the probe sequences of others back
+    for (uint32_t n = 0; n < 2000; n += 3) {
+        BOOST_CHECK(tallyMap.erase(CreateAddress(n)));
+    }
+    BOOST_CHECK(tallyMap.erase("1Address0"));
+    BOOST_CHECK(!tallyMap.erase("1Address0"));
+
+    for (uint32_t n = 0; n < 2000; ++n) {
+        const CMPTally* ptally = tallyMap.find(CreateAddress(n));
+        if (n % 3 == 0) {
+            BOOST_CHECK(ptally == NULL);
+        } else {
+            BOOST_REQUIRE(ptally != NULL);
+            BOOST_CHECK_EQUAL(ptally->getMoney(n + 1, BALANCE), int64_t(n + 1));
+        }
+    }
+    BOOST_CHECK(tallyMap.find("1Address0") == NULL);
+    BOOST_CHECK_EQUAL(tallyMap.size(), 1333U);
+
+    // erased entries are reused, and start empty
+    BOOST_CHECK_EQUAL(tallyMap[CreateAddress(0)].getMoney(1, BALANCE), 0);
+    BOOST_CHECK_EQUAL(tallyMap.size(), 1334U);
+
+    tallyMap.clear();
+    BOOST_CHECK_EQUAL(tallyMap.size(), 0U);
+    BOOST_CHECK(tallyMap.find(CreateAddress(1)) == NULL);
+    BOOST_CHECK(tallyMap.begin() == tallyMap.end());
+    BOOST_CHECK(tallyMap.unorderedBegin() == tallyMap.unorderedEnd());
+}
+
+BOOST_AUTO_TEST_CASE(references_remain_valid)
+{
+    CMPTallyMap tallyMap;
+    CMPTally& tally = tallyMap[CreateAddress(0)];
+    BOOST_CHECK(tally.updateMoney(3, 5, BALANCE));
+
+    for (uint32_t n = 1; n < 5000; ++n) {
+        tallyMap[CreateAddress(n)];
+    }
+    BOOST_CHECK_EQUAL(tally.getMoney(3, BALANCE), 5);
+    BOOST_CHECK_EQUAL(&tally, tallyMap.find(CreateAddress(0)));
+}
+
+BOOST_AUTO_TEST_CASE(ordered_iteration)
+{
+    CMPTallyMap tallyMap;
+    std::map<std::string, int64_t> mapExpected;
+
+    seed_insecure_rand(true);
+
+    for (int n = 0; n < 5000; ++n) {
+        uint32_t nAddress = insecure_rand() % 400;
+        // mix canonical and raw addresses, which share a common prefix
+        std::string address = (nAddress % 4 == 0) ? strprintf("1Address%d", nAddress) : CreateAddress(nAddress);
+
+        if (insecure_rand() % 3 == 0) {
+            BOOST_CHECK_EQUAL(tallyMap.erase(address), mapExpected.erase(address) > 0);
+        } else {
+            tallyMap[address].updateMoney(1, 1, BALANCE);
+            mapExpected[address] += 1;
+        }
+
+        if (n % 250 != 0) continue;
+
+        std::vector<std::string> vExpected;
+        for (std::map<std::string, int64_t>::const_iterator it = mapExpected.begin(); it != mapExpected.end(); ++it) {
+            vExpected.push_back(it->first);
+        }
+        std::vector<std::string> vAddresses = GetAddresses(tallyMap);
+        BOOST_CHECK(vAddresses == vExpected);
+        BOOST_CHECK_EQUAL(tallyMap.size(), mapExpected.size());
+
+        size_t nUnordered = 0;
+        for (CMPTallyMap::iterator it = tallyMap.unorderedBegin(); it != tallyMap.unorderedEnd(); ++it) {
+            BOOST_CHECK_EQUAL(it.getTally().getMoney(1, BALANCE), mapExpected[it.getAddress()]);
+            ++nUnordered;
+        }
+        BOOST_CHECK_EQUAL(nUnordered, mapExpected.size());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
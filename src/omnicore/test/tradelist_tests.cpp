@@ -0,0 +1,198 @@
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/omnicore.h"
+
+#include "random.h"
+#include "sync.h"
+#include "uint256.h"
+#include "util.h"
+
+#include "json/json_spirit_utils.h"
+#include "json/json_spirit_value.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "leveldb/iterator.h"
+
+using namespace mastercore;
+using namespace json_spirit;
+
+/** Provides an empty trade database. */
+struct TradeListTestingSetup
+{
+    TradeListTestingSetup()
+    {
+        LOCK(cs_tally);
+        t_tradelistdb->Clear();
+    }
+
+    ~TradeListTestingSetup()
+    {
+        LOCK(cs_tally);
+        t_tradelistdb->Clear();
+    }
+};
+
+/** Trade database, which finds the matches of an order by scanning all trade records. */
+class CTradeListScan : public CMPTradeList
+{
+public:
+    explicit CTradeListScan(const boost::filesystem::path& path) : CMPTradeList(path, true) {}
+
+    /** Returns the txids of the matches of an order, as found by a full scan. */
+    std::vector<std::string> ScanMatchingTxids(const uint256& txid) const
+    {
+        std::vector<std::string> vecTxids;
+        std::string txidStr = txid.ToString();
+        leveldb::Iterator* it = NewIterator();
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            std::string strKey = it->key().ToString();
+            size_t txidMatch = strKey.find(txidStr);
+            if (txidMatch == std::string::npos) continue;
+            if (strKey.length() != 129) continue;
+            vecTxids.push_back((txidMatch == 0) ? strKey.substr(65, 64) : strKey.substr(0, 64));
+        }
+        delete it;
+        return vecTxids;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_tradelist_tests, TradeListTestingSetup)
+
+BOOST_AUTO_TEST_CASE(trades_for_pair)
+{
+    LOCK(cs_tally);
+
+    for (int block = 400000; block < 400010; ++block) {
+        uint256 txidA = MakeTxid(block, 1);
+        uint256 txidB = MakeTxid(block, 2);
+        t_tradelistdb->recordMatchedTrade(txidA, txidB, "1Alice", "1Bob", 1, 2, 100 + block, 200, block, 2);
+    }
+    // a match of a different pair and one of the opposite direction
+    t_tradelistdb->recordMatchedTrade(MakeTxid(400005, 7), MakeTxid(400005, 8), "1Carol", "1Dave", 1, 3, 10, 20, 400005, 8);
+    t_tradelistdb->recordMatchedTrade(MakeTxid(400011, 1), MakeTxid(400011, 2), "1Bob", "1Alice", 2, 1, 300, 400, 400011, 2);
+
+    Array trades;
+    t_tradelistdb->getTradesForPair(1, 2, trades, 3);
+    BOOST_CHECK_EQUAL(3U, trades.size());
+
+    // the most recent trades are returned in ascending order
+    BOOST_CHECK_EQUAL(400008, find_value(trades[0].get_obj(), "block").get_int());
+    BOOST_CHECK_EQUAL(400009, find_value(trades[1].get_obj(), "block").get_int());
+    BOOST_CHECK_EQUAL(400011, find_value(trades[2].get_obj(), "block").get_int());
+    BOOST_CHECK_EQUAL(MakeTxid(400011, 1).GetHex(), find_value(trades[2].get_obj(), "sellertxid").get_str());
+    BOOST_CHECK_EQUAL("1Bob", find_value(trades[1].get_obj(), "selleraddress").get_str());
+
+    Array allTrades;
+    t_tradelistdb->getTradesForPair(2, 1, allTrades, 100);
+    BOOST_CHECK_EQUAL(11U, allTrades.size());
+    BOOST_CHECK_EQUAL(12, t_tradelistdb->getMPTradeCountTotal());
+}
+
+BOOST_AUTO_TEST_CASE(trades_for_address)
+{
+    LOCK(cs_tally);
+
+    t_tradelistdb->recordNewTrade(MakeTxid(400002, 5), "1Alice", 1, 2, 400002, 5);
+    t_tradelistdb->recordNewTrade(MakeTxid(400001, 9), "1Alice", 1, 3, 400001, 9);
+    t_tradelistdb->recordNewTrade(MakeTxid(400002, 1), "1Alice", 2, 1, 400002, 1);
+    t_tradelistdb->recordNewTrade(MakeTxid(400003, 1), "1Alice1", 1, 2, 400003, 1);
+    t_tradelistdb->recordNewTrade(MakeTxid(400003, 2), "1Bob", 1, 2, 400003, 2);
+
+    std::vector<uint256> vecTransactions;
+    t_tradelistdb->getTradesForAddress("1Alice", vecTransactions);
+    BOOST_CHECK_EQUAL(3U, vecTransactions.size());
+    BOOST_CHECK(vecTransactions[0] == MakeTxid(400001, 9));
+    BOOST_CHECK(vecTransactions[1] == MakeTxid(400002, 1));
+    BOOST_CHECK(vecTransactions[2] == MakeTxid(400002, 5));
+
+    vecTransactions.clear();
+    t_tradelistdb->getTradesForAddress("1Alice", vecTransactions, 3);
+    BOOST_CHECK_EQUAL(1U, vecTransactions.size());
+    BOOST_CHECK(vecTransactions[0] == MakeTxid(400001, 9));
+}
+
+BOOST_AUTO_TEST_CASE(trades_deleted_above_block)
+{
+    LOCK(cs_tally);
+
+    for (int block = 400000; block < 400010; ++block) {
+        t_tradelistdb->recordNewTrade(MakeTxid(block, 1), "1Alice", 1, 2, block, 1);
+        t_tradelistdb->recordNewTrade(MakeTxid(block, 2), "1Bob", 2, 1, block, 2);
+        t_tradelistdb->recordMatchedTrade(MakeTxid(block, 1), MakeTxid(block, 2), "1Alice", "1Bob", 1, 2, 100, 200, block, 2);
+    }
+
+    // records in the given block are kept
+    BOOST_CHECK_EQUAL(15, t_tradelistdb->deleteAboveBlock(400004));
+    BOOST_CHECK_EQUAL(15, t_tradelistdb->getMPTradeCountTotal());
+
+    Array trades;
+    t_tradelistdb->getTradesForPair(1, 2, trades, 3);
+    BOOST_CHECK_EQUAL(3U, trades.size());
+    BOOST_CHECK_EQUAL(400004, find_value(trades[2].get_obj(), "block").get_int());
+
+    std::vector<uint256> vecTransactions;
+    t_tradelistdb->getTradesForAddress("1Bob", vecTransactions);
+    BOOST_CHECK_EQUAL(5U, vecTransactions.size());
+    BOOST_CHECK(vecTransactions.back() == MakeTxid(400004, 2));
+
+    // the next block is recorded on top of the remaining index entries
+    t_tradelistdb->recordMatchedTrade(MakeTxid(400005, 3), MakeTxid(400005, 4), "1Carol", "1Dave", 2, 1, 5, 6, 400005, 4);
+    trades.clear();
+    t_tradelistdb->getTradesForPair(1, 2, trades, 1);
+    BOOST_CHECK_EQUAL(1U, trades.size());
+    BOOST_CHECK_EQUAL("1Carol", find_value(trades[0].get_obj(), "selleraddress").get_str());
+}
+
+BOOST_AUTO_TEST_CASE(matching_trades_same_as_scan)
+{
+    boost::filesystem::path path = GetTempPath() / strprintf("omnicore_tradelist_%lu", (unsigned long) GetRand(1ULL << 32));
+    {
+        CTradeListScan tradeList(path);
+
+        // an order, which is matched by several orders, and matches other orders itself
+        uint256 txidOrder = MakeTxid(400002, 1);
+        tradeList.recordMatchedTrade(MakeTxid(400003, 2), txidOrder, "1Bob", "1Alice", 2, 1, 30, 10, 400003, 2);
+        tradeList.recordMatchedTrade(MakeTxid(400004, 1), txidOrder, "1Carol", "1Alice", 2, 1, 60, 20, 400004, 1);
+        tradeList.recordMatchedTrade(txidOrder, MakeTxid(400001, 5), "1Alice", "1Dave", 1, 2, 15, 45, 400002, 1);
+        tradeList.recordMatchedTrade(MakeTxid(400004, 3), MakeTxid(400004, 4), "1Bob", "1Carol", 1, 2, 5, 5, 400004, 4);
+        tradeList.recordNewTrade(txidOrder, "1Alice", 1, 2, 400002, 1);
+
+        Array trades;
+        int64_t totalSold = 0;
+        int64_t totalReceived = 0;
+        BOOST_CHECK(tradeList.getMatchingTrades(txidOrder, 1, trades, totalSold, totalReceived));
+        BOOST_CHECK_EQUAL(45, totalSold);
+        BOOST_CHECK_EQUAL(135, totalReceived);
+
+        std::vector<std::string> vecExpected = tradeList.ScanMatchingTxids(txidOrder);
+        BOOST_CHECK_EQUAL(3U, vecExpected.size());
+        BOOST_REQUIRE_EQUAL(vecExpected.size(), trades.size());
+        for (size_t n = 0; n < trades.size(); ++n) {
+            BOOST_CHECK_EQUAL(vecExpected[n], find_value(trades[n].get_obj(), "txid").get_str());
+            BOOST_CHECK_EQUAL("1Alice", find_value(trades[n].get_obj(), "address").get_str());
+        }
+
+        // the matches of rolled back blocks are no longer found
+        tradeList.deleteAboveBlock(400003);
+        trades.clear();
+        BOOST_CHECK(tradeList.getMatchingTrades(txidOrder, 1, trades, totalSold, totalReceived));
+        BOOST_CHECK_EQUAL(2U, trades.size());
+        BOOST_CHECK_EQUAL(25, totalSold);
+        BOOST_CHECK_EQUAL(75, totalReceived);
+        BOOST_CHECK_EQUAL(2U, tradeList.ScanMatchingTxids(txidOrder).size());
+
+        trades.clear();
+        BOOST_CHECK(!tradeList.getMatchingTrades(MakeTxid(400004, 3), 1, trades, totalSold, totalReceived));
+        BOOST_CHECK(trades.empty());
+    }
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
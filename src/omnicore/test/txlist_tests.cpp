@@ -0,0 +1,251 @@
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/createpayload.h"
+#include "omnicore/notifications.h"
+#include "omnicore/omnicore.h"
+#include "omnicore/tx.h"
+
+#include "sync.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+/** Provides an empty transaction database. */
+struct TxListTestingSetup
+{
+    TxListTestingSetup()
+    {
+        LOCK(cs_tally);
+        p_txlistdb->Clear();
+    }
+
+    ~TxListTestingSetup()
+    {
+        LOCK(cs_tally);
+        p_txlistdb->Clear();
+        p_txlistdb->setDBVersion();
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_txlist_tests, TxListTestingSetup)
+
+BOOST_AUTO_TEST_CASE(transaction_counts)
+{
+    LOCK(cs_tally);
+
+    for (int block = 400000; block < 400005; ++block) {
+        for (int idx = 0; idx < block - 399999; ++idx) {
+            p_txlistdb->recordTX(MakeTxid(block, idx), true, block, 0, 100);
+        }
+    }
+    BOOST_CHECK_EQUAL(15, p_txlistdb->getMPTransactionCountTotal());
+    BOOST_CHECK_EQUAL(0, p_txlistdb->getMPTransactionCountBlock(399999));
+    BOOST_CHECK_EQUAL(1, p_txlistdb->getMPTransactionCountBlock(400000));
+    BOOST_CHECK_EQUAL(5, p_txlistdb->getMPTransactionCountBlock(400004));
+
+    // overwrites, sub records and payments to an existing transaction are not counted
+    p_txlistdb->recordTX(MakeTxid(400004, 0), false, 400004, 0, 100);
+    p_txlistdb->recordSendAllSubRecord(MakeTxid(400004, 1), 1, 3, 50, 400004);
+    p_txlistdb->recordPaymentTX(MakeTxid(400004, 2), true, 400004, 1, 1, 10, "1Buyer", "1Seller");
+    p_txlistdb->recordPaymentTX(MakeTxid(400005, 0), true, 400005, 1, 1, 10, "1Buyer", "1Seller");
+    p_txlistdb->recordPaymentTX(MakeTxid(400005, 0), true, 400005, 2, 1, 10, "1Buyer", "1Other");
+    BOOST_CHECK_EQUAL(16, p_txlistdb->getMPTransactionCountTotal());
+    BOOST_CHECK_EQUAL(5, p_txlistdb->getMPTransactionCountBlock(400004));
+    BOOST_CHECK_EQUAL(1, p_txlistdb->getMPTransactionCountBlock(400005));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_counts_rolled_back)
+{
+    LOCK(cs_tally);
+
+    for (int block = 400000; block < 400005; ++block) {
+        p_txlistdb->recordTX(MakeTxid(block, 1), true, block, 0, 100);
+        p_txlistdb->recordTX(MakeTxid(block, 2), true, block, 0, 100);
+    }
+
+    BOOST_CHECK(p_txlistdb->isMPinBlockRange(400003, 400010, false));
+    BOOST_CHECK_EQUAL(10, p_txlistdb->getMPTransactionCountTotal());
+
+    BOOST_CHECK(p_txlistdb->isMPinBlockRange(400003, 400010, true));
+    BOOST_CHECK_EQUAL(6, p_txlistdb->getMPTransactionCountTotal());
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getMPTransactionCountBlock(400002));
+    BOOST_CHECK_EQUAL(0, p_txlistdb->getMPTransactionCountBlock(400003));
+    BOOST_CHECK(!p_txlistdb->isMPinBlockRange(400003, 400010, false));
+
+    p_txlistdb->recordTX(MakeTxid(400003, 7), true, 400003, 0, 100);
+    BOOST_CHECK_EQUAL(7, p_txlistdb->getMPTransactionCountTotal());
+    BOOST_CHECK_EQUAL(1, p_txlistdb->getMPTransactionCountBlock(400003));
+}
+
+BOOST_AUTO_TEST_CASE(sub_records_rolled_back)
+{
+    LOCK(cs_tally);
+
+    p_txlistdb->recordTX(MakeTxid(400002, 1), true, 400002, 4, 1);
+    p_txlistdb->recordSendAllSubRecord(MakeTxid(400002, 1), 1, 3, 50, 400002);
+    p_txlistdb->recordTX(MakeTxid(400003, 1), true, 400003, 4, 2);
+    p_txlistdb->recordSendAllSubRecord(MakeTxid(400003, 1), 1, 3, 50, 400003);
+    p_txlistdb->recordSendAllSubRecord(MakeTxid(400003, 1), 2, 4, 60, 400003);
+    p_txlistdb->recordPaymentTX(MakeTxid(400003, 2), true, 400003, 1, 1, 10, "1Buyer", "1Seller");
+    p_txlistdb->recordMetaDExCancelTX(MakeTxid(400004, 1), MakeTxid(400000, 1), true, 400004, 3, 10);
+    p_txlistdb->recordTX(MakeTxid(400020, 1), true, 400020, 0, 100);
+    BOOST_CHECK_EQUAL(1, p_txlistdb->getNumberOfMetaDExCancels(MakeTxid(400004, 1)));
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getMPTransactionCountBlock(400003));
+
+    // only records within the range are removed, including sub records
+    BOOST_CHECK(p_txlistdb->isMPinBlockRange(400003, 400010, true));
+    uint32_t propertyId = 0;
+    int64_t amount = 0;
+    BOOST_CHECK(!p_txlistdb->getSendAllDetails(MakeTxid(400003, 1), 2, propertyId, amount));
+    BOOST_CHECK(p_txlistdb->getSendAllDetails(MakeTxid(400002, 1), 1, propertyId, amount));
+    BOOST_CHECK_EQUAL(50, amount);
+    std::string buyer, seller;
+    uint64_t vout = 0, paymentPropertyId = 0, paymentAmount = 0;
+    BOOST_CHECK(!p_txlistdb->getPurchaseDetails(MakeTxid(400003, 2), 1, &buyer, &seller, &vout, &paymentPropertyId, &paymentAmount));
+    BOOST_CHECK_EQUAL(0, p_txlistdb->getNumberOfMetaDExCancels(MakeTxid(400004, 1)));
+    BOOST_CHECK(!p_txlistdb->exists(MakeTxid(400003, 2)));
+    BOOST_CHECK(p_txlistdb->exists(MakeTxid(400020, 1)));
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getMPTransactionCountTotal());
+}
+
+BOOST_AUTO_TEST_CASE(records_written_in_batch)
+{
+    LOCK(cs_tally);
+
+    p_txlistdb->BeginBatch();
+    p_txlistdb->recordTX(MakeTxid(400001, 1), true, 400001, 0, 100);
+    p_txlistdb->recordPaymentTX(MakeTxid(400001, 2), true, 400001, 1, 1, 10, "1Buyer", "1Seller");
+    p_txlistdb->recordPaymentTX(MakeTxid(400001, 2), true, 400001, 2, 1, 20, "1Buyer", "1Other");
+    p_txlistdb->recordMetaDExCancelTX(MakeTxid(400001, 3), MakeTxid(400000, 1), true, 400001, 3, 10);
+    p_txlistdb->recordMetaDExCancelTX(MakeTxid(400001, 3), MakeTxid(400000, 2), true, 400001, 3, 20);
+
+    // pending records are readable, and updated on top of each other
+    BOOST_CHECK(p_txlistdb->exists(MakeTxid(400001, 1)));
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getNumberOfSubRecords(MakeTxid(400001, 2)));
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getNumberOfMetaDExCancels(MakeTxid(400001, 3)));
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getMPTransactionCountTotal());
+
+    // but they are not yet written to the database
+    BOOST_CHECK_EQUAL(0, p_txlistdb->getMPTransactionCountBlock(400001));
+
+    BOOST_CHECK(p_txlistdb->CommitBatch().ok());
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getMPTransactionCountBlock(400001));
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getMPTransactionCountTotal());
+    std::string buyer, seller;
+    uint64_t vout = 0, propertyId = 0, amount = 0;
+    BOOST_CHECK(p_txlistdb->getPurchaseDetails(MakeTxid(400001, 2), 2, &buyer, &seller, &vout, &propertyId, &amount));
+    BOOST_CHECK_EQUAL("1Other", seller);
+    BOOST_CHECK_EQUAL(20U, amount);
+
+    // records are written immediately, once the batch is committed
+    p_txlistdb->recordTX(MakeTxid(400002, 1), true, 400002, 0, 100);
+    BOOST_CHECK_EQUAL(1, p_txlistdb->getMPTransactionCountBlock(400002));
+
+    // pending records are discarded, when the database is cleared
+    p_txlistdb->BeginBatch();
+    p_txlistdb->recordTX(MakeTxid(400003, 1), true, 400003, 0, 100);
+    p_txlistdb->Clear();
+    BOOST_CHECK(p_txlistdb->CommitBatch().ok());
+    BOOST_CHECK(!p_txlistdb->exists(MakeTxid(400003, 1)));
+    BOOST_CHECK_EQUAL(0, p_txlistdb->getMPTransactionCountTotal());
+}
+
+BOOST_AUTO_TEST_CASE(binary_records)
+{
+    LOCK(cs_tally);
+
+    p_txlistdb->recordTX(MakeTxid(400000, 1), true, 400000, 25, 1234567890123LL);
+    p_txlistdb->recordTX(MakeTxid(400000, 2), false, 400000, 0, 5);
+    p_txlistdb->recordPaymentTX(MakeTxid(400001, 1), true, 400001, 3, 1, 250, "1Buyer", "1Seller");
+    p_txlistdb->recordPaymentTX(MakeTxid(400001, 1), true, 400001, 4, 2, 350, "1Buyer", "1Other");
+    p_txlistdb->recordMetaDExCancelTX(MakeTxid(400003, 1), MakeTxid(400000, 1), true, 400003, 3, 10);
+    p_txlistdb->recordMetaDExCancelTX(MakeTxid(400003, 1), MakeTxid(400000, 5), true, 400003, 4, 20);
+
+    int block = 0;
+    unsigned int type = 0;
+    uint64_t nValue = 0;
+    BOOST_CHECK(getValidMPTX(MakeTxid(400000, 1), &block, &type, &nValue));
+    BOOST_CHECK_EQUAL(400000, block);
+    BOOST_CHECK_EQUAL(25U, type);
+    BOOST_CHECK_EQUAL(1234567890123ULL, nValue);
+    BOOST_CHECK(!getValidMPTX(MakeTxid(400000, 2)));
+    BOOST_CHECK(!getValidMPTX(MakeTxid(400000, 3)));
+
+    std::string buyer, seller;
+    uint64_t vout = 0, propertyId = 0, amount = 0;
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getNumberOfSubRecords(MakeTxid(400001, 1)));
+    BOOST_CHECK(p_txlistdb->getPurchaseDetails(MakeTxid(400001, 1), 2, &buyer, &seller, &vout, &propertyId, &amount));
+    BOOST_CHECK_EQUAL("1Buyer", buyer);
+    BOOST_CHECK_EQUAL("1Other", seller);
+    BOOST_CHECK_EQUAL(4U, vout);
+    BOOST_CHECK_EQUAL(2U, propertyId);
+    BOOST_CHECK_EQUAL(350U, amount);
+
+    uint256 cancelledTxid;
+    uint32_t cancelledPropertyId = 0;
+    int64_t amountUnreserved = 0;
+    BOOST_CHECK_EQUAL(2, p_txlistdb->getNumberOfMetaDExCancels(MakeTxid(400003, 1)));
+    BOOST_CHECK(p_txlistdb->getMetaDExCancelDetails(MakeTxid(400003, 1), 2, cancelledTxid, cancelledPropertyId, amountUnreserved));
+    BOOST_CHECK(cancelledTxid == MakeTxid(400000, 5));
+    BOOST_CHECK_EQUAL(4U, cancelledPropertyId);
+    BOOST_CHECK_EQUAL(20, amountUnreserved);
+    BOOST_CHECK(!p_txlistdb->getMetaDExCancelDetails(MakeTxid(400003, 1), 3, cancelledTxid, cancelledPropertyId, amountUnreserved));
+    BOOST_CHECK(p_txlistdb->findMetaDExCancel(MakeTxid(400000, 5)) == MakeTxid(400003, 1));
+    BOOST_CHECK(p_txlistdb->findMetaDExCancel(MakeTxid(400000, 6)) == 0);
+
+    std::set<int> setSeedBlocks = p_txlistdb->GetSeedBlocks(400001, 400010);
+    BOOST_CHECK_EQUAL(2U, setSeedBlocks.size());
+    BOOST_CHECK(setSeedBlocks.count(400001));
+    BOOST_CHECK(setSeedBlocks.count(400003));
+}
+
+/** Records an alert, as it would be recorded while parsing a block. */
+static void RecordAlert(const std::string& sender, bool fValid, int block, int idx, const std::string& message)
+{
+    std::vector<unsigned char> payload = CreatePayload_OmniCoreAlert(ALERT_BLOCK_EXPIRY, 500000, message);
+    CMPTransaction mp_obj;
+    mp_obj.Set(sender, "", 0, MakeTxid(block, idx), block, idx, &payload[0], payload.size(), OMNI_CLASS_C, 0);
+    BOOST_CHECK(mp_obj.interpret_Transaction());
+    p_txlistdb->recordTX(MakeTxid(block, idx), fValid, block, OMNICORE_MESSAGE_TYPE_ALERT, 0, &mp_obj);
+}
+
+BOOST_AUTO_TEST_CASE(alerts_replayed_from_type_index)
+{
+    RecordAlert("1zAtHRASgdHvZDfHs6xJquMghga4eG7gy", true, 400000, 1, "First alert");
+    RecordAlert("1zAtHRASgdHvZDfHs6xJquMghga4eG7gy", false, 400001, 1, "Invalid alert");
+    RecordAlert("1JwSSubhmg6iPtRjtyqhUYYH7bZg3Lfy1T", true, 400001, 2, "Unauthorized alert");
+    RecordAlert("1dexX7zmPen1yBz2H9ZF62AK5TGGqGTZH", true, 400002, 1, "Second alert");
+    p_txlistdb->recordTX(MakeTxid(400002, 2), true, 400002, 0, 100);
+
+    ClearAlerts();
+    p_txlistdb->LoadAlerts(1);
+    std::vector<AlertData> alerts = GetOmniCoreAlerts();
+    BOOST_CHECK_EQUAL(2U, alerts.size());
+    if (alerts.size() == 2) {
+        BOOST_CHECK_EQUAL("First alert", alerts[0].alert_message);
+        BOOST_CHECK_EQUAL("1dexX7zmPen1yBz2H9ZF62AK5TGGqGTZH", alerts[1].alert_sender);
+        BOOST_CHECK_EQUAL(ALERT_BLOCK_EXPIRY, alerts[1].alert_type);
+        BOOST_CHECK_EQUAL(500000U, alerts[1].alert_expiry);
+    }
+
+    // the index entries are rolled back with the records
+    {
+        LOCK(cs_tally);
+        BOOST_CHECK(p_txlistdb->isMPinBlockRange(400002, 400010, true));
+    }
+    ClearAlerts();
+    p_txlistdb->LoadAlerts(1);
+    alerts = GetOmniCoreAlerts();
+    BOOST_CHECK_EQUAL(1U, alerts.size());
+    ClearAlerts();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,63 @@
+#include "omnicore/test/utils_state.h"
+
+#include "omnicore/mdex.h"
+#include "omnicore/omnicore.h"
+#include "omnicore/tally.h"
+
+#include "random.h"
+#include "sync.h"
+#include "tinyformat.h"
+
+#include <stdint.h>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+//! Tally types used by the randomized tests
+static const TallyType RANDOM_TALLY_TYPES[] = { BALANCE, SELLOFFER_RESERVE, ACCEPT_RESERVE, PENDING, METADEX_RESERVE };
+
+const uint32_t RANDOM_PROPERTIES[NUM_RANDOM_PROPERTIES] = { 1, 2, 3, 4, 2147483651U };
+
+StateTestingSetup::StateTestingSetup()
+{
+    LOCK(cs_tally);
+    ClearTallyMap();
+    MetaDEx_CLEAR();
+}
+
+StateTestingSetup::~StateTestingSetup()
+{
+    LOCK(cs_tally);
+    ClearTallyMap();
+    MetaDEx_CLEAR();
+}
+
+int AddOrder(const std::string& address, uint32_t propertyForSale, int64_t amountForSale,
+        uint32_t propertyDesired, int64_t amountDesired, int block, unsigned int idx)
+{
+    BOOST_CHECK(update_tally_map(address, propertyForSale, amountForSale, BALANCE));
+
+    return MetaDEx_ADD(address, propertyForSale, amountForSale, block, propertyDesired, amountDesired, MakeTxid(block, idx), idx);
+}
+
+void SeedRandomUpdates()
+{
+    seed_insecure_rand(true);
+}
+
+std::string GetRandomAddress()
+{
+    return strprintf("1Address%d", insecure_rand() % 50);
+}
+
+void ApplyRandomTallyUpdate()
+{
+    std::string address = GetRandomAddress();
+    uint32_t propertyId = RANDOM_PROPERTIES[insecure_rand() % NUM_RANDOM_PROPERTIES];
+    TallyType ttype = RANDOM_TALLY_TYPES[insecure_rand() % 5];
+    int64_t amount = (int64_t) (insecure_rand() % 1000) - 400;
+
+    if (amount != 0) update_tally_map(address, propertyId, amount, ttype);
+}
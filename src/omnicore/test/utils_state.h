@@ -0,0 +1,41 @@
+#ifndef OMNICORE_TEST_UTILS_STATE_H
+#define OMNICORE_TEST_UTILS_STATE_H
+
+#include "uint256.h"
+
+#include <stdint.h>
+#include <string>
+
+/** Provides an empty tally map and order book. */
+struct StateTestingSetup
+{
+    StateTestingSetup();
+    ~StateTestingSetup();
+};
+
+/** Returns a txid, which is derived from the position of a transaction in the chain. */
+inline uint256 MakeTxid(int block, unsigned int idx)
+{
+    return uint256(block) << 32 | uint256(idx);
+}
+
+/** Credits tokens and places a new order on the MetaDEx. */
+int AddOrder(const std::string& address, uint32_t propertyForSale, int64_t amountForSale,
+        uint32_t propertyDesired, int64_t amountDesired, int block, unsigned int idx);
+
+//! Number of properties used by the randomized tests
+static const int NUM_RANDOM_PROPERTIES = 5;
+//! Properties used by the randomized tests
+extern const uint32_t RANDOM_PROPERTIES[NUM_RANDOM_PROPERTIES];
+
+/** Seeds the random number generator, so the randomized tests are deterministic. */
+void SeedRandomUpdates();
+
+/** Returns one of the addresses used by the randomized tests. */
+std::string GetRandomAddress();
+
+/** Adds or subtracts a random amount of a random property and tally type of a random address. */
+void ApplyRandomTallyUpdate();
+
+
+#endif // OMNICORE_TEST_UTILS_STATE_H
@@ -1,6 +1,7 @@
 #ifndef OMNICORE_TX_H
 #define OMNICORE_TX_H
 
+class CBlock;
 class CMPMetaDEx;
 class CMPOffer;
 class CTransaction;
@@ -270,9 +271,12 @@ public:
         nNewValue = n;
         encodingClass = encodingClassIn;
         tx_fee_paid = txf;
-        memcpy(&pkt, p, pkt_size);
+        if (p != pkt) memcpy(&pkt, p, pkt_size);
     }
 
+    /** Returns the packet buffer, which may be filled in place before calling Set(). */
+    unsigned char* getPacketBuffer() { return pkt; }
+
     /** Parses the packet or payload. */
     bool interpret_Transaction();
 
@@ -293,5 +297,8 @@ public:
 /** Parses a transaction and populates the CMPTransaction object. */
 int ParseTransaction(const CTransaction& tx, int nBlock, unsigned int idx, CMPTransaction& mptx, unsigned int nTime=0);
 
+/** Parses a transaction of a block ahead of its execution, as done when the block is connected. */
+bool ParsePreparedTransaction(const CBlock& block, int nBlock, unsigned int idx, CMPTransaction& mptx, int& nResult, unsigned int nTime=0);
+
 
 #endif // OMNICORE_TX_H
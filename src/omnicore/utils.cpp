@@ -7,18 +7,68 @@
 
 #include "omnicore/utils.h"
 
+#include "crypto/sha256.h"
+#include "sync.h"
 #include "utilstrencodings.h"
 
-// TODO: use crypto/sha256 instead of openssl
-#include "openssl/sha.h"
-
 #include <boost/algorithm/string.hpp>
 
 #include <assert.h>
 #include <string.h>
+
+#include <algorithm>
+#include <list>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
+/** Maximum number of seeds with cached obfuscation hashes. */
+static const size_t MAX_OBFUSCATION_CACHE_SIZE = 1024;
+
+/**
+ * Encodes a hash as upper case hex string, which is used as input for the next round.
+ */
+static void HashToUpperHex(const unsigned char* pHash, char (&pszHex)[2*CSHA256::OUTPUT_SIZE])
+{
+    static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+
+    for (size_t i = 0; i < CSHA256::OUTPUT_SIZE; ++i) {
+        pszHex[2*i] = hexmap[pHash[i] >> 4];
+        pszHex[2*i+1] = hexmap[pHash[i] & 15];
+    }
+}
+
+/**
+ * Continues the chain of obfuscation hashes, until it contains at least nHashes hashes.
+ */
+static void ExtendObfuscatedHashes(const std::string& strSeed, unsigned int nHashes, std::vector<unsigned char>& vchHashes)
+{
+    assert(nHashes <= MAX_SHA256_OBFUSCATION_TIMES);
+    assert(vchHashes.size() % CSHA256::OUTPUT_SIZE == 0);
+
+    size_t nAvailable = vchHashes.size() / CSHA256::OUTPUT_SIZE;
+    if (nAvailable >= nHashes) {
+        return;
+    }
+    vchHashes.resize(nHashes * CSHA256::OUTPUT_SIZE);
+
+    for (size_t j = nAvailable; j < nHashes; ++j) {
+        unsigned char* pHash = &vchHashes[j * CSHA256::OUTPUT_SIZE];
+
+        if (j == 0) {
+            // the first round is seeded by the seed itself
+            CSHA256().Write((const unsigned char*) strSeed.c_str(), strlen(strSeed.c_str())).Finalize(pHash);
+        } else {
+            // every other round by the upper case hex string of the previous hash
+            char pszHex[2*CSHA256::OUTPUT_SIZE];
+            HashToUpperHex(pHash - CSHA256::OUTPUT_SIZE, pszHex);
+            CSHA256().Write((const unsigned char*) pszHex, sizeof(pszHex)).Finalize(pHash);
+        }
+    }
+}
+
 /**
  * Generates hashes used for obfuscation via ToUpper(HexStr(SHA256(x))).
  *
@@ -32,24 +82,96 @@
  */
 void PrepareObfuscatedHashes(const std::string& strSeed, std::string(&vstrHashes)[1+MAX_SHA256_OBFUSCATION_TIMES])
 {
-    unsigned char sha_input[128];
-    unsigned char sha_result[128];
-    std::vector<unsigned char> vec_chars;
+    assert(strSeed.size() < 128);
 
-    assert(strSeed.size() < sizeof(sha_input));
-    strcpy((char *)sha_input, strSeed.c_str());
+    std::vector<unsigned char> vchHashes;
+    PrepareObfuscatedHashes(strSeed, MAX_SHA256_OBFUSCATION_TIMES, vchHashes);
 
-    // Do only as many re-hashes as there are data packets, 255 per specification
     for (unsigned int j = 1; j <= MAX_SHA256_OBFUSCATION_TIMES; ++j)
     {
-        SHA256(sha_input, strlen((const char *)sha_input), sha_result);
-        vec_chars.resize(32);
-        memcpy(&vec_chars[0], &sha_result[0], 32);
-        vstrHashes[j] = HexStr(vec_chars);
+        std::vector<unsigned char>::const_iterator itHash = vchHashes.begin() + (j - 1) * CSHA256::OUTPUT_SIZE;
+        vstrHashes[j] = HexStr(itHash, itHash + CSHA256::OUTPUT_SIZE);
         boost::to_upper(vstrHashes[j]); // Convert to upper case characters
-
-        assert(vstrHashes[j].size() < sizeof(sha_input));
-        strcpy((char *)sha_input, vstrHashes[j].c_str());
     }
 }
 
+/**
+ * Generates the first nHashes hashes used for obfuscation in binary form.
+ *
+ * The hashes are equal to the ones generated via ToUpper(HexStr(SHA256(x))), but only as
+ * many hashes as needed are computed, and they are not converted into hex strings.
+ *
+ * The 32 byte hashes are stored consecutively, so the hash for the n-th data packet
+ * starts at position (n-1)*32.
+ *
+ * @param strSeed[in]     A seed used for the obfuscation
+ * @param nHashes[in]     The number of hashes to generate, at most 255
+ * @param vchHashes[out]  The generated hashes
+ */
+void PrepareObfuscatedHashes(const std::string& strSeed, unsigned int nHashes, std::vector<unsigned char>& vchHashes)
+{
+    vchHashes.clear();
+    ExtendObfuscatedHashes(strSeed, nHashes, vchHashes);
+}
+
+//! Recently used seeds and their hashes, with the most recently used one at the front
+typedef std::list<std::pair<std::string, std::vector<unsigned char> > > ObfuscationCacheList;
+
+static CCriticalSection cs_obfuscation_cache;
+static ObfuscationCacheList obfuscationCacheList;
+static std::map<std::string, ObfuscationCacheList::iterator> obfuscationCacheMap;
+
+/**
+ * Generates the first nHashes hashes used for obfuscation in binary form.
+ *
+ * The hashes of the most recently used seeds are kept, and extended, if more hashes
+ * are requested for a seed than previously generated.
+ *
+ * The cache is only locked to look up and store hashes, so the hashes of different
+ * seeds can be generated concurrently.
+ *
+ * @param strSeed[in]     A seed used for the obfuscation
+ * @param nHashes[in]     The number of hashes to generate, at most 255
+ * @param vchHashes[out]  The generated hashes
+ */
+void GetObfuscatedHashes(const std::string& strSeed, unsigned int nHashes, std::vector<unsigned char>& vchHashes)
+{
+    const size_t nSize = nHashes * CSHA256::OUTPUT_SIZE;
+    vchHashes.clear();
+    {
+        LOCK(cs_obfuscation_cache);
+
+        std::map<std::string, ObfuscationCacheList::iterator>::iterator it = obfuscationCacheMap.find(strSeed);
+        if (it != obfuscationCacheMap.end()) {
+            // move the entry to the front
+            obfuscationCacheList.splice(obfuscationCacheList.begin(), obfuscationCacheList, it->second);
+
+            const std::vector<unsigned char>& vchCached = it->second->second;
+            vchHashes.assign(vchCached.begin(), vchCached.begin() + std::min(nSize, vchCached.size()));
+        }
+    }
+
+    if (vchHashes.size() == nSize) {
+        return;
+    }
+    ExtendObfuscatedHashes(strSeed, nHashes, vchHashes);
+
+    LOCK(cs_obfuscation_cache);
+
+    std::map<std::string, ObfuscationCacheList::iterator>::iterator it = obfuscationCacheMap.find(strSeed);
+    if (it != obfuscationCacheMap.end()) {
+        // another thread may have stored the hashes of this seed in the meantime
+        obfuscationCacheList.splice(obfuscationCacheList.begin(), obfuscationCacheList, it->second);
+        if (it->second->second.size() < vchHashes.size()) {
+            it->second->second = vchHashes;
+        }
+    } else {
+        obfuscationCacheList.push_front(std::make_pair(strSeed, vchHashes));
+        obfuscationCacheMap.insert(std::make_pair(strSeed, obfuscationCacheList.begin()));
+
+        if (obfuscationCacheMap.size() > MAX_OBFUSCATION_CACHE_SIZE) {
+            obfuscationCacheMap.erase(obfuscationCacheList.back().first);
+            obfuscationCacheList.pop_back();
+        }
+    }
+}
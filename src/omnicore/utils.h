@@ -2,11 +2,18 @@
 #define OMNICORE_UTILS_H
 
 #include <string>
+#include <vector>
 
 #define MAX_SHA256_OBFUSCATION_TIMES  255
 
 /** Generates hashes used for obfuscation via ToUpper(HexStr(SHA256(x))). */
 void PrepareObfuscatedHashes(const std::string& strSeed, std::string(&vstrHashes)[1+MAX_SHA256_OBFUSCATION_TIMES]);
 
+/** Generates the first nHashes hashes used for obfuscation in binary form. */
+void PrepareObfuscatedHashes(const std::string& strSeed, unsigned int nHashes, std::vector<unsigned char>& vchHashes);
+
+/** Generates the first nHashes hashes used for obfuscation, and caches the hashes of recently used seeds. */
+void GetObfuscatedHashes(const std::string& strSeed, unsigned int nHashes, std::vector<unsigned char>& vchHashes);
+
 
 #endif // OMNICORE_UTILS_H
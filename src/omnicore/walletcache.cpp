@@ -89,8 +89,8 @@ int WalletCacheUpdate()
 
     LOCK(cs_tally);
 
-    for (std::map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        const std::string& address = my_it->first;
+    for (CMPTallyMap::iterator my_it = mp_tally_map.unorderedBegin(); my_it != mp_tally_map.unorderedEnd(); ++my_it) {
+        const std::string address = my_it.getAddress();
 
         // determine if this address is in the wallet
         int addressIsMine = IsMyAddress(address);
@@ -100,7 +100,7 @@ int WalletCacheUpdate()
         }
 
         // obtain & init the tally
-        CMPTally& tally = my_it->second;
+        CMPTally& tally = my_it.getTally();
         tally.init();
 
         // check cache for miss on address
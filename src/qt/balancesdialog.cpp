@@ -206,9 +206,9 @@ void BalancesDialog::PopulateBalances(unsigned int propertyId)
         bool propertyIsDivisible = isPropertyDivisible(propertyId); // only fetch the SP once, not for every address
 
         // iterate mp_tally_map looking for addresses that hold a balance in propertyId
-        for(std::map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-            const std::string& address = my_it->first;
-            CMPTally& tally = my_it->second;
+        for(CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+            const std::string address = my_it.getAddress();
+            CMPTally& tally = my_it.getTally();
             tally.init();
 
             uint32_t id;
@@ -245,9 +245,9 @@ void BalancesDialog::PopulateBalances(unsigned int propertyId)
 
             // add the row
             if (!watchAddress) {
-                AddRow(GetAddressLabel(my_it->first), address, reservedStr, availableStr);
+                AddRow(GetAddressLabel(address), address, reservedStr, availableStr);
             } else {
-                AddRow(GetAddressLabel(my_it->first), address + " (watch-only)", reservedStr, availableStr);
+                AddRow(GetAddressLabel(address), address + " (watch-only)", reservedStr, availableStr);
             }
         }
     }
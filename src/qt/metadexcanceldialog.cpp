@@ -299,7 +299,7 @@ void MetaDExCancelDialog::SendCancelTransaction()
         LOCK(cs_tally);
 
         for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-            if (my_it->first != propertyIdForSale) { continue; } // move along, this isn't the prop you're looking for
+            if (my_it->first.first != propertyIdForSale) { continue; } // move along, this isn't the prop you're looking for
             md_PricesMap & prices = my_it->second;
             for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
                 md_Set & indexes = it->second;
@@ -143,22 +143,22 @@ void MetaDExDialog::PopulateAddresses()
         ui->sellAddressCombo->clear();
 
         // populate buy and sell addresses
-        for (std::map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-            string address = (my_it->first).c_str();
+        for (CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+            string address = my_it.getAddress();
             unsigned int id;
-            (my_it->second).init();
-            while (0 != (id = (my_it->second).next())) {
+            (my_it.getTally()).init();
+            while (0 != (id = (my_it.getTally()).next())) {
                 if (id == propertyId) {
                     if (!getUserAvailableMPbalance(address, propertyId)) continue; // ignore this address, has no available balance to spend
-                    if (IsMyAddress(address) == ISMINE_SPENDABLE) ui->sellAddressCombo->addItem((my_it->first).c_str()); // only include wallet addresses
+                    if (IsMyAddress(address) == ISMINE_SPENDABLE) ui->sellAddressCombo->addItem(address.c_str()); // only include wallet addresses
                 }
                 if (id == OMNI_PROPERTY_MSC && !testeco) {
                     if (!getUserAvailableMPbalance(address, OMNI_PROPERTY_MSC)) continue;
-                    if (IsMyAddress(address) == ISMINE_SPENDABLE) ui->buyAddressCombo->addItem((my_it->first).c_str());
+                    if (IsMyAddress(address) == ISMINE_SPENDABLE) ui->buyAddressCombo->addItem(address.c_str());
                 }
                 if (id == OMNI_PROPERTY_TMSC && testeco) {
                     if (!getUserAvailableMPbalance(address, OMNI_PROPERTY_TMSC)) continue;
-                    if (IsMyAddress(address) == ISMINE_SPENDABLE) ui->buyAddressCombo->addItem((my_it->first).c_str());
+                    if (IsMyAddress(address) == ISMINE_SPENDABLE) ui->buyAddressCombo->addItem(address.c_str());
                 }
             }
         }
@@ -359,8 +359,8 @@ void MetaDExDialog::UpdateOffers()
         LOCK(cs_tally);
 
         for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-            if ((!useBuyList) && (my_it->first != global_metadex_market)) { continue; } // not the property we're looking for, don't waste any more work
-            if ((useBuyList) && (((!testeco) && (my_it->first != OMNI_PROPERTY_MSC)) || ((testeco) && (my_it->first != OMNI_PROPERTY_TMSC)))) continue;
+            if ((!useBuyList) && (my_it->first.first != global_metadex_market)) { continue; } // not the property we're looking for, don't waste any more work
+            if ((useBuyList) && (((!testeco) && (my_it->first.first != OMNI_PROPERTY_MSC)) || ((testeco) && (my_it->first.first != OMNI_PROPERTY_TMSC)))) continue;
             md_PricesMap & prices = my_it->second;
             for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) { // loop through the sell prices for the property
                 std::string unitPriceStr;
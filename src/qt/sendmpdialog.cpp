@@ -177,12 +177,12 @@ void SendMPDialog::updateProperty()
     QString spId = ui->propertyComboBox->itemData(ui->propertyComboBox->currentIndex()).toString();
     uint32_t propertyId = spId.toUInt();
     LOCK(cs_tally);
-    for (std::map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        string address = (my_it->first).c_str();
+    for (CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+        string address = my_it.getAddress();
         uint32_t id = 0;
         bool includeAddress=false;
-        (my_it->second).init();
-        while (0 != (id = (my_it->second).next())) {
+        (my_it.getTally()).init();
+        while (0 != (id = (my_it.getTally()).next())) {
             if(id == propertyId) { includeAddress=true; break; }
         }
         if (!includeAddress) continue; //ignore this address, has never transacted in this propertyId
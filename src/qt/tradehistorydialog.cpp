@@ -33,8 +33,6 @@
 #include "json/json_spirit_value.h"
 #include "json/json_spirit_writer_template.h"
 
-#include <boost/algorithm/string.hpp>
-
 #include <stdint.h>
 #include <map>
 #include <sstream>
@@ -310,16 +308,12 @@ int TradeHistoryDialog::PopulateTradeHistoryMap()
         uint256 hash = pwtx->GetHash();
 
         // use levelDB to perform a fast check on whether it's a bitcoin or Omni tx and whether it's a trade
-        std::string tempStrValue;
+        CMPTxRecord record;
         {
             LOCK(cs_tally);
-            if (!p_txlistdb->getTX(hash, tempStrValue)) continue;
-        }
-        std::vector<std::string> vstr;
-        boost::split(vstr, tempStrValue, boost::is_any_of(":"), boost::token_compress_on);
-        if (vstr.size() > 2) {
-            if (atoi(vstr[2]) != MSC_TYPE_METADEX_TRADE) continue;
+            if (!p_txlistdb->getTX(hash, record)) continue;
         }
+        if (record.type != MSC_TYPE_METADEX_TRADE) continue;
 
         // check historyMap, if this tx exists don't waste resources doing anymore work on it
         TradeHistoryMap::iterator hIter = tradeHistoryMap.find(hash);
@@ -248,6 +248,7 @@ extern json_spirit::Value omni_getallbalancesforaddress(const json_spirit::Array
 extern json_spirit::Value omni_gettradehistoryforaddress(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value omni_gettradehistoryforpair(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value omni_getcurrentconsensushash(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value omni_getcurrentstatecommitment(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value omni_getpayload(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value omni_getseedblocks(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value omni_getmetadexhash(const json_spirit::Array& params, bool fHelp);
@@ -0,0 +1,1581 @@
+namespace json_tests{
+static unsigned const char base58_keys_valid[] = {
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x31, 0x41, 0x47, 0x4e, 0x61, 0x31, 0x35, 
+0x5a, 0x51, 0x58, 0x41, 0x5a, 0x55, 0x67, 0x46, 
+0x69, 0x71, 0x4a, 0x32, 0x69, 0x37, 0x5a, 0x32, 
+0x44, 0x50, 0x55, 0x32, 0x4a, 0x36, 0x68, 0x57, 
+0x36, 0x32, 0x69, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x36, 0x35, 0x61, 0x31, 0x36, 0x30, 0x35, 0x39, 
+0x38, 0x36, 0x34, 0x61, 0x32, 0x66, 0x64, 0x62, 
+0x63, 0x37, 0x63, 0x39, 0x39, 0x61, 0x34, 0x37, 
+0x32, 0x33, 0x61, 0x38, 0x33, 0x39, 0x35, 0x62, 
+0x63, 0x36, 0x66, 0x31, 0x38, 0x38, 0x65, 0x62, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 
+0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 
+0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x33, 0x43, 0x4d, 0x4e, 0x46, 0x78, 
+0x4e, 0x31, 0x6f, 0x48, 0x42, 0x63, 0x34, 0x52, 
+0x31, 0x45, 0x70, 0x62, 0x6f, 0x41, 0x4c, 0x35, 
+0x79, 0x7a, 0x48, 0x47, 0x67, 0x45, 0x36, 0x31, 
+0x31, 0x58, 0x6f, 0x75, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x37, 0x34, 0x66, 0x32, 0x30, 0x39, 0x66, 
+0x36, 0x65, 0x61, 0x39, 0x30, 0x37, 0x65, 0x32, 
+0x65, 0x61, 0x34, 0x38, 0x66, 0x37, 0x34, 0x66, 
+0x61, 0x65, 0x30, 0x35, 0x37, 0x38, 0x32, 0x61, 
+0x65, 0x38, 0x61, 0x36, 0x36, 0x35, 0x32, 0x35, 
+0x37, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 
+0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 
+0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x6d, 0x6f, 0x39, 0x6e, 0x63, 
+0x58, 0x69, 0x73, 0x4d, 0x65, 0x41, 0x6f, 0x58, 
+0x77, 0x71, 0x63, 0x56, 0x35, 0x45, 0x57, 0x75, 
+0x79, 0x6e, 0x63, 0x62, 0x6d, 0x43, 0x63, 0x51, 
+0x4e, 0x34, 0x72, 0x56, 0x73, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x35, 0x33, 0x63, 0x30, 0x33, 0x30, 
+0x37, 0x64, 0x36, 0x38, 0x35, 0x31, 0x61, 0x61, 
+0x30, 0x63, 0x65, 0x37, 0x38, 0x32, 0x35, 0x62, 
+0x61, 0x38, 0x38, 0x33, 0x63, 0x36, 0x62, 0x64, 
+0x39, 0x61, 0x64, 0x32, 0x34, 0x32, 0x62, 0x34, 
+0x38, 0x36, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 
+0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 
+0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x32, 0x4e, 0x32, 0x4a, 0x44, 
+0x36, 0x77, 0x62, 0x35, 0x36, 0x41, 0x66, 0x4b, 
+0x34, 0x74, 0x66, 0x6d, 0x4d, 0x36, 0x50, 0x77, 
+0x64, 0x56, 0x6d, 0x6f, 0x59, 0x6b, 0x32, 0x64, 
+0x43, 0x4b, 0x66, 0x34, 0x42, 0x72, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x36, 0x33, 0x34, 0x39, 0x61, 
+0x34, 0x31, 0x38, 0x66, 0x63, 0x34, 0x35, 0x37, 
+0x38, 0x64, 0x31, 0x30, 0x61, 0x33, 0x37, 0x32, 
+0x62, 0x35, 0x34, 0x62, 0x34, 0x35, 0x63, 0x32, 
+0x38, 0x30, 0x63, 0x63, 0x38, 0x63, 0x34, 0x33, 
+0x38, 0x32, 0x66, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 
+0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 
+0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x35, 0x4b, 0x64, 0x33, 
+0x4e, 0x42, 0x55, 0x41, 0x64, 0x55, 0x6e, 0x68, 
+0x79, 0x7a, 0x65, 0x6e, 0x45, 0x77, 0x56, 0x4c, 
+0x79, 0x39, 0x70, 0x42, 0x4b, 0x78, 0x53, 0x77, 
+0x58, 0x76, 0x45, 0x39, 0x46, 0x4d, 0x50, 0x79, 
+0x52, 0x34, 0x55, 0x4b, 0x5a, 0x76, 0x70, 0x65, 
+0x36, 0x45, 0x33, 0x41, 0x67, 0x4c, 0x72, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x65, 0x64, 0x64, 0x62, 
+0x64, 0x63, 0x31, 0x31, 0x36, 0x38, 0x66, 0x31, 
+0x64, 0x61, 0x65, 0x61, 0x64, 0x62, 0x64, 0x33, 
+0x65, 0x34, 0x34, 0x63, 0x31, 0x65, 0x33, 0x66, 
+0x38, 0x66, 0x35, 0x61, 0x32, 0x38, 0x34, 0x63, 
+0x32, 0x30, 0x32, 0x39, 0x66, 0x37, 0x38, 0x61, 
+0x64, 0x32, 0x36, 0x61, 0x66, 0x39, 0x38, 0x35, 
+0x38, 0x33, 0x61, 0x34, 0x39, 0x39, 0x64, 0x65, 
+0x35, 0x62, 0x31, 0x39, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 
+0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x4b, 0x7a, 
+0x36, 0x55, 0x4a, 0x6d, 0x51, 0x41, 0x43, 0x4a, 
+0x6d, 0x4c, 0x74, 0x61, 0x51, 0x6a, 0x35, 0x41, 
+0x33, 0x4a, 0x41, 0x67, 0x65, 0x34, 0x6b, 0x56, 
+0x54, 0x4e, 0x51, 0x38, 0x67, 0x62, 0x76, 0x58, 
+0x75, 0x77, 0x62, 0x6d, 0x43, 0x6a, 0x37, 0x62, 
+0x73, 0x61, 0x61, 0x62, 0x75, 0x64, 0x62, 0x33, 
+0x52, 0x44, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x35, 
+0x35, 0x63, 0x39, 0x62, 0x63, 0x63, 0x62, 0x39, 
+0x65, 0x64, 0x36, 0x38, 0x34, 0x34, 0x36, 0x64, 
+0x31, 0x62, 0x37, 0x35, 0x32, 0x37, 0x33, 0x62, 
+0x62, 0x63, 0x65, 0x38, 0x39, 0x64, 0x37, 0x66, 
+0x65, 0x30, 0x31, 0x33, 0x61, 0x38, 0x61, 0x63, 
+0x64, 0x31, 0x36, 0x32, 0x35, 0x35, 0x31, 0x34, 
+0x34, 0x32, 0x30, 0x66, 0x62, 0x32, 0x61, 0x63, 
+0x61, 0x31, 0x61, 0x32, 0x31, 0x63, 0x34, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 
+0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x39, 0x32, 0x31, 0x33, 0x71, 0x4a, 0x61, 0x62, 
+0x32, 0x48, 0x4e, 0x45, 0x70, 0x4d, 0x70, 0x59, 
+0x4e, 0x42, 0x61, 0x37, 0x77, 0x48, 0x47, 0x46, 
+0x4b, 0x4b, 0x62, 0x6b, 0x44, 0x6e, 0x32, 0x34, 
+0x6a, 0x70, 0x41, 0x4e, 0x44, 0x73, 0x32, 0x68, 
+0x75, 0x4e, 0x33, 0x79, 0x69, 0x34, 0x4a, 0x31, 
+0x31, 0x6b, 0x6f, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x33, 0x36, 0x63, 0x62, 0x39, 0x33, 0x62, 0x39, 
+0x61, 0x62, 0x31, 0x62, 0x64, 0x61, 0x62, 0x66, 
+0x37, 0x66, 0x62, 0x39, 0x66, 0x32, 0x63, 0x30, 
+0x34, 0x66, 0x31, 0x62, 0x39, 0x63, 0x63, 0x38, 
+0x37, 0x39, 0x39, 0x33, 0x33, 0x35, 0x33, 0x30, 
+0x61, 0x65, 0x37, 0x38, 0x34, 0x32, 0x33, 0x39, 
+0x38, 0x65, 0x65, 0x66, 0x35, 0x61, 0x36, 0x33, 
+0x61, 0x35, 0x36, 0x38, 0x30, 0x30, 0x63, 0x32, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 
+0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x63, 0x54, 0x70, 0x42, 0x34, 0x59, 0x69, 
+0x79, 0x4b, 0x69, 0x42, 0x63, 0x50, 0x78, 0x6e, 
+0x65, 0x66, 0x73, 0x44, 0x70, 0x62, 0x6e, 0x44, 
+0x78, 0x46, 0x44, 0x66, 0x66, 0x6a, 0x71, 0x4a, 
+0x6f, 0x62, 0x38, 0x77, 0x47, 0x43, 0x45, 0x44, 
+0x58, 0x78, 0x67, 0x51, 0x37, 0x7a, 0x51, 0x6f, 
+0x4d, 0x58, 0x4a, 0x64, 0x48, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x62, 0x39, 0x66, 0x34, 0x38, 0x39, 
+0x32, 0x63, 0x39, 0x65, 0x38, 0x32, 0x38, 0x32, 
+0x30, 0x32, 0x38, 0x66, 0x65, 0x61, 0x31, 0x64, 
+0x32, 0x36, 0x36, 0x37, 0x63, 0x34, 0x64, 0x63, 
+0x35, 0x32, 0x31, 0x33, 0x35, 0x36, 0x34, 0x64, 
+0x34, 0x31, 0x66, 0x63, 0x35, 0x37, 0x38, 0x33, 
+0x38, 0x39, 0x36, 0x61, 0x30, 0x64, 0x38, 0x34, 
+0x33, 0x66, 0x63, 0x31, 0x35, 0x30, 0x38, 0x39, 
+0x66, 0x33, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 
+0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 
+0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x31, 0x41, 0x78, 0x34, 0x67, 0x5a, 
+0x74, 0x62, 0x37, 0x67, 0x41, 0x69, 0x74, 0x32, 
+0x54, 0x69, 0x76, 0x77, 0x65, 0x6a, 0x5a, 0x48, 
+0x59, 0x74, 0x4e, 0x4e, 0x4c, 0x54, 0x31, 0x38, 
+0x50, 0x55, 0x58, 0x4a, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x36, 0x64, 0x32, 0x33, 0x31, 0x35, 0x36, 
+0x63, 0x62, 0x62, 0x64, 0x63, 0x63, 0x38, 0x32, 
+0x61, 0x35, 0x61, 0x34, 0x37, 0x65, 0x65, 0x65, 
+0x34, 0x63, 0x32, 0x63, 0x37, 0x63, 0x35, 0x38, 
+0x33, 0x63, 0x31, 0x38, 0x62, 0x36, 0x62, 0x66, 
+0x34, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 
+0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 
+0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x33, 0x51, 0x6a, 0x59, 0x58, 
+0x68, 0x54, 0x6b, 0x76, 0x75, 0x6a, 0x38, 0x71, 
+0x50, 0x61, 0x58, 0x48, 0x54, 0x54, 0x57, 0x62, 
+0x35, 0x77, 0x6a, 0x58, 0x68, 0x64, 0x73, 0x4c, 
+0x41, 0x41, 0x57, 0x56, 0x79, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x66, 0x63, 0x63, 0x35, 0x34, 0x36, 
+0x30, 0x64, 0x64, 0x36, 0x65, 0x32, 0x34, 0x38, 
+0x37, 0x63, 0x37, 0x64, 0x37, 0x35, 0x62, 0x31, 
+0x39, 0x36, 0x33, 0x36, 0x32, 0x35, 0x64, 0x61, 
+0x30, 0x65, 0x38, 0x66, 0x34, 0x63, 0x35, 0x39, 
+0x37, 0x35, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 
+0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 
+0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x6e, 0x33, 0x5a, 0x64, 
+0x64, 0x78, 0x7a, 0x4c, 0x76, 0x41, 0x59, 0x39, 
+0x6f, 0x37, 0x31, 0x38, 0x34, 0x54, 0x42, 0x34, 
+0x63, 0x36, 0x46, 0x4a, 0x61, 0x73, 0x41, 0x79, 
+0x62, 0x73, 0x77, 0x34, 0x48, 0x5a, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x66, 0x31, 0x64, 0x34, 0x37, 
+0x30, 0x66, 0x39, 0x62, 0x30, 0x32, 0x33, 0x37, 
+0x30, 0x66, 0x64, 0x65, 0x63, 0x32, 0x65, 0x36, 
+0x62, 0x37, 0x30, 0x38, 0x62, 0x30, 0x38, 0x61, 
+0x63, 0x34, 0x33, 0x31, 0x62, 0x66, 0x37, 0x61, 
+0x35, 0x66, 0x37, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 
+0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 
+0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x32, 0x4e, 0x42, 0x46, 
+0x4e, 0x4a, 0x54, 0x6b, 0x74, 0x4e, 0x61, 0x37, 
+0x47, 0x5a, 0x75, 0x73, 0x47, 0x62, 0x44, 0x62, 
+0x47, 0x4b, 0x52, 0x5a, 0x54, 0x78, 0x64, 0x4b, 
+0x39, 0x56, 0x56, 0x65, 0x7a, 0x33, 0x6e, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x63, 0x35, 0x37, 0x39, 
+0x33, 0x34, 0x32, 0x63, 0x32, 0x63, 0x34, 0x63, 
+0x39, 0x32, 0x32, 0x30, 0x32, 0x30, 0x35, 0x65, 
+0x32, 0x63, 0x64, 0x63, 0x32, 0x38, 0x35, 0x36, 
+0x31, 0x37, 0x30, 0x34, 0x30, 0x63, 0x39, 0x32, 
+0x34, 0x61, 0x30, 0x61, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 
+0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 
+0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 
+0x74, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x35, 0x4b, 0x34, 
+0x39, 0x34, 0x58, 0x5a, 0x77, 0x70, 0x73, 0x32, 
+0x62, 0x47, 0x79, 0x65, 0x4c, 0x37, 0x31, 0x70, 
+0x57, 0x69, 0x64, 0x34, 0x6e, 0x6f, 0x69, 0x53, 
+0x4e, 0x41, 0x32, 0x63, 0x66, 0x43, 0x69, 0x62, 
+0x72, 0x76, 0x52, 0x57, 0x71, 0x63, 0x48, 0x53, 
+0x70, 0x74, 0x6f, 0x46, 0x6e, 0x37, 0x72, 0x63, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x33, 0x32, 
+0x36, 0x62, 0x39, 0x35, 0x65, 0x62, 0x61, 0x65, 
+0x33, 0x30, 0x31, 0x36, 0x34, 0x32, 0x31, 0x37, 
+0x64, 0x37, 0x61, 0x37, 0x66, 0x35, 0x37, 0x64, 
+0x37, 0x32, 0x61, 0x62, 0x32, 0x62, 0x35, 0x34, 
+0x65, 0x33, 0x62, 0x65, 0x36, 0x34, 0x39, 0x32, 
+0x38, 0x61, 0x31, 0x39, 0x64, 0x61, 0x30, 0x32, 
+0x31, 0x30, 0x62, 0x39, 0x35, 0x36, 0x38, 0x64, 
+0x34, 0x30, 0x31, 0x35, 0x65, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 
+0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x4c, 
+0x31, 0x52, 0x72, 0x72, 0x6e, 0x58, 0x6b, 0x63, 
+0x4b, 0x75, 0x74, 0x35, 0x44, 0x45, 0x4d, 0x77, 
+0x74, 0x44, 0x74, 0x68, 0x6a, 0x77, 0x52, 0x63, 
+0x54, 0x54, 0x77, 0x45, 0x44, 0x33, 0x36, 0x74, 
+0x68, 0x79, 0x4c, 0x31, 0x44, 0x65, 0x62, 0x56, 
+0x72, 0x4b, 0x75, 0x77, 0x76, 0x6f, 0x68, 0x6a, 
+0x4d, 0x4e, 0x69, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x37, 0x64, 0x39, 0x39, 0x38, 0x62, 0x34, 0x35, 
+0x63, 0x32, 0x31, 0x39, 0x61, 0x31, 0x65, 0x33, 
+0x38, 0x65, 0x39, 0x39, 0x65, 0x37, 0x63, 0x62, 
+0x64, 0x33, 0x31, 0x32, 0x65, 0x66, 0x36, 0x37, 
+0x66, 0x37, 0x37, 0x61, 0x34, 0x35, 0x35, 0x61, 
+0x39, 0x62, 0x35, 0x30, 0x63, 0x37, 0x33, 0x30, 
+0x63, 0x32, 0x37, 0x66, 0x30, 0x32, 0x63, 0x36, 
+0x66, 0x37, 0x33, 0x30, 0x64, 0x66, 0x62, 0x34, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 
+0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x39, 0x33, 0x44, 0x56, 0x4b, 0x79, 0x46, 
+0x59, 0x77, 0x53, 0x4e, 0x36, 0x77, 0x45, 0x6f, 
+0x33, 0x45, 0x32, 0x66, 0x43, 0x72, 0x46, 0x50, 
+0x55, 0x70, 0x31, 0x37, 0x46, 0x74, 0x72, 0x74, 
+0x4e, 0x69, 0x32, 0x4c, 0x66, 0x37, 0x6e, 0x34, 
+0x47, 0x33, 0x67, 0x61, 0x72, 0x46, 0x62, 0x31, 
+0x36, 0x43, 0x52, 0x6a, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x64, 0x36, 0x62, 0x63, 0x61, 0x32, 0x35, 
+0x36, 0x62, 0x35, 0x61, 0x62, 0x63, 0x35, 0x36, 
+0x30, 0x32, 0x65, 0x63, 0x32, 0x65, 0x31, 0x63, 
+0x31, 0x32, 0x31, 0x61, 0x30, 0x38, 0x62, 0x30, 
+0x64, 0x61, 0x32, 0x35, 0x35, 0x36, 0x35, 0x38, 
+0x37, 0x34, 0x33, 0x30, 0x62, 0x63, 0x66, 0x37, 
+0x65, 0x31, 0x38, 0x39, 0x38, 0x61, 0x66, 0x32, 
+0x32, 0x32, 0x34, 0x38, 0x38, 0x35, 0x32, 0x30, 
+0x33, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 
+0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x63, 0x54, 0x44, 0x56, 0x4b, 0x74, 
+0x4d, 0x47, 0x56, 0x59, 0x57, 0x54, 0x48, 0x43, 
+0x62, 0x31, 0x41, 0x46, 0x6a, 0x6d, 0x56, 0x62, 
+0x45, 0x62, 0x57, 0x6a, 0x76, 0x4b, 0x70, 0x4b, 
+0x71, 0x4b, 0x67, 0x4d, 0x61, 0x52, 0x33, 0x51, 
+0x4a, 0x78, 0x54, 0x6f, 0x4d, 0x53, 0x51, 0x41, 
+0x68, 0x6d, 0x43, 0x65, 0x54, 0x4e, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x38, 0x31, 0x63, 0x61, 
+0x34, 0x65, 0x38, 0x66, 0x39, 0x30, 0x31, 0x38, 
+0x31, 0x65, 0x63, 0x34, 0x62, 0x36, 0x31, 0x62, 
+0x36, 0x61, 0x37, 0x65, 0x62, 0x39, 0x39, 0x38, 
+0x61, 0x66, 0x31, 0x37, 0x62, 0x32, 0x63, 0x62, 
+0x30, 0x34, 0x64, 0x65, 0x38, 0x61, 0x30, 0x33, 
+0x62, 0x35, 0x30, 0x34, 0x62, 0x39, 0x65, 0x33, 
+0x34, 0x63, 0x34, 0x63, 0x36, 0x31, 0x64, 0x62, 
+0x37, 0x64, 0x39, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 
+0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x31, 0x43, 0x35, 0x62, 0x53, 
+0x6a, 0x31, 0x69, 0x45, 0x47, 0x55, 0x67, 0x53, 
+0x54, 0x62, 0x7a, 0x69, 0x79, 0x6d, 0x47, 0x37, 
+0x43, 0x6e, 0x31, 0x38, 0x45, 0x4e, 0x51, 0x75, 
+0x54, 0x33, 0x36, 0x76, 0x76, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x37, 0x39, 0x38, 0x37, 0x63, 0x63, 
+0x61, 0x61, 0x35, 0x33, 0x64, 0x30, 0x32, 0x63, 
+0x38, 0x38, 0x37, 0x33, 0x34, 0x38, 0x37, 0x65, 
+0x66, 0x39, 0x31, 0x39, 0x36, 0x37, 0x37, 0x63, 
+0x64, 0x33, 0x64, 0x62, 0x37, 0x61, 0x36, 0x39, 
+0x31, 0x32, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 
+0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 
+0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x33, 0x41, 0x6e, 0x4e, 
+0x78, 0x61, 0x62, 0x59, 0x47, 0x6f, 0x54, 0x78, 
+0x59, 0x69, 0x54, 0x45, 0x5a, 0x77, 0x46, 0x45, 
+0x6e, 0x65, 0x72, 0x55, 0x6f, 0x65, 0x46, 0x58, 
+0x4b, 0x32, 0x5a, 0x6f, 0x6b, 0x73, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x36, 0x33, 0x62, 0x63, 0x63, 
+0x35, 0x36, 0x35, 0x66, 0x39, 0x65, 0x36, 0x38, 
+0x65, 0x65, 0x30, 0x31, 0x38, 0x39, 0x64, 0x64, 
+0x35, 0x63, 0x63, 0x36, 0x37, 0x66, 0x31, 0x62, 
+0x30, 0x65, 0x35, 0x66, 0x30, 0x32, 0x66, 0x34, 
+0x35, 0x63, 0x62, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 
+0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 
+0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x6e, 0x33, 0x4c, 
+0x6e, 0x4a, 0x58, 0x43, 0x71, 0x62, 0x50, 0x6a, 
+0x67, 0x68, 0x75, 0x56, 0x73, 0x38, 0x70, 0x68, 
+0x39, 0x43, 0x59, 0x73, 0x41, 0x65, 0x34, 0x53, 
+0x68, 0x34, 0x6a, 0x39, 0x37, 0x77, 0x6b, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x65, 0x66, 0x36, 0x36, 
+0x34, 0x34, 0x34, 0x62, 0x35, 0x62, 0x31, 0x37, 
+0x66, 0x31, 0x34, 0x65, 0x38, 0x66, 0x61, 0x65, 
+0x36, 0x65, 0x37, 0x65, 0x31, 0x39, 0x62, 0x30, 
+0x34, 0x35, 0x61, 0x37, 0x38, 0x63, 0x35, 0x34, 
+0x66, 0x64, 0x37, 0x39, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 
+0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 
+0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 
+0x79, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x32, 0x4e, 0x42, 
+0x37, 0x32, 0x58, 0x74, 0x6b, 0x6a, 0x70, 0x6e, 
+0x41, 0x54, 0x4d, 0x67, 0x67, 0x75, 0x69, 0x38, 
+0x33, 0x61, 0x45, 0x74, 0x50, 0x61, 0x77, 0x79, 
+0x79, 0x4b, 0x76, 0x6e, 0x62, 0x58, 0x32, 0x6f, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x63, 0x33, 0x65, 
+0x35, 0x35, 0x66, 0x63, 0x65, 0x63, 0x65, 0x61, 
+0x61, 0x34, 0x33, 0x39, 0x31, 0x65, 0x64, 0x32, 
+0x61, 0x39, 0x36, 0x37, 0x37, 0x66, 0x34, 0x61, 
+0x34, 0x64, 0x33, 0x34, 0x65, 0x61, 0x63, 0x64, 
+0x30, 0x32, 0x31, 0x61, 0x30, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 
+0x70, 0x74, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x35, 0x4b, 
+0x61, 0x42, 0x57, 0x39, 0x76, 0x4e, 0x74, 0x57, 
+0x4e, 0x68, 0x63, 0x33, 0x5a, 0x45, 0x44, 0x79, 
+0x4e, 0x43, 0x69, 0x58, 0x4c, 0x50, 0x64, 0x56, 
+0x50, 0x48, 0x43, 0x69, 0x6b, 0x52, 0x78, 0x53, 
+0x42, 0x57, 0x77, 0x56, 0x39, 0x4e, 0x72, 0x70, 
+0x4c, 0x4c, 0x61, 0x34, 0x4c, 0x73, 0x58, 0x69, 
+0x39, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x65, 0x37, 
+0x35, 0x64, 0x39, 0x33, 0x36, 0x64, 0x35, 0x36, 
+0x33, 0x37, 0x37, 0x66, 0x34, 0x33, 0x32, 0x66, 
+0x34, 0x30, 0x34, 0x61, 0x61, 0x62, 0x62, 0x34, 
+0x30, 0x36, 0x36, 0x30, 0x31, 0x66, 0x38, 0x39, 
+0x32, 0x66, 0x64, 0x34, 0x39, 0x64, 0x61, 0x39, 
+0x30, 0x65, 0x62, 0x36, 0x61, 0x63, 0x35, 0x35, 
+0x38, 0x61, 0x37, 0x33, 0x33, 0x63, 0x39, 0x33, 
+0x62, 0x34, 0x37, 0x32, 0x35, 0x32, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 
+0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x4c, 0x31, 0x61, 0x78, 0x7a, 0x62, 0x53, 0x79, 
+0x79, 0x6e, 0x4e, 0x59, 0x41, 0x38, 0x6d, 0x43, 
+0x41, 0x68, 0x7a, 0x78, 0x6b, 0x69, 0x70, 0x4b, 
+0x6b, 0x66, 0x48, 0x74, 0x41, 0x58, 0x59, 0x46, 
+0x34, 0x59, 0x51, 0x6e, 0x68, 0x53, 0x4b, 0x63, 
+0x4c, 0x56, 0x38, 0x59, 0x58, 0x41, 0x38, 0x37, 
+0x34, 0x66, 0x67, 0x54, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x38, 0x32, 0x34, 0x38, 0x62, 0x64, 0x30, 
+0x33, 0x37, 0x35, 0x66, 0x32, 0x66, 0x37, 0x35, 
+0x64, 0x37, 0x65, 0x32, 0x37, 0x34, 0x61, 0x65, 
+0x35, 0x34, 0x34, 0x66, 0x62, 0x39, 0x32, 0x30, 
+0x66, 0x35, 0x31, 0x37, 0x38, 0x34, 0x34, 0x38, 
+0x30, 0x38, 0x36, 0x36, 0x62, 0x31, 0x30, 0x32, 
+0x33, 0x38, 0x34, 0x31, 0x39, 0x30, 0x62, 0x31, 
+0x61, 0x64, 0x64, 0x66, 0x62, 0x61, 0x61, 0x35, 
+0x63, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 
+0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x39, 0x32, 0x37, 0x43, 0x6e, 0x55, 
+0x6b, 0x55, 0x62, 0x61, 0x73, 0x59, 0x74, 0x44, 
+0x77, 0x59, 0x77, 0x56, 0x6e, 0x32, 0x6a, 0x38, 
+0x47, 0x64, 0x54, 0x75, 0x41, 0x43, 0x4e, 0x6e, 
+0x4b, 0x6b, 0x6a, 0x5a, 0x31, 0x72, 0x70, 0x5a, 
+0x64, 0x32, 0x79, 0x42, 0x42, 0x31, 0x43, 0x4c, 
+0x63, 0x6e, 0x58, 0x70, 0x6f, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x34, 0x34, 0x63, 0x34, 0x66, 0x36, 
+0x61, 0x30, 0x39, 0x36, 0x65, 0x61, 0x63, 0x35, 
+0x32, 0x33, 0x38, 0x32, 0x39, 0x31, 0x61, 0x39, 
+0x34, 0x63, 0x63, 0x32, 0x34, 0x63, 0x30, 0x31, 
+0x65, 0x33, 0x62, 0x31, 0x39, 0x62, 0x38, 0x64, 
+0x38, 0x63, 0x65, 0x66, 0x37, 0x32, 0x38, 0x37, 
+0x34, 0x61, 0x30, 0x37, 0x39, 0x65, 0x30, 0x30, 
+0x61, 0x32, 0x34, 0x32, 0x32, 0x33, 0x37, 0x61, 
+0x35, 0x32, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 
+0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 
+0x64, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x63, 0x55, 0x63, 0x66, 0x43, 
+0x4d, 0x52, 0x6a, 0x69, 0x51, 0x66, 0x38, 0x35, 
+0x59, 0x4d, 0x7a, 0x7a, 0x51, 0x45, 0x6b, 0x39, 
+0x64, 0x31, 0x73, 0x35, 0x41, 0x34, 0x4b, 0x37, 
+0x78, 0x4c, 0x35, 0x53, 0x6d, 0x42, 0x43, 0x4c, 
+0x72, 0x65, 0x7a, 0x71, 0x58, 0x46, 0x75, 0x54, 
+0x56, 0x65, 0x66, 0x79, 0x68, 0x59, 0x37, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x64, 0x31, 0x64, 0x65, 
+0x37, 0x30, 0x37, 0x30, 0x32, 0x30, 0x61, 0x39, 
+0x30, 0x35, 0x39, 0x64, 0x36, 0x64, 0x33, 0x61, 
+0x62, 0x61, 0x66, 0x38, 0x35, 0x65, 0x31, 0x37, 
+0x39, 0x36, 0x37, 0x63, 0x36, 0x35, 0x35, 0x35, 
+0x31, 0x35, 0x31, 0x31, 0x34, 0x33, 0x64, 0x62, 
+0x31, 0x33, 0x64, 0x62, 0x62, 0x30, 0x36, 0x64, 
+0x62, 0x37, 0x38, 0x64, 0x66, 0x30, 0x66, 0x31, 
+0x35, 0x63, 0x36, 0x39, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 
+0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x31, 0x47, 0x71, 0x6b, 
+0x34, 0x54, 0x76, 0x37, 0x39, 0x50, 0x39, 0x31, 
+0x43, 0x63, 0x31, 0x53, 0x54, 0x51, 0x74, 0x55, 
+0x33, 0x73, 0x31, 0x57, 0x36, 0x32, 0x37, 0x37, 
+0x4d, 0x32, 0x43, 0x56, 0x57, 0x75, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x64, 0x63, 0x31, 0x63, 
+0x63, 0x32, 0x30, 0x38, 0x31, 0x61, 0x32, 0x37, 
+0x32, 0x30, 0x36, 0x66, 0x61, 0x65, 0x32, 0x35, 
+0x37, 0x39, 0x32, 0x66, 0x32, 0x38, 0x62, 0x62, 
+0x63, 0x35, 0x35, 0x62, 0x38, 0x33, 0x31, 0x35, 
+0x34, 0x39, 0x64, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 
+0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 
+0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x33, 0x33, 0x76, 
+0x74, 0x38, 0x56, 0x69, 0x48, 0x35, 0x6a, 0x73, 
+0x72, 0x31, 0x31, 0x35, 0x41, 0x47, 0x6b, 0x57, 
+0x36, 0x63, 0x45, 0x6d, 0x45, 0x7a, 0x39, 0x4d, 
+0x70, 0x76, 0x4a, 0x53, 0x77, 0x44, 0x6b, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x31, 0x38, 0x38, 0x66, 
+0x39, 0x31, 0x61, 0x39, 0x33, 0x31, 0x39, 0x34, 
+0x37, 0x65, 0x64, 0x64, 0x64, 0x37, 0x34, 0x33, 
+0x32, 0x64, 0x36, 0x65, 0x36, 0x31, 0x34, 0x33, 
+0x38, 0x37, 0x65, 0x33, 0x32, 0x62, 0x32, 0x34, 
+0x34, 0x37, 0x30, 0x39, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 
+0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 
+0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 
+0x74, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x6d, 0x68, 
+0x61, 0x4d, 0x63, 0x42, 0x78, 0x4e, 0x68, 0x35, 
+0x63, 0x71, 0x58, 0x6d, 0x34, 0x61, 0x54, 0x51, 
+0x36, 0x45, 0x63, 0x56, 0x62, 0x4b, 0x74, 0x66, 
+0x4c, 0x36, 0x4c, 0x47, 0x79, 0x4b, 0x32, 0x48, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x31, 0x36, 0x39, 
+0x34, 0x66, 0x35, 0x62, 0x63, 0x31, 0x61, 0x37, 
+0x32, 0x39, 0x35, 0x62, 0x36, 0x30, 0x30, 0x66, 
+0x34, 0x30, 0x30, 0x31, 0x38, 0x61, 0x36, 0x31, 
+0x38, 0x61, 0x36, 0x65, 0x61, 0x34, 0x38, 0x65, 
+0x65, 0x62, 0x34, 0x39, 0x38, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 
+0x65, 0x79, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x32, 0x4d, 
+0x78, 0x67, 0x50, 0x71, 0x58, 0x31, 0x69, 0x54, 
+0x68, 0x57, 0x33, 0x6f, 0x5a, 0x56, 0x6b, 0x39, 
+0x4b, 0x6f, 0x46, 0x63, 0x45, 0x35, 0x4d, 0x34, 
+0x4a, 0x70, 0x69, 0x45, 0x54, 0x73, 0x73, 0x56, 
+0x4e, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x33, 0x62, 
+0x39, 0x62, 0x33, 0x66, 0x64, 0x37, 0x61, 0x35, 
+0x30, 0x64, 0x34, 0x66, 0x30, 0x38, 0x64, 0x31, 
+0x61, 0x35, 0x62, 0x30, 0x66, 0x36, 0x32, 0x66, 
+0x36, 0x34, 0x34, 0x66, 0x61, 0x37, 0x31, 0x31, 
+0x35, 0x61, 0x65, 0x32, 0x66, 0x33, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 
+0x69, 0x70, 0x74, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x35, 
+0x48, 0x74, 0x48, 0x36, 0x47, 0x64, 0x63, 0x77, 
+0x43, 0x4a, 0x41, 0x34, 0x67, 0x67, 0x57, 0x45, 
+0x4c, 0x31, 0x42, 0x33, 0x6a, 0x7a, 0x42, 0x42, 
+0x55, 0x42, 0x38, 0x48, 0x50, 0x69, 0x42, 0x69, 
+0x39, 0x53, 0x42, 0x63, 0x35, 0x68, 0x39, 0x69, 
+0x34, 0x57, 0x6b, 0x34, 0x50, 0x53, 0x65, 0x41, 
+0x70, 0x52, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x30, 
+0x39, 0x31, 0x30, 0x33, 0x35, 0x34, 0x34, 0x35, 
+0x65, 0x66, 0x31, 0x30, 0x35, 0x66, 0x61, 0x31, 
+0x62, 0x62, 0x31, 0x32, 0x35, 0x65, 0x63, 0x63, 
+0x66, 0x62, 0x31, 0x38, 0x38, 0x32, 0x66, 0x33, 
+0x66, 0x65, 0x36, 0x39, 0x35, 0x39, 0x32, 0x32, 
+0x36, 0x35, 0x39, 0x35, 0x36, 0x61, 0x64, 0x65, 
+0x37, 0x35, 0x31, 0x66, 0x64, 0x30, 0x39, 0x35, 
+0x30, 0x33, 0x33, 0x64, 0x38, 0x64, 0x30, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 
+0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x4c, 0x32, 0x78, 0x53, 0x59, 0x6d, 0x4d, 
+0x65, 0x56, 0x6f, 0x33, 0x5a, 0x65, 0x6b, 0x33, 
+0x5a, 0x54, 0x73, 0x76, 0x39, 0x78, 0x55, 0x72, 
+0x58, 0x56, 0x41, 0x6d, 0x72, 0x57, 0x78, 0x4a, 
+0x38, 0x55, 0x61, 0x34, 0x63, 0x77, 0x38, 0x70, 
+0x6b, 0x66, 0x62, 0x51, 0x68, 0x63, 0x45, 0x46, 
+0x68, 0x6b, 0x58, 0x54, 0x38, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x61, 0x62, 0x32, 0x62, 0x34, 0x62, 
+0x63, 0x64, 0x66, 0x63, 0x39, 0x31, 0x64, 0x33, 
+0x34, 0x64, 0x65, 0x65, 0x30, 0x61, 0x65, 0x32, 
+0x61, 0x38, 0x63, 0x36, 0x62, 0x36, 0x36, 0x36, 
+0x38, 0x64, 0x61, 0x64, 0x61, 0x65, 0x62, 0x33, 
+0x61, 0x38, 0x38, 0x62, 0x39, 0x38, 0x35, 0x39, 
+0x37, 0x34, 0x33, 0x31, 0x35, 0x36, 0x66, 0x34, 
+0x36, 0x32, 0x33, 0x32, 0x35, 0x31, 0x38, 0x37, 
+0x61, 0x66, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 
+0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 
+0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x39, 0x32, 0x78, 0x46, 0x45, 
+0x76, 0x65, 0x31, 0x5a, 0x39, 0x4e, 0x38, 0x5a, 
+0x36, 0x34, 0x31, 0x4b, 0x51, 0x51, 0x53, 0x37, 
+0x42, 0x79, 0x43, 0x53, 0x62, 0x38, 0x6b, 0x47, 
+0x6a, 0x73, 0x44, 0x7a, 0x77, 0x36, 0x66, 0x41, 
+0x6d, 0x6a, 0x48, 0x4e, 0x31, 0x4c, 0x5a, 0x47, 
+0x4b, 0x51, 0x58, 0x79, 0x4d, 0x71, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x62, 0x34, 0x32, 0x30, 0x34, 
+0x33, 0x38, 0x39, 0x63, 0x65, 0x66, 0x31, 0x38, 
+0x62, 0x62, 0x65, 0x32, 0x62, 0x33, 0x35, 0x33, 
+0x36, 0x32, 0x33, 0x63, 0x62, 0x66, 0x39, 0x33, 
+0x65, 0x38, 0x36, 0x37, 0x38, 0x66, 0x62, 0x63, 
+0x39, 0x32, 0x61, 0x34, 0x37, 0x35, 0x62, 0x36, 
+0x36, 0x34, 0x61, 0x65, 0x39, 0x38, 0x65, 0x64, 
+0x35, 0x39, 0x34, 0x65, 0x36, 0x63, 0x66, 0x30, 
+0x38, 0x35, 0x36, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 
+0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x63, 0x56, 0x4d, 0x36, 
+0x35, 0x74, 0x64, 0x59, 0x75, 0x31, 0x59, 0x4b, 
+0x33, 0x37, 0x74, 0x4e, 0x6f, 0x41, 0x79, 0x47, 
+0x6f, 0x4a, 0x54, 0x52, 0x31, 0x33, 0x56, 0x42, 
+0x59, 0x46, 0x76, 0x61, 0x31, 0x76, 0x67, 0x39, 
+0x46, 0x4c, 0x75, 0x50, 0x41, 0x73, 0x4a, 0x69, 
+0x6a, 0x47, 0x76, 0x47, 0x36, 0x4e, 0x45, 0x41, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x65, 0x37, 0x62, 
+0x32, 0x33, 0x30, 0x31, 0x33, 0x33, 0x66, 0x31, 
+0x62, 0x35, 0x34, 0x38, 0x39, 0x38, 0x34, 0x33, 
+0x32, 0x36, 0x30, 0x32, 0x33, 0x36, 0x62, 0x30, 
+0x36, 0x65, 0x64, 0x63, 0x61, 0x32, 0x35, 0x66, 
+0x36, 0x36, 0x61, 0x64, 0x62, 0x31, 0x62, 0x65, 
+0x34, 0x35, 0x35, 0x66, 0x62, 0x64, 0x33, 0x38, 
+0x64, 0x34, 0x30, 0x31, 0x30, 0x64, 0x34, 0x38, 
+0x66, 0x61, 0x65, 0x65, 0x66, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 
+0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x31, 0x4a, 0x77, 
+0x4d, 0x57, 0x42, 0x56, 0x4c, 0x74, 0x69, 0x71, 
+0x74, 0x73, 0x63, 0x62, 0x61, 0x52, 0x48, 0x61, 
+0x69, 0x34, 0x70, 0x71, 0x48, 0x6f, 0x6b, 0x68, 
+0x46, 0x43, 0x62, 0x74, 0x6f, 0x42, 0x34, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x63, 0x34, 0x63, 0x31, 
+0x62, 0x37, 0x32, 0x34, 0x39, 0x31, 0x65, 0x64, 
+0x65, 0x31, 0x65, 0x65, 0x64, 0x61, 0x63, 0x61, 
+0x30, 0x30, 0x36, 0x31, 0x38, 0x34, 0x30, 0x37, 
+0x65, 0x65, 0x30, 0x62, 0x37, 0x37, 0x32, 0x63, 
+0x61, 0x64, 0x30, 0x64, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 
+0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 
+0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 
+0x79, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x33, 0x51, 
+0x43, 0x7a, 0x76, 0x66, 0x4c, 0x34, 0x5a, 0x52, 
+0x76, 0x6d, 0x4a, 0x46, 0x69, 0x57, 0x57, 0x42, 
+0x56, 0x77, 0x78, 0x66, 0x64, 0x61, 0x4e, 0x42, 
+0x54, 0x38, 0x45, 0x74, 0x78, 0x42, 0x35, 0x79, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x66, 0x36, 0x66, 
+0x65, 0x36, 0x39, 0x62, 0x63, 0x62, 0x35, 0x34, 
+0x38, 0x61, 0x38, 0x32, 0x39, 0x63, 0x63, 0x65, 
+0x34, 0x63, 0x35, 0x37, 0x62, 0x66, 0x36, 0x66, 
+0x66, 0x66, 0x38, 0x61, 0x66, 0x33, 0x61, 0x35, 
+0x39, 0x38, 0x31, 0x66, 0x39, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 
+0x70, 0x74, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x6d, 
+0x69, 0x7a, 0x58, 0x69, 0x75, 0x63, 0x58, 0x52, 
+0x43, 0x73, 0x45, 0x72, 0x69, 0x51, 0x43, 0x48, 
+0x55, 0x6b, 0x43, 0x71, 0x65, 0x66, 0x39, 0x70, 
+0x68, 0x39, 0x71, 0x74, 0x50, 0x62, 0x5a, 0x5a, 
+0x36, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x32, 0x36, 
+0x31, 0x66, 0x38, 0x33, 0x35, 0x36, 0x38, 0x61, 
+0x30, 0x39, 0x38, 0x61, 0x38, 0x36, 0x33, 0x38, 
+0x38, 0x34, 0x34, 0x62, 0x64, 0x37, 0x61, 0x65, 
+0x63, 0x61, 0x30, 0x33, 0x39, 0x64, 0x35, 0x66, 
+0x32, 0x33, 0x35, 0x32, 0x63, 0x30, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 
+0x6b, 0x65, 0x79, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x32, 
+0x4e, 0x45, 0x57, 0x44, 0x7a, 0x48, 0x57, 0x77, 
+0x59, 0x35, 0x5a, 0x5a, 0x70, 0x38, 0x43, 0x51, 
+0x57, 0x62, 0x42, 0x37, 0x6f, 0x75, 0x4e, 0x4d, 
+0x4c, 0x71, 0x43, 0x69, 0x61, 0x36, 0x59, 0x52, 
+0x64, 0x61, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x65, 
+0x39, 0x33, 0x30, 0x65, 0x31, 0x38, 0x33, 0x34, 
+0x61, 0x34, 0x64, 0x32, 0x33, 0x34, 0x37, 0x30, 
+0x32, 0x37, 0x37, 0x33, 0x39, 0x35, 0x31, 0x64, 
+0x36, 0x32, 0x37, 0x63, 0x63, 0x65, 0x38, 0x32, 
+0x66, 0x62, 0x62, 0x35, 0x64, 0x32, 0x65, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 
+0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 
+0x72, 0x69, 0x70, 0x74, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x35, 0x4b, 0x51, 0x6d, 0x44, 0x72, 0x79, 0x4d, 
+0x4e, 0x44, 0x63, 0x69, 0x73, 0x54, 0x7a, 0x52, 
+0x70, 0x33, 0x7a, 0x45, 0x71, 0x39, 0x65, 0x34, 
+0x61, 0x77, 0x52, 0x6d, 0x4a, 0x72, 0x45, 0x56, 
+0x55, 0x31, 0x6a, 0x35, 0x76, 0x46, 0x52, 0x54, 
+0x4b, 0x70, 0x52, 0x4e, 0x59, 0x50, 0x71, 0x59, 
+0x72, 0x4d, 0x67, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x64, 0x31, 0x66, 0x61, 0x62, 0x37, 0x61, 0x62, 
+0x37, 0x33, 0x38, 0x35, 0x61, 0x64, 0x32, 0x36, 
+0x38, 0x37, 0x32, 0x32, 0x33, 0x37, 0x66, 0x31, 
+0x65, 0x62, 0x39, 0x37, 0x38, 0x39, 0x61, 0x61, 
+0x32, 0x35, 0x63, 0x63, 0x39, 0x38, 0x36, 0x62, 
+0x61, 0x63, 0x63, 0x36, 0x39, 0x35, 0x65, 0x30, 
+0x37, 0x61, 0x63, 0x35, 0x37, 0x31, 0x64, 0x36, 
+0x63, 0x64, 0x61, 0x63, 0x38, 0x62, 0x63, 0x30, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 
+0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x4c, 0x33, 0x39, 0x46, 0x79, 0x37, 
+0x41, 0x43, 0x32, 0x48, 0x68, 0x6a, 0x39, 0x35, 
+0x67, 0x68, 0x33, 0x59, 0x62, 0x32, 0x41, 0x55, 
+0x35, 0x59, 0x48, 0x68, 0x31, 0x6d, 0x51, 0x53, 
+0x41, 0x48, 0x67, 0x70, 0x4e, 0x69, 0x78, 0x76, 
+0x6d, 0x32, 0x37, 0x70, 0x6f, 0x69, 0x7a, 0x63, 
+0x4a, 0x79, 0x4c, 0x74, 0x55, 0x69, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x62, 0x30, 0x62, 0x62, 0x65, 
+0x64, 0x65, 0x33, 0x33, 0x65, 0x66, 0x32, 0x35, 
+0x34, 0x65, 0x38, 0x33, 0x37, 0x36, 0x61, 0x63, 
+0x65, 0x62, 0x31, 0x35, 0x31, 0x30, 0x32, 0x35, 
+0x33, 0x66, 0x63, 0x33, 0x35, 0x35, 0x30, 0x65, 
+0x66, 0x64, 0x30, 0x66, 0x63, 0x66, 0x38, 0x34, 
+0x64, 0x63, 0x64, 0x30, 0x63, 0x39, 0x39, 0x39, 
+0x38, 0x62, 0x32, 0x38, 0x38, 0x66, 0x31, 0x36, 
+0x36, 0x62, 0x33, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 
+0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x39, 0x31, 0x63, 0x54, 
+0x56, 0x55, 0x63, 0x67, 0x79, 0x64, 0x71, 0x79, 
+0x5a, 0x4c, 0x67, 0x61, 0x41, 0x4e, 0x70, 0x66, 
+0x31, 0x66, 0x76, 0x4c, 0x35, 0x35, 0x46, 0x48, 
+0x35, 0x33, 0x51, 0x4d, 0x6d, 0x34, 0x42, 0x73, 
+0x6e, 0x43, 0x41, 0x44, 0x56, 0x4e, 0x59, 0x75, 
+0x57, 0x75, 0x71, 0x64, 0x56, 0x79, 0x73, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x30, 0x33, 0x37, 0x66, 
+0x34, 0x31, 0x39, 0x32, 0x63, 0x36, 0x33, 0x30, 
+0x66, 0x33, 0x39, 0x39, 0x64, 0x39, 0x32, 0x37, 
+0x31, 0x65, 0x32, 0x36, 0x63, 0x35, 0x37, 0x35, 
+0x32, 0x36, 0x39, 0x62, 0x31, 0x64, 0x31, 0x35, 
+0x62, 0x65, 0x35, 0x35, 0x33, 0x65, 0x61, 0x31, 
+0x61, 0x37, 0x32, 0x31, 0x37, 0x66, 0x30, 0x63, 
+0x62, 0x38, 0x35, 0x31, 0x33, 0x63, 0x65, 0x66, 
+0x34, 0x31, 0x63, 0x62, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 
+0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x63, 0x51, 0x73, 
+0x70, 0x66, 0x53, 0x7a, 0x73, 0x67, 0x4c, 0x65, 
+0x69, 0x4a, 0x47, 0x42, 0x32, 0x75, 0x38, 0x76, 
+0x72, 0x41, 0x69, 0x57, 0x70, 0x43, 0x55, 0x34, 
+0x4d, 0x78, 0x55, 0x54, 0x36, 0x4a, 0x73, 0x65, 
+0x57, 0x6f, 0x32, 0x53, 0x6a, 0x58, 0x79, 0x34, 
+0x51, 0x62, 0x7a, 0x6e, 0x32, 0x66, 0x77, 0x44, 
+0x77, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x36, 0x32, 
+0x35, 0x31, 0x65, 0x32, 0x30, 0x35, 0x65, 0x38, 
+0x61, 0x64, 0x35, 0x30, 0x38, 0x62, 0x61, 0x62, 
+0x35, 0x35, 0x39, 0x36, 0x62, 0x65, 0x65, 0x30, 
+0x38, 0x36, 0x65, 0x66, 0x31, 0x36, 0x63, 0x64, 
+0x34, 0x62, 0x32, 0x33, 0x39, 0x65, 0x30, 0x63, 
+0x63, 0x30, 0x63, 0x35, 0x64, 0x37, 0x63, 0x34, 
+0x65, 0x36, 0x30, 0x33, 0x35, 0x34, 0x34, 0x31, 
+0x65, 0x37, 0x64, 0x35, 0x64, 0x65, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 
+0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x31, 0x39, 
+0x64, 0x63, 0x61, 0x77, 0x6f, 0x4b, 0x63, 0x5a, 
+0x64, 0x51, 0x7a, 0x33, 0x36, 0x35, 0x57, 0x70, 
+0x58, 0x57, 0x4d, 0x68, 0x58, 0x36, 0x51, 0x43, 
+0x55, 0x70, 0x52, 0x39, 0x53, 0x59, 0x34, 0x72, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x35, 0x65, 0x61, 
+0x64, 0x61, 0x66, 0x39, 0x62, 0x62, 0x37, 0x31, 
+0x32, 0x31, 0x66, 0x30, 0x66, 0x31, 0x39, 0x32, 
+0x35, 0x36, 0x31, 0x61, 0x35, 0x61, 0x36, 0x32, 
+0x66, 0x35, 0x65, 0x35, 0x66, 0x35, 0x34, 0x32, 
+0x31, 0x30, 0x32, 0x39, 0x32, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 
+0x65, 0x79, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x33, 
+0x37, 0x53, 0x70, 0x36, 0x52, 0x76, 0x33, 0x79, 
+0x34, 0x6b, 0x56, 0x64, 0x31, 0x6e, 0x51, 0x31, 
+0x4a, 0x56, 0x35, 0x70, 0x66, 0x71, 0x58, 0x63, 
+0x63, 0x48, 0x4e, 0x79, 0x5a, 0x6d, 0x31, 0x78, 
+0x33, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x33, 0x66, 
+0x32, 0x31, 0x30, 0x65, 0x37, 0x32, 0x37, 0x37, 
+0x63, 0x38, 0x39, 0x39, 0x63, 0x33, 0x61, 0x31, 
+0x35, 0x35, 0x63, 0x63, 0x31, 0x63, 0x39, 0x30, 
+0x66, 0x34, 0x31, 0x30, 0x36, 0x63, 0x62, 0x64, 
+0x64, 0x65, 0x65, 0x63, 0x36, 0x65, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 
+0x69, 0x70, 0x74, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x6d, 0x79, 0x6f, 0x71, 0x63, 0x67, 0x59, 0x69, 
+0x65, 0x68, 0x75, 0x66, 0x72, 0x73, 0x6e, 0x6e, 
+0x6b, 0x71, 0x64, 0x71, 0x62, 0x70, 0x36, 0x39, 
+0x64, 0x64, 0x64, 0x56, 0x44, 0x4d, 0x6f, 0x70, 
+0x4a, 0x75, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x63, 
+0x38, 0x61, 0x33, 0x63, 0x32, 0x61, 0x30, 0x39, 
+0x61, 0x32, 0x39, 0x38, 0x35, 0x39, 0x32, 0x63, 
+0x33, 0x65, 0x31, 0x38, 0x30, 0x66, 0x30, 0x32, 
+0x34, 0x38, 0x37, 0x63, 0x64, 0x39, 0x31, 0x62, 
+0x61, 0x33, 0x34, 0x30, 0x30, 0x62, 0x35, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 
+0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 
+0x62, 0x6b, 0x65, 0x79, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x32, 0x4e, 0x37, 0x46, 0x75, 0x77, 0x75, 0x55, 
+0x75, 0x6f, 0x54, 0x42, 0x72, 0x44, 0x46, 0x64, 
+0x72, 0x41, 0x5a, 0x39, 0x4b, 0x78, 0x42, 0x6d, 
+0x74, 0x71, 0x4d, 0x4c, 0x78, 0x63, 0x65, 0x39, 
+0x69, 0x31, 0x43, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x39, 0x39, 0x62, 0x33, 0x31, 0x64, 0x66, 0x37, 
+0x63, 0x39, 0x30, 0x36, 0x38, 0x64, 0x31, 0x34, 
+0x38, 0x31, 0x62, 0x35, 0x39, 0x36, 0x35, 0x37, 
+0x38, 0x64, 0x64, 0x62, 0x62, 0x34, 0x64, 0x33, 
+0x62, 0x64, 0x39, 0x30, 0x62, 0x61, 0x65, 0x62, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 
+0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 
+0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x35, 0x4b, 0x4c, 0x36, 0x7a, 0x45, 0x61, 
+0x4d, 0x74, 0x50, 0x52, 0x58, 0x5a, 0x4b, 0x6f, 
+0x31, 0x62, 0x62, 0x4d, 0x71, 0x37, 0x4a, 0x44, 
+0x6a, 0x6a, 0x6f, 0x31, 0x62, 0x4a, 0x75, 0x51, 
+0x63, 0x73, 0x67, 0x4c, 0x33, 0x33, 0x6a, 0x65, 
+0x33, 0x6f, 0x59, 0x38, 0x75, 0x53, 0x4a, 0x43, 
+0x52, 0x35, 0x62, 0x34, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x63, 0x37, 0x36, 0x36, 0x36, 0x38, 0x34, 
+0x32, 0x35, 0x30, 0x33, 0x64, 0x62, 0x36, 0x64, 
+0x63, 0x36, 0x65, 0x61, 0x30, 0x36, 0x31, 0x66, 
+0x30, 0x39, 0x32, 0x63, 0x66, 0x62, 0x39, 0x63, 
+0x33, 0x38, 0x38, 0x34, 0x34, 0x38, 0x36, 0x32, 
+0x39, 0x61, 0x36, 0x66, 0x65, 0x38, 0x36, 0x38, 
+0x64, 0x30, 0x36, 0x38, 0x63, 0x34, 0x32, 0x61, 
+0x34, 0x38, 0x38, 0x62, 0x34, 0x37, 0x38, 0x61, 
+0x65, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 
+0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x4b, 0x77, 0x56, 0x39, 0x4b, 
+0x41, 0x66, 0x77, 0x62, 0x77, 0x74, 0x35, 0x31, 
+0x76, 0x65, 0x5a, 0x57, 0x4e, 0x73, 0x63, 0x52, 
+0x54, 0x65, 0x5a, 0x73, 0x39, 0x43, 0x4b, 0x70, 
+0x6f, 0x6a, 0x79, 0x75, 0x31, 0x4d, 0x73, 0x50, 
+0x6e, 0x61, 0x4b, 0x54, 0x46, 0x35, 0x6b, 0x7a, 
+0x36, 0x39, 0x48, 0x31, 0x55, 0x4e, 0x32, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x30, 0x37, 0x66, 0x30, 
+0x38, 0x30, 0x33, 0x66, 0x63, 0x35, 0x33, 0x39, 
+0x39, 0x65, 0x37, 0x37, 0x33, 0x35, 0x35, 0x35, 
+0x61, 0x62, 0x31, 0x65, 0x38, 0x39, 0x33, 0x39, 
+0x39, 0x30, 0x37, 0x65, 0x39, 0x62, 0x61, 0x64, 
+0x61, 0x63, 0x63, 0x31, 0x37, 0x63, 0x61, 0x31, 
+0x32, 0x39, 0x65, 0x36, 0x37, 0x61, 0x32, 0x66, 
+0x35, 0x66, 0x32, 0x66, 0x66, 0x38, 0x34, 0x33, 
+0x35, 0x31, 0x64, 0x64, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 
+0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x39, 0x33, 0x4e, 
+0x38, 0x37, 0x44, 0x36, 0x75, 0x78, 0x53, 0x42, 
+0x7a, 0x77, 0x58, 0x76, 0x70, 0x6f, 0x6b, 0x70, 
+0x7a, 0x67, 0x38, 0x46, 0x46, 0x6d, 0x66, 0x51, 
+0x50, 0x6d, 0x76, 0x58, 0x34, 0x78, 0x48, 0x6f, 
+0x57, 0x51, 0x65, 0x33, 0x70, 0x4c, 0x64, 0x59, 
+0x70, 0x62, 0x69, 0x77, 0x54, 0x35, 0x59, 0x56, 
+0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x65, 0x61, 0x35, 
+0x37, 0x37, 0x61, 0x63, 0x66, 0x62, 0x35, 0x64, 
+0x31, 0x64, 0x31, 0x34, 0x64, 0x33, 0x62, 0x37, 
+0x62, 0x31, 0x39, 0x35, 0x63, 0x33, 0x32, 0x31, 
+0x35, 0x36, 0x36, 0x66, 0x31, 0x32, 0x66, 0x38, 
+0x37, 0x64, 0x32, 0x62, 0x37, 0x37, 0x65, 0x61, 
+0x33, 0x61, 0x35, 0x33, 0x66, 0x36, 0x38, 0x64, 
+0x66, 0x37, 0x65, 0x62, 0x66, 0x38, 0x36, 0x30, 
+0x34, 0x61, 0x38, 0x30, 0x31, 0x22, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 
+0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x63, 0x4d, 
+0x78, 0x58, 0x75, 0x73, 0x53, 0x69, 0x68, 0x61, 
+0x58, 0x35, 0x38, 0x77, 0x70, 0x4a, 0x33, 0x74, 
+0x4e, 0x75, 0x75, 0x55, 0x63, 0x5a, 0x45, 0x51, 
+0x47, 0x74, 0x36, 0x44, 0x4b, 0x4a, 0x31, 0x77, 
+0x45, 0x70, 0x78, 0x79, 0x73, 0x38, 0x38, 0x46, 
+0x46, 0x61, 0x51, 0x43, 0x59, 0x6a, 0x6b, 0x75, 
+0x39, 0x68, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x30, 
+0x62, 0x33, 0x62, 0x33, 0x34, 0x66, 0x30, 0x39, 
+0x35, 0x38, 0x64, 0x38, 0x61, 0x32, 0x36, 0x38, 
+0x31, 0x39, 0x33, 0x61, 0x39, 0x38, 0x31, 0x34, 
+0x64, 0x61, 0x39, 0x32, 0x63, 0x33, 0x65, 0x38, 
+0x62, 0x35, 0x38, 0x62, 0x34, 0x61, 0x34, 0x33, 
+0x37, 0x38, 0x61, 0x35, 0x34, 0x32, 0x38, 0x36, 
+0x33, 0x65, 0x33, 0x34, 0x61, 0x63, 0x32, 0x38, 
+0x39, 0x63, 0x64, 0x38, 0x33, 0x30, 0x63, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 
+0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x31, 
+0x33, 0x70, 0x31, 0x69, 0x6a, 0x4c, 0x77, 0x73, 
+0x6e, 0x72, 0x63, 0x75, 0x79, 0x71, 0x63, 0x54, 
+0x76, 0x4a, 0x58, 0x6b, 0x71, 0x32, 0x41, 0x53, 
+0x64, 0x58, 0x71, 0x63, 0x6e, 0x45, 0x42, 0x4c, 
+0x45, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x31, 0x65, 
+0x64, 0x34, 0x36, 0x37, 0x30, 0x31, 0x37, 0x66, 
+0x30, 0x34, 0x33, 0x65, 0x39, 0x31, 0x65, 0x64, 
+0x34, 0x63, 0x34, 0x34, 0x62, 0x34, 0x65, 0x38, 
+0x64, 0x64, 0x36, 0x37, 0x34, 0x64, 0x62, 0x32, 
+0x31, 0x31, 0x63, 0x34, 0x65, 0x36, 0x22, 0x2c, 
+0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 
+0x6b, 0x65, 0x79, 0x22, 0x2c, 0x20, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x33, 0x41, 0x4c, 0x4a, 0x48, 0x39, 0x59, 0x39, 
+0x35, 0x31, 0x56, 0x43, 0x47, 0x63, 0x56, 0x5a, 
+0x59, 0x41, 0x64, 0x70, 0x41, 0x33, 0x4b, 0x63, 
+0x68, 0x6f, 0x50, 0x39, 0x4d, 0x63, 0x45, 0x6a, 
+0x31, 0x47, 0x22, 0x2c, 0x20, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x35, 
+0x65, 0x63, 0x65, 0x30, 0x63, 0x61, 0x64, 0x64, 
+0x64, 0x63, 0x34, 0x31, 0x35, 0x62, 0x31, 0x39, 
+0x38, 0x30, 0x66, 0x30, 0x30, 0x31, 0x37, 0x38, 
+0x35, 0x39, 0x34, 0x37, 0x31, 0x32, 0x30, 0x61, 
+0x63, 0x64, 0x62, 0x33, 0x36, 0x66, 0x63, 0x22, 
+0x2c, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 
+0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 
+0x72, 0x69, 0x70, 0x74, 0x22, 0x2c, 0x20, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x0a, 
+0x5d, 0x0a, 
+};};